@@ -189,6 +189,7 @@ struct CollisionRequest
     , max_cost_sources(1)
     , min_cost_density(0.2)
     , verbose(false)
+    , num_threads(1)
   {
   }
   virtual ~CollisionRequest()
@@ -225,6 +226,17 @@ struct CollisionRequest
 
   /** \brief Flag indicating whether information about detected collisions should be reported */
   bool verbose;
+
+  /** \brief Maximum number of threads that may be used to answer this single request (0 to use all cores).
+   *
+   *  Collision checkers that support it split the narrowphase checks of a query across threads, which pays off for
+   *  requests that compute many contacts, costs or distances in dense scenes. Plugins without support ignore this.
+   *
+   *  The threads are taken from a process-wide pool that runs one query at a time. If the pool is busy with another
+   *  query, or the request is issued from within a pool thread (e.g. by a parallel planner), the checks run
+   *  sequentially on the calling thread instead, so this is an upper bound rather than a guarantee. A request with
+   *  is_done set is always checked sequentially. */
+  std::size_t num_threads;
 };
 
 namespace DistanceRequestTypes
@@ -252,6 +264,7 @@ struct DistanceRequest
     , distance_threshold(std::numeric_limits<double>::max())
     , verbose(false)
     , compute_gradient(false)
+    , num_threads(1)
   {
   }
 
@@ -297,6 +310,11 @@ struct DistanceRequest
   /// Indicate if gradient should be calculated between each object.
   /// This is the normalized vector connecting the closest points on the two objects.
   bool compute_gradient;
+
+  /// Maximum number of threads that may be used to answer this single request (0 to use all cores).
+  /// Ignored by collision checkers that do not support parallel queries. As for CollisionRequest::num_threads, the
+  /// query falls back to the calling thread if the shared thread pool is busy or the query is issued from it.
+  std::size_t num_threads;
 };
 
 /** \brief Generic representation of the distance information for a pair of objects */
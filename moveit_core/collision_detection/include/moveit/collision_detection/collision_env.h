@@ -156,6 +156,13 @@ public:
                                    const moveit::core::RobotState& state1,
                                    const moveit::core::RobotState& state2) const = 0;
 
+  /** \brief Return true if the continuous (two-state) checkRobotCollision() overloads are implemented by this
+   *  environment. Callers that can fall back to discrete checks should test this before using them. */
+  virtual bool supportsContinuousCollision() const
+  {
+    return false;
+  }
+
   /** \brief The distance to self-collision given the robot is at state \e state.
       @param req A DistanceRequest object that encapsulates the distance request
       @param res A DistanceResult object that encapsulates the distance result
@@ -236,6 +243,11 @@ public:
    * Passing NULL will result in a new empty world being created. */
   virtual void setWorld(const WorldPtr& world);
 
+  /** \brief Notify the environment that the octrees of world object \e id were modified in place, e.g. by integrating
+   *  new sensor data. World does not report such changes, so environments that derive data from the octrees need to
+   *  be told. The default implementation does nothing. */
+  virtual void updateOctreeObject(const std::string& id);
+
   /** access the world geometry */
   const WorldPtr& getWorld()
   {
@@ -44,6 +44,7 @@
 #include <vector>
 #include <string>
 #include <map>
+#include <unordered_map>
 
 namespace collision_detection
 {
@@ -269,11 +270,80 @@ public:
   /** @brief Print the allowed collision matrix */
   void print(std::ostream& out) const;
 
+  /** @brief Get a number that identifies the contents of the matrix. Every modification assigns a new, process-wide
+   * unique version; copies share the version of their source. Two matrices with equal versions are identical. */
+  std::size_t getVersion() const
+  {
+    return version_;
+  }
+
 private:
+  /** @brief Assign a new version after a modification */
+  void updateVersion();
+
+  std::size_t version_;
+
   std::map<std::string, std::map<std::string, AllowedCollision::Type> > entries_;
   std::map<std::string, std::map<std::string, DecideContactFn> > allowed_contacts_;
 
   std::map<std::string, AllowedCollision::Type> default_entries_;
   std::map<std::string, DecideContactFn> default_allowed_contacts_;
 };
+
+MOVEIT_CLASS_FORWARD(CompiledAllowedCollisionMatrix);
+
+/** @class CompiledAllowedCollisionMatrix
+ *  @brief A flat snapshot of an AllowedCollisionMatrix for a fixed set of names, which are referred to by their index
+ * (ID) in that set.
+ *   Lookups by ID take constant time and give the same result as AllowedCollisionMatrix::getAllowedCollision() for
+ * the corresponding names. The entry types are stored as a bit matrix, the predicates of conditional entries in a
+ * sparse table. The snapshot does not follow later changes of the matrix; use isCurrent() to check if it needs to be
+ * compiled again. */
+class CompiledAllowedCollisionMatrix
+{
+public:
+  /** @brief Compile the entries of \e acm between all pairs of \e names. The ID of a name is its index in \e names. */
+  CompiledAllowedCollisionMatrix(const AllowedCollisionMatrix& acm, const std::vector<std::string>& names);
+
+  /** @brief Check if this is a snapshot of the current contents of \e acm */
+  bool isCurrent(const AllowedCollisionMatrix& acm) const
+  {
+    return acm.getVersion() == version_;
+  }
+
+  /** @brief Get the number of names (IDs) this matrix was compiled for */
+  std::size_t getSize() const
+  {
+    return size_;
+  }
+
+  /** @brief Get the type of the allowed collision between the elements with IDs \e id1 and \e id2. Return false if
+   * the matrix does not specify the pair. */
+  bool getAllowedCollision(std::size_t id1, std::size_t id2, AllowedCollision::Type& allowed_collision) const
+  {
+    const std::size_t bit = 2 * (id1 * size_ + id2);
+    const unsigned int entry = (bits_[bit / 64] >> (bit % 64)) & 3u;
+    if (entry == NO_ENTRY)
+      return false;
+    allowed_collision = static_cast<AllowedCollision::Type>(entry - 1);
+    return true;
+  }
+
+  /** @brief Get the allowed collision predicate between the elements with IDs \e id1 and \e id2. Return false if
+   * there is no predicate for the pair. */
+  bool getAllowedCollision(std::size_t id1, std::size_t id2, DecideContactFn& fn) const;
+
+private:
+  /** @brief The value of a pair in bits_ that has no entry; other values are AllowedCollision::Type + 1 */
+  static const unsigned int NO_ENTRY = 0;
+
+  std::size_t version_;
+  std::size_t size_;
+
+  /** @brief Two bits per ordered pair of IDs, row-major */
+  std::vector<uint64_t> bits_;
+
+  /** @brief Predicates of the conditional entries, keyed by min(id1, id2) * size_ + max(id1, id2) */
+  std::unordered_map<std::size_t, DecideContactFn> allowed_contacts_;
+};
 }  // namespace collision_detection
@@ -279,6 +279,10 @@ void CollisionEnv::updatedPaddingOrScaling(const std::vector<std::string>& links
 {
 }
 
+void CollisionEnv::updateOctreeObject(const std::string& /*id*/)
+{
+}
+
 void CollisionEnv::setWorld(const WorldPtr& world)
 {
   world_ = world;
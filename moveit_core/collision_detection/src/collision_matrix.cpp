@@ -36,15 +36,26 @@
 
 #include <moveit/collision_detection/collision_matrix.h>
 #include <boost/bind.hpp>
+#include <atomic>
 #include <iomanip>
 
 namespace collision_detection
 {
-AllowedCollisionMatrix::AllowedCollisionMatrix()
+namespace
+{
+std::size_t newVersion()
+{
+  static std::atomic<std::size_t> last_version(0);
+  return ++last_version;
+}
+}  // namespace
+
+AllowedCollisionMatrix::AllowedCollisionMatrix() : version_(newVersion())
 {
 }
 
 AllowedCollisionMatrix::AllowedCollisionMatrix(const std::vector<std::string>& names, bool allowed)
+  : version_(newVersion())
 {
   for (std::size_t i = 0; i < names.size(); ++i)
     for (std::size_t j = i; j < names.size(); ++j)
@@ -52,6 +63,7 @@ AllowedCollisionMatrix::AllowedCollisionMatrix(const std::vector<std::string>& n
 }
 
 AllowedCollisionMatrix::AllowedCollisionMatrix(const moveit_msgs::AllowedCollisionMatrix& msg)
+  : version_(newVersion())
 {
   if (msg.entry_names.size() != msg.entry_values.size() ||
       msg.default_entry_names.size() != msg.default_entry_values.size())
@@ -73,7 +85,7 @@ AllowedCollisionMatrix::AllowedCollisionMatrix(const moveit_msgs::AllowedCollisi
   }
 }
 
-AllowedCollisionMatrix::AllowedCollisionMatrix(const AllowedCollisionMatrix& acm)
+AllowedCollisionMatrix::AllowedCollisionMatrix(const AllowedCollisionMatrix& acm) : version_(acm.version_)
 {
   entries_ = acm.entries_;
   allowed_contacts_ = acm.allowed_contacts_;
@@ -122,6 +134,7 @@ bool AllowedCollisionMatrix::hasEntry(const std::string& name1, const std::strin
 
 void AllowedCollisionMatrix::setEntry(const std::string& name1, const std::string& name2, bool allowed)
 {
+  updateVersion();
   const AllowedCollision::Type v = allowed ? AllowedCollision::ALWAYS : AllowedCollision::NEVER;
   entries_[name1][name2] = entries_[name2][name1] = v;
 
@@ -144,12 +157,14 @@ void AllowedCollisionMatrix::setEntry(const std::string& name1, const std::strin
 
 void AllowedCollisionMatrix::setEntry(const std::string& name1, const std::string& name2, const DecideContactFn& fn)
 {
+  updateVersion();
   entries_[name1][name2] = entries_[name2][name1] = AllowedCollision::CONDITIONAL;
   allowed_contacts_[name1][name2] = allowed_contacts_[name2][name1] = fn;
 }
 
 void AllowedCollisionMatrix::removeEntry(const std::string& name)
 {
+  updateVersion();
   entries_.erase(name);
   allowed_contacts_.erase(name);
   for (auto& entry : entries_)
@@ -160,6 +175,7 @@ void AllowedCollisionMatrix::removeEntry(const std::string& name)
 
 void AllowedCollisionMatrix::removeEntry(const std::string& name1, const std::string& name2)
 {
+  updateVersion();
   auto jt = entries_.find(name1);
   if (jt != entries_.end())
   {
@@ -219,6 +235,7 @@ void AllowedCollisionMatrix::setEntry(const std::string& name, bool allowed)
 
 void AllowedCollisionMatrix::setEntry(bool allowed)
 {
+  updateVersion();
   const AllowedCollision::Type v = allowed ? AllowedCollision::ALWAYS : AllowedCollision::NEVER;
   for (auto& entry : entries_)
     for (auto& it2 : entry.second)
@@ -227,6 +244,7 @@ void AllowedCollisionMatrix::setEntry(bool allowed)
 
 void AllowedCollisionMatrix::setDefaultEntry(const std::string& name, bool allowed)
 {
+  updateVersion();
   const AllowedCollision::Type v = allowed ? AllowedCollision::ALWAYS : AllowedCollision::NEVER;
   default_entries_[name] = v;
   default_allowed_contacts_.erase(name);
@@ -234,6 +252,7 @@ void AllowedCollisionMatrix::setDefaultEntry(const std::string& name, bool allow
 
 void AllowedCollisionMatrix::setDefaultEntry(const std::string& name, const DecideContactFn& fn)
 {
+  updateVersion();
   default_entries_[name] = AllowedCollision::CONDITIONAL;
   default_allowed_contacts_[name] = fn;
 }
@@ -314,8 +333,14 @@ bool AllowedCollisionMatrix::getAllowedCollision(const std::string& name1, const
   }
 }
 
+void AllowedCollisionMatrix::updateVersion()
+{
+  version_ = newVersion();
+}
+
 void AllowedCollisionMatrix::clear()
 {
+  updateVersion();
   entries_.clear();
   allowed_contacts_.clear();
   default_entries_.clear();
@@ -418,4 +443,38 @@ void AllowedCollisionMatrix::print(std::ostream& out) const
   }
 }
 
+CompiledAllowedCollisionMatrix::CompiledAllowedCollisionMatrix(const AllowedCollisionMatrix& acm,
+                                                               const std::vector<std::string>& names)
+  : version_(acm.getVersion()), size_(names.size()), bits_((2 * size_ * size_ + 63) / 64, 0)
+{
+  // entries (and defaults) are symmetric, so each unordered pair is looked up once
+  for (std::size_t i = 0; i < size_; ++i)
+    for (std::size_t j = i; j < size_; ++j)
+    {
+      AllowedCollision::Type type;
+      if (acm.getAllowedCollision(names[i], names[j], type))
+      {
+        const uint64_t entry = static_cast<uint64_t>(type) + 1;
+        const std::size_t bit_ij = 2 * (i * size_ + j);
+        const std::size_t bit_ji = 2 * (j * size_ + i);
+        bits_[bit_ij / 64] |= entry << (bit_ij % 64);
+        bits_[bit_ji / 64] |= entry << (bit_ji % 64);
+      }
+
+      // a predicate may be found even if the type is not CONDITIONAL (e.g. from a default entry)
+      DecideContactFn fn;
+      if (acm.getAllowedCollision(names[i], names[j], fn))
+        allowed_contacts_[i * size_ + j] = fn;
+    }
+}
+
+bool CompiledAllowedCollisionMatrix::getAllowedCollision(std::size_t id1, std::size_t id2, DecideContactFn& fn) const
+{
+  auto it = allowed_contacts_.find(id1 < id2 ? id1 * size_ + id2 : id2 * size_ + id1);
+  if (it == allowed_contacts_.end())
+    return false;
+  fn = it->second;
+  return true;
+}
+
 }  // end of namespace collision_detection
@@ -0,0 +1,104 @@
+/*********************************************************************
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2020, PickNik LLC.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the copyright holder nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************/
+
+#include <gtest/gtest.h>
+#include <moveit/collision_detection/collision_matrix.h>
+
+using namespace collision_detection;
+
+namespace
+{
+bool allowContact(Contact& /*contact*/)
+{
+  return true;
+}
+}  // namespace
+
+TEST(CompiledAllowedCollisionMatrix, MatchesAllowedCollisionMatrix)
+{
+  const std::vector<std::string> names = { "base", "link1", "link2", "link3", "gripper", "box", "unknown" };
+
+  AllowedCollisionMatrix acm(std::vector<std::string>{ "base", "link1", "link2", "link3", "gripper" }, false);
+  acm.setEntry("base", "link1", true);
+  acm.setEntry("link1", "link2", true);
+  acm.setEntry("link3", "gripper", DecideContactFn(&allowContact));
+  acm.setDefaultEntry("box", false);
+  acm.setDefaultEntry("gripper", DecideContactFn(&allowContact));
+
+  CompiledAllowedCollisionMatrix compiled(acm, names);
+  ASSERT_EQ(compiled.getSize(), names.size());
+  EXPECT_TRUE(compiled.isCurrent(acm));
+
+  for (std::size_t i = 0; i < names.size(); ++i)
+    for (std::size_t j = 0; j < names.size(); ++j)
+    {
+      AllowedCollision::Type expected_type, type;
+      const bool expected_found = acm.getAllowedCollision(names[i], names[j], expected_type);
+      ASSERT_EQ(compiled.getAllowedCollision(i, j, type), expected_found) << names[i] << ", " << names[j];
+      if (expected_found)
+      {
+        EXPECT_EQ(type, expected_type) << names[i] << ", " << names[j];
+      }
+
+      DecideContactFn expected_fn, fn;
+      EXPECT_EQ(compiled.getAllowedCollision(i, j, fn), acm.getAllowedCollision(names[i], names[j], expected_fn))
+          << names[i] << ", " << names[j];
+    }
+}
+
+TEST(CompiledAllowedCollisionMatrix, Version)
+{
+  AllowedCollisionMatrix acm(std::vector<std::string>{ "a", "b" }, false);
+  const std::vector<std::string> names = { "a", "b" };
+  CompiledAllowedCollisionMatrix compiled(acm, names);
+
+  // copies have the same contents, and so the same version
+  AllowedCollisionMatrix copy(acm);
+  EXPECT_TRUE(compiled.isCurrent(copy));
+
+  acm.setEntry("a", "b", true);
+  EXPECT_FALSE(compiled.isCurrent(acm));
+  EXPECT_TRUE(compiled.isCurrent(copy));
+  EXPECT_NE(AllowedCollisionMatrix().getVersion(), AllowedCollisionMatrix().getVersion());
+
+  AllowedCollision::Type type;
+  ASSERT_TRUE(CompiledAllowedCollisionMatrix(acm, names).getAllowedCollision(0, 1, type));
+  EXPECT_EQ(type, AllowedCollision::ALWAYS);
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -73,6 +73,10 @@ struct ContactTestData
   collision_detection::CollisionResult& res;
   const collision_detection::CollisionRequest& req;
 
+  /** \brief Set for distance queries, which store their results here instead of in \e res */
+  collision_detection::DistanceResult* distance_res{ nullptr };
+  const collision_detection::DistanceRequest* distance_req{ nullptr };
+
   /// Indicates if search is finished
   bool done;
 
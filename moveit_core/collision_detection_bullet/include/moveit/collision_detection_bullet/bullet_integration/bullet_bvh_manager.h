@@ -64,7 +64,7 @@ public:
   /**@brief Remove an object from the checker
    * @param name The name of the object
    * @return true if successfully removed, otherwise false. */
-  bool removeCollisionObject(const std::string& name);
+  virtual bool removeCollisionObject(const std::string& name);
 
   /**@brief Enable an object
    * @param name The name of the object
@@ -77,6 +77,9 @@ public:
   bool disableCollisionObject(const std::string& name);
 
   /**@brief Set a single static collision object's tansform
+   *
+   * The broadphase is only updated if the transform differs from the current one.
+   *
    * @param name The name of the object
    * @param pose The tranformation in world */
   void setCollisionObjectsTransform(const std::string& name, const Eigen::Isometry3d& pose);
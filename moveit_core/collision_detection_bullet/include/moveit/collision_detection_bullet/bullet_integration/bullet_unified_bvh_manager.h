@@ -0,0 +1,137 @@
+/*********************************************************************
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2020, PickNik LLC.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the copyright holder nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************/
+
+#pragma once
+
+#include <moveit/collision_detection_bullet/bullet_integration/bullet_utils.h>
+#include <moveit/collision_detection_bullet/bullet_integration/bullet_bvh_manager.h>
+#include <moveit/macros/class_forward.h>
+
+namespace collision_detection_bullet
+{
+MOVEIT_CLASS_FORWARD(BulletUnifiedBVHManager)
+
+/** @brief A bounding volume hierarchy (BVH) manager answering both discrete and continuous (cast) contact tests
+ *
+ *  BulletDiscreteBVHManager and BulletCastBVHManager each hold their own copy of every collision object and their own
+ *  broadphase. This manager registers every object once. For a cast query, the collision shape of each moving object
+ *  is swapped for a cast hull shape wrapping the same convex shapes and its broadphase AABB is grown to cover the
+ *  motion; the next discrete query swaps the original shape back. The cast shapes are created on first use and kept
+ *  until the object is removed, and static objects are never modified by a query. */
+class BulletUnifiedBVHManager : public BulletBVHManager
+{
+public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  /** \brief Constructor */
+  BulletUnifiedBVHManager() = default;
+
+  ~BulletUnifiedBVHManager() override;
+
+  /**@brief Clone the manager
+   *
+   * This is to be used for multi threaded applications. A user should make a clone for each thread. */
+  BulletUnifiedBVHManagerPtr clone() const;
+
+  bool removeCollisionObject(const std::string& name) override;
+
+  /**@brief Set a single cast (moving) collision object's tansforms for the next call to castContactTest()
+   *
+   * This should only be used for moving objects.
+   *
+   * @param name The name of the object
+   * @param pose1 The start tranformation in world
+   * @param pose2 The end tranformation in world */
+  void setCastCollisionObjectsTransform(const std::string& name, const Eigen::Isometry3d& pose1,
+                                        const Eigen::Isometry3d& pose2);
+
+  /**@brief Perform a discrete contact test for all objects at their transforms
+   * @param collisions The Contact results data
+   * @param req The collision request data
+   * @param acm The allowed collision matrix
+   * @param self Used for indicating self collision checks */
+  void contactTest(collision_detection::CollisionResult& collisions, const collision_detection::CollisionRequest& req,
+                   const collision_detection::AllowedCollisionMatrix* acm, bool self) override;
+
+  /**@brief Perform a continuous contact test of the objects moved by setCastCollisionObjectsTransform() against the
+   * static objects
+   * @param collisions The Contact results data
+   * @param req The collision request data
+   * @param acm The allowed collision matrix */
+  void castContactTest(collision_detection::CollisionResult& collisions,
+                       const collision_detection::CollisionRequest& req,
+                       const collision_detection::AllowedCollisionMatrix* acm);
+
+  /**@brief Perform a discrete distance test for all objects at their transforms
+   *
+   * Only pairs closer than the contact distance threshold are reported.
+   *
+   * @param res The distance results data
+   * @param req The distance request data, its acm is used to skip pairs
+   * @param active_components Only pairs with at least one of these objects are checked, all pairs if empty
+   * @param self Used for indicating self distance checks */
+  void distanceTest(collision_detection::DistanceResult& res, const collision_detection::DistanceRequest& req,
+                    const std::vector<std::string>& active_components, bool self);
+
+  /**@brief Add a bullet collision object to the manager
+   * @param cow The bullet collision object */
+  void addCollisionObject(const CollisionObjectWrapperPtr& cow) override;
+
+private:
+  /** \brief The shapes a moving object is checked with in discrete and in cast queries */
+  struct CastShapes
+  {
+    /** \brief Owns the cast hull shapes, which refer to the convex shapes of the discrete shape */
+    CollisionObjectWrapperPtr cast_cow;
+
+    /** \brief The shape the object was added with */
+    btCollisionShape* discrete_shape;
+  };
+
+  /** \brief Switch \e cow to its cast shape, moving from \e tf1 to \e tf2 */
+  void setCastTransform(const CollisionObjectWrapperPtr& cow, const btTransform& tf1, const btTransform& tf2);
+
+  /** \brief Make \e cow use \e shape, dropping collision algorithms cached for its previous shape */
+  void setCollisionShape(CollisionObjectWrapper& cow, btCollisionShape* shape);
+
+  /** \brief Give all objects moved by setCastCollisionObjectsTransform() their discrete shapes back */
+  void restoreDiscreteShapes();
+
+  /** \brief Cast shapes of the objects that were used in cast queries */
+  std::map<std::string, CastShapes> cast_shapes_;
+
+  /** \brief Names of the objects that currently use their cast shape */
+  std::vector<std::string> casting_;
+};
+}  // namespace collision_detection_bullet
@@ -451,6 +451,31 @@ inline btScalar addDiscreteSingleResult(btManifoldPoint& cp, const btCollisionOb
   return 1;
 }
 
+/** \brief Converts a bullet closest point result to a MoveIt distance result and adds it to the distance result */
+inline btScalar addDistanceSingleResult(btManifoldPoint& cp, const btCollisionObjectWrapper* colObj0Wrap,
+                                        const btCollisionObjectWrapper* colObj1Wrap, ContactTestData& collisions)
+{
+  assert(dynamic_cast<const CollisionObjectWrapper*>(colObj0Wrap->getCollisionObject()) != nullptr);
+  assert(dynamic_cast<const CollisionObjectWrapper*>(colObj1Wrap->getCollisionObject()) != nullptr);
+  const CollisionObjectWrapper* cd0 = static_cast<const CollisionObjectWrapper*>(colObj0Wrap->getCollisionObject());
+  const CollisionObjectWrapper* cd1 = static_cast<const CollisionObjectWrapper*>(colObj1Wrap->getCollisionObject());
+
+  collision_detection::DistanceResultsData dist_result;
+  dist_result.distance = static_cast<double>(cp.m_distance1);
+  dist_result.link_names[0] = cd0->getName();
+  dist_result.link_names[1] = cd1->getName();
+  dist_result.body_types[0] = cd0->getTypeID();
+  dist_result.body_types[1] = cd1->getTypeID();
+  dist_result.nearest_points[0] = convertBtToEigen(cp.m_positionWorldOnA);
+  dist_result.nearest_points[1] = convertBtToEigen(cp.m_positionWorldOnB);
+
+  // bullet's normal points from B to A, also for penetrating objects
+  dist_result.normal = convertBtToEigen(-1 * cp.m_normalWorldOnB);
+
+  processDistanceResult(collisions, dist_result, getObjectPairKey(cd0->getName(), cd1->getName()));
+  return 1;
+}
+
 inline btScalar addCastSingleResult(btManifoldPoint& cp, const btCollisionObjectWrapper* colObj0Wrap, int /*index0*/,
                                     const btCollisionObjectWrapper* colObj1Wrap, int /*index1*/,
                                     ContactTestData& collisions)
@@ -591,6 +616,13 @@ struct BroadphaseContactResultCallback
     {
       return !collisions_.done && !isOnlyKinematic(cow0, cow1) && !acmCheck(cow0->getName(), cow1->getName(), acm_);
     }
+    else if (collisions_.distance_req)
+    {
+      // distances are only computed for pairs with at least one active object
+      return !collisions_.done && (self_ ? isOnlyKinematic(cow0, cow1) : !isOnlyKinematic(cow0, cow1)) &&
+             (isLinkActive(collisions_.active, cow0->getName()) || isLinkActive(collisions_.active, cow1->getName())) &&
+             !acmCheck(cow0->getName(), cow1->getName(), acm_);
+    }
     else
     {
       return !collisions_.done && (self_ ? isOnlyKinematic(cow0, cow1) : !isOnlyKinematic(cow0, cow1)) &&
@@ -612,6 +644,10 @@ struct BroadphaseContactResultCallback
     {
       return addCastSingleResult(cp, colObj0Wrap, index0, colObj1Wrap, index1, collisions_);
     }
+    else if (collisions_.distance_req)
+    {
+      return addDistanceSingleResult(cp, colObj0Wrap, colObj1Wrap, collisions_);
+    }
     else
     {
       return addDiscreteSingleResult(cp, colObj0Wrap, colObj1Wrap, collisions_);
@@ -877,6 +913,57 @@ inline CollisionObjectWrapperPtr makeCastCollisionObject(const CollisionObjectWr
   return new_cow;
 }
 
+/** @brief Update the cast hull shapes created by makeCastCollisionObject() for a motion of their object
+ *  @param shape The cast collision shape, either a cast hull or a compound of cast hulls
+ *  @param tf1 The start transformation of the object in world
+ *  @param tf2 The end transformation of the object in world */
+inline void updateCastShapeTransforms(btCollisionShape* shape, const btTransform& tf1, const btTransform& tf2)
+{
+  if (btBroadphaseProxy::isConvex(shape->getShapeType()))
+  {
+    static_cast<CastHullShape*>(shape)->updateCastTransform(tf1.inverseTimes(tf2));
+  }
+  else if (btBroadphaseProxy::isCompound(shape->getShapeType()))
+  {
+    btCompoundShape* compound = static_cast<btCompoundShape*>(shape);
+
+    for (int i = 0; i < compound->getNumChildShapes(); ++i)
+    {
+      if (btBroadphaseProxy::isConvex(compound->getChildShape(i)->getShapeType()))
+      {
+        const btTransform& local_tf = compound->getChildTransform(i);
+
+        btTransform delta_tf = (tf1 * local_tf).inverseTimes(tf2 * local_tf);
+        static_cast<CastHullShape*>(compound->getChildShape(i))->updateCastTransform(delta_tf);
+        compound->updateChildTransform(i, local_tf, false);  // This is required to update the BVH tree
+      }
+      else if (btBroadphaseProxy::isCompound(compound->getChildShape(i)->getShapeType()))
+      {
+        btCompoundShape* second_compound = static_cast<btCompoundShape*>(compound->getChildShape(i));
+
+        for (int j = 0; j < second_compound->getNumChildShapes(); ++j)
+        {
+          assert(!btBroadphaseProxy::isCompound(second_compound->getChildShape(j)->getShapeType()));
+          const btTransform& local_tf = second_compound->getChildTransform(j);
+
+          btTransform delta_tf = (tf1 * local_tf).inverseTimes(tf2 * local_tf);
+          static_cast<CastHullShape*>(second_compound->getChildShape(j))->updateCastTransform(delta_tf);
+          second_compound->updateChildTransform(j, local_tf, false);  // This is required to update the BVH tree
+        }
+        second_compound->recalculateLocalAabb();
+      }
+    }
+    compound->recalculateLocalAabb();
+  }
+  else
+  {
+    ROS_ERROR_NAMED("collision_detection.bullet",
+                    "I can only continuous collision check convex shapes and compound shapes made of convex shapes");
+    throw std::runtime_error(
+        "I can only continuous collision check convex shapes and compound shapes made of convex shapes");
+  }
+}
+
 /** @brief Update the Broadphase AABB for the input collision object
  *  @param cow The collision objects
  *  @param broadphase The bullet broadphase interface
@@ -135,6 +135,49 @@ inline collision_detection::Contact* processResult(ContactTestData& cdata, colli
   return nullptr;
 }
 
+/** \brief Stores a single distance result according to the type of the distance request in \e cdata.
+*   \param key The sorted names of the two objects */
+inline void processDistanceResult(ContactTestData& cdata, const collision_detection::DistanceResultsData& dist_result,
+                                  const std::pair<std::string, std::string>& key)
+{
+  const collision_detection::DistanceRequest& req = *cdata.distance_req;
+  collision_detection::DistanceResult& res = *cdata.distance_res;
+
+  if (dist_result.distance < res.minimum_distance.distance)
+    res.minimum_distance = dist_result;
+
+  if (dist_result.distance <= 0)
+    res.collision = true;
+
+  if (req.type != collision_detection::DistanceRequestType::GLOBAL)
+  {
+    auto it = res.distances.find(key);
+    if (it == res.distances.end())
+    {
+      std::vector<collision_detection::DistanceResultsData> data;
+      data.reserve(req.type == collision_detection::DistanceRequestType::SINGLE ? 1 : req.max_contacts_per_body);
+      data.push_back(dist_result);
+      it = res.distances.insert(std::make_pair(key, data)).first;
+    }
+    else if (req.type == collision_detection::DistanceRequestType::SINGLE)
+    {
+      if (dist_result.distance < it->second[0].distance)
+        it->second[0] = dist_result;
+    }
+    else
+    {
+      it->second.push_back(dist_result);
+    }
+
+    if (req.type == collision_detection::DistanceRequestType::LIMITED && it->second.size() >= req.max_contacts_per_body)
+      cdata.pair_done = true;
+  }
+
+  // without signed distances, the distance of colliding objects is not meaningful
+  if (!req.enable_signed_distance && res.collision)
+    cdata.done = true;
+}
+
 /**
  * @brief Create a convex hull from vertices using Bullet Convex Hull Computer
  * @param (Output) vertices A vector of vertices
@@ -37,8 +37,7 @@
 #pragma once
 
 #include <moveit/collision_detection/collision_env.h>
-#include <moveit/collision_detection_bullet/bullet_integration/bullet_discrete_bvh_manager.h>
-#include <moveit/collision_detection_bullet/bullet_integration/bullet_cast_bvh_manager.h>
+#include <moveit/collision_detection_bullet/bullet_integration/bullet_unified_bvh_manager.h>
 
 namespace collision_detection
 {
@@ -77,6 +76,11 @@ public:
   void checkRobotCollision(const CollisionRequest& req, CollisionResult& res, const moveit::core::RobotState& state1,
                            const moveit::core::RobotState& state2, const AllowedCollisionMatrix& acm) const override;
 
+  bool supportsContinuousCollision() const override
+  {
+    return true;
+  }
+
   void distanceSelf(const DistanceRequest& req, DistanceResult& res,
                     const moveit::core::RobotState& state) const override;
 
@@ -88,7 +92,7 @@ public:
 protected:
   /** \brief Updates the poses of the objects in the manager according to given robot state */
   void updateTransformsFromState(const moveit::core::RobotState& state,
-                                 const collision_detection_bullet::BulletDiscreteBVHManagerPtr& manager) const;
+                                 const collision_detection_bullet::BulletUnifiedBVHManagerPtr& manager) const;
 
   /** \brief Updates the collision objects saved in the manager to reflect a new padding or scaling of the robot links
    */
@@ -109,20 +113,20 @@ protected:
   void checkRobotCollisionHelper(const CollisionRequest& req, CollisionResult& res,
                                  const moveit::core::RobotState& state, const AllowedCollisionMatrix* acm) const;
 
+  /** \brief Bundles distanceSelf and distanceRobot into a single function */
+  void distanceHelper(const DistanceRequest& req, DistanceResult& res, const moveit::core::RobotState& state,
+                      bool self) const;
+
   /** \brief Construts a bullet collision object out of a robot link */
   void addLinkAsCollisionObject(const urdf::LinkSharedPtr& link);
 
-  /** \brief Handles self collision checks */
-  mutable collision_detection_bullet::BulletDiscreteBVHManagerPtr manager_{
-    new collision_detection_bullet::BulletDiscreteBVHManager()
-  };
-
-  /** \brief Handles continuous robot world collision checks */
-  mutable collision_detection_bullet::BulletCastBVHManagerPtr manager_CCD_{
-    new collision_detection_bullet::BulletCastBVHManager()
+  /** \brief Handles discrete self and robot world collision checks as well as continuous robot world collision checks
+   */
+  mutable collision_detection_bullet::BulletUnifiedBVHManagerPtr manager_{
+    new collision_detection_bullet::BulletUnifiedBVHManager()
   };
 
-  /** \brief Adds a world object to the collision managers */
+  /** \brief Adds a world object to the collision manager */
   void addToManager(const World::Object* obj);
 
   /** \brief Updates a managed collision object with its world representation.
@@ -113,6 +113,8 @@ void BulletBVHManager::setCollisionObjectsTransform(const std::string& name, con
   {
     CollisionObjectWrapperPtr& cow = it->second;
     btTransform tf = convertEigenToBt(pose);
+    if (tf == cow->getWorldTransform())
+      return;
     cow->setWorldTransform(tf);
 
     // Now update Broadphase AABB (See BulletWorld updateSingleAabb function)
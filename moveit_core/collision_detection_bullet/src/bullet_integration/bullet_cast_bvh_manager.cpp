@@ -79,50 +79,7 @@ void BulletCastBVHManager::setCastCollisionObjectsTransform(const std::string& n
     // If collision object is disabled dont proceed
     if (cow->m_enabled)
     {
-      if (btBroadphaseProxy::isConvex(cow->getCollisionShape()->getShapeType()))
-      {
-        static_cast<CastHullShape*>(cow->getCollisionShape())->updateCastTransform(tf1.inverseTimes(tf2));
-      }
-      else if (btBroadphaseProxy::isCompound(cow->getCollisionShape()->getShapeType()))
-      {
-        btCompoundShape* compound = static_cast<btCompoundShape*>(cow->getCollisionShape());
-
-        for (int i = 0; i < compound->getNumChildShapes(); ++i)
-        {
-          if (btBroadphaseProxy::isConvex(compound->getChildShape(i)->getShapeType()))
-          {
-            const btTransform& local_tf = compound->getChildTransform(i);
-
-            btTransform delta_tf = (tf1 * local_tf).inverseTimes(tf2 * local_tf);
-            static_cast<CastHullShape*>(compound->getChildShape(i))->updateCastTransform(delta_tf);
-            compound->updateChildTransform(i, local_tf, false);  // This is required to update the BVH tree
-          }
-          else if (btBroadphaseProxy::isCompound(compound->getChildShape(i)->getShapeType()))
-          {
-            btCompoundShape* second_compound = static_cast<btCompoundShape*>(compound->getChildShape(i));
-
-            for (int j = 0; j < second_compound->getNumChildShapes(); ++j)
-            {
-              assert(!btBroadphaseProxy::isCompound(second_compound->getChildShape(j)->getShapeType()));
-              const btTransform& local_tf = second_compound->getChildTransform(j);
-
-              btTransform delta_tf = (tf1 * local_tf).inverseTimes(tf2 * local_tf);
-              static_cast<CastHullShape*>(second_compound->getChildShape(j))->updateCastTransform(delta_tf);
-              second_compound->updateChildTransform(j, local_tf, false);  // This is required to update the BVH tree
-            }
-            second_compound->recalculateLocalAabb();
-          }
-        }
-        compound->recalculateLocalAabb();
-      }
-      else
-      {
-        ROS_ERROR_NAMED(
-            "collision_detection.bullet",
-            "I can only continuous collision check convex shapes and compound shapes made of convex shapes");
-        throw std::runtime_error(
-            "I can only continuous collision check convex shapes and compound shapes made of convex shapes");
-      }
+      updateCastShapeTransforms(cow->getCollisionShape(), tf1, tf2);
 
       // Now update Broadphase AABB (See BulletWorld updateSingleAabb function)
       updateBroadphaseAABB(cow, broadphase_, dispatcher_);
@@ -0,0 +1,240 @@
+/*********************************************************************
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2020, PickNik LLC.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the copyright holder nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************/
+
+#include <moveit/collision_detection_bullet/bullet_integration/bullet_unified_bvh_manager.h>
+#include <algorithm>
+#include <utility>
+
+namespace collision_detection_bullet
+{
+BulletUnifiedBVHManager::~BulletUnifiedBVHManager()
+{
+  // the base class removes the objects from the broadphase, when the cast shapes are already gone
+  restoreDiscreteShapes();
+}
+
+BulletUnifiedBVHManagerPtr BulletUnifiedBVHManager::clone() const
+{
+  BulletUnifiedBVHManagerPtr manager(new BulletUnifiedBVHManager());
+
+  for (const std::pair<const std::string, CollisionObjectWrapperPtr>& cow : link2cow_)
+  {
+    CollisionObjectWrapperPtr new_cow = cow.second->clone();
+
+    // the clone creates its own cast shapes when needed
+    auto shapes = cast_shapes_.find(cow.first);
+    if (shapes != cast_shapes_.end())
+      new_cow->setCollisionShape(shapes->second.discrete_shape);
+
+    assert(new_cow->getCollisionShape());
+    assert(new_cow->getCollisionShape()->getShapeType() != CUSTOM_CONVEX_SHAPE_TYPE);
+
+    new_cow->setWorldTransform(cow.second->getWorldTransform());
+    new_cow->setContactProcessingThreshold(static_cast<btScalar>(contact_distance_));
+    manager->addCollisionObject(new_cow);
+  }
+
+  manager->setActiveCollisionObjects(active_);
+  manager->setContactDistanceThreshold(contact_distance_);
+
+  return manager;
+}
+
+bool BulletUnifiedBVHManager::removeCollisionObject(const std::string& name)
+{
+  auto shapes = cast_shapes_.find(name);
+  if (shapes != cast_shapes_.end())
+  {
+    auto it = link2cow_.find(name);
+    if (it != link2cow_.end())
+      setCollisionShape(*it->second, shapes->second.discrete_shape);
+    casting_.erase(std::remove(casting_.begin(), casting_.end(), name), casting_.end());
+    cast_shapes_.erase(shapes);
+  }
+
+  return BulletBVHManager::removeCollisionObject(name);
+}
+
+void BulletUnifiedBVHManager::setCastCollisionObjectsTransform(const std::string& name,
+                                                               const Eigen::Isometry3d& pose1,
+                                                               const Eigen::Isometry3d& pose2)
+{
+  auto it = link2cow_.find(name);
+  if (it == link2cow_.end())
+    return;
+
+  setCastTransform(it->second, convertEigenToBt(pose1), convertEigenToBt(pose2));
+}
+
+void BulletUnifiedBVHManager::contactTest(collision_detection::CollisionResult& collisions,
+                                          const collision_detection::CollisionRequest& req,
+                                          const collision_detection::AllowedCollisionMatrix* acm, bool self)
+{
+  restoreDiscreteShapes();
+
+  ContactTestData cdata(active_, contact_distance_, collisions, req);
+
+  broadphase_->calculateOverlappingPairs(dispatcher_.get());
+  btOverlappingPairCache* pair_cache = broadphase_->getOverlappingPairCache();
+
+  ROS_DEBUG_STREAM_NAMED("collision_detection.bullet", "Num overlapping candidates "
+                                                           << pair_cache->getNumOverlappingPairs());
+
+  BroadphaseContactResultCallback cc(cdata, contact_distance_, acm, self);
+  TesseractCollisionPairCallback collision_callback(dispatch_info_, dispatcher_.get(), cc);
+  pair_cache->processAllOverlappingPairs(&collision_callback, dispatcher_.get());
+
+  ROS_DEBUG_STREAM_NAMED("collision_detection.bullet", (collisions.collision ? "In" : "No") << " collision with "
+                                                                                            << collisions.contact_count
+                                                                                            << " collisions");
+}
+
+void BulletUnifiedBVHManager::distanceTest(collision_detection::DistanceResult& res,
+                                           const collision_detection::DistanceRequest& req,
+                                           const std::vector<std::string>& active_components, bool self)
+{
+  restoreDiscreteShapes();
+
+  // the collision request and result are not used by distance queries
+  collision_detection::CollisionRequest collision_req;
+  collision_detection::CollisionResult collision_res;
+  ContactTestData cdata(active_components, contact_distance_, collision_res, collision_req);
+  cdata.distance_req = &req;
+  cdata.distance_res = &res;
+
+  broadphase_->calculateOverlappingPairs(dispatcher_.get());
+  btOverlappingPairCache* pair_cache = broadphase_->getOverlappingPairCache();
+
+  ROS_DEBUG_STREAM_NAMED("collision_detection.bullet", "Num overlapping candidates "
+                                                           << pair_cache->getNumOverlappingPairs());
+
+  BroadphaseContactResultCallback cc(cdata, contact_distance_, req.acm, self);
+  TesseractCollisionPairCallback collision_callback(dispatch_info_, dispatcher_.get(), cc);
+  pair_cache->processAllOverlappingPairs(&collision_callback, dispatcher_.get());
+
+  ROS_DEBUG_STREAM_NAMED("collision_detection.bullet", "Minimum distance " << res.minimum_distance.distance);
+}
+
+void BulletUnifiedBVHManager::castContactTest(collision_detection::CollisionResult& collisions,
+                                              const collision_detection::CollisionRequest& req,
+                                              const collision_detection::AllowedCollisionMatrix* acm)
+{
+  // moving objects without a cast transform for this query stay where they are; the cast callback needs cast shapes
+  for (std::pair<const std::string, CollisionObjectWrapperPtr>& cow : link2cow_)
+  {
+    if (cow.second->m_collisionFilterGroup == btBroadphaseProxy::KinematicFilter && cow.second->m_enabled &&
+        std::find(casting_.begin(), casting_.end(), cow.first) == casting_.end())
+      setCastTransform(cow.second, cow.second->getWorldTransform(), cow.second->getWorldTransform());
+  }
+
+  ContactTestData cdata(active_, contact_distance_, collisions, req);
+
+  broadphase_->calculateOverlappingPairs(dispatcher_.get());
+  btOverlappingPairCache* pair_cache = broadphase_->getOverlappingPairCache();
+
+  ROS_DEBUG_STREAM_NAMED("collision_detection.bullet", "Number overlapping candidates "
+                                                           << pair_cache->getNumOverlappingPairs());
+
+  BroadphaseContactResultCallback cc(cdata, contact_distance_, acm, false, true);
+  TesseractCollisionPairCallback collision_callback(dispatch_info_, dispatcher_.get(), cc);
+  pair_cache->processAllOverlappingPairs(&collision_callback, dispatcher_.get());
+}
+
+void BulletUnifiedBVHManager::addCollisionObject(const CollisionObjectWrapperPtr& cow)
+{
+  if (hasCollisionObject(cow->getName()))
+    removeCollisionObject(cow->getName());
+
+  cow->setContactProcessingThreshold(static_cast<btScalar>(contact_distance_));
+  link2cow_[cow->getName()] = cow;
+  addCollisionObjectToBroadphase(cow, broadphase_, dispatcher_);
+}
+
+void BulletUnifiedBVHManager::setCastTransform(const CollisionObjectWrapperPtr& cow, const btTransform& tf1,
+                                               const btTransform& tf2)
+{
+  assert(cow->m_collisionFilterGroup == btBroadphaseProxy::KinematicFilter);
+  cow->setWorldTransform(tf1);
+
+  // If collision object is disabled dont proceed
+  if (!cow->m_enabled)
+    return;
+
+  auto shapes = cast_shapes_.find(cow->getName());
+  if (shapes == cast_shapes_.end())
+  {
+    CastShapes cast_shapes;
+    cast_shapes.discrete_shape = cow->getCollisionShape();
+    cast_shapes.cast_cow = makeCastCollisionObject(cow);
+    shapes = cast_shapes_.insert(std::make_pair(cow->getName(), cast_shapes)).first;
+  }
+
+  btCollisionShape* cast_shape = shapes->second.cast_cow->getCollisionShape();
+  if (cow->getCollisionShape() != cast_shape)
+  {
+    setCollisionShape(*cow, cast_shape);
+    casting_.push_back(cow->getName());
+  }
+
+  updateCastShapeTransforms(cast_shape, tf1, tf2);
+
+  // Now update Broadphase AABB (See BulletWorld updateSingleAabb function)
+  updateBroadphaseAABB(cow, broadphase_, dispatcher_);
+}
+
+void BulletUnifiedBVHManager::setCollisionShape(CollisionObjectWrapper& cow, btCollisionShape* shape)
+{
+  // the dispatcher keeps collision algorithms in the overlapping pairs, which are specific to the shapes
+  if (cow.getBroadphaseHandle())
+    broadphase_->getOverlappingPairCache()->cleanProxyFromPairs(cow.getBroadphaseHandle(), dispatcher_.get());
+  cow.setCollisionShape(shape);
+}
+
+void BulletUnifiedBVHManager::restoreDiscreteShapes()
+{
+  for (const std::string& name : casting_)
+  {
+    auto it = link2cow_.find(name);
+    if (it == link2cow_.end())
+      continue;
+
+    CollisionObjectWrapperPtr& cow = it->second;
+    setCollisionShape(*cow, cast_shapes_[name].discrete_shape);
+    if (cow->getBroadphaseHandle())
+      updateBroadphaseAABB(cow, broadphase_, dispatcher_);
+  }
+  casting_.clear();
+}
+
+}  // namespace collision_detection_bullet
@@ -39,6 +39,7 @@
 #include <moveit/collision_detection_bullet/bullet_integration/ros_bullet_utils.h>
 #include <moveit/collision_detection_bullet/bullet_integration/contact_checker_common.h>
 #include <boost/bind.hpp>
+#include <algorithm>
 #include <bullet/btBulletCollisionCommon.h>
 
 namespace collision_detection
@@ -46,6 +47,25 @@ namespace collision_detection
 const std::string CollisionDetectorAllocatorBullet::NAME("Bullet");
 const double MAX_DISTANCE_MARGIN = 99;
 
+namespace
+{
+/** \brief Set the contact distance of \e manager for the next query. All objects are only updated if the contact
+ *  distance changes. */
+void setContactDistanceThreshold(collision_detection_bullet::BulletBVHManager& manager, double contact_distance)
+{
+  if (manager.getContactDistanceThreshold() != contact_distance)
+    manager.setContactDistanceThreshold(contact_distance);
+}
+
+/** \brief Set the contact distance of \e manager for a collision query that does (not) compute \e distance */
+void setContactDistanceThreshold(collision_detection_bullet::BulletBVHManager& manager, bool distance)
+{
+  setContactDistanceThreshold(manager, distance ? MAX_DISTANCE_MARGIN :
+                                                  static_cast<double>(
+                                                      collision_detection_bullet::BULLET_DEFAULT_CONTACT_DISTANCE));
+}
+}  // namespace
+
 CollisionEnvBullet::CollisionEnvBullet(const moveit::core::RobotModelConstPtr& model, double padding, double scale)
   : CollisionEnv(model, padding, scale)
 {
@@ -112,10 +132,7 @@ void CollisionEnvBullet::checkSelfCollisionHelper(const CollisionRequest& req, C
   std::vector<collision_detection_bullet::CollisionObjectWrapperPtr> cows;
   addAttachedOjects(state, cows);
 
-  if (req.distance)
-  {
-    manager_->setContactDistanceThreshold(MAX_DISTANCE_MARGIN);
-  }
+  setContactDistanceThreshold(*manager_, req.distance);
 
   for (const collision_detection_bullet::CollisionObjectWrapperPtr& cow : cows)
   {
@@ -170,10 +187,7 @@ void CollisionEnvBullet::checkRobotCollisionHelper(const CollisionRequest& req,
                                                    const moveit::core::RobotState& state,
                                                    const AllowedCollisionMatrix* acm) const
 {
-  if (req.distance)
-  {
-    manager_->setContactDistanceThreshold(MAX_DISTANCE_MARGIN);
-  }
+  setContactDistanceThreshold(*manager_, req.distance);
 
   std::vector<collision_detection_bullet::CollisionObjectWrapperPtr> attached_cows;
   addAttachedOjects(state, attached_cows);
@@ -199,41 +213,88 @@ void CollisionEnvBullet::checkRobotCollisionHelperCCD(const CollisionRequest& re
                                                       const moveit::core::RobotState& state2,
                                                       const AllowedCollisionMatrix* acm) const
 {
+  // distances are not computed along a motion
+  setContactDistanceThreshold(*manager_, false);
+
   std::vector<collision_detection_bullet::CollisionObjectWrapperPtr> attached_cows;
   addAttachedOjects(state1, attached_cows);
 
   for (const collision_detection_bullet::CollisionObjectWrapperPtr& cow : attached_cows)
   {
-    manager_CCD_->addCollisionObject(cow);
-    manager_CCD_->setCastCollisionObjectsTransform(
+    manager_->addCollisionObject(cow);
+    manager_->setCastCollisionObjectsTransform(
         cow->getName(), state1.getAttachedBody(cow->getName())->getGlobalCollisionBodyTransforms()[0],
         state2.getAttachedBody(cow->getName())->getGlobalCollisionBodyTransforms()[0]);
   }
 
   for (const std::string& link : active_)
   {
-    manager_CCD_->setCastCollisionObjectsTransform(link, state1.getCollisionBodyTransform(link, 0),
-                                                   state2.getCollisionBodyTransform(link, 0));
+    manager_->setCastCollisionObjectsTransform(link, state1.getCollisionBodyTransform(link, 0),
+                                               state2.getCollisionBodyTransform(link, 0));
   }
 
-  manager_CCD_->contactTest(res, req, acm, false);
+  manager_->castContactTest(res, req, acm);
 
   for (const collision_detection_bullet::CollisionObjectWrapperPtr& cow : attached_cows)
   {
-    manager_CCD_->removeCollisionObject(cow->getName());
+    manager_->removeCollisionObject(cow->getName());
   }
 }
 
 void CollisionEnvBullet::distanceSelf(const DistanceRequest& req, DistanceResult& res,
                                       const moveit::core::RobotState& state) const
 {
-  ROS_INFO_NAMED("collision_detection.bullet", "Distance to self not implemented yet.");
+  distanceHelper(req, res, state, true);
 }
 
 void CollisionEnvBullet::distanceRobot(const DistanceRequest& req, DistanceResult& res,
                                        const moveit::core::RobotState& state) const
 {
-  ROS_INFO_NAMED("collision_detection.bullet", "Distance to self not implemented yet.");
+  distanceHelper(req, res, state, false);
+}
+
+void CollisionEnvBullet::distanceHelper(const DistanceRequest& req, DistanceResult& res,
+                                        const moveit::core::RobotState& state, bool self) const
+{
+  // the manager identifies objects by name, attached bodies are active if the link they are attached to is
+  std::vector<std::string> active_components;
+  if (req.active_components_only)
+  {
+    if (req.active_components_only->empty())
+      return;
+
+    for (const moveit::core::LinkModel* link : *req.active_components_only)
+      active_components.push_back(link->getName());
+
+    std::vector<const moveit::core::AttachedBody*> attached_bodies;
+    state.getAttachedBodies(attached_bodies);
+    for (const moveit::core::AttachedBody* body : attached_bodies)
+    {
+      if (req.active_components_only->count(body->getAttachedLink()))
+        active_components.push_back(body->getName());
+    }
+  }
+
+  // pairs further apart than the contact distance are not reported by bullet
+  setContactDistanceThreshold(*manager_, std::min(req.distance_threshold, MAX_DISTANCE_MARGIN));
+
+  std::vector<collision_detection_bullet::CollisionObjectWrapperPtr> attached_cows;
+  addAttachedOjects(state, attached_cows);
+  updateTransformsFromState(state, manager_);
+
+  for (const collision_detection_bullet::CollisionObjectWrapperPtr& cow : attached_cows)
+  {
+    manager_->addCollisionObject(cow);
+    manager_->setCollisionObjectsTransform(
+        cow->getName(), state.getAttachedBody(cow->getName())->getGlobalCollisionBodyTransforms()[0]);
+  }
+
+  manager_->distanceTest(res, req, active_components, self);
+
+  for (const collision_detection_bullet::CollisionObjectWrapperPtr& cow : attached_cows)
+  {
+    manager_->removeCollisionObject(cow->getName());
+  }
 }
 
 void CollisionEnvBullet::addToManager(const World::Object* obj)
@@ -253,7 +314,6 @@ void CollisionEnvBullet::addToManager(const World::Object* obj)
       false));
 
   manager_->addCollisionObject(cow);
-  manager_CCD_->addCollisionObject(cow->clone());
 }
 
 void CollisionEnvBullet::updateManagedObject(const std::string& id)
@@ -264,7 +324,6 @@ void CollisionEnvBullet::updateManagedObject(const std::string& id)
     if (manager_->hasCollisionObject(id))
     {
       manager_->removeCollisionObject(id);
-      manager_CCD_->removeCollisionObject(id);
       addToManager(it->second.get());
     }
     else
@@ -277,7 +336,6 @@ void CollisionEnvBullet::updateManagedObject(const std::string& id)
     if (manager_->hasCollisionObject(id))
     {
       manager_->removeCollisionObject(id);
-      manager_CCD_->removeCollisionObject(id);
     }
   }
 }
@@ -304,7 +362,6 @@ void CollisionEnvBullet::notifyObjectChange(const ObjectConstPtr& obj, World::Ac
   if (action == World::DESTROY)
   {
     manager_->removeCollisionObject(obj->id_);
-    manager_CCD_->removeCollisionObject(obj->id_);
   }
   else
   {
@@ -357,7 +414,7 @@ void CollisionEnvBullet::updatedPaddingOrScaling(const std::vector<std::string>&
 }
 
 void CollisionEnvBullet::updateTransformsFromState(
-    const moveit::core::RobotState& state, const collision_detection_bullet::BulletDiscreteBVHManagerPtr& manager) const
+    const moveit::core::RobotState& state, const collision_detection_bullet::BulletUnifiedBVHManagerPtr& manager) const
 {
   // updating link positions with the current robot state
   for (const std::string& link : active_)
@@ -411,7 +468,6 @@ void CollisionEnvBullet::addLinkAsCollisionObject(const urdf::LinkSharedPtr& lin
     if (manager_->hasCollisionObject(link->name))
     {
       manager_->removeCollisionObject(link->name);
-      manager_CCD_->removeCollisionObject(link->name);
     }
 
     try
@@ -419,7 +475,6 @@ void CollisionEnvBullet::addLinkAsCollisionObject(const urdf::LinkSharedPtr& lin
       collision_detection_bullet::CollisionObjectWrapperPtr cow(new collision_detection_bullet::CollisionObjectWrapper(
           link->name, collision_detection::BodyType::ROBOT_LINK, shapes, shape_poses, collision_object_types, true));
       manager_->addCollisionObject(cow);
-      manager_CCD_->addCollisionObject(cow->clone());
       active_.push_back(cow->getName());
     }
     catch (std::exception&)
@@ -35,11 +35,181 @@
 /* Author: Jens Petit */
 
 #include <moveit/collision_detection_bullet/collision_detector_allocator_bullet.h>
+#include <moveit/collision_detection_fcl/collision_detector_allocator_fcl.h>
 #include <moveit/collision_detection/test_collision_common_panda.h>
 
 INSTANTIATE_TYPED_TEST_CASE_P(BulletCollisionCheckPanda, CollisionDetectorPandaTest,
                               collision_detection::CollisionDetectorAllocatorBullet);
 
+INSTANTIATE_TYPED_TEST_CASE_P(BulletDistanceCheckPanda, DistanceCheckPandaTest,
+                              collision_detection::CollisionDetectorAllocatorBullet);
+
+/** \brief Bullet converts the panda meshes to convex hulls, FCL checks the meshes themselves */
+static const double DISTANCE_TOLERANCE = 0.01;
+
+/** \brief Compares the distance queries of Bullet with the ones of FCL on a shared world */
+class BulletDistanceParityTest : public testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    robot_model_ = moveit::core::loadTestingRobotModel("panda");
+    world_.reset(new collision_detection::World());
+
+    acm_.reset(new collision_detection::AllowedCollisionMatrix());
+    const std::vector<std::string>& collision_links = robot_model_->getLinkModelNamesWithCollisionGeometry();
+    acm_->setEntry(collision_links, collision_links, false);
+    for (const srdf::Model::DisabledCollision& dc : robot_model_->getSRDF()->getDisabledCollisionPairs())
+      acm_->setEntry(dc.link1_, dc.link2_, true);
+
+    bullet_env_ = collision_detection::CollisionDetectorAllocatorBullet::create()->allocateEnv(world_, robot_model_);
+    fcl_env_ = collision_detection::CollisionDetectorAllocatorFCL::create()->allocateEnv(world_, robot_model_);
+
+    robot_state_.reset(new moveit::core::RobotState(robot_model_));
+    setToHome(*robot_state_);
+  }
+
+  /** \brief Expects the same distance for all pairs FCL reports clearly within the threshold of \e req */
+  void expectSameDistances(const collision_detection::DistanceRequest& req,
+                           const collision_detection::DistanceResult& fcl_res,
+                           const collision_detection::DistanceResult& bullet_res)
+  {
+    EXPECT_NEAR(fcl_res.minimum_distance.distance, bullet_res.minimum_distance.distance, DISTANCE_TOLERANCE);
+    for (const auto& fcl_pair : fcl_res.distances)
+    {
+      if (fcl_pair.second[0].distance > req.distance_threshold - 2 * DISTANCE_TOLERANCE)
+        continue;
+
+      auto bullet_pair = bullet_res.distances.find(fcl_pair.first);
+      ASSERT_NE(bullet_pair, bullet_res.distances.end())
+          << "no distance reported for " << fcl_pair.first.first << "/" << fcl_pair.first.second;
+      ASSERT_EQ(bullet_pair->second.size(), 1u);
+      EXPECT_NEAR(fcl_pair.second[0].distance, bullet_pair->second[0].distance, DISTANCE_TOLERANCE)
+          << fcl_pair.first.first << "/" << fcl_pair.first.second;
+    }
+  }
+
+  moveit::core::RobotModelPtr robot_model_;
+  collision_detection::WorldPtr world_;
+  collision_detection::AllowedCollisionMatrixPtr acm_;
+  collision_detection::CollisionEnvPtr bullet_env_;
+  collision_detection::CollisionEnvPtr fcl_env_;
+  moveit::core::RobotStatePtr robot_state_;
+};
+
+/** \brief Checks the nearest points and the gradient of a distance to a world object */
+TEST_F(BulletDistanceParityTest, NearestPointsAndGradient)
+{
+  shapes::ShapeConstPtr shape(new shapes::Box(0.1, 0.1, 0.1));
+  Eigen::Isometry3d pos{ Eigen::Isometry3d::Identity() };
+  pos.translation() = Eigen::Vector3d(0.43, 0, 0.55);
+  world_->addToObject("box", shape, pos);
+
+  collision_detection::DistanceRequest req;
+  req.enable_nearest_points = true;
+  req.enable_signed_distance = true;
+  req.compute_gradient = true;
+  collision_detection::DistanceResult res;
+  bullet_env_->distanceRobot(req, res, *robot_state_);
+
+  const collision_detection::DistanceResultsData& min_distance = res.minimum_distance;
+  ASSERT_FALSE(res.collision);
+  EXPECT_NEAR(min_distance.distance, 0.029, DISTANCE_TOLERANCE);
+  EXPECT_NEAR((min_distance.nearest_points[1] - min_distance.nearest_points[0]).norm(), min_distance.distance, 1e-4);
+  EXPECT_NEAR(min_distance.normal.norm(), 1.0, 1e-4);
+  EXPECT_GT(min_distance.normal.dot(min_distance.nearest_points[1] - min_distance.nearest_points[0]), 0.0);
+
+  // the nearest point on the box lies on its surface
+  const std::size_t box_index = min_distance.link_names[0] == "box" ? 0 : 1;
+  Eigen::Vector3d box_point = pos.inverse() * min_distance.nearest_points[box_index];
+  EXPECT_NEAR(box_point.cwiseAbs().maxCoeff(), 0.05, 1e-3);
+
+  // move the box into the hand, which gives a negative signed distance
+  pos.translation().x() = 0.38;
+  world_->moveShapeInObject("box", shape, pos);
+  res.clear();
+  bullet_env_->distanceRobot(req, res, *robot_state_);
+  EXPECT_TRUE(res.collision);
+  EXPECT_LT(res.minimum_distance.distance, 0.0);
+}
+
+/** \brief Compares self distances for random robot states */
+TEST_F(BulletDistanceParityTest, DistanceSelf)
+{
+  collision_detection::DistanceRequest req;
+  req.type = collision_detection::DistanceRequestType::SINGLE;
+  req.enable_signed_distance = true;
+  req.distance_threshold = 0.2;
+  req.acm = acm_.get();
+
+  random_numbers::RandomNumberGenerator rng(0x47110815);
+  for (int i = 0; i < 20; ++i)
+  {
+    robot_state_->setToRandomPositions(robot_model_->getJointModelGroup("panda_arm"), rng);
+    robot_state_->update();
+
+    collision_detection::CollisionRequest collision_req;
+    collision_detection::CollisionResult collision_res;
+    fcl_env_->checkSelfCollision(collision_req, collision_res, *robot_state_, *acm_);
+    if (collision_res.collision)
+      continue;
+
+    collision_detection::DistanceResult fcl_res;
+    collision_detection::DistanceResult bullet_res;
+    fcl_env_->distanceSelf(req, fcl_res, *robot_state_);
+    bullet_env_->distanceSelf(req, bullet_res, *robot_state_);
+    expectSameDistances(req, fcl_res, bullet_res);
+  }
+}
+
+/** \brief Compares the distances to world objects for random worlds, also restricted to the active components */
+TEST_F(BulletDistanceParityTest, DistanceRobot)
+{
+  std::set<const moveit::core::LinkModel*> active_components{ robot_model_->getLinkModel("panda_hand"),
+                                                              robot_model_->getLinkModel("panda_link7") };
+  collision_detection::DistanceRequest req;
+  req.type = collision_detection::DistanceRequestType::SINGLE;
+  req.enable_nearest_points = true;
+  req.distance_threshold = 0.5;
+
+  random_numbers::RandomNumberGenerator rng(0x47110815);
+  for (int i = 0; i < 10; ++i)
+  {
+    shapes::ShapeConstPtr shape(
+        new shapes::Box(rng.uniformReal(0.05, 0.2), rng.uniformReal(0.05, 0.2), rng.uniformReal(0.05, 0.2)));
+    Eigen::Isometry3d pose{ Eigen::Isometry3d::Identity() };
+    pose.translation() =
+        Eigen::Vector3d(rng.uniformReal(0.2, 0.8), rng.uniformReal(-0.5, 0.5), rng.uniformReal(0.2, 1.0));
+    world_->addToObject("box" + std::to_string(i), shape, pose);
+
+    // penetration depths are computed differently by both checkers
+    collision_detection::CollisionRequest collision_req;
+    collision_detection::CollisionResult collision_res;
+    fcl_env_->checkRobotCollision(collision_req, collision_res, *robot_state_);
+    if (collision_res.collision)
+    {
+      world_->removeObject("box" + std::to_string(i));
+      continue;
+    }
+
+    collision_detection::DistanceResult fcl_res;
+    collision_detection::DistanceResult bullet_res;
+    req.active_components_only = nullptr;
+    fcl_env_->distanceRobot(req, fcl_res, *robot_state_);
+    bullet_env_->distanceRobot(req, bullet_res, *robot_state_);
+    expectSameDistances(req, fcl_res, bullet_res);
+
+    fcl_res.clear();
+    bullet_res.clear();
+    req.active_components_only = &active_components;
+    fcl_env_->distanceRobot(req, fcl_res, *robot_state_);
+    bullet_env_->distanceRobot(req, bullet_res, *robot_state_);
+    expectSameDistances(req, fcl_res, bullet_res);
+    for (const auto& pair : bullet_res.distances)
+      EXPECT_TRUE(pair.first.second == "panda_hand" || pair.first.second == "panda_link7") << pair.first.second;
+  }
+}
+
 int main(int argc, char* argv[])
 {
   testing::InitGoogleTest(&argc, argv);
@@ -39,6 +39,7 @@
 
 #include <moveit/collision_detection_bullet/bullet_integration/bullet_cast_bvh_manager.h>
 #include <moveit/collision_detection_bullet/bullet_integration/bullet_discrete_bvh_manager.h>
+#include <moveit/collision_detection_bullet/bullet_integration/bullet_unified_bvh_manager.h>
 #include <moveit/collision_detection/collision_common.h>
 
 #include <moveit/robot_model/robot_model.h>
@@ -109,7 +110,8 @@ protected:
   moveit::core::RobotStatePtr robot_state_;
 };
 
-void addCollisionObjects(cb::BulletCastBVHManager& checker)
+template <class Manager>
+void addCollisionObjects(Manager& checker)
 {
   ////////////////////////////
   // Add static box to checker
@@ -150,7 +152,8 @@ void addCollisionObjects(cb::BulletCastBVHManager& checker)
   checker.addCollisionObject(cow_2);
 }
 
-void addCollisionObjectsMesh(cb::BulletCastBVHManager& checker)
+template <class Manager>
+void addCollisionObjectsMesh(Manager& checker)
 {
   ////////////////////////////
   // Add static box to checker
@@ -315,6 +318,52 @@ TEST_F(BulletCollisionDetectionTester, ContinuousCollisionWorld)
   res.clear();
 }
 
+/** \brief Discrete and continuous checks share the collision objects; alternating them must not change results. */
+TEST_F(BulletCollisionDetectionTester, DiscreteAndContinuousChecksInterleaved)
+{
+  collision_detection::CollisionRequest req;
+  req.contacts = true;
+  req.max_contacts = 10;
+
+  moveit::core::RobotState state1(robot_model_);
+  moveit::core::RobotState state2(robot_model_);
+  setToHome(state1);
+  setToHome(state2);
+  double joint_2{ 0.05 };
+  double joint_4{ -1.6 };
+  state2.setJointPositions("panda_joint2", &joint_2);
+  state2.setJointPositions("panda_joint4", &joint_4);
+  state2.update();
+
+  shapes::ShapeConstPtr shape_ptr(new shapes::Box(0.1, 0.1, 0.1));
+  Eigen::Isometry3d pos{ Eigen::Isometry3d::Identity() };
+  pos.translation() = Eigen::Vector3d(0.43, 0, 0.55);
+  cenv_->getWorld()->addToObject("box", shape_ptr, pos);
+
+  for (int i = 0; i < 2; ++i)
+  {
+    collision_detection::CollisionResult res;
+    cenv_->checkRobotCollision(req, res, state1, state2, *acm_);
+    EXPECT_TRUE(res.collision);
+    EXPECT_EQ(res.contact_count, 4u);
+
+    res.clear();
+    cenv_->checkRobotCollision(req, res, state1, *acm_);
+    EXPECT_FALSE(res.collision);
+
+    res.clear();
+    cenv_->checkSelfCollision(req, res, state2, *acm_);
+    EXPECT_FALSE(res.collision);
+
+    // a distance query in between must not leave its contact distance to later checks
+    collision_detection::CollisionRequest distance_req;
+    distance_req.distance = true;
+    res.clear();
+    cenv_->checkRobotCollision(distance_req, res, state2, *acm_);
+    EXPECT_FALSE(res.collision);
+  }
+}
+
 TEST(ContinuousCollisionUnit, BulletCastBVHCollisionBoxBoxUnit)
 {
   collision_detection::CollisionResult result;
@@ -354,6 +403,75 @@ TEST(ContinuousCollisionUnit, BulletCastMeshVsBox)
   ASSERT_TRUE(result.collision);
 }
 
+TEST(ContinuousCollisionUnit, BulletUnifiedBVHCollisionBoxBoxUnit)
+{
+  cb::BulletUnifiedBVHManager checker;
+  addCollisionObjects(checker);
+  checker.setActiveCollisionObjects({ "moving_box_link" });
+  checker.setContactDistanceThreshold(0.1);
+  checker.setCollisionObjectsTransform("static_box_link", Eigen::Isometry3d::Identity());
+
+  Eigen::Isometry3d start_pos, end_pos;
+  start_pos.setIdentity();
+  start_pos.translation().x() = -2;
+  end_pos.setIdentity();
+  end_pos.translation().x() = 2;
+
+  collision_detection::CollisionRequest request;
+  request.contacts = true;
+
+  // the same object is checked in cast, discrete and again in cast queries
+  for (int i = 0; i < 2; ++i)
+  {
+    collision_detection::CollisionResult result;
+    checker.setCastCollisionObjectsTransform("moving_box_link", start_pos, end_pos);
+    checker.castContactTest(result, request, nullptr);
+    ASSERT_TRUE(result.collision);
+    ASSERT_FALSE(result.contacts.empty());
+    const collision_detection::Contact& contact = result.contacts.begin()->second[0];
+    EXPECT_NEAR(contact.depth, -0.6, 0.001);
+    EXPECT_NEAR(contact.percent_interpolation, 0.6, 0.001);
+
+    result.clear();
+    checker.setCollisionObjectsTransform("moving_box_link", end_pos);
+    checker.contactTest(result, request, nullptr, false);
+    EXPECT_FALSE(result.collision);
+  }
+
+  // clones share no state with the original manager
+  cb::BulletUnifiedBVHManagerPtr clone = checker.clone();
+  collision_detection::CollisionResult result;
+  clone->setCastCollisionObjectsTransform("moving_box_link", start_pos, end_pos);
+  clone->castContactTest(result, request, nullptr);
+  EXPECT_TRUE(result.collision);
+}
+
+TEST(ContinuousCollisionUnit, BulletUnifiedMeshVsBox)
+{
+  cb::BulletUnifiedBVHManager checker;
+  addCollisionObjectsMesh(checker);
+  checker.setActiveCollisionObjects({ "moving_box_link" });
+  checker.setContactDistanceThreshold(0.1);
+
+  Eigen::Isometry3d start_pos, end_pos;
+  start_pos.setIdentity();
+  start_pos.translation().x() = -1.9;
+  end_pos.setIdentity();
+  end_pos.translation().x() = 1.9;
+
+  collision_detection::CollisionRequest request;
+  request.contacts = true;
+  collision_detection::CollisionResult result;
+  checker.setCastCollisionObjectsTransform("moving_box_link", start_pos, end_pos);
+  checker.castContactTest(result, request, nullptr);
+  ASSERT_TRUE(result.collision);
+
+  result.clear();
+  checker.setCollisionObjectsTransform("moving_box_link", end_pos);
+  checker.contactTest(result, request, nullptr, false);
+  EXPECT_FALSE(result.collision);
+}
+
 int main(int argc, char** argv)
 {
   testing::InitGoogleTest(&argc, argv);
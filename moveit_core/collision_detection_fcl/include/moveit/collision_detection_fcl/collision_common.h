@@ -51,8 +51,11 @@
 #include <fcl/distance.h>
 #endif
 
+#include <array>
 #include <memory>
+#include <mutex>
 #include <set>
+#include <unordered_map>
 
 namespace collision_detection
 {
@@ -139,12 +142,18 @@ struct CollisionGeometryData
 /** \brief Data structure which is passed to the collision callback function of the collision manager. */
 struct CollisionData
 {
-  CollisionData() : req_(nullptr), active_components_only_(nullptr), res_(nullptr), acm_(nullptr), done_(false)
+  CollisionData()
+    : req_(nullptr)
+    , active_components_only_(nullptr)
+    , res_(nullptr)
+    , acm_(nullptr)
+    , compiled_acm_(nullptr)
+    , done_(false)
   {
   }
 
   CollisionData(const CollisionRequest* req, CollisionResult* res, const AllowedCollisionMatrix* acm)
-    : req_(req), active_components_only_(nullptr), res_(res), acm_(acm), done_(false)
+    : req_(req), active_components_only_(nullptr), res_(res), acm_(acm), compiled_acm_(nullptr), done_(false)
   {
   }
 
@@ -170,14 +179,97 @@ struct CollisionData
   /** \brief The user-specified collision matrix (may be NULL). */
   const AllowedCollisionMatrix* acm_;
 
+  /** \brief A snapshot of \e acm_ indexed by LinkModel::getLinkIndex(), used for pairs of robot links (may be NULL) */
+  const CompiledAllowedCollisionMatrix* compiled_acm_;
+
   /** \brief Flag indicating whether collision checking is complete. */
   bool done_;
 };
 
+/** \brief Remembers the last narrowphase distance computed for pairs of FCL collision geometries.
+ *
+ *  Distance queries are often repeated for poses that differ only slightly, e.g. in successive iterations of an
+ *  optimizing planner or when validating densely sampled trajectories. If a pair has not moved since it was last
+ *  queried, its stored result is reused. Otherwise, the stored distance minus the largest displacement any point of
+ *  either geometry underwent is a lower bound of the current distance, and the narrowphase query is skipped if that
+ *  bound is not below the threshold of the current query. Entries are keyed by geometry and store the poses they were
+ *  computed for, so they remain valid as long as the geometries are not modified; clear() must be called otherwise.
+ *  Pairs involving an octree are not cached, as octrees are modified in place. All methods are thread-safe. */
+class DistanceCache
+{
+public:
+  /** \brief Answer the distance query between \e o1 and \e o2 from the cache, if possible.
+   *
+   *  On success, \e result.min_distance is set to the distance of the pair, or to \e threshold if the pair is known
+   *  to be at least \e threshold apart. Nearest points are provided if \e nearest_points is set. */
+  bool lookup(const fcl::CollisionObjectd* o1, const fcl::CollisionObjectd* o2, double threshold, bool nearest_points,
+              fcl::DistanceResultd& result) const;
+
+  /** \brief Remember \e result, computed by a distance query between \e o1 and \e o2 with \e threshold as initial
+   *  minimum distance */
+  void store(const fcl::CollisionObjectd* o1, const fcl::CollisionObjectd* o2, double threshold, bool nearest_points,
+             const fcl::DistanceResultd& result);
+
+  /** \brief Forget all stored results */
+  void clear();
+
+private:
+  struct Entry
+  {
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+    std::weak_ptr<const fcl::CollisionGeometryd> geometry1;
+    std::weak_ptr<const fcl::CollisionGeometryd> geometry2;
+
+    /** \brief Poses of the two geometries the distance was computed for */
+    fcl::Transform3d transform1;
+    fcl::Transform3d transform2;
+
+    /** \brief A lower bound of the distance at \e transform1, \e transform2; the distance itself if \e exact */
+    double distance;
+    bool exact;
+    bool has_nearest_points;
+    Eigen::Vector3d nearest_points[2];
+  };
+
+  /** \brief Geometries of a pair, ordered by address */
+  typedef std::pair<const fcl::CollisionGeometryd*, const fcl::CollisionGeometryd*> Key;
+
+  struct KeyHash
+  {
+    std::size_t operator()(const Key& key) const
+    {
+      return std::hash<const void*>()(key.first) * 31 + std::hash<const void*>()(key.second);
+    }
+  };
+
+  /** \brief A part of the cache with its own lock, so that concurrent queries rarely wait for each other */
+  struct Shard
+  {
+    std::mutex lock_;
+    std::unordered_map<Key, Entry, KeyHash, std::equal_to<Key>,
+                       Eigen::aligned_allocator<std::pair<const Key, Entry> > >
+        entries_;
+  };
+
+  static const std::size_t NUM_SHARDS = 16;
+
+  /** \brief Shards are emptied when they grow larger than this, to drop entries of geometries that no longer exist */
+  static const std::size_t MAX_SHARD_SIZE = 4096;
+
+  Shard& getShard(const Key& key) const
+  {
+    return shards_[KeyHash()(key) % NUM_SHARDS];
+  }
+
+  mutable std::array<Shard, NUM_SHARDS> shards_;
+};
+
 /** \brief Data structure which is passed to the distance callback function of the collision manager. */
 struct DistanceData
 {
-  DistanceData(const DistanceRequest* req, DistanceResult* res) : req(req), res(res), done(false)
+  DistanceData(const DistanceRequest* req, DistanceResult* res)
+    : req(req), res(res), compiled_acm(nullptr), distance_cache(nullptr), done(false)
   {
   }
   ~DistanceData()
@@ -190,6 +282,13 @@ struct DistanceData
   /** \brief Distance query results information. */
   DistanceResult* res;
 
+  /** \brief A snapshot of the collision matrix of \e req indexed by LinkModel::getLinkIndex(), used for pairs of robot
+   *  links (may be NULL) */
+  const CompiledAllowedCollisionMatrix* compiled_acm;
+
+  /** \brief Results of earlier narrowphase queries to reuse (may be NULL) */
+  DistanceCache* distance_cache;
+
   /** \brief Indicates if distance query is finished. */
   bool done;
 };
@@ -267,6 +366,32 @@ struct FCLManager
   std::shared_ptr<fcl::BroadPhaseCollisionManagerd> manager_;
 };
 
+/** \brief Data structure which is passed to the continuous collision callback function of the collision manager.
+ *
+ *  The manager is queried with \e swept_object_, whose bounding box contains the motion of a single robot body,
+ *  \e body_, from \e body_start_ to \e body_end_. */
+struct ContinuousCollisionData : public CollisionData
+{
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  ContinuousCollisionData(const CollisionRequest* req, CollisionResult* res, const AllowedCollisionMatrix* acm)
+    : CollisionData(req, res, acm), swept_object_(nullptr), body_(nullptr)
+  {
+  }
+
+  /** \brief The object the manager is queried with; it has no collision geometry data */
+  const fcl::CollisionObjectd* swept_object_;
+
+  /** \brief The moving robot body */
+  const FCLGeometry* body_;
+
+  /** \brief The transform of \e body_ at the start of the motion */
+  Eigen::Isometry3d body_start_;
+
+  /** \brief The transform of \e body_ at the end of the motion */
+  Eigen::Isometry3d body_end_;
+};
+
 /** \brief Callback function used by the FCLManager used for each pair of collision objects to
 *   calculate object contact information.
 *
@@ -276,6 +401,26 @@ struct FCLManager
 *   \return True terminates the distance check, false continues it to the next pair of objects */
 bool collisionCallback(fcl::CollisionObjectd* o1, fcl::CollisionObjectd* o2, void* data);
 
+/** \brief Check the robot bodies \e robot_objects against the octree of the world object \e octree_object.
+ *
+ *  Instead of colliding every body with the whole octree, the octree is traversed once for all bodies. Only the nodes
+ *  overlapping the bounding box of a body are descended into, and only the occupied leaf cells that do are checked
+ *  against that body, as boxes passed to collisionCallback(). The result is the same as the one of passing each body
+ *  and the octree to collisionCallback(), but bodies are dropped from the traversal as soon as further cells cannot
+ *  add to the result.
+ *
+ *  \param octree_object World collision object holding an octree
+ *  \param robot_objects Collision objects of the robot links and attached bodies, with up to date AABBs
+ *  \param cdata The collision data of the query
+ *  \return True terminates the collision check */
+bool collideOctree(fcl::CollisionObjectd* octree_object, const std::vector<fcl::CollisionObjectd*>& robot_objects,
+                   CollisionData& cdata);
+
+/** \brief Check whether distanceCallback() computes the distance between \e o1 and \e o2 for the request of \e data.
+ *  Pairs of the same object, of inactive components and pairs whose collision is always allowed are skipped. */
+bool isDistanceCheckRequired(const fcl::CollisionObjectd* o1, const fcl::CollisionObjectd* o2,
+                             const DistanceData& data);
+
 /** \brief Callback function used by the FCLManager used for each pair of collision objects to
 *   calculate collisions and distances.
 *
@@ -285,6 +430,16 @@ bool collisionCallback(fcl::CollisionObjectd* o1, fcl::CollisionObjectd* o2, voi
 *   \return True terminates the collision check, false continues it to the next pair of objects */
 bool distanceCallback(fcl::CollisionObjectd* o1, fcl::CollisionObjectd* o2, void* data, double& min_dist);
 
+/** \brief Callback function used by the FCLManager for each pair of the swept object of a ContinuousCollisionData
+*   and a world object, to check if the moving robot body collides with the world object during its motion.
+*   If a conditionally allowed collision permits the first contact, the remainder of the motion is checked as well.
+*
+*   \param o1 First FCL collision object
+*   \param o2 Second FCL collision object
+*   \data Pointer to the ContinuousCollisionData of the query
+*   \return True terminates the collision check, false continues it to the next pair of objects */
+bool continuousCollisionCallback(fcl::CollisionObjectd* o1, fcl::CollisionObjectd* o2, void* data);
+
 /** \brief Create new FCLGeometry object out of robot link model. */
 FCLGeometryConstPtr createCollisionGeometry(const shapes::ShapeConstPtr& shape, const moveit::core::LinkModel* link,
                                             int shape_index);
@@ -46,6 +46,7 @@
 #endif
 
 #include <memory>
+#include <mutex>
 
 namespace collision_detection
 {
@@ -82,6 +83,11 @@ public:
   void checkRobotCollision(const CollisionRequest& req, CollisionResult& res, const moveit::core::RobotState& state1,
                            const moveit::core::RobotState& state2) const override;
 
+  bool supportsContinuousCollision() const override
+  {
+    return true;
+  }
+
   void distanceSelf(const DistanceRequest& req, DistanceResult& res,
                     const moveit::core::RobotState& state) const override;
 
@@ -104,10 +110,25 @@ protected:
   void checkSelfCollisionHelper(const CollisionRequest& req, CollisionResult& res,
                                 const moveit::core::RobotState& state, const AllowedCollisionMatrix* acm) const;
 
-  /** \brief Bundles the different checkRobotCollision functions into a single function */
+  /** \brief Bundles the different checkRobotCollision functions into a single function.
+   *
+   *  Octree world objects are not checked per robot body: each octree is traversed once against all robot bodies
+   *  the broadphase found overlapping it (see collideOctree()). */
   void checkRobotCollisionHelper(const CollisionRequest& req, CollisionResult& res,
                                  const moveit::core::RobotState& state, const AllowedCollisionMatrix* acm) const;
 
+  /** \brief Bundles the different continuous checkRobotCollision functions into a single function.
+   *
+   *  Each robot body is moved linearly from its pose in \e state1 to its pose in \e state2. World objects that may
+   *  be hit by the swept body are found with the broadphase and checked with FCL's conservative advancement. */
+  void checkRobotCollisionHelperCCD(const CollisionRequest& req, CollisionResult& res,
+                                    const moveit::core::RobotState& state1, const moveit::core::RobotState& state2,
+                                    const AllowedCollisionMatrix* acm) const;
+
+  /** \brief Check the motion of the robot body \e body from \e start to \e end against the world */
+  void castRobotBody(const FCLGeometry& body, const Eigen::Isometry3d& start, const Eigen::Isometry3d& end,
+                     ContinuousCollisionData& cdata) const;
+
   /** \brief Construct an FCL collision object from MoveIt's World::Object. */
   void constructFCLObjectWorld(const World::Object* obj, FCLObject& fcl_obj) const;
 
@@ -130,6 +151,45 @@ protected:
   *   state and specifying a broadphase collision manager of FCL where the constructed object is registered to. */
   void allocSelfCollisionBroadPhase(const moveit::core::RobotState& state, FCLManager& manager) const;
 
+  /** \brief Persistent FCL representation of the robot, reused across queries.
+   *
+   *  Holds one copy of each of \m robot_fcl_objs_, registered to a dynamic AABB tree manager once. For each query,
+   *  only the transforms and AABBs of these objects are updated and the tree is refit, instead of allocating new
+   *  objects and building a new tree. */
+  struct RobotBroadPhase
+  {
+    /** \brief Collision objects of the robot links, indexed like \m robot_fcl_objs_ (nullptr where it is null) */
+    std::vector<FCLCollisionObjectPtr> link_objects_;
+
+    /** \brief Collision objects of the attached bodies of the current query's state */
+    FCLObject attached_objects_;
+
+    /** \brief All collision objects of the current query's state, i.e. links and attached bodies */
+    std::vector<fcl::CollisionObjectd*> objects_;
+
+    /** \brief Manager for self-collision queries, created on first use; contains all \e objects_ */
+    std::unique_ptr<fcl::BroadPhaseCollisionManagerd> manager_;
+
+    /** \brief Whether \e attached_objects_ are registered to \e manager_ */
+    bool attached_objects_registered_ = false;
+
+    /** \brief The value of \m robot_geometry_version_ the link objects were created for */
+    std::size_t geometry_version_;
+  };
+
+  /** \brief Get a broadphase from the pool (or create a new one) and update it to \e state. The manager is only
+   *  refit if \e self_collision is true, as queries against the world only need the objects' transforms and AABBs.
+   *  The broadphase is used exclusively by the caller until it is handed back with releaseRobotBroadPhase(). */
+  std::unique_ptr<RobotBroadPhase> acquireRobotBroadPhase(const moveit::core::RobotState& state,
+                                                          bool self_collision) const;
+
+  /** \brief Return a broadphase obtained from acquireRobotBroadPhase() to the pool */
+  void releaseRobotBroadPhase(std::unique_ptr<RobotBroadPhase> broadphase) const;
+
+  /** \brief Get a snapshot of \e acm for the links of the robot, indexed by LinkModel::getLinkIndex(). The last
+   *  snapshot is cached and only compiled again when a different matrix (or a modified one) is passed. */
+  CompiledAllowedCollisionMatrixConstPtr getCompiledACM(const AllowedCollisionMatrix& acm) const;
+
   /** \brief Converts all shapes which make up an atttached body into a vector of FCLGeometryConstPtr.
   *
   *   When they are converted, they can be added to the FCL representation of the robot for collision checking.
@@ -150,6 +210,20 @@ protected:
 
   std::map<std::string, FCLObject> fcl_objs_;
 
+  /** \brief Incremented whenever \m robot_fcl_objs_ change, invalidating the pooled robot broadphases */
+  std::size_t robot_geometry_version_ = 0;
+
+  /** \brief Broadphases of the robot not in use by any query; one per concurrent query at most */
+  mutable std::vector<std::unique_ptr<RobotBroadPhase> > robot_broadphases_;
+  mutable std::mutex robot_broadphases_lock_;
+
+  /** \brief The last result of getCompiledACM() */
+  mutable CompiledAllowedCollisionMatrixConstPtr compiled_acm_;
+  mutable std::mutex compiled_acm_lock_;
+
+  /** \brief Narrowphase results of earlier distance queries; cleared whenever the world or robot geometry changes */
+  mutable DistanceCache distance_cache_;
+
 private:
   /** \brief Callback function executed for each change to the world environment */
   void notifyObjectChange(const ObjectConstPtr& obj, World::Action action);
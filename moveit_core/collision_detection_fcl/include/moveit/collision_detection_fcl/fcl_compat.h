@@ -64,6 +64,10 @@ class DistanceRequest;
 using DistanceRequestd = fcl::DistanceRequest;
 class DistanceResult;
 using DistanceResultd = fcl::DistanceResult;
+class ContinuousCollisionRequest;
+using ContinuousCollisionRequestd = fcl::ContinuousCollisionRequest;
+class ContinuousCollisionResult;
+using ContinuousCollisionResultd = fcl::ContinuousCollisionResult;
 class Plane;
 using Planed = fcl::Plane;
 class Sphere;
@@ -41,17 +41,32 @@
 #if (MOVEIT_FCL_VERSION >= FCL_VERSION_CHECK(0, 6, 0))
 #include <fcl/geometry/bvh/BVH_model.h>
 #include <fcl/geometry/octree/octree.h>
+#include <fcl/geometry/shape/box.h>
+#include <fcl/narrowphase/continuous_collision.h>
 #else
 #include <fcl/BVH/BVH_model.h>
 #include <fcl/shape/geometric_shapes.h>
 #include <fcl/octree.h>
+#include <fcl/continuous_collision.h>
 #endif
 
 #include <boost/thread/mutex.hpp>
+#include <octomap/octomap.h>
 #include <memory>
 
 namespace collision_detection
 {
+/** \brief Look up the entry of the pair (\e cd1, \e cd2) in \e acm. Pairs of robot links are looked up by link index
+ *  in \e compiled_acm instead, if it is available. */
+template <typename T>
+static bool getAllowedCollision(const AllowedCollisionMatrix& acm, const CompiledAllowedCollisionMatrix* compiled_acm,
+                                const CollisionGeometryData* cd1, const CollisionGeometryData* cd2, T& value)
+{
+  if (compiled_acm && cd1->type == BodyTypes::ROBOT_LINK && cd2->type == BodyTypes::ROBOT_LINK)
+    return compiled_acm->getAllowedCollision(cd1->ptr.link->getLinkIndex(), cd2->ptr.link->getLinkIndex(), value);
+  return acm.getAllowedCollision(cd1->getID(), cd2->getID(), value);
+}
+
 bool collisionCallback(fcl::CollisionObjectd* o1, fcl::CollisionObjectd* o2, void* data)
 {
   CollisionData* cdata = reinterpret_cast<CollisionData*>(data);
@@ -88,7 +103,7 @@ bool collisionCallback(fcl::CollisionObjectd* o1, fcl::CollisionObjectd* o2, voi
   if (cdata->acm_)
   {
     AllowedCollision::Type type;
-    bool found = cdata->acm_->getAllowedCollision(cd1->getID(), cd2->getID(), type);
+    bool found = getAllowedCollision(*cdata->acm_, cdata->compiled_acm_, cd1, cd2, type);
     if (found)
     {
       // if we have an entry in the collision matrix, we read it
@@ -103,7 +118,7 @@ bool collisionCallback(fcl::CollisionObjectd* o1, fcl::CollisionObjectd* o2, voi
       }
       else if (type == AllowedCollision::CONDITIONAL)
       {
-        cdata->acm_->getAllowedCollision(cd1->getID(), cd2->getID(), dcf);
+        getAllowedCollision(*cdata->acm_, cdata->compiled_acm_, cd1, cd2, dcf);
         if (cdata->req_->verbose)
           ROS_DEBUG_NAMED("collision_detection.fcl", "Collision between '%s' and '%s' is conditionally allowed",
                           cd1->getID().c_str(), cd2->getID().c_str());
@@ -356,6 +371,198 @@ bool collisionCallback(fcl::CollisionObjectd* o1, fcl::CollisionObjectd* o2, voi
   return cdata->done_;
 }
 
+#if (MOVEIT_FCL_VERSION >= FCL_VERSION_CHECK(0, 6, 0))
+/** \brief A robot body checked against an octree in collideOctree() */
+struct OctreeBody
+{
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  fcl::CollisionObjectd* object;
+
+  /** \brief The bounding box of \e object in the frame of the octree */
+  Eigen::AlignedBox3d box;
+
+  /** \brief Set once further cells cannot change the result of the query for this body */
+  bool saturated;
+};
+
+/** \brief The state of a single traversal of an octree in collideOctree() */
+struct OctreeTraversal
+{
+  OctreeTraversal(const octomap::OcTree& tree, const fcl::CollisionObjectd& octree_object, CollisionData& cdata)
+    : tree(tree), octree_object(octree_object), cdata(cdata)
+  {
+  }
+
+  const octomap::OcTree& tree;
+  const fcl::CollisionObjectd& octree_object;
+  CollisionData& cdata;
+
+  std::vector<OctreeBody, Eigen::aligned_allocator<OctreeBody>> bodies;
+
+  /** \brief Indices of the bodies overlapping the node visited at each depth */
+  std::vector<std::vector<std::size_t>> candidates;
+
+  /** \brief Box geometries of the cells at each depth, created on first use */
+  std::vector<std::shared_ptr<fcl::CollisionGeometryd>> cells;
+};
+
+/** \brief Check whether contacts between \e robot and the world object \e world are never of interest to \e cdata,
+ *  because \e robot is not an active component or the pair is always allowed to collide */
+static bool isPairIgnored(const CollisionData& cdata, const CollisionGeometryData* robot,
+                          const CollisionGeometryData* world)
+{
+  if (cdata.active_components_only_)
+  {
+    const moveit::core::LinkModel* link =
+        robot->type == BodyTypes::ROBOT_LINK ?
+            robot->ptr.link :
+            (robot->type == BodyTypes::ROBOT_ATTACHED ? robot->ptr.ab->getAttachedLink() : nullptr);
+    if (!link || cdata.active_components_only_->find(link) == cdata.active_components_only_->end())
+      return true;
+  }
+
+  AllowedCollision::Type type;
+  return cdata.acm_ && getAllowedCollision(*cdata.acm_, cdata.compiled_acm_, robot, world, type) &&
+         type == AllowedCollision::ALWAYS;
+}
+
+/** \brief Check the occupied cell at \e center at \e depth against the candidate bodies at that depth */
+static void collideOctreeCell(OctreeTraversal& traversal, const Eigen::Vector3d& center, unsigned int depth)
+{
+  std::shared_ptr<fcl::CollisionGeometryd>& cell = traversal.cells[depth];
+  if (!cell)
+  {
+    double size = traversal.tree.getNodeSize(depth);
+    cell = std::make_shared<fcl::Boxd>(size, size, size);
+    cell->computeLocalAABB();
+    // contacts with the cell are reported for the octree
+    cell->setUserData(traversal.octree_object.collisionGeometry()->getUserData());
+  }
+  fcl::CollisionObjectd cell_object(cell, traversal.octree_object.getTransform() * Eigen::Translation3d(center));
+
+  const CollisionRequest& req = *traversal.cdata.req_;
+  CollisionResult& res = *traversal.cdata.res_;
+  for (std::size_t index : traversal.candidates[depth])
+  {
+    OctreeBody& body = traversal.bodies[index];
+    if (body.saturated)
+      continue;
+
+    std::size_t contact_count = res.contact_count;
+    if (collisionCallback(body.object, &cell_object, &traversal.cdata))
+      return;
+
+    // once a body has all the contacts with the octree it may have, further cells only cost time
+    if (res.contact_count != contact_count && !req.cost)
+    {
+      const CollisionGeometryData* cd1 =
+          static_cast<const CollisionGeometryData*>(body.object->collisionGeometry()->getUserData());
+      const CollisionGeometryData* cd2 = static_cast<const CollisionGeometryData*>(cell->getUserData());
+      auto contacts = res.contacts.find(cd1->getID() < cd2->getID() ? std::make_pair(cd1->getID(), cd2->getID()) :
+                                                                       std::make_pair(cd2->getID(), cd1->getID()));
+      body.saturated = contacts != res.contacts.end() && contacts->second.size() >= req.max_contacts_per_pair;
+    }
+  }
+}
+
+/** \brief Descend into \e node at \e center and \e depth with the bodies that overlap its parent */
+static void collideOctreeNode(OctreeTraversal& traversal, const octomap::OcTreeNode* node,
+                              const Eigen::Vector3d& center, unsigned int depth)
+{
+  const double half_size = traversal.tree.getNodeSize(depth) / 2;
+  const Eigen::AlignedBox3d node_box(center.array() - half_size, center.array() + half_size);
+
+  const std::vector<std::size_t>& parent_candidates = traversal.candidates[depth == 0 ? 0 : depth - 1];
+  std::vector<std::size_t>& candidates = traversal.candidates[depth];
+  if (depth > 0)
+  {
+    candidates.clear();
+    for (std::size_t index : parent_candidates)
+      if (!traversal.bodies[index].saturated && traversal.bodies[index].box.intersects(node_box))
+        candidates.push_back(index);
+  }
+  if (candidates.empty())
+    return;
+
+  if (!traversal.tree.nodeHasChildren(node))
+  {
+    if (traversal.tree.isNodeOccupied(node))
+      collideOctreeCell(traversal, center, depth);
+    return;
+  }
+
+  // the children of a node are ordered by their position along x (bit 0), y (bit 1) and z (bit 2)
+  const double child_offset = half_size / 2;
+  for (unsigned int i = 0; i < 8 && !traversal.cdata.done_; ++i)
+  {
+    if (!traversal.tree.nodeChildExists(node, i))
+      continue;
+    Eigen::Vector3d child_center(center.x() + (i & 1 ? child_offset : -child_offset),
+                                 center.y() + (i & 2 ? child_offset : -child_offset),
+                                 center.z() + (i & 4 ? child_offset : -child_offset));
+    collideOctreeNode(traversal, traversal.tree.getNodeChild(node, i), child_center, depth + 1);
+  }
+}
+#endif
+
+bool collideOctree(fcl::CollisionObjectd* octree_object, const std::vector<fcl::CollisionObjectd*>& robot_objects,
+                   CollisionData& cdata)
+{
+  if (cdata.done_)
+    return true;
+
+#if (MOVEIT_FCL_VERSION >= FCL_VERSION_CHECK(0, 6, 0))
+  const CollisionGeometryData* octree_data =
+      static_cast<const CollisionGeometryData*>(octree_object->collisionGeometry()->getUserData());
+  std::shared_ptr<const octomap::OcTree> tree;
+  if (octree_data->type == BodyTypes::WORLD_OBJECT)
+  {
+    const shapes::ShapeConstPtr& shape = octree_data->ptr.obj->shapes_[octree_data->shape_index];
+    if (shape->type == shapes::OCTREE)
+      tree = static_cast<const shapes::OcTree*>(shape.get())->octree;
+  }
+
+  if (tree)
+  {
+    if (!tree->getRoot())
+      return false;
+
+    OctreeTraversal traversal(*tree, *octree_object, cdata);
+    const fcl::Transform3d world_to_octree = octree_object->getTransform().inverse();
+    for (fcl::CollisionObjectd* robot_object : robot_objects)
+    {
+      const CollisionGeometryData* robot_data =
+          static_cast<const CollisionGeometryData*>(robot_object->collisionGeometry()->getUserData());
+      if (isPairIgnored(cdata, robot_data, octree_data))
+        continue;
+
+      const fcl::AABBd& aabb = robot_object->getAABB();
+      const Eigen::Vector3d center = world_to_octree * aabb.center();
+      const Eigen::Vector3d half_extents = world_to_octree.linear().cwiseAbs() * (aabb.max_ - aabb.min_) / 2;
+      traversal.bodies.push_back(OctreeBody{ robot_object, Eigen::AlignedBox3d(center - half_extents,
+                                                                               center + half_extents),
+                                             false });
+    }
+
+    traversal.candidates.resize(tree->getTreeDepth() + 1);
+    traversal.cells.resize(tree->getTreeDepth() + 1);
+    for (std::vector<std::size_t>& candidates : traversal.candidates)
+      candidates.reserve(traversal.bodies.size());
+    for (std::size_t i = 0; i < traversal.bodies.size(); ++i)
+      traversal.candidates[0].push_back(i);
+
+    collideOctreeNode(traversal, tree->getRoot(), Eigen::Vector3d::Zero(), 0);
+    return cdata.done_;
+  }
+#endif
+
+  // fall back to checking the whole octree against each body
+  for (std::size_t i = 0; !cdata.done_ && i < robot_objects.size(); ++i)
+    collisionCallback(robot_objects[i], octree_object, &cdata);
+  return cdata.done_;
+}
+
 /** \brief Cache for an arbitrary type of shape. It is assigned during the execution of \e createCollisionGeometry().
  *
  *  Only a single cache per thread and object type is created as it is a quasi-singleton instance. */
@@ -400,10 +607,127 @@ struct FCLShapeCache
   unsigned int clean_count_;
 };
 
-bool distanceCallback(fcl::CollisionObjectd* o1, fcl::CollisionObjectd* o2, void* data, double& min_dist)
+#if (MOVEIT_FCL_VERSION >= FCL_VERSION_CHECK(0, 6, 0))
+/** \brief Upper bound of the distance any point of \e geometry moves when its pose changes from \e from to \e to */
+static double maxDisplacement(const fcl::CollisionGeometryd* geometry, const fcl::Transform3d& from,
+                              const fcl::Transform3d& to)
 {
-  DistanceData* cdata = reinterpret_cast<DistanceData*>(data);
+  double displacement = (to.translation() - from.translation()).norm();
+  // the Frobenius norm bounds how far the rotation change moves a point, relative to its distance to the origin
+  double rotation = (to.linear() - from.linear()).norm();
+  if (rotation > 0.0)
+    displacement += rotation * (geometry->aabb_center.norm() + geometry->aabb_radius);
+  return displacement;
+}
+
+/** \brief Octrees are updated in place by the occupancy map monitor, without a notification of the world. Results of
+ *  pairs with an octree are therefore never cached. */
+static bool isCacheable(const fcl::CollisionObjectd* o1, const fcl::CollisionObjectd* o2)
+{
+  return o1->getObjectType() != fcl::OT_OCTREE && o2->getObjectType() != fcl::OT_OCTREE;
+}
+#endif
+
+bool DistanceCache::lookup(const fcl::CollisionObjectd* o1, const fcl::CollisionObjectd* o2, double threshold,
+                           bool nearest_points, fcl::DistanceResultd& result) const
+{
+#if (MOVEIT_FCL_VERSION >= FCL_VERSION_CHECK(0, 6, 0))
+  if (!isCacheable(o1, o2))
+    return false;
+  const bool swapped = o2->collisionGeometry().get() < o1->collisionGeometry().get();
+  if (swapped)
+    std::swap(o1, o2);
+  const Key key(o1->collisionGeometry().get(), o2->collisionGeometry().get());
+
+  Shard& shard = getShard(key);
+  std::lock_guard<std::mutex> lock(shard.lock_);
+  auto it = shard.entries_.find(key);
+  // an expired entry belongs to a geometry that was destroyed; its address has been reused since
+  if (it == shard.entries_.end() || it->second.geometry1.expired() || it->second.geometry2.expired())
+    return false;
+  const Entry& entry = it->second;
+
+  if (entry.exact && (entry.has_nearest_points || !nearest_points) &&
+      entry.transform1.matrix() == o1->getTransform().matrix() &&
+      entry.transform2.matrix() == o2->getTransform().matrix())
+  {
+    result.min_distance = entry.distance;
+    if (entry.has_nearest_points)
+    {
+      result.nearest_points[0] = entry.nearest_points[swapped ? 1 : 0];
+      result.nearest_points[1] = entry.nearest_points[swapped ? 0 : 1];
+    }
+    return true;
+  }
+
+  const double bound = entry.distance - maxDisplacement(key.first, entry.transform1, o1->getTransform()) -
+                       maxDisplacement(key.second, entry.transform2, o2->getTransform());
+  if (bound >= threshold)
+  {
+    result.min_distance = threshold;
+    return true;
+  }
+#else
+  (void)o1;
+  (void)o2;
+  (void)threshold;
+  (void)nearest_points;
+  (void)result;
+#endif
+  return false;
+}
+
+void DistanceCache::store(const fcl::CollisionObjectd* o1, const fcl::CollisionObjectd* o2, double threshold,
+                          bool nearest_points, const fcl::DistanceResultd& result)
+{
+#if (MOVEIT_FCL_VERSION >= FCL_VERSION_CHECK(0, 6, 0))
+  if (!isCacheable(o1, o2))
+    return;
+  const bool swapped = o2->collisionGeometry().get() < o1->collisionGeometry().get();
+  if (swapped)
+    std::swap(o1, o2);
+  const Key key(o1->collisionGeometry().get(), o2->collisionGeometry().get());
+
+  Entry entry;
+  entry.geometry1 = o1->collisionGeometry();
+  entry.geometry2 = o2->collisionGeometry();
+  entry.transform1 = o1->getTransform();
+  entry.transform2 = o2->getTransform();
+  // if the pair is farther apart than the threshold, FCL stops early and reports the threshold
+  entry.distance = result.min_distance;
+  entry.exact = result.min_distance < threshold;
+  entry.has_nearest_points = nearest_points && entry.exact;
+  if (entry.has_nearest_points)
+  {
+    entry.nearest_points[0] = result.nearest_points[swapped ? 1 : 0];
+    entry.nearest_points[1] = result.nearest_points[swapped ? 0 : 1];
+  }
+
+  Shard& shard = getShard(key);
+  std::lock_guard<std::mutex> lock(shard.lock_);
+  if (shard.entries_.size() >= MAX_SHARD_SIZE)
+    shard.entries_.clear();
+  shard.entries_[key] = entry;
+#else
+  (void)o1;
+  (void)o2;
+  (void)threshold;
+  (void)nearest_points;
+  (void)result;
+#endif
+}
 
+void DistanceCache::clear()
+{
+  for (Shard& shard : shards_)
+  {
+    std::lock_guard<std::mutex> lock(shard.lock_);
+    shard.entries_.clear();
+  }
+}
+
+bool isDistanceCheckRequired(const fcl::CollisionObjectd* o1, const fcl::CollisionObjectd* o2, const DistanceData& data)
+{
   const CollisionGeometryData* cd1 = static_cast<const CollisionGeometryData*>(o1->collisionGeometry()->getUserData());
   const CollisionGeometryData* cd2 = static_cast<const CollisionGeometryData*>(o2->collisionGeometry()->getUserData());
 
@@ -412,7 +736,7 @@ bool distanceCallback(fcl::CollisionObjectd* o1, fcl::CollisionObjectd* o2, void
     return false;
 
   // If active components are specified
-  if (cdata->req->active_components_only)
+  if (data.req->active_components_only)
   {
     const moveit::core::LinkModel* l1 =
         cd1->type == BodyTypes::ROBOT_LINK ?
@@ -424,8 +748,8 @@ bool distanceCallback(fcl::CollisionObjectd* o1, fcl::CollisionObjectd* o2, void
             (cd2->type == BodyTypes::ROBOT_ATTACHED ? cd2->ptr.ab->getAttachedLink() : nullptr);
 
     // If neither of the involved components is active
-    if ((!l1 || cdata->req->active_components_only->find(l1) == cdata->req->active_components_only->end()) &&
-        (!l2 || cdata->req->active_components_only->find(l2) == cdata->req->active_components_only->end()))
+    if ((!l1 || data.req->active_components_only->find(l1) == data.req->active_components_only->end()) &&
+        (!l2 || data.req->active_components_only->find(l2) == data.req->active_components_only->end()))
     {
       return false;
     }
@@ -433,18 +757,18 @@ bool distanceCallback(fcl::CollisionObjectd* o1, fcl::CollisionObjectd* o2, void
 
   // use the collision matrix (if any) to avoid certain distance checks
   bool always_allow_collision = false;
-  if (cdata->req->acm)
+  if (data.req->acm)
   {
     AllowedCollision::Type type;
 
-    bool found = cdata->req->acm->getAllowedCollision(cd1->getID(), cd2->getID(), type);
+    bool found = getAllowedCollision(*data.req->acm, data.compiled_acm, cd1, cd2, type);
     if (found)
     {
       // if we have an entry in the collision matrix, we read it
       if (type == AllowedCollision::ALWAYS)
       {
         always_allow_collision = true;
-        if (cdata->req->verbose)
+        if (data.req->verbose)
           ROS_DEBUG_NAMED("collision_detection.fcl",
                           "Collision between '%s' and '%s' is always allowed. No distances are computed.",
                           cd1->getID().c_str(), cd2->getID().c_str());
@@ -459,7 +783,7 @@ bool distanceCallback(fcl::CollisionObjectd* o1, fcl::CollisionObjectd* o2, void
     if (tl.find(cd1->getID()) != tl.end())
     {
       always_allow_collision = true;
-      if (cdata->req->verbose)
+      if (data.req->verbose)
         ROS_DEBUG_NAMED("collision_detection.fcl",
                         "Robot link '%s' is allowed to touch attached object '%s'. No distances are computed.",
                         cd1->getID().c_str(), cd2->getID().c_str());
@@ -471,17 +795,26 @@ bool distanceCallback(fcl::CollisionObjectd* o1, fcl::CollisionObjectd* o2, void
     if (tl.find(cd2->getID()) != tl.end())
     {
       always_allow_collision = true;
-      if (cdata->req->verbose)
+      if (data.req->verbose)
         ROS_DEBUG_NAMED("collision_detection.fcl",
                         "Robot link '%s' is allowed to touch attached object '%s'. No distances are computed.",
                         cd2->getID().c_str(), cd1->getID().c_str());
     }
   }
 
-  if (always_allow_collision)
-  {
+  return !always_allow_collision;
+}
+
+bool distanceCallback(fcl::CollisionObjectd* o1, fcl::CollisionObjectd* o2, void* data, double& min_dist)
+{
+  DistanceData* cdata = reinterpret_cast<DistanceData*>(data);
+
+  const CollisionGeometryData* cd1 = static_cast<const CollisionGeometryData*>(o1->collisionGeometry()->getUserData());
+  const CollisionGeometryData* cd2 = static_cast<const CollisionGeometryData*>(o2->collisionGeometry()->getUserData());
+
+  if (!isDistanceCheckRequired(o1, o2, *cdata))
     return false;
-  }
+
   if (cdata->req->verbose)
     ROS_DEBUG_NAMED("collision_detection.fcl", "Actually checking collisions between %s and %s", cd1->getID().c_str(),
                     cd2->getID().c_str());
@@ -517,7 +850,18 @@ bool distanceCallback(fcl::CollisionObjectd* o1, fcl::CollisionObjectd* o2, void
   }
 
   fcl_result.min_distance = dist_threshold;
-  double d = fcl::distance(o1, o2, fcl::DistanceRequestd(cdata->req->enable_nearest_points), fcl_result);
+  double d;
+  if (cdata->distance_cache &&
+      cdata->distance_cache->lookup(o1, o2, dist_threshold, cdata->req->enable_nearest_points, fcl_result))
+  {
+    d = fcl_result.min_distance;
+  }
+  else
+  {
+    d = fcl::distance(o1, o2, fcl::DistanceRequestd(cdata->req->enable_nearest_points), fcl_result);
+    if (cdata->distance_cache)
+      cdata->distance_cache->store(o1, o2, dist_threshold, cdata->req->enable_nearest_points, fcl_result);
+  }
 
   // Check if either object is already in the map. If not add it or if present
   // check to see if the new distance is closer. If closer remove the existing
@@ -627,6 +971,183 @@ bool distanceCallback(fcl::CollisionObjectd* o1, fcl::CollisionObjectd* o2, void
   return cdata->done;
 }
 
+/** \brief Check if FCL's conservative advancement supports \e geometry. It relies on distance queries, which are not
+ *  implemented for octrees and planes. */
+static bool supportsConservativeAdvancement(const fcl::CollisionGeometryd* geometry)
+{
+  return geometry->getObjectType() != fcl::OT_OCTREE && geometry->getNodeType() != fcl::GEOM_PLANE &&
+         geometry->getNodeType() != fcl::GEOM_HALFSPACE;
+}
+
+/** \brief Fraction of a motion between the discrete checks of bodies in allowed contact */
+static const double ALLOWED_CONTACT_STEP = 0.01;
+
+/** \brief Maximum number of contacts passed to the decision function at each discrete check of an allowed contact */
+static const std::size_t ALLOWED_CONTACT_MAX_CONTACTS = 16;
+
+/** \brief Pose of the moving body of \e cdata at \e time in [0, 1] of its motion. Like FCL's linear motion, the origin
+ *  of the body moves on a straight line while the body rotates about a fixed axis at constant speed. */
+static Eigen::Isometry3d interpolateBodyPose(const ContinuousCollisionData& cdata, double time)
+{
+  Eigen::Isometry3d pose;
+  pose.linear() = Eigen::Quaterniond(cdata.body_start_.linear())
+                      .slerp(time, Eigen::Quaterniond(cdata.body_end_.linear()))
+                      .toRotationMatrix();
+  pose.translation() = (1.0 - time) * cdata.body_start_.translation() + time * cdata.body_end_.translation();
+  pose.makeAffine();
+  return pose;
+}
+
+/** \brief Describe the first contact of a continuous check by a contact between the bodies at the time of contact */
+static Contact getContinuousContact(const fcl::CollisionGeometryd* body_geometry,
+                                    const fcl::CollisionGeometryd* world_geometry,
+                                    const fcl::ContinuousCollisionResultd& result)
+{
+  Contact c;
+  fcl::CollisionResultd col_result;
+  if (fcl::collide(body_geometry, result.contact_tf1, world_geometry, result.contact_tf2,
+                   fcl::CollisionRequestd(1, true), col_result) > 0)
+  {
+    fcl2contact(col_result.getContact(0), c);
+    return c;
+  }
+
+  // conservative advancement stops when the bodies are just touching
+  const CollisionGeometryData* cd1 = static_cast<const CollisionGeometryData*>(body_geometry->getUserData());
+  const CollisionGeometryData* cd2 = static_cast<const CollisionGeometryData*>(world_geometry->getUserData());
+  fcl::DistanceResultd dist_result;
+  fcl::distance(body_geometry, result.contact_tf1, world_geometry, result.contact_tf2, fcl::DistanceRequestd(true),
+                dist_result);
+  const Eigen::Vector3d p1(dist_result.nearest_points[0][0], dist_result.nearest_points[0][1],
+                           dist_result.nearest_points[0][2]);
+  const Eigen::Vector3d p2(dist_result.nearest_points[1][0], dist_result.nearest_points[1][1],
+                           dist_result.nearest_points[1][2]);
+  c.pos = 0.5 * (p1 + p2);
+  c.normal =
+      (p2 - p1).norm() > std::numeric_limits<double>::epsilon() ? (p2 - p1).normalized() : Eigen::Vector3d::Zero();
+  c.depth = 0.0;
+  c.body_name_1 = cd1->getID();
+  c.body_type_1 = cd1->type;
+  c.body_name_2 = cd2->getID();
+  c.body_type_2 = cd2->type;
+  return c;
+}
+
+/** \brief Record the disallowed contact \e c between the moving body \e cd1 and the world object \e cd2 in the result
+ *  of \e cdata
+ *  \return True if the query is done */
+static bool addContinuousContact(ContinuousCollisionData& cdata, const CollisionGeometryData* cd1,
+                                 const CollisionGeometryData* cd2, const Contact& c)
+{
+  if (cdata.req_->verbose)
+    ROS_INFO_NAMED("collision_detection.fcl",
+                   "Found a contact between '%s' (type '%s') and '%s' (type '%s') at %.3f of the motion, "
+                   "which constitutes a collision.",
+                   cd1->getID().c_str(), cd1->getTypeString().c_str(), cd2->getID().c_str(),
+                   cd2->getTypeString().c_str(), c.percent_interpolation);
+
+  cdata.res_->collision = true;
+  if (cdata.req_->contacts && cdata.res_->contact_count < cdata.req_->max_contacts)
+  {
+    const std::pair<std::string, std::string>& pc = cd1->getID() < cd2->getID() ?
+                                                        std::make_pair(cd1->getID(), cd2->getID()) :
+                                                        std::make_pair(cd2->getID(), cd1->getID());
+    std::vector<Contact>& contacts = cdata.res_->contacts[pc];
+    if (contacts.size() < cdata.req_->max_contacts_per_pair)
+    {
+      contacts.push_back(c);
+      cdata.res_->contact_count++;
+    }
+  }
+
+  if (!cdata.req_->contacts || cdata.res_->contact_count >= cdata.req_->max_contacts)
+    cdata.done_ = true;
+  return cdata.done_;
+}
+
+bool continuousCollisionCallback(fcl::CollisionObjectd* o1, fcl::CollisionObjectd* o2, void* data)
+{
+  ContinuousCollisionData* cdata = reinterpret_cast<ContinuousCollisionData*>(data);
+  if (cdata->done_)
+    return true;
+
+  const fcl::CollisionObjectd* world_object = o1 == cdata->swept_object_ ? o2 : o1;
+  const fcl::CollisionGeometryd* body_geometry = cdata->body_->collision_geometry_.get();
+  const fcl::CollisionGeometryd* world_geometry = world_object->collisionGeometry().get();
+  const CollisionGeometryData* cd1 = cdata->body_->collision_geometry_data_.get();
+  const CollisionGeometryData* cd2 = static_cast<const CollisionGeometryData*>(world_geometry->getUserData());
+
+  // use the collision matrix (if any) to avoid certain collision checks
+  DecideContactFn dcf;
+  if (cdata->acm_)
+  {
+    AllowedCollision::Type type;
+    if (cdata->acm_->getAllowedCollision(cd1->getID(), cd2->getID(), type))
+    {
+      if (type == AllowedCollision::ALWAYS)
+      {
+        if (cdata->req_->verbose)
+          ROS_DEBUG_NAMED("collision_detection.fcl",
+                          "Collision between '%s' and '%s' is always allowed. No continuous check is done.",
+                          cd1->getID().c_str(), cd2->getID().c_str());
+        return false;
+      }
+      else if (type == AllowedCollision::CONDITIONAL)
+        cdata->acm_->getAllowedCollision(cd1->getID(), cd2->getID(), dcf);
+    }
+  }
+
+  // pairs that conservative advancement does not support are checked at discrete steps along the motion
+  fcl::ContinuousCollisionRequestd request;
+  request.num_max_iterations = 100;
+  request.ccd_motion_type = fcl::CCDM_LINEAR;
+  request.ccd_solver_type =
+      supportsConservativeAdvancement(body_geometry) && supportsConservativeAdvancement(world_geometry) ?
+          fcl::CCDC_CONSERVATIVE_ADVANCEMENT :
+          fcl::CCDC_NAIVE;
+  const fcl::Transform3d body_end = transform2fcl(cdata->body_end_);
+
+  // A continuous check only finds the first contact of the motion. If the collision matrix allows that contact, the
+  // rest of the motion is checked as well: while the bodies touch, their contacts are checked at discrete steps, and
+  // once they are separated again, the continuous check resumes from there.
+  double start_time = 0.0;
+  while (start_time < 1.0)
+  {
+    fcl::ContinuousCollisionResultd result;
+    fcl::continuousCollide(body_geometry, transform2fcl(interpolateBodyPose(*cdata, start_time)), body_end,
+                           world_geometry, world_object->getTransform(), world_object->getTransform(), request,
+                           result);
+    if (!result.is_collide)
+      return false;
+
+    Contact c = getContinuousContact(body_geometry, world_geometry, result);
+    c.percent_interpolation = start_time + result.time_of_contact * (1.0 - start_time);
+    if (!dcf || !dcf(c))
+      return addContinuousContact(*cdata, cd1, cd2, c);
+
+    double time = c.percent_interpolation;
+    bool touching = true;
+    while (touching && time < 1.0)
+    {
+      time = std::min(1.0, time + ALLOWED_CONTACT_STEP);
+      fcl::CollisionResultd col_result;
+      fcl::collide(body_geometry, transform2fcl(interpolateBodyPose(*cdata, time)), world_geometry,
+                   world_object->getTransform(), fcl::CollisionRequestd(ALLOWED_CONTACT_MAX_CONTACTS, true),
+                   col_result);
+      touching = col_result.numContacts() > 0;
+      for (std::size_t i = 0; i < col_result.numContacts(); ++i)
+      {
+        fcl2contact(col_result.getContact(i), c);
+        c.percent_interpolation = time;
+        if (!dcf(c))
+          return addContinuousContact(*cdata, cd1, cd2, c);
+      }
+    }
+    start_time = time;
+  }
+  return false;
+}
+
 /* Templated function to get a different cache for each of the template arguments combinations.
  *
  * The returned cache is a quasi-singleton for each thread as it is created \e thread_local. */
@@ -39,15 +39,248 @@
 #include <moveit/collision_detection_fcl/collision_common.h>
 
 #include <moveit/collision_detection_fcl/fcl_compat.h>
+#include <moveit/utils/thread_pool.h>
 
 #if (MOVEIT_FCL_VERSION >= FCL_VERSION_CHECK(0, 6, 0))
 #include <fcl/broadphase/broadphase_dynamic_AABB_tree.h>
 #endif
 
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <map>
+
 namespace collision_detection
 {
 const std::string CollisionDetectorAllocatorFCL::NAME("FCL");
 
+namespace
+{
+// Below this number of candidate pairs, a query is not worth distributing across threads
+const std::size_t MIN_PARALLEL_CANDIDATE_PAIRS = 16;
+
+typedef std::vector<std::pair<fcl::CollisionObjectd*, fcl::CollisionObjectd*> > CandidatePairs;
+
+/** \brief Broadphase collision callback that only records the candidate pairs */
+bool collectCollisionCandidate(fcl::CollisionObjectd* o1, fcl::CollisionObjectd* o2, void* data)
+{
+  static_cast<CandidatePairs*>(data)->emplace_back(o1, o2);
+  return false;
+}
+
+/** \brief Robot objects overlapping each octree world object, found by the broadphase and left to collideOctree() */
+typedef std::map<fcl::CollisionObjectd*, std::vector<fcl::CollisionObjectd*> > OctreeCandidates;
+
+/** \brief Record the pair (\e o1, \e o2) in \e candidates if one of the objects is an octree
+ *  \return True if the pair has been recorded */
+bool deferOctreePair(fcl::CollisionObjectd* o1, fcl::CollisionObjectd* o2, OctreeCandidates& candidates)
+{
+  if (o2->getObjectType() == fcl::OT_OCTREE)
+    candidates[o2].push_back(o1);
+  else if (o1->getObjectType() == fcl::OT_OCTREE)
+    candidates[o1].push_back(o2);
+  else
+    return false;
+  return true;
+}
+
+/** \brief Collision data of a query against the world that leaves the pairs with an octree to collideOctree() */
+struct DeferOctreesCollisionData : public CollisionData
+{
+  DeferOctreesCollisionData(const CollisionRequest* req, CollisionResult* res, const AllowedCollisionMatrix* acm)
+    : CollisionData(req, res, acm)
+  {
+  }
+
+  OctreeCandidates octree_candidates_;
+};
+
+/** \brief Broadphase collision callback that checks all pairs without an octree with collisionCallback() */
+bool collisionCallbackDeferOctrees(fcl::CollisionObjectd* o1, fcl::CollisionObjectd* o2, void* data)
+{
+  DeferOctreesCollisionData* cdata = static_cast<DeferOctreesCollisionData*>(data);
+  if (deferOctreePair(o1, o2, cdata->octree_candidates_))
+    return cdata->done_;
+  return collisionCallback(o1, o2, data);
+}
+
+/** \brief Candidate pairs of a distance query, collected by collectDistanceCandidate() */
+struct DistanceCandidateData
+{
+  DistanceCandidateData(const DistanceRequest* req, const CompiledAllowedCollisionMatrix* compiled_acm)
+    : filter_(req, nullptr), bound_(req->distance_threshold)
+  {
+    filter_.compiled_acm = compiled_acm;
+  }
+
+  /** \brief Drop the pairs whose bounding boxes are farther apart than the final bound */
+  void prune()
+  {
+    pairs_.erase(std::remove_if(pairs_.begin(), pairs_.end(),
+                                [this](const std::pair<fcl::CollisionObjectd*, fcl::CollisionObjectd*>& pair) {
+                                  return pair.first->getAABB().distance(pair.second->getAABB()) > bound_;
+                                }),
+                 pairs_.end());
+  }
+
+  /** \brief The request and collision matrix that decide which pairs distanceCallback() computes */
+  DistanceData filter_;
+  CandidatePairs pairs_;
+  /** \brief No pair farther apart than this can change the result */
+  double bound_;
+};
+
+/** \brief Largest distance between any point in the box \e a and any point in the box \e b */
+template <typename AABB>
+double maxDistance(const AABB& a, const AABB& b)
+{
+  double squared = 0.0;
+  for (int i = 0; i < 3; ++i)
+  {
+    double d = std::max(a.max_[i] - b.min_[i], b.max_[i] - a.min_[i]);
+    squared += d * d;
+  }
+  return std::sqrt(squared);
+}
+
+/** \brief Broadphase distance callback that only records the candidate pairs that distanceCallback() would compute.
+ *  The broadphase skips pairs whose bounding boxes are farther apart than \e min_dist, which starts at the distance
+ *  threshold of the request and, for global requests, shrinks to the farthest extent of the closest candidate pair. */
+bool collectDistanceCandidate(fcl::CollisionObjectd* o1, fcl::CollisionObjectd* o2, void* data, double& min_dist)
+{
+  DistanceCandidateData* cdata = static_cast<DistanceCandidateData*>(data);
+  if (!isDistanceCheckRequired(o1, o2, cdata->filter_))
+    return false;
+  cdata->pairs_.emplace_back(o1, o2);
+
+  // only the closest pair is reported, which is not farther apart than the extent of any other pair
+  if (cdata->filter_.req->type == DistanceRequestType::GLOBAL)
+    cdata->bound_ = std::min(cdata->bound_, maxDistance(o1->getAABB(), o2->getAABB()));
+  min_dist = cdata->bound_;
+  return false;
+}
+
+/** \brief Number of threads to use for a query that asked for \e num_threads, or 1 if the query should not be
+ *  split across threads */
+std::size_t queryConcurrency(std::size_t num_threads, bool has_is_done)
+{
+  // a user-provided termination criterion needs to see the complete result after every pair
+  if (num_threads == 1 || has_is_done)
+    return 1;
+  std::size_t concurrency = moveit::core::ThreadPool::getShared().getConcurrency();
+  return num_threads == 0 ? concurrency : std::min(num_threads, concurrency);
+}
+
+/** \brief Add the contacts and cost sources of \e from to \e res, within the limits of \e req */
+void mergeCollisionResult(const CollisionRequest& req, const CollisionResult& from, CollisionResult& res)
+{
+  res.collision = res.collision || from.collision;
+  for (const std::pair<const std::pair<std::string, std::string>, std::vector<Contact> >& contacts : from.contacts)
+  {
+    if (res.contact_count >= req.max_contacts)
+      break;
+    std::vector<Contact>& pair_contacts = res.contacts[contacts.first];
+    for (const Contact& contact : contacts.second)
+    {
+      if (pair_contacts.size() >= req.max_contacts_per_pair || res.contact_count >= req.max_contacts)
+        break;
+      pair_contacts.push_back(contact);
+      ++res.contact_count;
+    }
+    if (pair_contacts.empty())
+      res.contacts.erase(contacts.first);
+  }
+  for (const CostSource& cost_source : from.cost_sources)
+  {
+    res.cost_sources.insert(cost_source);
+    while (res.cost_sources.size() > req.max_cost_sources)
+      res.cost_sources.erase(--res.cost_sources.end());
+  }
+}
+
+/** \brief Add the distances of \e from to \e res, keeping the pair entries that \e req asks for */
+void mergeDistanceResult(const DistanceRequest& req, const DistanceResult& from, DistanceResult& res)
+{
+  res.collision = res.collision || from.collision;
+  if (from.minimum_distance.distance < res.minimum_distance.distance)
+    res.minimum_distance = from.minimum_distance;
+  for (const std::pair<const std::pair<std::string, std::string>, std::vector<DistanceResultsData> >& distances :
+       from.distances)
+  {
+    std::vector<DistanceResultsData>& pair_distances = res.distances[distances.first];
+    for (const DistanceResultsData& distance : distances.second)
+    {
+      if (req.type == DistanceRequestType::SINGLE && !pair_distances.empty())
+      {
+        if (distance.distance < pair_distances[0].distance)
+          pair_distances[0] = distance;
+      }
+      else if (req.type != DistanceRequestType::LIMITED || pair_distances.size() < req.max_contacts_per_body)
+        pair_distances.push_back(distance);
+    }
+  }
+}
+
+/** \brief Run the narrowphase collision checks of all candidate \e pairs on up to \e concurrency threads and merge the
+ *  per-thread results into \e res. Stops early once any thread has found enough collisions.
+ *  \return True if a thread was done with the query, as CollisionData::done_ of a sequential check */
+bool collideCandidates(const CandidatePairs& pairs, const CollisionRequest& req, CollisionResult& res,
+                       const AllowedCollisionMatrix* acm, const CompiledAllowedCollisionMatrix* compiled_acm,
+                       const moveit::core::RobotModelConstPtr& robot_model, std::size_t concurrency)
+{
+  std::vector<CollisionResult> results(concurrency);
+  std::vector<CollisionData> data;
+  data.reserve(concurrency);
+  for (CollisionResult& result : results)
+  {
+    data.emplace_back(&req, &result, acm);
+    data.back().compiled_acm_ = compiled_acm;
+    data.back().enableGroup(robot_model);
+  }
+
+  std::atomic<bool> done(false);
+  auto check_pair = [&](std::size_t thread, std::size_t i) {
+    if (!done.load(std::memory_order_relaxed) && collisionCallback(pairs[i].first, pairs[i].second, &data[thread]))
+      done = true;
+  };
+  moveit::core::ThreadPool::getShared().parallelFor(pairs.size(), check_pair, concurrency);
+
+  for (const CollisionResult& result : results)
+    mergeCollisionResult(req, result, res);
+  return done;
+}
+
+/** \brief Run the narrowphase distance queries of all candidate \e pairs on up to \e concurrency threads and merge the
+ *  per-thread results into \e res. */
+void distanceCandidates(const CandidatePairs& pairs, const DistanceRequest& req, DistanceResult& res,
+                        const CompiledAllowedCollisionMatrix* compiled_acm, DistanceCache* distance_cache,
+                        std::size_t concurrency)
+{
+  std::vector<DistanceResult> results(concurrency);
+  std::vector<DistanceData> data;
+  data.reserve(concurrency);
+  for (DistanceResult& result : results)
+  {
+    data.emplace_back(&req, &result);
+    data.back().compiled_acm = compiled_acm;
+    data.back().distance_cache = distance_cache;
+  }
+
+  std::atomic<bool> done(false);
+  auto check_pair = [&](std::size_t thread, std::size_t i) {
+    double min_dist = std::numeric_limits<double>::max();
+    if (!done.load(std::memory_order_relaxed) &&
+        distanceCallback(pairs[i].first, pairs[i].second, &data[thread], min_dist))
+      done = true;
+  };
+  moveit::core::ThreadPool::getShared().parallelFor(pairs.size(), check_pair, concurrency);
+
+  for (const DistanceResult& result : results)
+    mergeDistanceResult(req, result, res);
+}
+}  // namespace
+
 CollisionEnvFCL::CollisionEnvFCL(const moveit::core::RobotModelConstPtr& model, double padding, double scale)
   : CollisionEnv(model, padding, scale)
 {
@@ -222,6 +455,113 @@ void CollisionEnvFCL::allocSelfCollisionBroadPhase(const moveit::core::RobotStat
   // manager.manager_->update();
 }
 
+std::unique_ptr<CollisionEnvFCL::RobotBroadPhase>
+CollisionEnvFCL::acquireRobotBroadPhase(const moveit::core::RobotState& state, bool self_collision) const
+{
+  std::unique_ptr<RobotBroadPhase> broadphase;
+  std::size_t geometry_version;
+  {
+    // updatedPaddingOrScaling() changes the version under the same lock
+    std::lock_guard<std::mutex> lock(robot_broadphases_lock_);
+    geometry_version = robot_geometry_version_;
+    if (!robot_broadphases_.empty())
+    {
+      broadphase = std::move(robot_broadphases_.back());
+      robot_broadphases_.pop_back();
+    }
+  }
+  if (!broadphase || broadphase->geometry_version_ != geometry_version)
+  {
+    broadphase.reset(new RobotBroadPhase());
+    broadphase->geometry_version_ = geometry_version;
+    broadphase->link_objects_.resize(robot_geoms_.size());
+    for (std::size_t i = 0; i < robot_geoms_.size(); ++i)
+      if (robot_geoms_[i] && robot_geoms_[i]->collision_geometry_)
+        broadphase->link_objects_[i].reset(new fcl::CollisionObjectd(*robot_fcl_objs_[i]));
+  }
+
+  // move the link objects to the current state; their local AABBs are computed already
+  fcl::Transform3d fcl_tf;
+  broadphase->objects_.clear();
+  for (std::size_t i = 0; i < broadphase->link_objects_.size(); ++i)
+    if (broadphase->link_objects_[i])
+    {
+      transform2fcl(state.getCollisionBodyTransform(robot_geoms_[i]->collision_geometry_data_->ptr.link,
+                                                    robot_geoms_[i]->collision_geometry_data_->shape_index),
+                    fcl_tf);
+      broadphase->link_objects_[i]->setTransform(fcl_tf);
+      broadphase->link_objects_[i]->computeAABB();
+      broadphase->objects_.push_back(broadphase->link_objects_[i].get());
+    }
+
+  std::vector<const moveit::core::AttachedBody*> ab;
+  state.getAttachedBodies(ab);
+  for (auto& body : ab)
+  {
+    std::vector<FCLGeometryConstPtr> objs;
+    getAttachedBodyObjects(body, objs);
+    const EigenSTL::vector_Isometry3d& ab_t = body->getGlobalCollisionBodyTransforms();
+    for (std::size_t k = 0; k < objs.size(); ++k)
+      if (objs[k]->collision_geometry_)
+      {
+        transform2fcl(ab_t[k], fcl_tf);
+        broadphase->attached_objects_.collision_objects_.push_back(
+            FCLCollisionObjectPtr(new fcl::CollisionObjectd(objs[k]->collision_geometry_, fcl_tf)));
+        broadphase->attached_objects_.collision_geometry_.push_back(objs[k]);
+        broadphase->objects_.push_back(broadphase->attached_objects_.collision_objects_.back().get());
+      }
+  }
+
+  if (self_collision)
+  {
+    if (!broadphase->manager_)
+    {
+      // build the tree once, from the link objects' current AABBs
+      broadphase->manager_.reset(new fcl::DynamicAABBTreeCollisionManagerd());
+      std::vector<fcl::CollisionObjectd*> link_objects(broadphase->objects_.begin(),
+                                                       broadphase->objects_.end() -
+                                                           broadphase->attached_objects_.collision_objects_.size());
+      if (!link_objects.empty())
+        broadphase->manager_->registerObjects(link_objects);
+    }
+    broadphase->attached_objects_.registerTo(broadphase->manager_.get());
+    broadphase->attached_objects_registered_ = true;
+    // refit the tree to the moved objects instead of rebuilding it
+    broadphase->manager_->update();
+  }
+  return broadphase;
+}
+
+void CollisionEnvFCL::releaseRobotBroadPhase(std::unique_ptr<RobotBroadPhase> broadphase) const
+{
+  // attached bodies are not owned by the broadphase and may not outlive the query's state
+  if (broadphase->attached_objects_registered_)
+    broadphase->attached_objects_.unregisterFrom(broadphase->manager_.get());
+  broadphase->attached_objects_registered_ = false;
+  broadphase->attached_objects_.clear();
+  broadphase->objects_.clear();
+
+  std::lock_guard<std::mutex> lock(robot_broadphases_lock_);
+  if (broadphase->geometry_version_ == robot_geometry_version_)
+    robot_broadphases_.push_back(std::move(broadphase));
+}
+
+CompiledAllowedCollisionMatrixConstPtr CollisionEnvFCL::getCompiledACM(const AllowedCollisionMatrix& acm) const
+{
+  {
+    std::lock_guard<std::mutex> lock(compiled_acm_lock_);
+    if (compiled_acm_ && compiled_acm_->isCurrent(acm))
+      return compiled_acm_;
+  }
+
+  // compile without holding the lock, so queries using the cached matrix are not blocked
+  CompiledAllowedCollisionMatrixConstPtr compiled_acm =
+      std::make_shared<const CompiledAllowedCollisionMatrix>(acm, getRobotModel()->getLinkModelNames());
+  std::lock_guard<std::mutex> lock(compiled_acm_lock_);
+  compiled_acm_ = compiled_acm;
+  return compiled_acm;
+}
+
 void CollisionEnvFCL::checkSelfCollision(const CollisionRequest& req, CollisionResult& res,
                                          const moveit::core::RobotState& state) const
 {
@@ -238,11 +578,27 @@ void CollisionEnvFCL::checkSelfCollisionHelper(const CollisionRequest& req, Coll
                                                const moveit::core::RobotState& state,
                                                const AllowedCollisionMatrix* acm) const
 {
-  FCLManager manager;
-  allocSelfCollisionBroadPhase(state, manager);
-  CollisionData cd(&req, &res, acm);
-  cd.enableGroup(getRobotModel());
-  manager.manager_->collide(&cd, &collisionCallback);
+  std::unique_ptr<RobotBroadPhase> broadphase = acquireRobotBroadPhase(state, true);
+  // self-collision pairs are all pairs of robot links, which the compiled matrix covers
+  CompiledAllowedCollisionMatrixConstPtr compiled_acm = acm ? getCompiledACM(*acm) : nullptr;
+
+  const std::size_t concurrency = queryConcurrency(req.num_threads, static_cast<bool>(req.is_done));
+  if (concurrency > 1)
+  {
+    CandidatePairs candidates;
+    broadphase->manager_->collide(&candidates, &collectCollisionCandidate);
+    collideCandidates(candidates, req, res, acm, compiled_acm.get(), getRobotModel(),
+                      candidates.size() < MIN_PARALLEL_CANDIDATE_PAIRS ? 1 : concurrency);
+  }
+  else
+  {
+    CollisionData cd(&req, &res, acm);
+    cd.compiled_acm_ = compiled_acm.get();
+    cd.enableGroup(getRobotModel());
+    broadphase->manager_->collide(&cd, &collisionCallback);
+  }
+  releaseRobotBroadPhase(std::move(broadphase));
+
   if (req.distance)
   {
     DistanceRequest dreq;
@@ -250,6 +606,7 @@ void CollisionEnvFCL::checkSelfCollisionHelper(const CollisionRequest& req, Coll
 
     dreq.group_name = req.group_name;
     dreq.acm = acm;
+    dreq.num_threads = req.num_threads;
     dreq.enableGroup(getRobotModel());
     distanceSelf(dreq, dres, state);
     res.distance = dres.minimum_distance.distance;
@@ -273,7 +630,7 @@ void CollisionEnvFCL::checkRobotCollision(const CollisionRequest& req, Collision
                                           const moveit::core::RobotState& state1,
                                           const moveit::core::RobotState& state2) const
 {
-  ROS_ERROR_NAMED("collision_detection.bullet", "Continuous collision not implemented");
+  checkRobotCollisionHelperCCD(req, res, state1, state2, nullptr);
 }
 
 void CollisionEnvFCL::checkRobotCollision(const CollisionRequest& req, CollisionResult& res,
@@ -281,20 +638,46 @@ void CollisionEnvFCL::checkRobotCollision(const CollisionRequest& req, Collision
                                           const moveit::core::RobotState& state2,
                                           const AllowedCollisionMatrix& acm) const
 {
-  ROS_ERROR_NAMED("collision_detection.fcl", "Not implemented");
+  checkRobotCollisionHelperCCD(req, res, state1, state2, &acm);
 }
 
 void CollisionEnvFCL::checkRobotCollisionHelper(const CollisionRequest& req, CollisionResult& res,
                                                 const moveit::core::RobotState& state,
                                                 const AllowedCollisionMatrix* acm) const
 {
-  FCLObject fcl_obj;
-  constructFCLObjectRobot(state, fcl_obj);
+  std::unique_ptr<RobotBroadPhase> broadphase = acquireRobotBroadPhase(state, false);
+  const std::vector<fcl::CollisionObjectd*>& robot_objects = broadphase->objects_;
 
-  CollisionData cd(&req, &res, acm);
+  // octrees are checked against all robot objects they overlap at once, after the other world objects
+  DeferOctreesCollisionData cd(&req, &res, acm);
   cd.enableGroup(getRobotModel());
-  for (std::size_t i = 0; !cd.done_ && i < fcl_obj.collision_objects_.size(); ++i)
-    manager_->collide(fcl_obj.collision_objects_[i].get(), &cd, &collisionCallback);
+
+  const std::size_t concurrency = queryConcurrency(req.num_threads, static_cast<bool>(req.is_done));
+  if (concurrency > 1)
+  {
+    CandidatePairs candidates;
+    for (fcl::CollisionObjectd* robot_object : robot_objects)
+      manager_->collide(robot_object, &candidates, &collectCollisionCandidate);
+    candidates.erase(std::remove_if(candidates.begin(), candidates.end(),
+                                    [&cd](const std::pair<fcl::CollisionObjectd*, fcl::CollisionObjectd*>& pair) {
+                                      return deferOctreePair(pair.first, pair.second, cd.octree_candidates_);
+                                    }),
+                     candidates.end());
+    cd.done_ = collideCandidates(candidates, req, res, acm, nullptr, getRobotModel(),
+                                 candidates.size() < MIN_PARALLEL_CANDIDATE_PAIRS ? 1 : concurrency);
+  }
+  else
+  {
+    for (std::size_t i = 0; !cd.done_ && i < robot_objects.size(); ++i)
+      manager_->collide(robot_objects[i], &cd, &collisionCallbackDeferOctrees);
+  }
+
+  for (std::pair<fcl::CollisionObjectd* const, std::vector<fcl::CollisionObjectd*> >& octree : cd.octree_candidates_)
+  {
+    if (collideOctree(octree.first, octree.second, cd))
+      break;
+  }
+  releaseRobotBroadPhase(std::move(broadphase));
 
   if (req.distance)
   {
@@ -303,31 +686,141 @@ void CollisionEnvFCL::checkRobotCollisionHelper(const CollisionRequest& req, Col
 
     dreq.group_name = req.group_name;
     dreq.acm = acm;
+    dreq.num_threads = req.num_threads;
     dreq.enableGroup(getRobotModel());
     distanceRobot(dreq, dres, state);
     res.distance = dres.minimum_distance.distance;
   }
 }
 
+void CollisionEnvFCL::checkRobotCollisionHelperCCD(const CollisionRequest& req, CollisionResult& res,
+                                                   const moveit::core::RobotState& state1,
+                                                   const moveit::core::RobotState& state2,
+                                                   const AllowedCollisionMatrix* acm) const
+{
+  ContinuousCollisionData cd(&req, &res, acm);
+  cd.enableGroup(getRobotModel());
+  auto is_active = [&cd](const moveit::core::LinkModel* link) {
+    return !cd.active_components_only_ || cd.active_components_only_->count(link) > 0;
+  };
+
+  for (const moveit::core::LinkModel* link : robot_model_->getLinkModelsWithCollisionGeometry())
+  {
+    if (!is_active(link))
+      continue;
+    for (std::size_t j = 0; !cd.done_ && j < link->getShapes().size(); ++j)
+    {
+      const FCLGeometryConstPtr& geometry = robot_geoms_[link->getFirstCollisionBodyTransformIndex() + j];
+      if (geometry)
+        castRobotBody(*geometry, state1.getCollisionBodyTransform(link, j), state2.getCollisionBodyTransform(link, j),
+                      cd);
+    }
+  }
+
+  std::vector<const moveit::core::AttachedBody*> attached_bodies;
+  state1.getAttachedBodies(attached_bodies);
+  for (const moveit::core::AttachedBody* body : attached_bodies)
+  {
+    if (cd.done_)
+      break;
+    if (!is_active(body->getAttachedLink()))
+      continue;
+    const moveit::core::AttachedBody* end_body = state2.getAttachedBody(body->getName());
+    if (!end_body || end_body->getShapes().size() != body->getShapes().size())
+    {
+      ROS_WARN_NAMED("collision_detection.fcl",
+                     "Attached body '%s' is not attached in the same way at the end of the motion. It is ignored "
+                     "by the continuous collision check.",
+                     body->getName().c_str());
+      continue;
+    }
+
+    std::vector<FCLGeometryConstPtr> geometries;
+    getAttachedBodyObjects(body, geometries);
+    for (std::size_t k = 0; !cd.done_ && k < geometries.size(); ++k)
+    {
+      const int shape_index = geometries[k]->collision_geometry_data_->shape_index;
+      castRobotBody(*geometries[k], body->getGlobalCollisionBodyTransforms()[shape_index],
+                    end_body->getGlobalCollisionBodyTransforms()[shape_index], cd);
+    }
+  }
+}
+
+void CollisionEnvFCL::castRobotBody(const FCLGeometry& body, const Eigen::Isometry3d& start,
+                                    const Eigen::Isometry3d& end, ContinuousCollisionData& cdata) const
+{
+  // FCL's linear motion moves the origin of the body on a straight line, so the body stays within a sphere of this
+  // radius around that line
+  const fcl::CollisionGeometryd& geometry = *body.collision_geometry_;
+  const double radius =
+      Eigen::Vector3d(geometry.aabb_center[0], geometry.aabb_center[1], geometry.aabb_center[2]).norm() +
+      geometry.aabb_radius;
+  const Eigen::Vector3d min = start.translation().cwiseMin(end.translation()).array() - radius;
+  const Eigen::Vector3d max = start.translation().cwiseMax(end.translation()).array() + radius;
+
+  const Eigen::Vector3d size = max - min;
+  Eigen::Isometry3d swept_pose = Eigen::Isometry3d::Identity();
+  swept_pose.translation() = 0.5 * (min + max);
+  fcl::CollisionObjectd swept_object(std::make_shared<fcl::Boxd>(size.x(), size.y(), size.z()),
+                                     transform2fcl(swept_pose));
+
+  cdata.swept_object_ = &swept_object;
+  cdata.body_ = &body;
+  cdata.body_start_ = start;
+  cdata.body_end_ = end;
+  manager_->collide(&swept_object, &cdata, &continuousCollisionCallback);
+  cdata.swept_object_ = nullptr;
+}
+
 void CollisionEnvFCL::distanceSelf(const DistanceRequest& req, DistanceResult& res,
                                    const moveit::core::RobotState& state) const
 {
-  FCLManager manager;
-  allocSelfCollisionBroadPhase(state, manager);
-  DistanceData drd(&req, &res);
+  std::unique_ptr<RobotBroadPhase> broadphase = acquireRobotBroadPhase(state, true);
+  CompiledAllowedCollisionMatrixConstPtr compiled_acm = req.acm ? getCompiledACM(*req.acm) : nullptr;
 
-  manager.manager_->distance(&drd, &distanceCallback);
+  const std::size_t concurrency = queryConcurrency(req.num_threads, false);
+  if (concurrency > 1)
+  {
+    DistanceCandidateData candidates(&req, compiled_acm.get());
+    broadphase->manager_->distance(&candidates, &collectDistanceCandidate);
+    candidates.prune();
+    distanceCandidates(candidates.pairs_, req, res, compiled_acm.get(), &distance_cache_,
+                       candidates.pairs_.size() < MIN_PARALLEL_CANDIDATE_PAIRS ? 1 : concurrency);
+  }
+  else
+  {
+    DistanceData drd(&req, &res);
+    drd.compiled_acm = compiled_acm.get();
+    drd.distance_cache = &distance_cache_;
+    broadphase->manager_->distance(&drd, &distanceCallback);
+  }
+  releaseRobotBroadPhase(std::move(broadphase));
 }
 
 void CollisionEnvFCL::distanceRobot(const DistanceRequest& req, DistanceResult& res,
                                     const moveit::core::RobotState& state) const
 {
-  FCLObject fcl_obj;
-  constructFCLObjectRobot(state, fcl_obj);
+  std::unique_ptr<RobotBroadPhase> broadphase = acquireRobotBroadPhase(state, false);
+  const std::vector<fcl::CollisionObjectd*>& robot_objects = broadphase->objects_;
 
-  DistanceData drd(&req, &res);
-  for (std::size_t i = 0; !drd.done && i < fcl_obj.collision_objects_.size(); ++i)
-    manager_->distance(fcl_obj.collision_objects_[i].get(), &drd, &distanceCallback);
+  const std::size_t concurrency = queryConcurrency(req.num_threads, false);
+  if (concurrency > 1)
+  {
+    DistanceCandidateData candidates(&req, nullptr);
+    for (fcl::CollisionObjectd* robot_object : robot_objects)
+      manager_->distance(robot_object, &candidates, &collectDistanceCandidate);
+    candidates.prune();
+    distanceCandidates(candidates.pairs_, req, res, nullptr, &distance_cache_,
+                       candidates.pairs_.size() < MIN_PARALLEL_CANDIDATE_PAIRS ? 1 : concurrency);
+  }
+  else
+  {
+    DistanceData drd(&req, &res);
+    drd.distance_cache = &distance_cache_;
+    for (std::size_t i = 0; !drd.done && i < robot_objects.size(); ++i)
+      manager_->distance(robot_objects[i], &drd, &distanceCallback);
+  }
+  releaseRobotBroadPhase(std::move(broadphase));
 }
 
 void CollisionEnvFCL::updateFCLObject(const std::string& id)
@@ -377,6 +870,7 @@ void CollisionEnvFCL::setWorld(const WorldPtr& world)
   manager_->clear();
   fcl_objs_.clear();
   cleanCollisionGeometryCache();
+  distance_cache_.clear();
 
   CollisionEnv::setWorld(world);
 
@@ -389,6 +883,8 @@ void CollisionEnvFCL::setWorld(const WorldPtr& world)
 
 void CollisionEnvFCL::notifyObjectChange(const ObjectConstPtr& obj, World::Action action)
 {
+  // shapes such as octrees may have been modified in place
+  distance_cache_.clear();
   if (action == World::DESTROY)
   {
     auto it = fcl_objs_.find(obj->id_);
@@ -431,6 +927,12 @@ void CollisionEnvFCL::updatedPaddingOrScaling(const std::vector<std::string>& li
     else
       ROS_ERROR_NAMED("collision_detection.fcl", "Updating padding or scaling for unknown link: '%s'", link.c_str());
   }
+
+  // pooled robot broadphases hold copies of the old link objects
+  std::lock_guard<std::mutex> lock(robot_broadphases_lock_);
+  ++robot_geometry_version_;
+  robot_broadphases_.clear();
+  distance_cache_.clear();
 }
 
 }  // end of namespace collision_detection
@@ -0,0 +1,167 @@
+/*********************************************************************
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2020, PickNik LLC.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the copyright holder nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************/
+
+#include <moveit/collision_detection_fcl/collision_env_fcl.h>
+#include <moveit/collision_detection_fcl/collision_common.h>
+#include <moveit/robot_state/robot_state.h>
+#include <moveit/utils/robot_model_test_utils.h>
+#include <geometric_shapes/shapes.h>
+#include <gtest/gtest.h>
+#include <chrono>
+
+// Helper class to measure time within a scoped block and output the result
+class ScopedTimer
+{
+  const char* const msg_;
+  double* const gold_standard_;
+  const std::chrono::time_point<std::chrono::steady_clock> start_;
+
+public:
+  // if gold_standard is provided, a relative increase/decrease is shown too
+  ScopedTimer(const char* msg = "", double* gold_standard = nullptr)
+    : msg_(msg), gold_standard_(gold_standard), start_(std::chrono::steady_clock::now())
+  {
+  }
+
+  ~ScopedTimer()
+  {
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start_;
+    std::cerr << msg_ << elapsed.count() * 1000. << "ms ";
+
+    if (gold_standard_)
+    {
+      if (*gold_standard_ == 0)
+        *gold_standard_ = elapsed.count();
+      std::cerr << 100 * elapsed.count() / *gold_standard_ << "%";
+    }
+    std::cerr << std::endl;
+  }
+};
+
+// Exposes the previous query path, which allocates new robot collision objects and a new broadphase per query
+class RebuildingCollisionEnvFCL : public collision_detection::CollisionEnvFCL
+{
+public:
+  using CollisionEnvFCL::CollisionEnvFCL;
+
+  bool isStateColliding(const moveit::core::RobotState& state, const collision_detection::AllowedCollisionMatrix& acm)
+  {
+    collision_detection::CollisionRequest req;
+    collision_detection::CollisionResult res;
+    {
+      collision_detection::FCLManager manager;
+      allocSelfCollisionBroadPhase(state, manager);
+      collision_detection::CollisionData cd(&req, &res, &acm);
+      cd.enableGroup(getRobotModel());
+      manager.manager_->collide(&cd, &collision_detection::collisionCallback);
+    }
+    if (!res.collision)
+    {
+      collision_detection::FCLObject fcl_obj;
+      constructFCLObjectRobot(state, fcl_obj);
+      collision_detection::CollisionData cd(&req, &res, &acm);
+      cd.enableGroup(getRobotModel());
+      for (std::size_t i = 0; !cd.done_ && i < fcl_obj.collision_objects_.size(); ++i)
+        manager_->collide(fcl_obj.collision_objects_[i].get(), &cd, &collision_detection::collisionCallback);
+    }
+    return res.collision;
+  }
+};
+
+bool isStateColliding(const collision_detection::CollisionEnv& env, const moveit::core::RobotState& state,
+                      const collision_detection::AllowedCollisionMatrix& acm)
+{
+  collision_detection::CollisionRequest req;
+  collision_detection::CollisionResult res;
+  env.checkSelfCollision(req, res, state, acm);
+  if (!res.collision)
+    env.checkRobotCollision(req, res, state, acm);
+  return res.collision;
+}
+
+// Validity checks of 10k random states, as done by a sampling-based planner
+TEST(Timing, validityChecks)
+{
+  const std::size_t num_states = 10000;
+  moveit::core::RobotModelPtr model = moveit::core::loadTestingRobotModel("panda");
+  ASSERT_TRUE(bool(model));
+
+  collision_detection::AllowedCollisionMatrix acm(model->getLinkModelNames(), false);
+  const std::vector<std::string> links = { "panda_link0", "panda_link1", "panda_link2", "panda_link3",
+                                           "panda_link4", "panda_link5", "panda_link6", "panda_link7",
+                                           "panda_hand" };
+  for (std::size_t i = 0; i + 1 < links.size(); ++i)
+    acm.setEntry(links[i], links[i + 1], true);
+  acm.setEntry("panda_hand", "panda_leftfinger", true);
+  acm.setEntry("panda_hand", "panda_rightfinger", true);
+  acm.setEntry("panda_leftfinger", "panda_rightfinger", true);
+
+  collision_detection::WorldPtr world(new collision_detection::World());
+  shapes::ShapeConstPtr box(new shapes::Box(0.1, 0.1, 0.1));
+  for (int i = 0; i < 20; ++i)
+  {
+    Eigen::Isometry3d pose = Eigen::Isometry3d::Identity();
+    pose.translation() = Eigen::Vector3d(0.6 * std::cos(0.3 * i), 0.6 * std::sin(0.3 * i), 0.05 * i);
+    world->addToObject("box" + std::to_string(i), box, pose);
+  }
+  collision_detection::CollisionEnvFCL persistent_env(model, world);
+  RebuildingCollisionEnvFCL rebuilding_env(model, world);
+
+  std::vector<moveit::core::RobotState> states(num_states, moveit::core::RobotState(model));
+  for (moveit::core::RobotState& state : states)
+  {
+    state.setToRandomPositions();
+    state.update();
+  }
+
+  std::vector<bool> rebuilding_result(num_states), persistent_result(num_states);
+  double gold_standard = 0;
+  {
+    ScopedTimer t("Rebuilding broadphase per check: ", &gold_standard);
+    for (std::size_t i = 0; i < num_states; ++i)
+      rebuilding_result[i] = rebuilding_env.isStateColliding(states[i], acm);
+  }
+  {
+    ScopedTimer t("Persistent, refit broadphase: ", &gold_standard);
+    for (std::size_t i = 0; i < num_states; ++i)
+      persistent_result[i] = isStateColliding(persistent_env, states[i], acm);
+  }
+  EXPECT_EQ(rebuilding_result, persistent_result);
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -48,6 +48,9 @@
 
 #include <urdf_parser/urdf_parser.h>
 #include <geometric_shapes/shape_operations.h>
+#include <octomap/octomap.h>
+
+#include <set>
 
 /** \brief Brings the panda robot in user defined home position */
 inline void setToHome(moveit::core::RobotState& panda_state)
@@ -222,6 +225,273 @@ TEST_F(CollisionDetectionEnvTest, PaddingTest)
   ASSERT_FALSE(res.collision);
 }
 
+/** \brief Splitting a query across threads yields the same contacts and distances as the sequential check. */
+TEST_F(CollisionDetectionEnvTest, ParallelQueriesMatchSequential)
+{
+  // a colliding configuration in a cluttered world
+  robot_state_->setToDefaultValues();
+  robot_state_->update();
+  shapes::ShapeConstPtr shape_ptr(new shapes::Box(0.05, 0.05, 0.05));
+  for (int i = 0; i < 10; ++i)
+    for (int j = 0; j < 10; ++j)
+    {
+      Eigen::Isometry3d pos{ Eigen::Isometry3d::Identity() };
+      pos.translation() = Eigen::Vector3d(-0.5 + 0.1 * i, -0.5 + 0.1 * j, 0.3);
+      c_env_->getWorld()->addToObject("box_" + std::to_string(i) + "_" + std::to_string(j), shape_ptr, pos);
+    }
+
+  collision_detection::CollisionRequest req;
+  req.contacts = true;
+  req.max_contacts = 1000;
+  collision_detection::CollisionResult sequential_self, sequential_robot;
+  c_env_->checkSelfCollision(req, sequential_self, *robot_state_);
+  c_env_->checkRobotCollision(req, sequential_robot, *robot_state_);
+  ASSERT_TRUE(sequential_self.collision);
+  ASSERT_TRUE(sequential_robot.collision);
+
+  req.num_threads = 4;
+  collision_detection::CollisionResult parallel_self, parallel_robot;
+  c_env_->checkSelfCollision(req, parallel_self, *robot_state_);
+  c_env_->checkRobotCollision(req, parallel_robot, *robot_state_);
+  EXPECT_TRUE(parallel_self.collision);
+  EXPECT_TRUE(parallel_robot.collision);
+  EXPECT_EQ(parallel_self.contact_count, sequential_self.contact_count);
+  EXPECT_EQ(parallel_robot.contact_count, sequential_robot.contact_count);
+  for (const auto& contacts : sequential_robot.contacts)
+    EXPECT_EQ(parallel_robot.contacts.count(contacts.first), 1u)
+        << contacts.first.first << " " << contacts.first.second;
+
+  // the overall contact limit still holds
+  req.max_contacts = 3;
+  collision_detection::CollisionResult limited;
+  c_env_->checkRobotCollision(req, limited, *robot_state_);
+  EXPECT_TRUE(limited.collision);
+  EXPECT_LE(limited.contact_count, 3u);
+
+  // binary checks terminate early and still report the collision
+  collision_detection::CollisionRequest binary_req;
+  binary_req.num_threads = 0;
+  collision_detection::CollisionResult binary;
+  c_env_->checkRobotCollision(binary_req, binary, *robot_state_);
+  EXPECT_TRUE(binary.collision);
+
+  setToHome(*robot_state_);
+  collision_detection::DistanceRequest dreq;
+  dreq.type = collision_detection::DistanceRequestType::SINGLE;
+  dreq.acm = acm_.get();
+  collision_detection::DistanceResult sequential_distance, parallel_distance;
+  c_env_->distanceSelf(dreq, sequential_distance, *robot_state_);
+  dreq.num_threads = 4;
+  c_env_->distanceSelf(dreq, parallel_distance, *robot_state_);
+  EXPECT_NEAR(parallel_distance.minimum_distance.distance, sequential_distance.minimum_distance.distance, 1e-9);
+  EXPECT_EQ(parallel_distance.distances.size(), sequential_distance.distances.size());
+
+  dreq.num_threads = 1;
+  sequential_distance.clear();
+  parallel_distance.clear();
+  c_env_->distanceRobot(dreq, sequential_distance, *robot_state_);
+  dreq.num_threads = 4;
+  c_env_->distanceRobot(dreq, parallel_distance, *robot_state_);
+  EXPECT_NEAR(parallel_distance.minimum_distance.distance, sequential_distance.minimum_distance.distance, 1e-9);
+  EXPECT_EQ(parallel_distance.distances.size(), sequential_distance.distances.size());
+}
+
+/** \brief Repeated checks reuse the robot's broadphase; attached bodies must not outlive the query they were in. */
+TEST_F(CollisionDetectionEnvTest, AttachedBodiesInRepeatedChecks)
+{
+  collision_detection::CollisionRequest req;
+  for (int i = 0; i < 3; ++i)
+  {
+    shapes::ShapeConstPtr shape_ptr(new shapes::Box(1.0, 1.0, 1.0));
+    robot_state_->attachBody("box", { shape_ptr }, { Eigen::Isometry3d::Identity() },
+                             std::vector<std::string>{ "panda_hand", "panda_leftfinger", "panda_rightfinger" },
+                             "panda_hand");
+    robot_state_->update();
+
+    collision_detection::CollisionResult res;
+    c_env_->checkSelfCollision(req, res, *robot_state_, *acm_);
+    EXPECT_TRUE(res.collision);
+
+    robot_state_->clearAttachedBody("box");
+    res.clear();
+    c_env_->checkSelfCollision(req, res, *robot_state_, *acm_);
+    EXPECT_FALSE(res.collision);
+  }
+}
+
+/** \brief Self collision checks use a cached, compiled copy of the ACM, which must follow changes to the ACM. */
+TEST_F(CollisionDetectionEnvTest, ModifiedACMInRepeatedChecks)
+{
+  robot_state_->setToDefaultValues();
+  robot_state_->update();
+
+  collision_detection::CollisionRequest req;
+  req.contacts = true;
+  req.max_contacts = 100;
+  collision_detection::CollisionResult res;
+  c_env_->checkSelfCollision(req, res, *robot_state_, *acm_);
+  ASSERT_TRUE(res.collision);
+
+  for (const auto& contact : res.contacts)
+    acm_->setEntry(contact.first.first, contact.first.second, true);
+  res.clear();
+  c_env_->checkSelfCollision(req, res, *robot_state_, *acm_);
+  EXPECT_FALSE(res.collision);
+
+  // a matrix that allows no collisions reports the collision again
+  collision_detection::AllowedCollisionMatrix acm(*acm_);
+  acm.setEntry(false);
+  res.clear();
+  c_env_->checkSelfCollision(req, res, *robot_state_, acm);
+  EXPECT_TRUE(res.collision);
+}
+
+/** \brief Distance queries for slightly moved states reuse earlier results, which must not change the answers. */
+TEST_F(CollisionDetectionEnvTest, DistanceCacheInRepeatedQueries)
+{
+  shapes::ShapeConstPtr shape_ptr(new shapes::Box(0.1, 0.1, 0.1));
+  Eigen::Isometry3d pos{ Eigen::Isometry3d::Identity() };
+  pos.translation() = Eigen::Vector3d(0.4, 0.0, 0.4);
+  c_env_->getWorld()->addToObject("box", shape_ptr, pos);
+
+  collision_detection::DistanceRequest dreq;
+  dreq.type = collision_detection::DistanceRequestType::SINGLE;
+  dreq.enable_nearest_points = true;
+  dreq.acm = acm_.get();
+
+  double joint1 = 0.0;
+  for (int i = 0; i < 20; ++i)
+  {
+    // query the same state twice and a slightly moved one, the latter also from an environment without cached results
+    for (int repeat = 0; repeat < 2; ++repeat)
+    {
+      robot_state_->setJointPositions("panda_joint1", &joint1);
+      robot_state_->update();
+      collision_detection::CollisionEnvFCL fresh_env(robot_model_);
+      fresh_env.getWorld()->addToObject("box", shape_ptr, pos);
+
+      collision_detection::DistanceResult cached_robot, fresh_robot, cached_self, fresh_self;
+      c_env_->distanceRobot(dreq, cached_robot, *robot_state_);
+      fresh_env.distanceRobot(dreq, fresh_robot, *robot_state_);
+      c_env_->distanceSelf(dreq, cached_self, *robot_state_);
+      fresh_env.distanceSelf(dreq, fresh_self, *robot_state_);
+
+      EXPECT_NEAR(cached_robot.minimum_distance.distance, fresh_robot.minimum_distance.distance, 1e-6);
+      EXPECT_NEAR(cached_self.minimum_distance.distance, fresh_self.minimum_distance.distance, 1e-6);
+      EXPECT_TRUE(cached_robot.minimum_distance.nearest_points[0].isApprox(
+          fresh_robot.minimum_distance.nearest_points[0], 1e-6));
+      EXPECT_EQ(cached_robot.distances.size(), fresh_robot.distances.size());
+      EXPECT_EQ(cached_self.distances.size(), fresh_self.distances.size());
+    }
+    joint1 += 0.01;
+  }
+
+  // moving the world object invalidates its cached results
+  pos.translation() = Eigen::Vector3d(0.6, 0.0, 0.4);
+  c_env_->getWorld()->moveShapeInObject("box", shape_ptr, pos);
+  collision_detection::CollisionEnvFCL fresh_env(robot_model_);
+  fresh_env.getWorld()->addToObject("box", shape_ptr, pos);
+  collision_detection::DistanceResult cached_robot, fresh_robot;
+  c_env_->distanceRobot(dreq, cached_robot, *robot_state_);
+  fresh_env.distanceRobot(dreq, fresh_robot, *robot_state_);
+  EXPECT_NEAR(cached_robot.minimum_distance.distance, fresh_robot.minimum_distance.distance, 1e-6);
+}
+
+/** \brief Octomaps are modified in place without notifying the world, so their distances must not be cached */
+TEST_F(CollisionDetectionEnvTest, DistanceCacheWithModifiedOctomap)
+{
+  std::shared_ptr<octomap::OcTree> tree(new octomap::OcTree(0.05));
+  tree->updateNode(0.8, 0.0, 0.4, true);
+  tree->updateInnerOccupancy();
+  shapes::ShapeConstPtr octree_ptr(new shapes::OcTree(tree));
+  c_env_->getWorld()->addToObject("octomap", octree_ptr, Eigen::Isometry3d::Identity());
+
+  collision_detection::DistanceRequest dreq;
+  dreq.acm = acm_.get();
+  collision_detection::DistanceResult before;
+  c_env_->distanceRobot(dreq, before, *robot_state_);
+
+  // move the occupied cell closer to the robot
+  tree->updateNode(0.8, 0.0, 0.4, false);
+  tree->updateNode(0.5, 0.0, 0.4, true);
+  tree->updateInnerOccupancy();
+  collision_detection::CollisionEnvFCL fresh_env(robot_model_);
+  fresh_env.getWorld()->addToObject("octomap", octree_ptr, Eigen::Isometry3d::Identity());
+  collision_detection::DistanceResult cached, fresh;
+  c_env_->distanceRobot(dreq, cached, *robot_state_);
+  fresh_env.distanceRobot(dreq, fresh, *robot_state_);
+  EXPECT_LT(fresh.minimum_distance.distance, before.minimum_distance.distance);
+  EXPECT_NEAR(cached.minimum_distance.distance, fresh.minimum_distance.distance, 1e-6);
+}
+
+/** \brief Octomaps are checked in a single traversal against all robot bodies; the result has to match the one of the
+ *  same occupied cells added as separate boxes. */
+TEST_F(CollisionDetectionEnvTest, OctomapCollision)
+{
+  const double resolution = 0.02;
+  std::shared_ptr<octomap::OcTree> tree(new octomap::OcTree(resolution));
+  collision_detection::CollisionEnvFCL boxes_env(robot_model_);
+  shapes::ShapeConstPtr cell_ptr(new shapes::Box(resolution, resolution, resolution));
+  for (int i = -5; i < 5; ++i)
+    for (int j = -5; j < 5; ++j)
+      for (int k = 12; k < 18; ++k)
+      {
+        // cell centers, so that the boxes match the octree's leaves
+        Eigen::Isometry3d pos{ Eigen::Isometry3d::Identity() };
+        pos.translation() = Eigen::Vector3d(i + 0.5, j + 0.5, k + 0.5) * resolution;
+        tree->updateNode(pos.translation().x(), pos.translation().y(), pos.translation().z(), true);
+        const std::string name = "box_" + std::to_string(i) + "_" + std::to_string(j) + "_" + std::to_string(k);
+        boxes_env.getWorld()->addToObject(name, cell_ptr, pos);
+      }
+  tree->updateInnerOccupancy();
+  shapes::ShapeConstPtr octree_ptr(new shapes::OcTree(tree));
+  c_env_->getWorld()->addToObject("octomap", octree_ptr, Eigen::Isometry3d::Identity());
+
+  collision_detection::CollisionRequest req;
+  collision_detection::CollisionResult res;
+  c_env_->checkRobotCollision(req, res, *robot_state_, *acm_);
+  EXPECT_TRUE(res.collision);
+
+  // the same robot links are reported as with the separate boxes, sequentially and in parallel
+  req.contacts = true;
+  req.max_contacts = 1000;
+  collision_detection::CollisionResult boxes_res;
+  boxes_env.checkRobotCollision(req, boxes_res, *robot_state_, *acm_);
+  ASSERT_TRUE(boxes_res.collision);
+  std::set<std::string> boxes_links;
+  for (const auto& contacts : boxes_res.contacts)
+    boxes_links.insert(contacts.first.first.compare(0, 4, "box_") == 0 ? contacts.first.second : contacts.first.first);
+  for (std::size_t num_threads : { 1u, 4u })
+  {
+    req.num_threads = num_threads;
+    res.clear();
+    c_env_->checkRobotCollision(req, res, *robot_state_, *acm_);
+    EXPECT_TRUE(res.collision);
+    std::set<std::string> octree_links;
+    for (const auto& contacts : res.contacts)
+    {
+      ASSERT_TRUE(contacts.first.first == "octomap" || contacts.first.second == "octomap");
+      octree_links.insert(contacts.first.first == "octomap" ? contacts.first.second : contacts.first.first);
+    }
+    EXPECT_EQ(octree_links, boxes_links);
+  }
+
+  // collisions with the octomap may be allowed
+  collision_detection::AllowedCollisionMatrix acm(*acm_);
+  acm.setDefaultEntry("octomap", true);
+  res.clear();
+  c_env_->checkRobotCollision(req, res, *robot_state_, acm);
+  EXPECT_FALSE(res.collision);
+
+  // no collision once the octomap is moved away from the robot
+  Eigen::Isometry3d pos{ Eigen::Isometry3d::Identity() };
+  pos.translation() = Eigen::Vector3d(2.0, 2.0, 0.0);
+  c_env_->getWorld()->moveObject("octomap", pos);
+  res.clear();
+  c_env_->checkRobotCollision(req, res, *robot_state_, *acm_);
+  EXPECT_FALSE(res.collision);
+}
+
 /** \brief Continuous self collision checks of the robot.
  *
  *  Functionality not supported yet. */
@@ -266,10 +536,8 @@ TEST_F(CollisionDetectionEnvTest, DISABLED_ContinuousCollisionSelf)
   res.clear();
 }
 
-/** \brief Two similar robot poses are used as start and end pose of a continuous collision check.
- *
- *  Functionality not supported yet. */
-TEST_F(CollisionDetectionEnvTest, DISABLED_ContinuousCollisionWorld)
+/** \brief Two similar robot poses are used as start and end pose of a continuous collision check. */
+TEST_F(CollisionDetectionEnvTest, ContinuousCollisionWorld)
 {
   collision_detection::CollisionRequest req;
   req.contacts = true;
@@ -313,8 +581,38 @@ TEST_F(CollisionDetectionEnvTest, DISABLED_ContinuousCollisionWorld)
 
   c_env_->checkRobotCollision(req, res, state1, state2, *acm_);
   ASSERT_TRUE(res.collision);
-  ASSERT_EQ(res.contact_count, 4u);
+  ASSERT_GE(res.contact_count, 1u);
+  for (const auto& contacts : res.contacts)
+    for (const collision_detection::Contact& contact : contacts.second)
+    {
+      EXPECT_GT(contact.percent_interpolation, 0.0);
+      EXPECT_LT(contact.percent_interpolation, 1.0);
+    }
+  res.clear();
+
+  // the box does not block the motion if collisions with it are allowed
+  collision_detection::AllowedCollisionMatrix acm(*acm_);
+  acm.setDefaultEntry("box", true);
+  c_env_->checkRobotCollision(req, res, state1, state2, acm);
+  EXPECT_FALSE(res.collision);
+  res.clear();
+
+  // allowing only the first contact does not allow the rest of the motion through the box
+  std::size_t decisions = 0;
+  collision_detection::DecideContactFn allow_first = [&decisions](collision_detection::Contact& /*contact*/) {
+    return decisions++ == 0;
+  };
+  acm.setDefaultEntry("box", allow_first);
+  c_env_->checkRobotCollision(req, res, state1, state2, acm);
+  EXPECT_TRUE(res.collision);
+  EXPECT_GT(decisions, 1u);
   res.clear();
+
+  // if all contacts are allowed, the motion is collision-free
+  collision_detection::DecideContactFn allow_all = [](collision_detection::Contact& /*contact*/) { return true; };
+  acm.setDefaultEntry("box", allow_all);
+  c_env_->checkRobotCollision(req, res, state1, state2, acm);
+  EXPECT_FALSE(res.collision);
 }
 
 int main(int argc, char** argv)
@@ -47,5 +47,50 @@ class CollisionDetectorAllocatorHybrid
 {
 public:
   static const std::string NAME;  // defined in collision_env_hybrid.cpp
+
+  CollisionDetectorAllocatorHybrid(DistanceFieldType distance_field_type = DEFAULT_DISTANCE_FIELD_TYPE,
+                                   bool interpolate_gradients = false)
+    : distance_field_type_(distance_field_type), interpolate_gradients_(interpolate_gradients)
+  {
+  }
+
+  CollisionEnvPtr allocateEnv(const WorldPtr& world, const moveit::core::RobotModelConstPtr& robot_model) const override
+  {
+    CollisionEnvHybrid* env = new CollisionEnvHybrid(
+        robot_model, world, std::map<std::string, std::vector<CollisionSphere>>(), DEFAULT_SIZE_X, DEFAULT_SIZE_Y,
+        DEFAULT_SIZE_Z, Eigen::Vector3d(0, 0, 0), DEFAULT_USE_SIGNED_DISTANCE_FIELD, DEFAULT_RESOLUTION,
+        DEFAULT_COLLISION_TOLERANCE, DEFAULT_MAX_PROPOGATION_DISTANCE, 0.0, 1.0, distance_field_type_);
+    env->setInterpolateGradients(interpolate_gradients_);
+    return CollisionEnvPtr(env);
+  }
+
+  CollisionEnvPtr allocateEnv(const CollisionEnvConstPtr& orig, const WorldPtr& world) const override
+  {
+    return CollisionDetectorAllocatorTemplate::allocateEnv(orig, world);
+  }
+
+  CollisionEnvPtr allocateEnv(const moveit::core::RobotModelConstPtr& robot_model) const override
+  {
+    CollisionEnvHybrid* env = new CollisionEnvHybrid(
+        robot_model, std::map<std::string, std::vector<CollisionSphere>>(), DEFAULT_SIZE_X, DEFAULT_SIZE_Y,
+        DEFAULT_SIZE_Z, Eigen::Vector3d(0, 0, 0), DEFAULT_USE_SIGNED_DISTANCE_FIELD, DEFAULT_RESOLUTION,
+        DEFAULT_COLLISION_TOLERANCE, DEFAULT_MAX_PROPOGATION_DISTANCE, 0.0, 1.0, distance_field_type_);
+    env->setInterpolateGradients(interpolate_gradients_);
+    return CollisionEnvPtr(env);
+  }
+
+  /** \brief Create an allocator for hybrid collision detectors whose distance fields are of \e distance_field_type,
+   *  so the distance field of the world is only computed once. If \e interpolate_gradients is set, the gradients
+   *  are interpolated, see CollisionEnvDistanceField::setInterpolateGradients(). */
+  static CollisionDetectorAllocatorPtr create(DistanceFieldType distance_field_type = DEFAULT_DISTANCE_FIELD_TYPE,
+                                              bool interpolate_gradients = false)
+  {
+    return CollisionDetectorAllocatorPtr(
+        new CollisionDetectorAllocatorHybrid(distance_field_type, interpolate_gradients));
+  }
+
+private:
+  DistanceFieldType distance_field_type_;
+  bool interpolate_gradients_;
 };
 }
@@ -38,6 +38,8 @@
 
 #include <vector>
 #include <string>
+#include <unordered_map>
+#include <cstdint>
 #include <algorithm>
 #include <sstream>
 #include <memory>
@@ -202,12 +204,14 @@ protected:
 std::vector<CollisionSphere> determineCollisionSpheres(const bodies::Body* body, Eigen::Isometry3d& relativeTransform);
 
 // determines a set of gradients of the given collision spheres in the distance
-// field
+// field; if interpolate is set, the distances and gradients of all spheres are
+// looked up at once and trilinearly interpolated, see
+// DistanceField::getInterpolatedDistanceGradients()
 bool getCollisionSphereGradients(const distance_field::DistanceField* distance_field,
                                  const std::vector<CollisionSphere>& sphere_list,
                                  const EigenSTL::vector_Vector3d& sphere_centers, GradientInfo& gradient,
                                  const CollisionType& type, double tolerance, bool subtract_radii, double maximum_value,
-                                 bool stop_at_first_collision);
+                                 bool stop_at_first_collision, bool interpolate = false);
 
 bool getCollisionSphereCollision(const distance_field::DistanceField* distance_field,
                                  const std::vector<CollisionSphere>& sphere_list,
@@ -351,6 +355,7 @@ public:
 
   PosedBodyPointDecomposition(const BodyDecompositionConstPtr& body_decomposition, const Eigen::Isometry3d& pose);
 
+  /** \brief Decompose the occupied leaves of \e octree into one point per cell at the resolution of the octree */
   PosedBodyPointDecomposition(const std::shared_ptr<const octomap::OcTree>& octree);
 
   const EigenSTL::vector_Vector3d& getCollisionPoints() const
@@ -360,9 +365,26 @@ public:
   // the collision spheres, and the posed collision points
   void updatePose(const Eigen::Isometry3d& linkTransform);
 
+  /** \brief Bring the points of an octree decomposition up to date with its octree after the octree was modified in
+   *  place. The occupied leaves of the octree are compared with the ones the points were generated from; the points of
+   *  the leaves that appeared are appended to \e add_points, those of the leaves that disappeared to \e
+   *  subtract_points. A leaf that was split or pruned appears in both, so the distance field only has to diff the
+   *  changed leaves' cells (see distance_field::DistanceField::updatePointsInField()). If the octree has change
+   *  detection enabled (octomap::OcTree::enableChangeDetection()) and reports no changes, nothing is compared;
+   *  resetting the changes is left to the owner of the octree.
+   *  @return False if this is not the decomposition of an octree */
+  bool updateOctreeCells(EigenSTL::vector_Vector3d& add_points, EigenSTL::vector_Vector3d& subtract_points);
+
 protected:
+  /** \brief Append the points of the cells of the occupied octree leaf \e leaf (see octreeLeafId()) */
+  void addOctreeLeaf(std::uint64_t leaf);
+
   BodyDecompositionConstPtr body_decomposition_;
   EigenSTL::vector_Vector3d posed_collision_points_;
+
+  std::shared_ptr<const octomap::OcTree> octree_;
+  /** \brief The occupied octree leaves, in the order of their points in posed_collision_points_ */
+  std::vector<std::uint64_t> octree_leaves_;
 };
 
 class PosedBodySphereDecompositionVector
@@ -53,6 +53,15 @@ static const double DEFAULT_RESOLUTION = .02;
 static const double DEFAULT_COLLISION_TOLERANCE = 0.0;
 static const double DEFAULT_MAX_PROPOGATION_DISTANCE = .25;
 
+/** \brief The implementations of distance fields CollisionEnvDistanceField can compute distances with */
+enum class DistanceFieldType
+{
+  PROPAGATION,       /**< \brief distance_field::PropagationDistanceField, cheap small updates */
+  EUCLIDEAN,         /**< \brief distance_field::EuclideanDistanceField, exact distances */
+  SPARSE_PROPAGATION /**< \brief distance_field::PropagationDistanceField storing voxels only near obstacles */
+};
+static const DistanceFieldType DEFAULT_DISTANCE_FIELD_TYPE = DistanceFieldType::PROPAGATION;
+
 MOVEIT_CLASS_FORWARD(CollisionEnvDistanceField);
 
 class CollisionEnvDistanceField : public CollisionEnv
@@ -69,7 +78,7 @@ public:
                             double resolution = DEFAULT_RESOLUTION,
                             double collision_tolerance = DEFAULT_COLLISION_TOLERANCE,
                             double max_propogation_distance = DEFAULT_MAX_PROPOGATION_DISTANCE, double padding = 0.0,
-                            double scale = 1.0);
+                            double scale = 1.0, DistanceFieldType distance_field_type = DEFAULT_DISTANCE_FIELD_TYPE);
 
   CollisionEnvDistanceField(const moveit::core::RobotModelConstPtr& robot_model, const WorldPtr& world,
                             const std::map<std::string, std::vector<CollisionSphere>>& link_body_decompositions =
@@ -80,7 +89,7 @@ public:
                             double resolution = DEFAULT_RESOLUTION,
                             double collision_tolerance = DEFAULT_COLLISION_TOLERANCE,
                             double max_propogation_distance = DEFAULT_MAX_PROPOGATION_DISTANCE, double padding = 0.0,
-                            double scale = 1.0);
+                            double scale = 1.0, DistanceFieldType distance_field_type = DEFAULT_DISTANCE_FIELD_TYPE);
 
   CollisionEnvDistanceField(const CollisionEnvDistanceField& other, const WorldPtr& world);
 
@@ -122,6 +131,33 @@ public:
     ROS_ERROR_NAMED("collision_distance_field", "Not implemented");
   }
 
+  /** \brief Set the implementation of the distance fields of the world and of the robot links that are not checked.
+   *  The distance field of the world is regenerated. */
+  void setDistanceFieldType(DistanceFieldType type);
+
+  DistanceFieldType getDistanceFieldType() const
+  {
+    return distance_field_type_;
+  }
+
+  /** \brief Compute the proximity gradients of getCollisionGradients() by trilinear interpolation of the distance
+   *  fields, looking up all collision spheres of a body at once (see getCollisionSphereGradients()). Otherwise, the
+   *  distance and gradient of the cell containing each sphere center are used. Disabled by default. */
+  void setInterpolateGradients(bool interpolate)
+  {
+    interpolate_gradients_ = interpolate;
+  }
+
+  bool getInterpolateGradients() const
+  {
+    return interpolate_gradients_;
+  }
+
+  /** \brief Update the distance field of the world after the octrees of object \e id were modified in place, e.g. by
+   *  integrating sensor data, which the World does not notify about. Only the cells of octree leaves that changed are
+   *  passed to the distance field; see PosedBodyPointDecomposition::updateOctreeCells(). */
+  void updateOctreeObject(const std::string& id) override;
+
   DistanceFieldCacheEntryConstPtr getLastDistanceFieldEntry() const
   {
     return distance_field_cache_entry_;
@@ -270,6 +306,9 @@ protected:
 
   DistanceFieldCacheEntryWorldPtr generateDistanceFieldCacheEntryWorld();
 
+  /** \brief Create an empty distance field of the configured type, size and resolution */
+  distance_field::DistanceFieldPtr createDistanceField() const;
+
   void updateDistanceObject(const std::string& id, CollisionEnvDistanceField::DistanceFieldCacheEntryWorldPtr& dfce,
                             EigenSTL::vector_Vector3d& add_points, EigenSTL::vector_Vector3d& subtract_points);
 
@@ -288,6 +327,8 @@ protected:
   double resolution_;
   double collision_tolerance_;
   double max_propogation_distance_;
+  DistanceFieldType distance_field_type_;
+  bool interpolate_gradients_;
 
   std::vector<BodyDecompositionConstPtr> link_body_decomposition_vector_;
   std::map<std::string, unsigned int> link_body_decomposition_index_map_;
@@ -60,7 +60,7 @@ public:
                      bool use_signed_distance_field = DEFAULT_USE_SIGNED_DISTANCE_FIELD,
                      double resolution = DEFAULT_RESOLUTION, double collision_tolerance = DEFAULT_COLLISION_TOLERANCE,
                      double max_propogation_distance = DEFAULT_MAX_PROPOGATION_DISTANCE, double padding = 0.0,
-                     double scale = 1.0);
+                     double scale = 1.0, DistanceFieldType distance_field_type = DEFAULT_DISTANCE_FIELD_TYPE);
 
   CollisionEnvHybrid(const moveit::core::RobotModelConstPtr& robot_model, const WorldPtr& world,
                      const std::map<std::string, std::vector<CollisionSphere>>& link_body_decompositions =
@@ -70,7 +70,7 @@ public:
                      bool use_signed_distance_field = DEFAULT_USE_SIGNED_DISTANCE_FIELD,
                      double resolution = DEFAULT_RESOLUTION, double collision_tolerance = DEFAULT_COLLISION_TOLERANCE,
                      double max_propogation_distance = DEFAULT_MAX_PROPOGATION_DISTANCE, double padding = 0.0,
-                     double scale = 1.0);
+                     double scale = 1.0, DistanceFieldType distance_field_type = DEFAULT_DISTANCE_FIELD_TYPE);
 
   CollisionEnvHybrid(const CollisionEnvHybrid& other, const WorldPtr& world);
 
@@ -87,6 +87,26 @@ public:
                                max_propogation_distance);
   }
 
+  /** \brief Set the implementation of the distance fields used by the distance field checks and gradients */
+  void setDistanceFieldType(DistanceFieldType type)
+  {
+    cenv_distance_->setDistanceFieldType(type);
+  }
+
+  /** \brief Interpolate the distance fields for the gradients of getCollisionGradients(),
+   *  see CollisionEnvDistanceField::setInterpolateGradients() */
+  void setInterpolateGradients(bool interpolate)
+  {
+    cenv_distance_->setInterpolateGradients(interpolate);
+  }
+
+  /** \brief Update the distance field after the octrees of object \e id were modified in place,
+   *  see CollisionEnvDistanceField::updateOctreeObject() */
+  void updateOctreeObject(const std::string& id) override
+  {
+    cenv_distance_->updateOctreeObject(id);
+  }
+
   void checkSelfCollisionDistanceField(const collision_detection::CollisionRequest& req,
                                        collision_detection::CollisionResult& res,
                                        const moveit::core::RobotState& state) const;
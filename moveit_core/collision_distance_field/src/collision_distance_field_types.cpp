@@ -40,6 +40,7 @@
 #include <moveit/distance_field/find_internal_points.h>
 #include <ros/console.h>
 #include <memory>
+#include <unordered_set>
 
 const static double EPSILON = 0.0001;
 
@@ -132,17 +133,32 @@ bool collision_detection::getCollisionSphereGradients(const distance_field::Dist
                                                       GradientInfo& gradient,
                                                       const collision_detection::CollisionType& type, double tolerance,
                                                       bool subtract_radii, double maximum_value,
-                                                      bool stop_at_first_collision)
+                                                      bool stop_at_first_collision, bool interpolate)
 {
   // assumes gradient is properly initialized
 
+  std::vector<double> interpolated_distances;
+  EigenSTL::vector_Vector3d interpolated_gradients;
+  std::vector<bool> interpolated_in_bounds;
+  if (interpolate)
+    distance_field->getInterpolatedDistanceGradients(sphere_centers, interpolated_distances, interpolated_gradients,
+                                                     interpolated_in_bounds);
+
   bool in_collision = false;
   for (unsigned int i = 0; i < sphere_list.size(); i++)
   {
     Eigen::Vector3d p = sphere_centers[i];
     Eigen::Vector3d grad;
     bool in_bounds;
-    double dist = distance_field->getDistanceGradient(p.x(), p.y(), p.z(), grad.x(), grad.y(), grad.z(), in_bounds);
+    double dist;
+    if (interpolate)
+    {
+      dist = interpolated_distances[i];
+      grad = interpolated_gradients[i];
+      in_bounds = interpolated_in_bounds[i];
+    }
+    else
+      dist = distance_field->getDistanceGradient(p.x(), p.y(), p.z(), grad.x(), grad.y(), grad.z(), in_bounds);
     if (!in_bounds && grad.norm() > EPSILON)
     {
       ROS_DEBUG("Collision sphere point is out of bounds %lf, %lf, %lf", p.x(), p.y(), p.z());
@@ -338,17 +354,100 @@ collision_detection::PosedBodyPointDecomposition::PosedBodyPointDecomposition(
   updatePose(trans);
 }
 
+namespace
+{
+/** \brief Identify an octree leaf by its key and depth; a leaf at the maximum depth can have the same key as one of
+ *  its pruned ancestors */
+std::uint64_t octreeLeafId(const octomap::OcTreeKey& key, unsigned int depth)
+{
+  return static_cast<std::uint64_t>(depth) << 48 | static_cast<std::uint64_t>(key[0]) << 32 |
+         static_cast<std::uint64_t>(key[1]) << 16 | static_cast<std::uint64_t>(key[2]);
+}
+
+/** \brief Call \e f with the id of every occupied leaf of \e octree */
+template <typename F>
+void forEachOccupiedOctreeLeaf(const octomap::OcTree& octree, const F& f)
+{
+  for (octomap::OcTree::leaf_iterator it = octree.begin_leafs(); it != octree.end_leafs(); ++it)
+    if (octree.isNodeOccupied(*it))
+      f(octreeLeafId(it.getKey(), it.getDepth()));
+}
+}  // namespace
+
 collision_detection::PosedBodyPointDecomposition::PosedBodyPointDecomposition(
     const std::shared_ptr<const octomap::OcTree>& octree)
-  : body_decomposition_()
+  : body_decomposition_(), octree_(octree)
+{
+  posed_collision_points_.reserve(octree->getNumLeafNodes());
+  forEachOccupiedOctreeLeaf(*octree_, [this](std::uint64_t leaf) { addOctreeLeaf(leaf); });
+}
+
+bool collision_detection::PosedBodyPointDecomposition::updateOctreeCells(EigenSTL::vector_Vector3d& add_points,
+                                                                         EigenSTL::vector_Vector3d& subtract_points)
 {
-  int num_nodes = octree->getNumLeafNodes();
-  posed_collision_points_.reserve(num_nodes);
-  for (octomap::OcTree::tree_iterator tree_iter = octree->begin_tree(); tree_iter != octree->end_tree(); ++tree_iter)
+  if (!octree_)
+    return false;
+  if (octree_->isChangeDetectionEnabled() && octree_->numChangesDetected() == 0)
+    return true;
+
+  std::unordered_set<std::uint64_t> occupied;
+  occupied.reserve(octree_->getNumLeafNodes());
+  forEachOccupiedOctreeLeaf(*octree_, [&occupied](std::uint64_t leaf) { occupied.insert(leaf); });
+
+  // keep the points of the leaves that are still occupied, moving them to the front
+  const unsigned int tree_depth = octree_->getTreeDepth();
+  std::size_t num_leaves = 0;
+  std::size_t num_points = 0;
+  std::size_t first_point = 0;
+  for (std::uint64_t leaf : octree_leaves_)
+  {
+    const std::size_t leaf_points = std::size_t(1) << (3 * (tree_depth - (leaf >> 48)));
+    EigenSTL::vector_Vector3d::const_iterator first = posed_collision_points_.begin() + first_point;
+    if (occupied.erase(leaf))
+    {
+      if (num_points != first_point)
+        std::copy(first, first + leaf_points, posed_collision_points_.begin() + num_points);
+      octree_leaves_[num_leaves++] = leaf;
+      num_points += leaf_points;
+    }
+    else
+      subtract_points.insert(subtract_points.end(), first, first + leaf_points);
+    first_point += leaf_points;
+  }
+  octree_leaves_.resize(num_leaves);
+  posed_collision_points_.resize(num_points);
+
+  // the remaining leaves are new
+  for (std::uint64_t leaf : occupied)
   {
-    Eigen::Vector3d p = Eigen::Vector3d(tree_iter.getX(), tree_iter.getY(), tree_iter.getZ());
-    posed_collision_points_.push_back(p);
+    addOctreeLeaf(leaf);
+    add_points.insert(add_points.end(), posed_collision_points_.begin() + num_points, posed_collision_points_.end());
+    num_points = posed_collision_points_.size();
   }
+  return true;
+}
+
+void collision_detection::PosedBodyPointDecomposition::addOctreeLeaf(std::uint64_t leaf)
+{
+  const unsigned int level = octree_->getTreeDepth() - (leaf >> 48);
+  const octomap::OcTreeKey leaf_key(static_cast<octomap::key_type>(leaf >> 32),
+                                    static_cast<octomap::key_type>(leaf >> 16), static_cast<octomap::key_type>(leaf));
+  const octomap::OcTreeKey min_key = octomap::computeIndexKey(level, leaf_key);
+
+  // pruned leaves cover several cells
+  const unsigned int cells = 1u << level;
+  octomap::OcTreeKey key;
+  for (unsigned int x = 0; x < cells; ++x)
+    for (unsigned int y = 0; y < cells; ++y)
+      for (unsigned int z = 0; z < cells; ++z)
+      {
+        key[0] = min_key[0] + x;
+        key[1] = min_key[1] + y;
+        key[2] = min_key[2] + z;
+        const octomap::point3d p = octree_->keyToCoord(key);
+        posed_collision_points_.push_back(Eigen::Vector3d(p.x(), p.y(), p.z()));
+      }
+  octree_leaves_.push_back(leaf);
 }
 
 void collision_detection::PosedBodyPointDecomposition::updatePose(const Eigen::Isometry3d& trans)
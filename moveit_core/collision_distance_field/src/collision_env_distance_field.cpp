@@ -41,6 +41,7 @@
 #include <moveit/collision_distance_field/collision_env_distance_field.h>
 #include <moveit/collision_distance_field/collision_common_distance_field.h>
 #include <moveit/distance_field/propagation_distance_field.h>
+#include <moveit/distance_field/euclidean_distance_field.h>
 #include <moveit/collision_distance_field/collision_detector_allocator_distance_field.h>
 #include <boost/bind.hpp>
 #include <memory>
@@ -56,8 +57,9 @@ CollisionEnvDistanceField::CollisionEnvDistanceField(
     const moveit::core::RobotModelConstPtr& robot_model,
     const std::map<std::string, std::vector<CollisionSphere>>& link_body_decompositions, double size_x, double size_y,
     double size_z, const Eigen::Vector3d& origin, bool use_signed_distance_field, double resolution,
-    double collision_tolerance, double max_propogation_distance, double padding, double scale)
-  : CollisionEnv(robot_model)
+    double collision_tolerance, double max_propogation_distance, double padding, double scale,
+    DistanceFieldType distance_field_type)
+  : CollisionEnv(robot_model), distance_field_type_(distance_field_type), interpolate_gradients_(false)
 {
   initialize(link_body_decompositions, Eigen::Vector3d(size_x, size_y, size_z), origin, use_signed_distance_field,
              resolution, collision_tolerance, max_propogation_distance);
@@ -74,8 +76,11 @@ CollisionEnvDistanceField::CollisionEnvDistanceField(
     const moveit::core::RobotModelConstPtr& robot_model, const WorldPtr& world,
     const std::map<std::string, std::vector<CollisionSphere>>& link_body_decompositions, double size_x, double size_y,
     double size_z, const Eigen::Vector3d& origin, bool use_signed_distance_field, double resolution,
-    double collision_tolerance, double max_propogation_distance, double padding, double scale)
+    double collision_tolerance, double max_propogation_distance, double padding, double scale,
+    DistanceFieldType distance_field_type)
   : CollisionEnv(robot_model, world, padding, scale)
+  , distance_field_type_(distance_field_type)
+  , interpolate_gradients_(false)
 {
   initialize(link_body_decompositions, Eigen::Vector3d(size_x, size_y, size_z), origin, use_signed_distance_field,
              resolution, collision_tolerance, max_propogation_distance);
@@ -98,6 +103,8 @@ CollisionEnvDistanceField::CollisionEnvDistanceField(const CollisionEnvDistanceF
   resolution_ = other.resolution_;
   collision_tolerance_ = other.collision_tolerance_;
   max_propogation_distance_ = other.max_propogation_distance_;
+  distance_field_type_ = other.distance_field_type_;
+  interpolate_gradients_ = other.interpolate_gradients_;
   link_body_decomposition_vector_ = other.link_body_decomposition_vector_;
   link_body_decomposition_index_map_ = other.link_body_decomposition_index_map_;
   in_group_update_map_ = other.in_group_update_map_;
@@ -405,7 +412,7 @@ bool CollisionEnvDistanceField::getSelfProximityGradients(GroupStateRepresentati
 
     coll = getCollisionSphereGradients(gsr->dfce_->distance_field_.get(), *collision_spheres_1, *sphere_centers_1,
                                        gsr->gradients_[i], collision_detection::SELF, collision_tolerance_, false,
-                                       max_propogation_distance_, false);
+                                       max_propogation_distance_, false, interpolate_gradients_);
 
     if (coll)
     {
@@ -933,9 +940,7 @@ DistanceFieldCacheEntryPtr CollisionEnvDistanceField::generateDistanceFieldCache
               getAttachedBodyPointDecomposition(attached_body, resolution_));
         }
       }
-      dfce->distance_field_.reset(new distance_field::PropagationDistanceField(
-          size_.x(), size_.y(), size_.z(), resolution_, origin_.x() - 0.5 * size_.x(), origin_.y() - 0.5 * size_.y(),
-          origin_.z() - 0.5 * size_.z(), max_propogation_distance_, use_signed_distance_field_));
+      dfce->distance_field_ = createDistanceField();
 
       // ROS_INFO_STREAM("Creation took " <<
       // (ros::WallTime::now()-before_create).toSec());
@@ -1678,7 +1683,7 @@ bool CollisionEnvDistanceField::getEnvironmentProximityGradients(
 
     bool coll = getCollisionSphereGradients(env_distance_field.get(), *collision_spheres_1, *sphere_centers_1,
                                             gsr->gradients_[i], ENVIRONMENT, collision_tolerance_, false,
-                                            max_propogation_distance_, false);
+                                            max_propogation_distance_, false, interpolate_gradients_);
     if (coll)
     {
       in_collision = true;
@@ -1720,14 +1725,14 @@ void CollisionEnvDistanceField::notifyObjectChange(CollisionEnvDistanceField* se
   {
     self->distance_field_cache_entry_world_->distance_field_->removePointsFromField(subtract_points);
   }
-  else if (action & (World::MOVE_SHAPE | World::REMOVE_SHAPE))
+  else if (subtract_points.empty())
   {
-    self->distance_field_cache_entry_world_->distance_field_->removePointsFromField(subtract_points);
     self->distance_field_cache_entry_world_->distance_field_->addPointsToField(add_points);
   }
   else
   {
-    self->distance_field_cache_entry_world_->distance_field_->addPointsToField(add_points);
+    // only the voxels that are not shared by the old and new shapes of the object change
+    self->distance_field_cache_entry_world_->distance_field_->updatePointsInField(subtract_points, add_points);
   }
 
   ROS_DEBUG_NAMED("collision_distance_field", "Modifying object %s took %lf s", obj->id_.c_str(),
@@ -1785,13 +1790,58 @@ void CollisionEnvDistanceField::updateDistanceObject(const std::string& id, Dist
   }
 }
 
+void CollisionEnvDistanceField::updateOctreeObject(const std::string& id)
+{
+  ros::WallTime n = ros::WallTime::now();
+
+  std::map<std::string, std::vector<PosedBodyPointDecompositionPtr>>::iterator cur_it =
+      distance_field_cache_entry_world_->posed_body_point_decompositions_.find(id);
+  if (cur_it == distance_field_cache_entry_world_->posed_body_point_decompositions_.end())
+    return;
+
+  EigenSTL::vector_Vector3d add_points;
+  EigenSTL::vector_Vector3d subtract_points;
+  for (PosedBodyPointDecompositionPtr& posed_body_point_decomposition : cur_it->second)
+    posed_body_point_decomposition->updateOctreeCells(add_points, subtract_points);
+
+  // cells of split or pruned leaves are in both sets and left untouched by the field
+  if (!add_points.empty() || !subtract_points.empty())
+    distance_field_cache_entry_world_->distance_field_->updatePointsInField(subtract_points, add_points);
+
+  ROS_DEBUG_NAMED("collision_distance_field", "Updating %zu added and %zu removed octree cells of %s took %lf s",
+                  add_points.size(), subtract_points.size(), id.c_str(), (ros::WallTime::now() - n).toSec());
+}
+
+distance_field::DistanceFieldPtr CollisionEnvDistanceField::createDistanceField() const
+{
+  const Eigen::Vector3d min_corner = origin_ - 0.5 * size_;
+  if (distance_field_type_ == DistanceFieldType::EUCLIDEAN)
+    return std::make_shared<distance_field::EuclideanDistanceField>(
+        size_.x(), size_.y(), size_.z(), resolution_, min_corner.x(), min_corner.y(), min_corner.z(),
+        max_propogation_distance_, use_signed_distance_field_);
+  return std::make_shared<distance_field::PropagationDistanceField>(
+      size_.x(), size_.y(), size_.z(), resolution_, min_corner.x(), min_corner.y(), min_corner.z(),
+      max_propogation_distance_, use_signed_distance_field_,
+      distance_field_type_ == DistanceFieldType::SPARSE_PROPAGATION);
+}
+
+void CollisionEnvDistanceField::setDistanceFieldType(DistanceFieldType type)
+{
+  if (type == distance_field_type_)
+    return;
+  distance_field_type_ = type;
+  distance_field_cache_entry_world_ = generateDistanceFieldCacheEntryWorld();
+
+  // the robot links' distance fields are regenerated on the next query
+  boost::mutex::scoped_lock slock(update_cache_lock_);
+  distance_field_cache_entry_.reset();
+}
+
 CollisionEnvDistanceField::DistanceFieldCacheEntryWorldPtr
 CollisionEnvDistanceField::generateDistanceFieldCacheEntryWorld()
 {
   DistanceFieldCacheEntryWorldPtr dfce(new DistanceFieldCacheEntryWorld());
-  dfce->distance_field_.reset(new distance_field::PropagationDistanceField(
-      size_.x(), size_.y(), size_.z(), resolution_, origin_.x() - 0.5 * size_.x(), origin_.y() - 0.5 * size_.y(),
-      origin_.z() - 0.5 * size_.z(), max_propogation_distance_, use_signed_distance_field_));
+  dfce->distance_field_ = createDistanceField();
 
   EigenSTL::vector_Vector3d add_points;
   EigenSTL::vector_Vector3d subtract_points;
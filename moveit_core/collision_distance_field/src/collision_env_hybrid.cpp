@@ -46,11 +46,12 @@ CollisionEnvHybrid::CollisionEnvHybrid(
     const moveit::core::RobotModelConstPtr& robot_model,
     const std::map<std::string, std::vector<CollisionSphere>>& link_body_decompositions, double size_x, double size_y,
     double size_z, const Eigen::Vector3d& origin, bool use_signed_distance_field, double resolution,
-    double collision_tolerance, double max_propogation_distance, double padding, double scale)
+    double collision_tolerance, double max_propogation_distance, double padding, double scale,
+    DistanceFieldType distance_field_type)
   : CollisionEnvFCL(robot_model)
   , cenv_distance_(new collision_detection::CollisionEnvDistanceField(
         robot_model, getWorld(), link_body_decompositions, size_x, size_y, size_z, origin, use_signed_distance_field,
-        resolution, collision_tolerance, max_propogation_distance, padding, scale))
+        resolution, collision_tolerance, max_propogation_distance, padding, scale, distance_field_type))
 {
 }
 
@@ -58,11 +59,12 @@ CollisionEnvHybrid::CollisionEnvHybrid(
     const moveit::core::RobotModelConstPtr& robot_model, const WorldPtr& world,
     const std::map<std::string, std::vector<CollisionSphere>>& link_body_decompositions, double size_x, double size_y,
     double size_z, const Eigen::Vector3d& origin, bool use_signed_distance_field, double resolution,
-    double collision_tolerance, double max_propogation_distance, double padding, double scale)
+    double collision_tolerance, double max_propogation_distance, double padding, double scale,
+    DistanceFieldType distance_field_type)
   : CollisionEnvFCL(robot_model, world, padding, scale)
   , cenv_distance_(new collision_detection::CollisionEnvDistanceField(
         robot_model, getWorld(), link_body_decompositions, size_x, size_y, size_z, origin, use_signed_distance_field,
-        resolution, collision_tolerance, max_propogation_distance, padding, scale))
+        resolution, collision_tolerance, max_propogation_distance, padding, scale, distance_field_type))
 {
 }
 
@@ -362,6 +362,111 @@ TEST_F(DistanceFieldCollisionDetectionTester, AttachedBodyTester)
   ASSERT_TRUE(res.collision);
 }
 
+TEST_F(DistanceFieldCollisionDetectionTester, OctreeChanges)
+{
+  collision_detection::CollisionRequest req;
+  collision_detection::CollisionResult res;
+
+  req.group_name = "right_arm";
+
+  moveit::core::RobotState robot_state(robot_model_);
+  robot_state.setToDefaultValues();
+  robot_state.update();
+
+  Eigen::Isometry3d pos1 = Eigen::Isometry3d::Identity();
+  pos1.translation().x() = 1.0;
+  robot_state.updateStateWithLinkAt("r_gripper_palm_link", pos1);
+
+  std::shared_ptr<octomap::OcTree> octree = std::make_shared<octomap::OcTree>(0.02);
+  octree->enableChangeDetection(true);
+  cenv_->getWorld()->addToObject("octomap", std::make_shared<const shapes::OcTree>(octree),
+                                 Eigen::Isometry3d::Identity());
+
+  cenv_->checkRobotCollision(req, res, robot_state, *acm_);
+  ASSERT_FALSE(res.collision);
+
+  // occupy a box around the palm without notifying the world
+  for (double x = 0.95; x < 1.05; x += 0.02)
+    for (double y = -0.05; y < 0.05; y += 0.02)
+      for (double z = -0.05; z < 0.05; z += 0.02)
+        octree->updateNode(x, y, z, true);
+  EXPECT_GT(octree->numChangesDetected(), 0u);
+
+  collision_detection::CollisionEnvDistanceField* cenv =
+      static_cast<collision_detection::CollisionEnvDistanceField*>(cenv_.get());
+  cenv->updateOctreeObject("octomap");
+  octree->resetChangeDetection();
+
+  res = collision_detection::CollisionResult();
+  cenv_->checkRobotCollision(req, res, robot_state, *acm_);
+  ASSERT_TRUE(res.collision);
+
+  // free the box again
+  for (double x = 0.95; x < 1.05; x += 0.02)
+    for (double y = -0.05; y < 0.05; y += 0.02)
+      for (double z = -0.05; z < 0.05; z += 0.02)
+        octree->setNodeValue(x, y, z, octree->getClampingThresMinLog());
+  cenv->updateOctreeObject("octomap");
+  octree->resetChangeDetection();
+
+  res = collision_detection::CollisionResult();
+  cenv_->checkRobotCollision(req, res, robot_state, *acm_);
+  ASSERT_FALSE(res.collision);
+}
+
+TEST_F(DistanceFieldCollisionDetectionTester, OctreeChangesPrunedLeaves)
+{
+  collision_detection::CollisionRequest req;
+  collision_detection::CollisionResult res;
+
+  req.group_name = "right_arm";
+
+  moveit::core::RobotState robot_state(robot_model_);
+  robot_state.setToDefaultValues();
+  robot_state.update();
+
+  Eigen::Isometry3d pos1 = Eigen::Isometry3d::Identity();
+  pos1.translation().x() = 1.0;
+  robot_state.updateStateWithLinkAt("r_gripper_palm_link", pos1);
+
+  // no change detection, so the occupied leaves are compared
+  std::shared_ptr<octomap::OcTree> octree = std::make_shared<octomap::OcTree>(0.02);
+  cenv_->getWorld()->addToObject("octomap", std::make_shared<const shapes::OcTree>(octree),
+                                 Eigen::Isometry3d::Identity());
+
+  // saturate a box of 4x8x8 cells around the palm, which is pruned to four leaves of 4x4x4 cells
+  for (double x = 0.97; x < 1.04; x += 0.02)
+    for (double y = -0.07; y < 0.08; y += 0.02)
+      for (double z = -0.07; z < 0.08; z += 0.02)
+        octree->setNodeValue(x, y, z, octree->getClampingThresMaxLog());
+  EXPECT_EQ(octree->getNumLeafNodes(), 4u);
+
+  cenv_->updateOctreeObject("octomap");
+
+  res = collision_detection::CollisionResult();
+  cenv_->checkRobotCollision(req, res, robot_state, *acm_);
+  ASSERT_TRUE(res.collision);
+
+  // freeing a single cell splits its leaf, the rest of the box stays in the field
+  octree->setNodeValue(0.97, -0.07, -0.07, octree->getClampingThresMinLog());
+  EXPECT_GT(octree->getNumLeafNodes(), 4u);
+  cenv_->updateOctreeObject("octomap");
+
+  res = collision_detection::CollisionResult();
+  cenv_->checkRobotCollision(req, res, robot_state, *acm_);
+  ASSERT_TRUE(res.collision);
+
+  for (double x = 0.97; x < 1.04; x += 0.02)
+    for (double y = -0.07; y < 0.08; y += 0.02)
+      for (double z = -0.07; z < 0.08; z += 0.02)
+        octree->setNodeValue(x, y, z, octree->getClampingThresMinLog());
+  cenv_->updateOctreeObject("octomap");
+
+  res = collision_detection::CollisionResult();
+  cenv_->checkRobotCollision(req, res, robot_state, *acm_);
+  ASSERT_FALSE(res.collision);
+}
+
 int main(int argc, char** argv)
 {
   testing::InitGoogleTest(&argc, argv);
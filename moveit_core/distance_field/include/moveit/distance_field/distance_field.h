@@ -322,6 +322,81 @@ public:
    */
   double getDistanceGradient(double x, double y, double z, double& gradient_x, double& gradient_y, double& gradient_z,
                              bool& in_bounds) const;
+
+  /**
+   * \brief Gets the distance and gradient at a location by trilinear
+   * interpolation of the eight cells surrounding it.
+   *
+   * Unlike \ref getDistanceGradient, the distance varies continuously
+   * with the location.  If \ref computeGradientChannels has been
+   * called since the field last changed, the gradient is interpolated
+   * from the precomputed gradients of the surrounding cells and also
+   * varies continuously; otherwise it is the derivative of the
+   * interpolated distance.
+   *
+   * @param [in] x The X location
+   * @param [in] y The Y location
+   * @param [in] z The Z location
+   * @param [out] gradient_x The X component of the gradient
+   * @param [out] gradient_y The Y component of the gradient
+   * @param [out] gradient_z The Z component of the gradient
+   *
+   * @param [out] in_bounds Whether or not the location lies between
+   * the centers of cells of the distance field
+   *
+   * @return The interpolated distance, or the uninitialized distance
+   * if the location is not in bounds
+   */
+  double getInterpolatedDistanceGradient(double x, double y, double z, double& gradient_x, double& gradient_y,
+                                         double& gradient_z, bool& in_bounds) const;
+
+  /**
+   * \brief Gets interpolated distances and gradients for a batch of
+   * locations, see \ref getInterpolatedDistanceGradient.
+   *
+   * Looking up many locations at once avoids the per-cell virtual
+   * calls of \ref getDistanceGradient, which makes this the
+   * preferred way to query the field for many collision spheres.
+   *
+   * @param [in] points The locations to query
+   * @param [out] distances The interpolated distance of each location
+   * @param [out] gradients The gradient of each location
+   * @param [out] in_bounds Whether each location lies between the centers of cells
+   */
+  void getInterpolatedDistanceGradients(const EigenSTL::vector_Vector3d& points, std::vector<double>& distances,
+                                        EigenSTL::vector_Vector3d& gradients, std::vector<bool>& in_bounds) const;
+
+  /**
+   * \brief Precomputes the gradient of every cell by central
+   * differences, so that interpolated lookups return smooth gradients
+   * and read only eight cells per location.
+   *
+   * This stores three floats per cell for the whole volume, trading
+   * memory for query speed.  The gradients are discarded whenever the
+   * field changes, so this is best used for fields that are queried
+   * many times between changes.
+   *
+   * @return True if the gradients were computed; False if the field
+   * does not support them, e.g. because its storage is sparse
+   */
+  virtual bool computeGradientChannels();
+
+  /**
+   * \brief Discards the gradients precomputed by \ref computeGradientChannels.
+   */
+  void clearGradientChannels();
+
+  /**
+   * \brief Checks whether gradients have been precomputed by
+   * \ref computeGradientChannels since the field last changed.
+   *
+   * @return True if interpolated lookups use precomputed gradients; otherwise False.
+   */
+  bool hasGradientChannels() const
+  {
+    return !gradient_channels_.empty();
+  }
+
   /**
    * \brief Gets the distance to the closest obstacle at the given
    * integer cell location. The particulars of this function are
@@ -614,6 +689,31 @@ protected:
   void setPoint(int xCell, int yCell, int zCell, double dist, geometry_msgs::Point& point, std_msgs::ColorRGBA& color,
                 double max_distance) const;
 
+  /**
+   * \brief Gets the distances of the eight cells of the cube with the
+   * given minimum cell, used by the interpolated lookups.  The default
+   * implementation calls \ref getDistance for each cell; derived
+   * classes may read their storage directly.
+   *
+   * x+1,y+1,z+1 MUST be valid or data corruption (SEGFAULTS) will occur.
+   *
+   * @param [in] x The X index of the minimum cell
+   * @param [in] y The Y index of the minimum cell
+   * @param [in] z The Z index of the minimum cell
+   * @param [out] distances The distances of the cells, where the cell
+   * offset by (dx, dy, dz) is stored at index 4*dx + 2*dy + dz
+   */
+  virtual void getCornerDistances(int x, int y, int z, double distances[8]) const;
+
+  /**
+   * \brief Trilinearly interpolates the distance and gradient at a
+   * point, shared by \ref getInterpolatedDistanceGradient and \ref
+   * getInterpolatedDistanceGradients.
+   *
+   * @return True if the point lies within the cell centers of the field
+   */
+  bool interpolateDistanceGradient(const Eigen::Vector3d& point, double& distance, Eigen::Vector3d& gradient) const;
+
   double size_x_;            /**< \brief X size of the distance field */
   double size_y_;            /**< \brief Y size of the distance field */
   double size_z_;            /**< \brief Z size of the distance field */
@@ -622,6 +722,8 @@ protected:
   double origin_z_;          /**< \brief Z origin of the distance field */
   double resolution_;        /**< \brief Resolution of the distance field */
   int inv_twice_resolution_; /**< \brief Computed value 1.0/(2.0*resolution_) */
+
+  std::vector<Eigen::Vector3f> gradient_channels_; /**< \brief Precomputed gradient of each cell, empty if none */
 };
 
 }  // namespace distance_field
@@ -0,0 +1,314 @@
+/*********************************************************************
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2020, PickNik LLC.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the copyright holder nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************/
+
+#pragma once
+
+#include <moveit/distance_field/voxel_grid.h>
+#include <moveit/distance_field/distance_field.h>
+#include <vector>
+
+namespace distance_field
+{
+/**
+ * \brief Structure that holds voxel information for the
+ * EuclideanDistanceField.  Will be used in VoxelGrid.
+ */
+struct EuclideanDistanceFieldVoxel
+{
+  /**
+   * \brief Constructor.  All fields left uninitialized.
+   */
+  EuclideanDistanceFieldVoxel()
+  {
+  }
+
+  /**
+   * \brief Constructor for a free voxel with the given squared
+   * distances, in cells.
+   *
+   * @param [in] distance_sq_positive Squared distance to the closest obstacle cell
+   * @param [in] distance_sq_negative Squared distance to the closest unoccupied cell
+   */
+  EuclideanDistanceFieldVoxel(int distance_sq_positive, int distance_sq_negative)
+    : distance_square_(distance_sq_positive), negative_distance_square_(distance_sq_negative), occupied_(false)
+  {
+  }
+
+  int distance_square_;          /**< \brief Distance in cells to the closest obstacle, squared */
+  int negative_distance_square_; /**< \brief Distance in cells to the nearest unoccupied cell, squared */
+  bool occupied_;                /**< \brief Whether the cell is an obstacle cell */
+};
+
+/**
+ * \brief A DistanceField implementation that computes the exact
+ * Euclidean distance transform of the obstacle cells.
+ *
+ * Distances are computed with the separable linear-time algorithm of
+ * Felzenszwalb and Huttenlocher: the squared distance transform is
+ * the lower envelope of parabolas rooted at the obstacle cells, which
+ * is computed independently along every row of the grid, one axis
+ * after the other.  The rows of each pass are distributed over the
+ * shared \ref moveit::core::ThreadPool if enabled with \ref
+ * setNumThreads.
+ *
+ * The field offers the same distances as a \ref
+ * PropagationDistanceField with the same parameters, except that they
+ * are exact where the propagation only approximates them: distances
+ * are clamped to the maximum distance, obstacle cells have zero
+ * distance, and if negative distances are computed, obstacle cells
+ * have the negated distance to the nearest unoccupied cell.  Every
+ * change to the obstacle cells recomputes the whole transform, whose
+ * cost only depends on the size of the grid, so large changes are
+ * cheaper and small changes more expensive than with propagation.
+ */
+class EuclideanDistanceField : public DistanceField
+{
+public:
+  /**
+   * \brief Constructor that initializes entire distance field to
+   * empty - all cells will be assigned maximum distance values.
+   *
+   * @param [in] size_x The X dimension in meters of the volume to represent
+   * @param [in] size_y The Y dimension in meters of the volume to represent
+   * @param [in] size_z The Z dimension in meters of the volume to represent
+   * @param [in] resolution The resolution in meters of the volume
+   * @param [in] origin_x The minimum X point of the volume
+   * @param [in] origin_y The minimum Y point of the volume
+   * @param [in] origin_z The minimum Z point of the volume
+   *
+   * @param [in] max_distance The maximum distance to report.  Cells
+   * that are further away from obstacles will be assigned this
+   * distance.
+   *
+   * @param [in] compute_negative_distances Whether or not to compute
+   * negative distances for obstacle cells.  If false, all obstacle
+   * cells will be assigned zero distance.
+   */
+  EuclideanDistanceField(double size_x, double size_y, double size_z, double resolution, double origin_x,
+                         double origin_y, double origin_z, double max_distance,
+                         bool compute_negative_distances = false);
+
+  /**
+   * \brief Constructor that reads the contents of a saved distance
+   * field with \ref readFromStream and computes its distances.
+   *
+   * @param [in] stream The stream from which to read the data
+   * @param [in] max_distance The maximum distance to report
+   * @param [in] compute_negative_distances Whether or not to compute
+   * negative distances for obstacle cells
+   */
+  EuclideanDistanceField(std::istream& stream, double max_distance, bool compute_negative_distances = false);
+
+  ~EuclideanDistanceField() override
+  {
+  }
+
+  /**
+   * \brief Marks the cells of the valid \e points as obstacle cells
+   * and recomputes the distances if any cell changed.
+   *
+   * @param [in] points The set of obstacle points to add
+   */
+  void addPointsToField(const EigenSTL::vector_Vector3d& points) override;
+
+  /**
+   * \brief Marks the cells of the valid \e points as unoccupied and
+   * recomputes the distances if any cell changed.
+   *
+   * @param [in] points The set of obstacle points that will be set as free
+   */
+  void removePointsFromField(const EigenSTL::vector_Vector3d& points) override;
+
+  /**
+   * \brief Marks the cells of \e old_points as unoccupied and then
+   * those of \e new_points as obstacle cells, and recomputes the
+   * distances once if any cell changed.
+   *
+   * @param [in] old_points The set of points that all should be obstacle cells in the distance field
+   * @param [in] new_points The set of points, all of which are intended to be obstacle points in the distance field
+   */
+  void updatePointsInField(const EigenSTL::vector_Vector3d& old_points,
+                           const EigenSTL::vector_Vector3d& new_points) override;
+
+  /**
+   * \brief Resets the entire distance field to max_distance for
+   * positive values and zero for negative values.
+   */
+  void reset() override;
+
+  double getDistance(double x, double y, double z) const override;
+  double getDistance(int x, int y, int z) const override;
+  bool isCellValid(int x, int y, int z) const override;
+  int getXNumCells() const override;
+  int getYNumCells() const override;
+  int getZNumCells() const override;
+  bool gridToWorld(int x, int y, int z, double& world_x, double& world_y, double& world_z) const override;
+  bool worldToGrid(double world_x, double world_y, double world_z, int& x, int& y, int& z) const override;
+
+  /**
+   * \brief Writes the contents of the distance field to the supplied
+   * stream, in the format of \ref
+   * PropagationDistanceField::writeToStream.
+   *
+   * @param [out] stream The stream to which to write the distance field contents.
+   *
+   * @return True
+   */
+  bool writeToStream(std::ostream& stream) const override;
+
+  /**
+   * \brief Reads, parameterizes, and populates the distance field
+   * from a stream written by \ref writeToStream or \ref
+   * PropagationDistanceField::writeToStream.
+   *
+   * @param [in] stream The stream from which to read
+   *
+   * @return True if reading, parameterizing, and populating the
+   * distance field is successful; otherwise False.
+   */
+  bool readFromStream(std::istream& stream) override;
+
+  double getUninitializedDistance() const override
+  {
+    return max_distance_;
+  }
+
+  /**
+   * \brief Gets full cell data given an index.
+   *
+   * x,y,z MUST be valid or data corruption (SEGFAULTS) will occur.
+   *
+   * @param [in] x The integer X location
+   * @param [in] y The integer Y location
+   * @param [in] z The integer Z location
+   *
+   * @return The data in the indicated cell.
+   */
+  const EuclideanDistanceFieldVoxel& getCell(int x, int y, int z) const
+  {
+    return voxel_grid_->getCell(x, y, z);
+  }
+
+  /**
+   * \brief Sets the number of threads the rows of each pass of the
+   * transform are distributed over.
+   *
+   * @param [in] num_threads The maximum number of threads to use, 0
+   * to use all cores, 1 (the default) to compute the transform
+   * sequentially
+   */
+  void setNumThreads(std::size_t num_threads)
+  {
+    num_threads_ = num_threads;
+  }
+
+  /**
+   * \brief Gets the maximum number of threads used to compute the
+   * transform, see \ref setNumThreads.
+   *
+   * @return The maximum number of threads, 0 for all cores
+   */
+  std::size_t getNumThreads() const
+  {
+    return num_threads_;
+  }
+
+  /**
+   * \brief Gets the maximum distance squared value, in cells.
+   *
+   * @return The maximum distance squared.
+   */
+  int getMaximumDistanceSquared() const
+  {
+    return max_distance_sq_;
+  }
+
+private:
+  /**
+   * \brief Initializes the voxel grid and the square root lookup
+   * table, and resets the field.
+   */
+  void initialize();
+
+  /**
+   * \brief Sets the occupancy of the cells of the valid \e points.
+   *
+   * @return True if the occupancy of any cell changed
+   */
+  bool setOccupancy(const EigenSTL::vector_Vector3d& points, bool occupied);
+
+  /**
+   * \brief Recomputes all distances from the occupancy of the cells.
+   */
+  void computeDistances();
+
+  /**
+   * \brief Computes the squared distance transform of the cells whose
+   * occupancy is \e sites, in cells and clamped to \ref
+   * max_distance_sq_, into the member \e distance of every voxel.
+   */
+  void computeTransform(int EuclideanDistanceFieldVoxel::*distance, bool sites);
+
+  /**
+   * \brief Determines distance based on actual voxel data
+   *
+   * @param object Actual voxel data
+   *
+   * @return The distance reported by the cell
+   */
+  double getDistance(const EuclideanDistanceFieldVoxel& object) const;
+
+  /**
+   * \brief Reads the distances of the eight cells of a cube directly
+   * from the voxel grid, see \ref DistanceField::getCornerDistances.
+   */
+  void getCornerDistances(int x, int y, int z, double distances[8]) const override;
+
+  bool compute_negative_; /**< \brief Whether or not to compute negative distances */
+
+  std::size_t num_threads_; /**< \brief Maximum number of threads used for the transform, 0 for all cores */
+
+  VoxelGrid<EuclideanDistanceFieldVoxel>::Ptr voxel_grid_; /**< \brief Actual container for distance data */
+
+  double max_distance_; /**< \brief Holds maximum distance */
+  int max_distance_sq_; /**< \brief Holds maximum distance squared in cells */
+
+  std::vector<double> sqrt_table_; /**< \brief Precomputed square root table for faster distance lookups */
+};
+
+inline double EuclideanDistanceField::getDistance(const EuclideanDistanceFieldVoxel& object) const
+{
+  return sqrt_table_[object.distance_square_] - sqrt_table_[object.negative_distance_square_];
+}
+}  // namespace distance_field
@@ -162,10 +162,15 @@ public:
    * \ref PropagationDistanceField description for more information on
    * the implications of this.
    *
+   * @param [in] sparse_storage Whether to store the voxels in blocks
+   * that are only allocated near obstacles, see \ref VoxelGrid.  This
+   * bounds the memory use of large volumes by the obstacle surface
+   * area times the maximum distance rather than by their volume.
+   *
    */
   PropagationDistanceField(double size_x, double size_y, double size_z, double resolution, double origin_x,
                            double origin_y, double origin_z, double max_distance,
-                           bool propagate_negative_distances = false);
+                           bool propagate_negative_distances = false, bool sparse_storage = false);
 
   /**
    * \brief Constructor based on an OcTree and bounding box
@@ -188,10 +193,15 @@ public:
    * and all obstacle cells will be assigned zero distance.  See the
    * \ref PropagationDistanceField description for more information on
    * the implications of this.
+   *
+   * @param [in] sparse_storage Whether to store the voxels in blocks
+   * that are only allocated near obstacles, see \ref VoxelGrid.  This
+   * bounds the memory use of large volumes by the obstacle surface
+   * area times the maximum distance rather than by their volume.
    */
   PropagationDistanceField(const octomap::OcTree& octree, const octomap::point3d& bbx_min,
                            const octomap::point3d& bbx_max, double max_distance,
-                           bool propagate_negative_distances = false);
+                           bool propagate_negative_distances = false, bool sparse_storage = false);
 
   /**
    * \brief Constructor that takes an istream and reads the contents
@@ -388,7 +398,9 @@ public:
    */
   const PropDistanceFieldVoxel& getCell(int x, int y, int z) const
   {
-    return voxel_grid_->getCell(x, y, z);
+    // never allocates storage, so that sparse fields can be read concurrently
+    const VoxelGrid<PropDistanceFieldVoxel>& voxel_grid = *voxel_grid_;
+    return voxel_grid.getCell(x, y, z);
   }
 
   /**
@@ -411,19 +423,19 @@ public:
    */
   const PropDistanceFieldVoxel* getNearestCell(int x, int y, int z, double& dist, Eigen::Vector3i& pos) const
   {
-    const PropDistanceFieldVoxel* cell = &voxel_grid_->getCell(x, y, z);
+    const PropDistanceFieldVoxel* cell = &getCell(x, y, z);
     if (cell->distance_square_ > 0)
     {
       dist = sqrt_table_[cell->distance_square_];
       pos = cell->closest_point_;
-      const PropDistanceFieldVoxel* ncell = &voxel_grid_->getCell(pos.x(), pos.y(), pos.z());
+      const PropDistanceFieldVoxel* ncell = &getCell(pos.x(), pos.y(), pos.z());
       return ncell == cell ? nullptr : ncell;
     }
     if (cell->negative_distance_square_ > 0)
     {
       dist = -sqrt_table_[cell->negative_distance_square_];
       pos = cell->closest_negative_point_;
-      const PropDistanceFieldVoxel* ncell = &voxel_grid_->getCell(pos.x(), pos.y(), pos.z());
+      const PropDistanceFieldVoxel* ncell = &getCell(pos.x(), pos.y(), pos.z());
       return ncell == cell ? nullptr : ncell;
     }
     dist = 0.0;
@@ -433,6 +445,71 @@ public:
     return nullptr;
   }
 
+  /**
+   * \brief Sets the number of threads used to propagate distances.
+   *
+   * When adding or removing obstacle cells, the voxels of each
+   * bucket of the propagation queue are expanded in parallel on the
+   * shared \ref moveit::core::ThreadPool, and their updates are then
+   * applied in the order the single-threaded propagation would apply
+   * them.  The resulting distance field is identical to the one
+   * computed on a single thread.  Small buckets are always expanded
+   * on the calling thread.
+   *
+   * @param [in] num_threads The maximum number of threads to use, 0
+   * to use all cores, 1 (the default) to propagate sequentially
+   */
+  void setNumThreads(std::size_t num_threads)
+  {
+    num_threads_ = num_threads;
+  }
+
+  /**
+   * \brief Gets the maximum number of threads used to propagate
+   * distances, see \ref setNumThreads.
+   *
+   * @return The maximum number of threads, 0 for all cores
+   */
+  std::size_t getNumThreads() const
+  {
+    return num_threads_;
+  }
+
+  /**
+   * \brief Checks whether the voxels are stored in blocks that are
+   * only allocated near obstacles.
+   *
+   * @return True if the distance field uses sparse storage; otherwise False.
+   */
+  bool hasSparseStorage() const
+  {
+    return sparse_storage_;
+  }
+
+  /**
+   * \brief Precomputes the gradient of every cell, see \ref
+   * DistanceField::computeGradientChannels.
+   *
+   * The gradients are stored densely for the whole volume, which
+   * would defeat sparse storage, so nothing is computed for fields
+   * with sparse storage; their interpolated lookups differentiate the
+   * interpolated distance instead.
+   *
+   * @return True if the gradients were computed; False if the field uses sparse storage
+   */
+  bool computeGradientChannels() override;
+
+  /**
+   * \brief Gets the number of voxels that currently have storage,
+   * see \ref VoxelGrid::getNumAllocatedCells.
+   *
+   * @return The number of allocated voxels
+   */
+  std::size_t getNumAllocatedCells() const
+  {
+    return voxel_grid_->getNumAllocatedCells();
+  }
+
   /**
    * \brief Gets the maximum distance squared value.
    *
@@ -447,6 +524,14 @@ public:
   }
 
 private:
+  /** \brief A decrease of the distance of a voxel found while propagating from a neighboring voxel */
+  struct PropagationUpdate
+  {
+    Eigen::Vector3i loc_;   /**< \brief Location of the updated voxel */
+    int distance_square_;   /**< \brief New distance in cells, squared */
+    int update_direction_;  /**< \brief Direction of the update */
+  };
+
   /** Typedef for set of integer indices */
   typedef std::set<Eigen::Vector3i, CompareEigenVector3i, Eigen::aligned_allocator<Eigen::Vector3i>> VoxelSet;
   /**
@@ -487,6 +572,44 @@ private:
    */
   void propagateNegative();
 
+  /**
+   * \brief Propagates the contents of \e bucket_queue like \ref
+   * propagatePositive (or \ref propagateNegative if \e negative is
+   * true), expanding the voxels of large buckets in parallel.
+   *
+   * @param bucket_queue The queue to propagate and clear
+   * @param negative Whether negative distances are propagated
+   */
+  void propagateParallel(std::vector<EigenSTL::vector_Vector3i>& bucket_queue, bool negative);
+
+  /**
+   * \brief Finds the neighbors of the voxel at \e loc whose distance
+   * decreases when the voxel's closest point is propagated to them.
+   * Does not modify the field.
+   *
+   * @param loc Location of the voxel to expand
+   * @param bucket Index of the bucket the voxel was queued in
+   * @param negative Whether negative distances are propagated
+   * @param [out] updates The updates found are appended to this vector
+   */
+  void proposeUpdates(const Eigen::Vector3i& loc, unsigned int bucket, bool negative,
+                      std::vector<PropagationUpdate>& updates) const;
+
+  /**
+   * \brief Applies the updates in [\e begin, \e end) from a voxel
+   * with the given closest point, skipping those that no longer
+   * decrease the distance, and queues the updated voxels.
+   *
+   * @param closest_point The closest point propagated by the updates
+   * @param begin First update to apply
+   * @param end End of the updates to apply
+   * @param negative Whether negative distances are propagated
+   * @param bucket_queue The queue the updated voxels are added to
+   */
+  void applyUpdates(const Eigen::Vector3i& closest_point, std::vector<PropagationUpdate>::const_iterator begin,
+                    std::vector<PropagationUpdate>::const_iterator end, bool negative,
+                    std::vector<EigenSTL::vector_Vector3i>& bucket_queue);
+
   /**
    * \brief Determines distance based on actual voxel data
    *
@@ -496,6 +619,12 @@ private:
    */
   virtual double getDistance(const PropDistanceFieldVoxel& object) const;
 
+  /**
+   * \brief Reads the distances of the eight cells of a cube directly
+   * from the voxel grid, see \ref DistanceField::getCornerDistances.
+   */
+  void getCornerDistances(int x, int y, int z, double distances[8]) const override;
+
   /**
    * \brief Helper function to get a single number in a 27 connected
    * 3D voxel grid given dx, dy, and dz values.
@@ -565,6 +694,10 @@ private:
                                                                        integer distance from the closest unoccupied
                                                                        points*/
 
+  std::size_t num_threads_; /**< \brief Maximum number of threads used for propagation, 0 for all cores */
+
+  bool sparse_storage_; /**< \brief Whether voxel_grid_ allocates its voxels in blocks near obstacles */
+
   double max_distance_; /**< \brief Holds maximum distance  */
   int max_distance_sq_; /**< \brief Holds maximum distance squared in cells */
 
@@ -38,6 +38,8 @@
 
 #include <algorithm>
 #include <cmath>
+#include <memory>
+#include <vector>
 #include <Eigen/Core>
 #include <moveit/macros/declare_ptr.h>
 
@@ -52,10 +54,15 @@ enum Dimension
 };
 
 /**
- * \brief VoxelGrid holds a dense 3D, axis-aligned set of data at a
- * given resolution, where the data is supplied as a template
- * parameter.
+ * \brief VoxelGrid holds a 3D, axis-aligned set of data at a given
+ * resolution, where the data is supplied as a template parameter.
  *
+ * The data is either stored densely, or in blocks of
+ * BLOCK_SIZE x BLOCK_SIZE x BLOCK_SIZE cells that are only allocated
+ * when one of their cells is written.  Cells of blocks that have not
+ * been allocated hold the value of the last \ref VoxelGrid::reset, so
+ * sparse grids use memory proportional to the region that has been
+ * written rather than to their volume.
  */
 template <typename T>
 class VoxelGrid
@@ -63,6 +70,12 @@ class VoxelGrid
 public:
   MOVEIT_DECLARE_PTR_MEMBER(VoxelGrid);
 
+  /** \brief Number of bits of a cell index that address a cell within a block of sparse storage */
+  static const int BLOCK_BITS = 3;
+
+  /** \brief Number of cells of a block of sparse storage along each dimension */
+  static const int BLOCK_SIZE = 1 << BLOCK_BITS;
+
   /**
    * \brief Constructor for the VoxelGrid.
    *
@@ -87,9 +100,12 @@ public:
    *
    * @param [in] default_object An object that will be returned for any
    * future queries that are not valid
+   *
+   * @param [in] sparse Whether to allocate the data in blocks on first
+   * write instead of all at once
    */
   VoxelGrid(double size_x, double size_y, double size_z, double resolution, double origin_x, double origin_y,
-            double origin_z, T default_object);
+            double origin_z, T default_object, bool sparse = false);
   virtual ~VoxelGrid();
 
   /**
@@ -116,9 +132,12 @@ public:
    * @param [in] origin_x Minimum point along the X axis of the volume
    * @param [in] origin_y Minimum point along the Y axis of the volume
    * @param [in] origin_z Minimum point along the Z axis of the volume
+   *
+   * @param [in] sparse Whether to allocate the data in blocks on first
+   * write instead of all at once
    */
   void resize(double size_x, double size_y, double size_z, double resolution, double origin_x, double origin_y,
-              double origin_z, T default_object);
+              double origin_z, T default_object, bool sparse = false);
 
   /**
    * \brief Operator that gets the value of the given location (x, y,
@@ -152,6 +171,10 @@ public:
    *
    * @return The data in the indicated cell.  If x,y,z is invalid then
    * corruption and/or SEGFAULTS will occur.
+   *
+   * With sparse storage, the non-const versions allocate the block
+   * containing the cell, while the const versions never allocate and
+   * are safe to call concurrently.
    */
   T& getCell(int x, int y, int z);
   T& getCell(const Eigen::Vector3i& pos);
@@ -182,10 +205,28 @@ public:
   /**
    * \brief Sets every cell in the voxel grid to the supplied data
    *
+   * With sparse storage, this releases all allocated blocks.
+   *
    * @param [in] initial The template variable to which to set the data
    */
   void reset(const T& initial);
 
+  /**
+   * \brief Checks whether the data is allocated in blocks on first
+   * write
+   *
+   * @return True if the voxel grid uses sparse storage; otherwise False.
+   */
+  bool isSparse() const;
+
+  /**
+   * \brief Gets the number of cells that currently have storage
+   *
+   * @return The total number of cells for dense storage, or the
+   * number of cells of all allocated blocks for sparse storage
+   */
+  std::size_t getNumAllocatedCells() const;
+
   /**
    * \brief Gets the size in arbitrary units of the indicated dimension
    *
@@ -299,6 +340,14 @@ protected:
   int stride1_;            /**< \brief The step to take when stepping between consecutive X members in the 1D array */
   int stride2_; /**< \brief The step to take when stepping between consecutive Y members given an X in the 1D array */
 
+  bool sparse_;                              /**< \brief Whether the data is stored in blocks_ instead of data_ */
+  T background_;                             /**< \brief The value of all cells of blocks that are not allocated */
+  int num_blocks_[3];                        /**< \brief The number of blocks in each dimension (in Dimension order) */
+  int block_stride1_;                        /**< \brief The step between consecutive X blocks in blocks_ */
+  int block_stride2_;                        /**< \brief The step between consecutive Y blocks given an X in blocks_ */
+  std::size_t num_allocated_blocks_;         /**< \brief The number of non-null entries of blocks_ */
+  std::vector<std::unique_ptr<T[]>> blocks_; /**< \brief Storage for sparse data, null for unallocated blocks */
+
   /**
    * \brief Gets the 1D index into the array, with no validity check.
    *
@@ -310,6 +359,24 @@ protected:
    */
   int ref(int x, int y, int z) const;
 
+  /**
+   * \brief Gets the index into blocks_ of the block containing a
+   * cell, with no validity check.
+   */
+  int blockRef(int x, int y, int z) const;
+
+  /**
+   * \brief Gets the index of a cell within its block, with no
+   * validity check.
+   */
+  int cellInBlockRef(int x, int y, int z) const;
+
+  /**
+   * \brief Gets a cell of sparse storage, allocating its block if
+   * needed.
+   */
+  T& getSparseCell(int x, int y, int z);
+
   /**
    * \brief Gets the cell number from the location
    */
@@ -340,10 +407,10 @@ protected:
 
 template <typename T>
 VoxelGrid<T>::VoxelGrid(double size_x, double size_y, double size_z, double resolution, double origin_x,
-                        double origin_y, double origin_z, T default_object)
+                        double origin_y, double origin_z, T default_object, bool sparse)
   : data_(nullptr)
 {
-  resize(size_x, size_y, size_z, resolution, origin_x, origin_y, origin_z, default_object);
+  resize(size_x, size_y, size_z, resolution, origin_x, origin_y, origin_z, default_object, sparse);
 }
 
 template <typename T>
@@ -355,20 +422,27 @@ VoxelGrid<T>::VoxelGrid() : data_(NULL)
     origin_[i] = 0;
     origin_minus_[i] = 0;
     num_cells_[i] = 0;
+    num_blocks_[i] = 0;
   }
   resolution_ = 1.0;
   oo_resolution_ = 1.0 / resolution_;
   num_cells_total_ = 0;
   stride1_ = 0;
   stride2_ = 0;
+  sparse_ = false;
+  block_stride1_ = 0;
+  block_stride2_ = 0;
+  num_allocated_blocks_ = 0;
 }
 
 template <typename T>
 void VoxelGrid<T>::resize(double size_x, double size_y, double size_z, double resolution, double origin_x,
-                          double origin_y, double origin_z, T default_object)
+                          double origin_y, double origin_z, T default_object, bool sparse)
 {
   delete[] data_;
   data_ = nullptr;
+  blocks_.clear();
+  num_allocated_blocks_ = 0;
 
   size_[DIM_X] = size_x;
   size_[DIM_Y] = size_y;
@@ -389,13 +463,25 @@ void VoxelGrid<T>::resize(double size_x, double size_y, double size_z, double re
   }
 
   default_object_ = default_object;
+  background_ = default_object;
+  sparse_ = sparse;
 
   stride1_ = num_cells_[DIM_Y] * num_cells_[DIM_Z];
   stride2_ = num_cells_[DIM_Z];
 
+  for (int i = DIM_X; i <= DIM_Z; ++i)
+    num_blocks_[i] = (num_cells_[i] + BLOCK_SIZE - 1) >> BLOCK_BITS;
+  block_stride1_ = num_blocks_[DIM_Y] * num_blocks_[DIM_Z];
+  block_stride2_ = num_blocks_[DIM_Z];
+
   // initialize the data:
   if (num_cells_total_ > 0)
-    data_ = new T[num_cells_total_];
+  {
+    if (sparse_)
+      blocks_.resize(num_blocks_[DIM_X] * block_stride1_);
+    else
+      data_ = new T[num_cells_total_];
+  }
 }
 
 template <typename T>
@@ -428,6 +514,33 @@ inline int VoxelGrid<T>::ref(int x, int y, int z) const
   return x * stride1_ + y * stride2_ + z;
 }
 
+template <typename T>
+inline int VoxelGrid<T>::blockRef(int x, int y, int z) const
+{
+  return (x >> BLOCK_BITS) * block_stride1_ + (y >> BLOCK_BITS) * block_stride2_ + (z >> BLOCK_BITS);
+}
+
+template <typename T>
+inline int VoxelGrid<T>::cellInBlockRef(int x, int y, int z) const
+{
+  const int mask = BLOCK_SIZE - 1;
+  return ((x & mask) << (2 * BLOCK_BITS)) | ((y & mask) << BLOCK_BITS) | (z & mask);
+}
+
+template <typename T>
+T& VoxelGrid<T>::getSparseCell(int x, int y, int z)
+{
+  std::unique_ptr<T[]>& block = blocks_[blockRef(x, y, z)];
+  if (!block)
+  {
+    const int block_cells = BLOCK_SIZE * BLOCK_SIZE * BLOCK_SIZE;
+    block.reset(new T[block_cells]);
+    std::fill(block.get(), block.get() + block_cells, background_);
+    ++num_allocated_blocks_;
+  }
+  return block[cellInBlockRef(x, y, z)];
+}
+
 template <typename T>
 inline double VoxelGrid<T>::getSize(Dimension dim) const
 {
@@ -478,37 +591,42 @@ inline const T& VoxelGrid<T>::operator()(const Eigen::Vector3d& pos) const
 template <typename T>
 inline T& VoxelGrid<T>::getCell(int x, int y, int z)
 {
-  return data_[ref(x, y, z)];
+  if (!sparse_)
+    return data_[ref(x, y, z)];
+  return getSparseCell(x, y, z);
 }
 
 template <typename T>
 inline const T& VoxelGrid<T>::getCell(int x, int y, int z) const
 {
-  return data_[ref(x, y, z)];
+  if (!sparse_)
+    return data_[ref(x, y, z)];
+  const T* block = blocks_[blockRef(x, y, z)].get();
+  return block ? block[cellInBlockRef(x, y, z)] : background_;
 }
 
 template <typename T>
 inline T& VoxelGrid<T>::getCell(const Eigen::Vector3i& pos)
 {
-  return data_[ref(pos.x(), pos.y(), pos.z())];
+  return getCell(pos.x(), pos.y(), pos.z());
 }
 
 template <typename T>
 inline const T& VoxelGrid<T>::getCell(const Eigen::Vector3i& pos) const
 {
-  return data_[ref(pos.x(), pos.y(), pos.z())];
+  return getCell(pos.x(), pos.y(), pos.z());
 }
 
 template <typename T>
 inline void VoxelGrid<T>::setCell(int x, int y, int z, const T& obj)
 {
-  data_[ref(x, y, z)] = obj;
+  getCell(x, y, z) = obj;
 }
 
 template <typename T>
 inline void VoxelGrid<T>::setCell(const Eigen::Vector3i& pos, const T& obj)
 {
-  data_[ref(pos.x(), pos.y(), pos.z())] = obj;
+  getCell(pos.x(), pos.y(), pos.z()) = obj;
 }
 
 template <typename T>
@@ -540,7 +658,29 @@ inline double VoxelGrid<T>::getLocationFromCell(Dimension dim, int cell) const
 template <typename T>
 inline void VoxelGrid<T>::reset(const T& initial)
 {
-  std::fill(data_, data_ + num_cells_total_, initial);
+  if (!sparse_)
+  {
+    std::fill(data_, data_ + num_cells_total_, initial);
+    return;
+  }
+  for (std::unique_ptr<T[]>& block : blocks_)
+    block.reset();
+  num_allocated_blocks_ = 0;
+  background_ = initial;
+}
+
+template <typename T>
+inline bool VoxelGrid<T>::isSparse() const
+{
+  return sparse_;
+}
+
+template <typename T>
+inline std::size_t VoxelGrid<T>::getNumAllocatedCells() const
+{
+  if (!sparse_)
+    return num_cells_total_;
+  return num_allocated_blocks_ * BLOCK_SIZE * BLOCK_SIZE * BLOCK_SIZE;
 }
 
 template <typename T>
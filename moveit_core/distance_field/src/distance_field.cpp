@@ -85,6 +85,131 @@ double DistanceField::getDistanceGradient(double x, double y, double z, double&
   return getDistance(gx, gy, gz);
 }
 
+double DistanceField::getInterpolatedDistanceGradient(double x, double y, double z, double& gradient_x,
+                                                      double& gradient_y, double& gradient_z, bool& in_bounds) const
+{
+  double distance;
+  Eigen::Vector3d gradient;
+  in_bounds = interpolateDistanceGradient(Eigen::Vector3d(x, y, z), distance, gradient);
+  gradient_x = gradient.x();
+  gradient_y = gradient.y();
+  gradient_z = gradient.z();
+  return distance;
+}
+
+void DistanceField::getInterpolatedDistanceGradients(const EigenSTL::vector_Vector3d& points,
+                                                     std::vector<double>& distances,
+                                                     EigenSTL::vector_Vector3d& gradients,
+                                                     std::vector<bool>& in_bounds) const
+{
+  distances.resize(points.size());
+  gradients.resize(points.size());
+  in_bounds.resize(points.size());
+  for (std::size_t i = 0; i < points.size(); ++i)
+    in_bounds[i] = interpolateDistanceGradient(points[i], distances[i], gradients[i]);
+}
+
+bool DistanceField::interpolateDistanceGradient(const Eigen::Vector3d& point, double& distance,
+                                                Eigen::Vector3d& gradient) const
+{
+  const Eigen::Array3i num_cells(getXNumCells(), getYNumCells(), getZNumCells());
+  const double inv_resolution = 1.0 / resolution_;
+
+  // location in cell units, where cell centers lie on integers
+  const Eigen::Array3d cell = (point.array() - Eigen::Array3d(origin_x_, origin_y_, origin_z_)) * inv_resolution;
+  if ((cell < 0.0).any() || (cell > (num_cells - 1).cast<double>()).any() || (num_cells < 2).any())
+  {
+    distance = getUninitializedDistance();
+    gradient.setZero();
+    return false;
+  }
+
+  // the minimum corner of the surrounding cube, moved inside at the far boundary
+  const Eigen::Array3i corner = cell.floor().cast<int>().min(num_cells - 2);
+  const Eigen::Array3d t = cell - corner.cast<double>();
+  const Eigen::Array3d s = 1.0 - t;
+  double d[8];
+  getCornerDistances(corner.x(), corner.y(), corner.z(), d);
+
+  // interpolate along z, then y, then x
+  const double d00 = s.z() * d[0] + t.z() * d[1];
+  const double d01 = s.z() * d[2] + t.z() * d[3];
+  const double d10 = s.z() * d[4] + t.z() * d[5];
+  const double d11 = s.z() * d[6] + t.z() * d[7];
+  const double d0 = s.y() * d00 + t.y() * d01;
+  const double d1 = s.y() * d10 + t.y() * d11;
+  distance = s.x() * d0 + t.x() * d1;
+
+  if (gradient_channels_.empty())
+  {
+    // derivative of the interpolated distance
+    gradient.x() = (d1 - d0) * inv_resolution;
+    gradient.y() = (s.x() * (d01 - d00) + t.x() * (d11 - d10)) * inv_resolution;
+    gradient.z() = (s.x() * (s.y() * (d[1] - d[0]) + t.y() * (d[3] - d[2])) +
+                    t.x() * (s.y() * (d[5] - d[4]) + t.y() * (d[7] - d[6]))) *
+                   inv_resolution;
+    return true;
+  }
+
+  // interpolate the precomputed gradients with the same weights
+  const int stride_x = num_cells.y() * num_cells.z();
+  const int stride_y = num_cells.z();
+  const std::size_t base = corner.x() * stride_x + corner.y() * stride_y + corner.z();
+  const double weights[8] = { s.x() * s.y() * s.z(), s.x() * s.y() * t.z(), s.x() * t.y() * s.z(),
+                              s.x() * t.y() * t.z(), t.x() * s.y() * s.z(), t.x() * s.y() * t.z(),
+                              t.x() * t.y() * s.z(), t.x() * t.y() * t.z() };
+  const int offsets[8] = { 0, 1, stride_y, stride_y + 1, stride_x, stride_x + 1, stride_x + stride_y,
+                           stride_x + stride_y + 1 };
+  gradient.setZero();
+  for (int c = 0; c < 8; ++c)
+    gradient += weights[c] * gradient_channels_[base + offsets[c]].cast<double>();
+  return true;
+}
+
+bool DistanceField::computeGradientChannels()
+{
+  const int num_x = getXNumCells();
+  const int num_y = getYNumCells();
+  const int num_z = getZNumCells();
+  gradient_channels_.assign(static_cast<std::size_t>(num_x) * num_y * num_z, Eigen::Vector3f::Zero());
+
+  // central differences inside the field and one-sided differences at its boundary
+  const double inv_resolution = 1.0 / resolution_;
+  std::size_t index = 0;
+  for (int x = 0; x < num_x; ++x)
+  {
+    for (int y = 0; y < num_y; ++y)
+    {
+      for (int z = 0; z < num_z; ++z, ++index)
+      {
+        const int x0 = std::max(x - 1, 0), x1 = std::min(x + 1, num_x - 1);
+        const int y0 = std::max(y - 1, 0), y1 = std::min(y + 1, num_y - 1);
+        const int z0 = std::max(z - 1, 0), z1 = std::min(z + 1, num_z - 1);
+        Eigen::Vector3f& gradient = gradient_channels_[index];
+        if (x1 > x0)
+          gradient.x() = (getDistance(x1, y, z) - getDistance(x0, y, z)) * inv_resolution / (x1 - x0);
+        if (y1 > y0)
+          gradient.y() = (getDistance(x, y1, z) - getDistance(x, y0, z)) * inv_resolution / (y1 - y0);
+        if (z1 > z0)
+          gradient.z() = (getDistance(x, y, z1) - getDistance(x, y, z0)) * inv_resolution / (z1 - z0);
+      }
+    }
+  }
+  return true;
+}
+
+void DistanceField::clearGradientChannels()
+{
+  // release the memory, not just the contents
+  std::vector<Eigen::Vector3f>().swap(gradient_channels_);
+}
+
+void DistanceField::getCornerDistances(int x, int y, int z, double distances[8]) const
+{
+  for (int c = 0; c < 8; ++c)
+    distances[c] = getDistance(x + (c >> 2), y + ((c >> 1) & 1), z + (c & 1));
+}
+
 void DistanceField::getIsoSurfaceMarkers(double min_distance, double max_distance, const std::string& frame_id,
                                          const ros::Time stamp, visualization_msgs::Marker& inf_marker) const
 {
@@ -0,0 +1,385 @@
+/*********************************************************************
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2020, PickNik LLC.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the copyright holder nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************/
+
+#include <moveit/distance_field/euclidean_distance_field.h>
+#include <moveit/utils/thread_pool.h>
+#include <boost/iostreams/filtering_stream.hpp>
+#include <boost/iostreams/filter/zlib.hpp>
+#include <bitset>
+#include <cmath>
+#include <limits>
+
+namespace distance_field
+{
+namespace
+{
+/** \brief Temporary storage for the transform of a single row */
+struct RowBuffers
+{
+  std::vector<int> f;     /**< \brief The squared distances of the row before the pass */
+  std::vector<int> d;     /**< \brief The squared distances of the row after the pass */
+  std::vector<int> v;     /**< \brief Locations of the parabolas of the lower envelope */
+  std::vector<double> z;  /**< \brief Boundaries between the parabolas of the lower envelope */
+
+  void resize(std::size_t n)
+  {
+    f.resize(n);
+    d.resize(n);
+    v.resize(n);
+    z.resize(n + 1);
+  }
+};
+
+/** \brief Location of the intersection of the parabolas rooted at \e q and \e p of the row \e f */
+inline double intersection(const std::vector<int>& f, int q, int p)
+{
+  return ((static_cast<double>(f[q]) + static_cast<double>(q) * q) -
+          (static_cast<double>(f[p]) + static_cast<double>(p) * p)) /
+         (2.0 * (q - p));
+}
+
+/** \brief Computes the 1D squared distance transform of the first \e n values of \e buffers.f into \e buffers.d,
+ *  clamped to \e far, as the lower envelope of the parabolas rooted at each value */
+void transformRow(RowBuffers& buffers, int n, int far)
+{
+  const std::vector<int>& f = buffers.f;
+  std::vector<int>& v = buffers.v;
+  std::vector<double>& z = buffers.z;
+
+  int k = 0;
+  v[0] = 0;
+  z[0] = -std::numeric_limits<double>::infinity();
+  z[1] = std::numeric_limits<double>::infinity();
+  for (int q = 1; q < n; ++q)
+  {
+    double s = intersection(f, q, v[k]);
+    while (s <= z[k])
+    {
+      --k;
+      s = intersection(f, q, v[k]);
+    }
+    ++k;
+    v[k] = q;
+    z[k] = s;
+    z[k + 1] = std::numeric_limits<double>::infinity();
+  }
+
+  k = 0;
+  for (int q = 0; q < n; ++q)
+  {
+    while (z[k + 1] < q)
+      ++k;
+    const long long distance = static_cast<long long>(q - v[k]) * (q - v[k]) + f[v[k]];
+    buffers.d[q] = distance < far ? static_cast<int>(distance) : far;
+  }
+}
+}  // namespace
+
+EuclideanDistanceField::EuclideanDistanceField(double size_x, double size_y, double size_z, double resolution,
+                                               double origin_x, double origin_y, double origin_z, double max_distance,
+                                               bool compute_negative_distances)
+  : DistanceField(size_x, size_y, size_z, resolution, origin_x, origin_y, origin_z)
+  , compute_negative_(compute_negative_distances)
+  , num_threads_(1)
+  , max_distance_(max_distance)
+{
+  initialize();
+}
+
+EuclideanDistanceField::EuclideanDistanceField(std::istream& is, double max_distance, bool compute_negative_distances)
+  : DistanceField(0, 0, 0, 0, 0, 0, 0)
+  , compute_negative_(compute_negative_distances)
+  , num_threads_(1)
+  , max_distance_(max_distance)
+{
+  readFromStream(is);
+}
+
+void EuclideanDistanceField::initialize()
+{
+  max_distance_sq_ = ceil(max_distance_ / resolution_) * ceil(max_distance_ / resolution_);
+  voxel_grid_.reset(new VoxelGrid<EuclideanDistanceFieldVoxel>(size_x_, size_y_, size_z_, resolution_, origin_x_,
+                                                               origin_y_, origin_z_,
+                                                               EuclideanDistanceFieldVoxel(max_distance_sq_, 0)));
+
+  // create a sqrt table:
+  sqrt_table_.resize(max_distance_sq_ + 1);
+  for (int i = 0; i <= max_distance_sq_; ++i)
+    sqrt_table_[i] = sqrt(double(i)) * resolution_;
+
+  reset();
+}
+
+void EuclideanDistanceField::addPointsToField(const EigenSTL::vector_Vector3d& points)
+{
+  if (setOccupancy(points, true))
+    computeDistances();
+}
+
+void EuclideanDistanceField::removePointsFromField(const EigenSTL::vector_Vector3d& points)
+{
+  if (setOccupancy(points, false))
+    computeDistances();
+}
+
+void EuclideanDistanceField::updatePointsInField(const EigenSTL::vector_Vector3d& old_points,
+                                                 const EigenSTL::vector_Vector3d& new_points)
+{
+  bool changed = setOccupancy(old_points, false);
+  changed = setOccupancy(new_points, true) || changed;
+  if (changed)
+    computeDistances();
+}
+
+void EuclideanDistanceField::reset()
+{
+  clearGradientChannels();
+  voxel_grid_->reset(EuclideanDistanceFieldVoxel(max_distance_sq_, 0));
+}
+
+bool EuclideanDistanceField::setOccupancy(const EigenSTL::vector_Vector3d& points, bool occupied)
+{
+  bool changed = false;
+  for (const Eigen::Vector3d& point : points)
+  {
+    int x, y, z;
+    if (!worldToGrid(point.x(), point.y(), point.z(), x, y, z))
+      continue;
+    EuclideanDistanceFieldVoxel& voxel = voxel_grid_->getCell(x, y, z);
+    if (voxel.occupied_ != occupied)
+    {
+      voxel.occupied_ = occupied;
+      changed = true;
+    }
+  }
+  return changed;
+}
+
+void EuclideanDistanceField::computeDistances()
+{
+  clearGradientChannels();
+  computeTransform(&EuclideanDistanceFieldVoxel::distance_square_, true);
+  if (compute_negative_)
+    computeTransform(&EuclideanDistanceFieldVoxel::negative_distance_square_, false);
+}
+
+void EuclideanDistanceField::computeTransform(int EuclideanDistanceFieldVoxel::*distance, bool sites)
+{
+  const int num_cells[3] = { getXNumCells(), getYNumCells(), getZNumCells() };
+  if (num_cells[DIM_X] <= 0 || num_cells[DIM_Y] <= 0 || num_cells[DIM_Z] <= 0)
+    return;
+
+  // distances beyond the maximum distance are clamped to far during the passes, which does not change any of the
+  // distances up to the maximum distance, and to the maximum distance after the last pass
+  const int far = max_distance_sq_ + 1;
+
+  moveit::core::ThreadPool& pool = moveit::core::ThreadPool::getShared();
+  const std::size_t concurrency =
+      num_threads_ == 0 ? pool.getConcurrency() : std::min(num_threads_, pool.getConcurrency());
+  std::vector<RowBuffers> buffers(concurrency == 1 ? 1 : pool.getConcurrency());
+  for (RowBuffers& buffer : buffers)
+    buffer.resize(*std::max_element(num_cells, num_cells + 3));
+
+  // one pass along each axis, starting with z along which the cells are contiguous
+  for (Dimension dim : { DIM_Z, DIM_Y, DIM_X })
+  {
+    const bool first_pass = dim == DIM_Z;
+    const bool last_pass = dim == DIM_X;
+    // the rows of the pass are indexed by the cells along the two other axes
+    const Dimension row_dim = dim == DIM_X ? DIM_Y : DIM_X;
+    const Dimension col_dim = dim == DIM_Z ? DIM_Y : DIM_Z;
+    const int n = num_cells[dim];
+
+    auto transform = [&](std::size_t thread, std::size_t row) {
+      RowBuffers& buffer = buffers[thread];
+      int cell[3];
+      cell[row_dim] = static_cast<int>(row) / num_cells[col_dim];
+      cell[col_dim] = static_cast<int>(row) % num_cells[col_dim];
+      for (cell[dim] = 0; cell[dim] < n; ++cell[dim])
+      {
+        const EuclideanDistanceFieldVoxel& voxel = voxel_grid_->getCell(cell[DIM_X], cell[DIM_Y], cell[DIM_Z]);
+        buffer.f[cell[dim]] = first_pass ? (voxel.occupied_ == sites ? 0 : far) : voxel.*distance;
+      }
+      transformRow(buffer, n, far);
+      for (cell[dim] = 0; cell[dim] < n; ++cell[dim])
+      {
+        EuclideanDistanceFieldVoxel& voxel = voxel_grid_->getCell(cell[DIM_X], cell[DIM_Y], cell[DIM_Z]);
+        voxel.*distance = last_pass ? std::min(buffer.d[cell[dim]], max_distance_sq_) : buffer.d[cell[dim]];
+      }
+    };
+
+    const std::size_t num_rows = static_cast<std::size_t>(num_cells[row_dim]) * num_cells[col_dim];
+    if (concurrency == 1)
+    {
+      for (std::size_t row = 0; row < num_rows; ++row)
+        transform(0, row);
+    }
+    else
+      pool.parallelFor(num_rows, transform, concurrency);
+  }
+}
+
+double EuclideanDistanceField::getDistance(double x, double y, double z) const
+{
+  return getDistance((*voxel_grid_.get())(x, y, z));
+}
+
+double EuclideanDistanceField::getDistance(int x, int y, int z) const
+{
+  return getDistance(voxel_grid_->getCell(x, y, z));
+}
+
+void EuclideanDistanceField::getCornerDistances(int x, int y, int z, double distances[8]) const
+{
+  for (int c = 0; c < 8; ++c)
+    distances[c] = getDistance(voxel_grid_->getCell(x + (c >> 2), y + ((c >> 1) & 1), z + (c & 1)));
+}
+
+bool EuclideanDistanceField::isCellValid(int x, int y, int z) const
+{
+  return voxel_grid_->isCellValid(x, y, z);
+}
+
+int EuclideanDistanceField::getXNumCells() const
+{
+  return voxel_grid_->getNumCells(DIM_X);
+}
+
+int EuclideanDistanceField::getYNumCells() const
+{
+  return voxel_grid_->getNumCells(DIM_Y);
+}
+
+int EuclideanDistanceField::getZNumCells() const
+{
+  return voxel_grid_->getNumCells(DIM_Z);
+}
+
+bool EuclideanDistanceField::gridToWorld(int x, int y, int z, double& world_x, double& world_y, double& world_z) const
+{
+  voxel_grid_->gridToWorld(x, y, z, world_x, world_y, world_z);
+  return true;
+}
+
+bool EuclideanDistanceField::worldToGrid(double world_x, double world_y, double world_z, int& x, int& y, int& z) const
+{
+  return voxel_grid_->worldToGrid(world_x, world_y, world_z, x, y, z);
+}
+
+bool EuclideanDistanceField::writeToStream(std::ostream& os) const
+{
+  os << "resolution: " << resolution_ << std::endl;
+  os << "size_x: " << size_x_ << std::endl;
+  os << "size_y: " << size_y_ << std::endl;
+  os << "size_z: " << size_z_ << std::endl;
+  os << "origin_x: " << origin_x_ << std::endl;
+  os << "origin_y: " << origin_y_ << std::endl;
+  os << "origin_z: " << origin_z_ << std::endl;
+
+  // the occupancy of the cells, one bit per cell, zlib compressed
+  boost::iostreams::filtering_ostream out;
+  out.push(boost::iostreams::zlib_compressor());
+  out.push(os);
+
+  for (int x = 0; x < getXNumCells(); x++)
+  {
+    for (int y = 0; y < getYNumCells(); y++)
+    {
+      for (int z = 0; z < getZNumCells(); z += 8)
+      {
+        std::bitset<8> bs(0);
+        int zv = std::min(8, getZNumCells() - z);
+        for (int zi = 0; zi < zv; zi++)
+        {
+          if (getCell(x, y, z + zi).occupied_)
+            bs[zi] = 1;
+        }
+        out.write((char*)&bs, sizeof(char));
+      }
+    }
+  }
+  out.flush();
+  return true;
+}
+
+bool EuclideanDistanceField::readFromStream(std::istream& is)
+{
+  if (!is.good())
+    return false;
+
+  const std::pair<const char*, double*> fields[] = { { "resolution:", &resolution_ }, { "size_x:", &size_x_ },
+                                                     { "size_y:", &size_y_ },         { "size_z:", &size_z_ },
+                                                     { "origin_x:", &origin_x_ },     { "origin_y:", &origin_y_ },
+                                                     { "origin_z:", &origin_z_ } };
+  for (const std::pair<const char*, double*>& field : fields)
+  {
+    std::string temp;
+    is >> temp;
+    if (temp != field.first)
+      return false;
+    is >> *field.second;
+  }
+
+  // previous values for compute_negative_ and max_distance_ will be used
+  initialize();
+
+  // this should be newline
+  char nl;
+  is.get(nl);
+
+  boost::iostreams::filtering_istream in;
+  in.push(boost::iostreams::zlib_decompressor());
+  in.push(is);
+
+  for (int x = 0; x < getXNumCells(); x++)
+  {
+    for (int y = 0; y < getYNumCells(); y++)
+    {
+      for (int z = 0; z < getZNumCells(); z += 8)
+      {
+        char inchar;
+        if (!in.good())
+          return false;
+        in.get(inchar);
+        std::bitset<8> inbit((unsigned long long)inchar);
+        int zv = std::min(8, getZNumCells() - z);
+        for (int zi = 0; zi < zv; zi++)
+          voxel_grid_->getCell(x, y, z + zi).occupied_ = inbit[zi] == 1;
+      }
+    }
+  }
+  computeDistances();
+  return true;
+}
+}  // namespace distance_field
@@ -35,6 +35,7 @@
 /* Author: Mrinal Kalakrishnan, Ken Anderson */
 
 #include <moveit/distance_field/propagation_distance_field.h>
+#include <moveit/utils/thread_pool.h>
 #include <visualization_msgs/Marker.h>
 #include <ros/console.h>
 #include <boost/iostreams/filtering_stream.hpp>
@@ -43,11 +44,22 @@
 
 namespace distance_field
 {
+namespace
+{
+/** \brief Buckets with fewer voxels are expanded on the calling thread */
+const std::size_t MIN_PARALLEL_BUCKET_SIZE = 1024;
+
+/** \brief Number of voxels of a bucket expanded by a single task */
+const std::size_t PARALLEL_CHUNK_SIZE = 256;
+}  // namespace
+
 PropagationDistanceField::PropagationDistanceField(double size_x, double size_y, double size_z, double resolution,
                                                    double origin_x, double origin_y, double origin_z,
-                                                   double max_distance, bool propagate_negative)
+                                                   double max_distance, bool propagate_negative, bool sparse_storage)
   : DistanceField(size_x, size_y, size_z, resolution, origin_x, origin_y, origin_z)
   , propagate_negative_(propagate_negative)
+  , num_threads_(1)
+  , sparse_storage_(sparse_storage)
   , max_distance_(max_distance)
 {
   initialize();
@@ -55,10 +67,12 @@ PropagationDistanceField::PropagationDistanceField(double size_x, double size_y,
 
 PropagationDistanceField::PropagationDistanceField(const octomap::OcTree& octree, const octomap::point3d& bbx_min,
                                                    const octomap::point3d& bbx_max, double max_distance,
-                                                   bool propagate_negative_distances)
+                                                   bool propagate_negative_distances, bool sparse_storage)
   : DistanceField(bbx_max.x() - bbx_min.x(), bbx_max.y() - bbx_min.y(), bbx_max.z() - bbx_min.z(),
                   octree.getResolution(), bbx_min.x(), bbx_min.y(), bbx_min.z())
   , propagate_negative_(propagate_negative_distances)
+  , num_threads_(1)
+  , sparse_storage_(sparse_storage)
   , max_distance_(max_distance)
   , max_distance_sq_(0)  // avoid gcc warning about uninitialized value
 {
@@ -68,7 +82,11 @@ PropagationDistanceField::PropagationDistanceField(const octomap::OcTree& octree
 
 PropagationDistanceField::PropagationDistanceField(std::istream& is, double max_distance,
                                                    bool propagate_negative_distances)
-  : DistanceField(0, 0, 0, 0, 0, 0, 0), propagate_negative_(propagate_negative_distances), max_distance_(max_distance)
+  : DistanceField(0, 0, 0, 0, 0, 0, 0)
+  , propagate_negative_(propagate_negative_distances)
+  , num_threads_(1)
+  , sparse_storage_(false)
+  , max_distance_(max_distance)
 {
   readFromStream(is);
 }
@@ -77,7 +95,8 @@ void PropagationDistanceField::initialize()
 {
   max_distance_sq_ = ceil(max_distance_ / resolution_) * ceil(max_distance_ / resolution_);
   voxel_grid_.reset(new VoxelGrid<PropDistanceFieldVoxel>(size_x_, size_y_, size_z_, resolution_, origin_x_, origin_y_,
-                                                          origin_z_, PropDistanceFieldVoxel(max_distance_sq_, 0)));
+                                                          origin_z_, PropDistanceFieldVoxel(max_distance_sq_, 0),
+                                                          sparse_storage_));
 
   initNeighborhoods();
 
@@ -226,12 +245,14 @@ void PropagationDistanceField::removePointsFromField(const EigenSTL::vector_Vect
 
 void PropagationDistanceField::addNewObstacleVoxels(const EigenSTL::vector_Vector3i& voxel_points)
 {
+  clearGradientChannels();
   int initial_update_direction = getDirectionNumber(0, 0, 0);
   bucket_queue_[0].reserve(voxel_points.size());
   EigenSTL::vector_Vector3i negative_stack;
   if (propagate_negative_)
   {
-    negative_stack.reserve(getXNumCells() * getYNumCells() * getZNumCells());
+    if (!sparse_storage_)
+      negative_stack.reserve(getXNumCells() * getYNumCells() * getZNumCells());
     negative_bucket_queue_[0].reserve(voxel_points.size());
   }
 
@@ -309,15 +330,18 @@ void PropagationDistanceField::addNewObstacleVoxels(const EigenSTL::vector_Vecto
 void PropagationDistanceField::removeObstacleVoxels(const EigenSTL::vector_Vector3i& voxel_points)
 // const VoxelSet& locations )
 {
+  clearGradientChannels();
   EigenSTL::vector_Vector3i stack;
   EigenSTL::vector_Vector3i negative_stack;
   int initial_update_direction = getDirectionNumber(0, 0, 0);
 
-  stack.reserve(getXNumCells() * getYNumCells() * getZNumCells());
+  if (!sparse_storage_)
+    stack.reserve(getXNumCells() * getYNumCells() * getZNumCells());
   bucket_queue_[0].reserve(voxel_points.size());
   if (propagate_negative_)
   {
-    negative_stack.reserve(getXNumCells() * getYNumCells() * getZNumCells());
+    if (!sparse_storage_)
+      negative_stack.reserve(getXNumCells() * getYNumCells() * getZNumCells());
     negative_bucket_queue_[0].reserve(voxel_points.size());
   }
 
@@ -395,6 +419,12 @@ void PropagationDistanceField::removeObstacleVoxels(const EigenSTL::vector_Vecto
 
 void PropagationDistanceField::propagatePositive()
 {
+  if (num_threads_ != 1)
+  {
+    propagateParallel(bucket_queue_, false);
+    return;
+  }
+
   // now process the queue:
   for (unsigned int i = 0; i < bucket_queue_.size(); ++i)
   {
@@ -429,10 +459,10 @@ void PropagationDistanceField::propagatePositive()
 
         // the real update code:
         // calculate the neighbor's new distance based on my closest filled voxel:
-        PropDistanceFieldVoxel* neighbor = &voxel_grid_->getCell(nloc.x(), nloc.y(), nloc.z());
         int new_distance_sq = eucDistSq(vptr->closest_point_, nloc);
         if (new_distance_sq > max_distance_sq_)
           continue;
+        PropDistanceFieldVoxel* neighbor = &voxel_grid_->getCell(nloc.x(), nloc.y(), nloc.z());
 
         if (new_distance_sq < neighbor->distance_square_)
         {
@@ -452,6 +482,12 @@ void PropagationDistanceField::propagatePositive()
 
 void PropagationDistanceField::propagateNegative()
 {
+  if (num_threads_ != 1)
+  {
+    propagateParallel(negative_bucket_queue_, true);
+    return;
+  }
+
   // now process the queue:
   for (unsigned int i = 0; i < negative_bucket_queue_.size(); ++i)
   {
@@ -487,10 +523,10 @@ void PropagationDistanceField::propagateNegative()
 
         // the real update code:
         // calculate the neighbor's new distance based on my closest filled voxel:
-        PropDistanceFieldVoxel* neighbor = &voxel_grid_->getCell(nloc.x(), nloc.y(), nloc.z());
         int new_distance_sq = eucDistSq(vptr->closest_negative_point_, nloc);
         if (new_distance_sq > max_distance_sq_)
           continue;
+        PropDistanceFieldVoxel* neighbor = &voxel_grid_->getCell(nloc.x(), nloc.y(), nloc.z());
         // std::cout << "Looking at " << nloc.x() << " " << nloc.y() << " " << nloc.z() << " " << new_distance_sq << " "
         // << neighbor->negative_distance_square_ << std::endl;
         if (new_distance_sq < neighbor->negative_distance_square_)
@@ -511,9 +547,151 @@ void PropagationDistanceField::propagateNegative()
   }
 }
 
+void PropagationDistanceField::propagateParallel(std::vector<EigenSTL::vector_Vector3i>& bucket_queue, bool negative)
+{
+  moveit::core::ThreadPool& pool = moveit::core::ThreadPool::getShared();
+  const std::size_t concurrency =
+      num_threads_ == 0 ? pool.getConcurrency() : std::min(num_threads_, pool.getConcurrency());
+
+  // updates found by each chunk of a bucket, and for each voxel of the bucket the closest point and update direction
+  // it was expanded with and the end of its updates in the chunk's updates
+  std::vector<std::vector<PropagationUpdate>> chunk_updates;
+  EigenSTL::vector_Vector3i expanded_closest_points;
+  std::vector<int> expanded_directions;
+  std::vector<std::size_t> updates_end;
+  std::vector<PropagationUpdate> updates;
+
+  for (unsigned int i = 0; i < bucket_queue.size(); ++i)
+  {
+    // voxels queued in this bucket while it is processed are not expanded, just like in propagatePositive()
+    const std::size_t count = bucket_queue[i].size();
+    if (concurrency == 1 || count < MIN_PARALLEL_BUCKET_SIZE)
+    {
+      for (std::size_t j = 0; j < count; ++j)
+      {
+        const Eigen::Vector3i loc = bucket_queue[i][j];
+        const PropDistanceFieldVoxel& voxel = voxel_grid_->getCell(loc.x(), loc.y(), loc.z());
+        const Eigen::Vector3i closest_point = negative ? voxel.closest_negative_point_ : voxel.closest_point_;
+        updates.clear();
+        proposeUpdates(loc, i, negative, updates);
+        applyUpdates(closest_point, updates.begin(), updates.end(), negative, bucket_queue);
+      }
+      bucket_queue[i].clear();
+      continue;
+    }
+
+    // expand all voxels of the bucket in parallel, without modifying the field
+    const std::size_t num_chunks = (count + PARALLEL_CHUNK_SIZE - 1) / PARALLEL_CHUNK_SIZE;
+    if (chunk_updates.size() < num_chunks)
+      chunk_updates.resize(num_chunks);
+    expanded_closest_points.resize(count);
+    expanded_directions.resize(count);
+    updates_end.resize(count);
+    const EigenSTL::vector_Vector3i& bucket = bucket_queue[i];
+    pool.parallelFor(num_chunks,
+                     [&](std::size_t /*thread*/, std::size_t chunk) {
+                       std::vector<PropagationUpdate>& chunk_update = chunk_updates[chunk];
+                       chunk_update.clear();
+                       const std::size_t end = std::min(count, (chunk + 1) * PARALLEL_CHUNK_SIZE);
+                       for (std::size_t j = chunk * PARALLEL_CHUNK_SIZE; j < end; ++j)
+                       {
+                         const PropDistanceFieldVoxel& voxel = getCell(bucket[j].x(), bucket[j].y(), bucket[j].z());
+                         expanded_closest_points[j] = negative ? voxel.closest_negative_point_ : voxel.closest_point_;
+                         expanded_directions[j] = negative ? voxel.negative_update_direction_ : voxel.update_direction_;
+                         proposeUpdates(bucket[j], i, negative, chunk_update);
+                         updates_end[j] = chunk_update.size();
+                       }
+                     },
+                     concurrency);
+
+    // apply the updates in the sequential order; distances only decrease, so updates that are outdated by preceding
+    // ones are skipped by applyUpdates(), and updates that are missing cannot have been applied sequentially either
+    for (std::size_t chunk = 0; chunk < num_chunks; ++chunk)
+    {
+      const std::vector<PropagationUpdate>& chunk_update = chunk_updates[chunk];
+      std::size_t begin = 0;
+      const std::size_t end = std::min(count, (chunk + 1) * PARALLEL_CHUNK_SIZE);
+      for (std::size_t j = chunk * PARALLEL_CHUNK_SIZE; j < end; ++j)
+      {
+        const Eigen::Vector3i loc = bucket_queue[i][j];
+        const PropDistanceFieldVoxel& voxel = voxel_grid_->getCell(loc.x(), loc.y(), loc.z());
+        const Eigen::Vector3i closest_point = negative ? voxel.closest_negative_point_ : voxel.closest_point_;
+        const int direction = negative ? voxel.negative_update_direction_ : voxel.update_direction_;
+        if (closest_point == expanded_closest_points[j] && direction == expanded_directions[j])
+        {
+          applyUpdates(closest_point, chunk_update.begin() + begin, chunk_update.begin() + updates_end[j], negative,
+                       bucket_queue);
+        }
+        else
+        {
+          // the voxel has been updated by a preceding voxel of this bucket, expand it again
+          updates.clear();
+          proposeUpdates(loc, i, negative, updates);
+          applyUpdates(closest_point, updates.begin(), updates.end(), negative, bucket_queue);
+        }
+        begin = updates_end[j];
+      }
+    }
+    bucket_queue[i].clear();
+  }
+}
+
+void PropagationDistanceField::proposeUpdates(const Eigen::Vector3i& loc, unsigned int bucket, bool negative,
+                                              std::vector<PropagationUpdate>& updates) const
+{
+  const PropDistanceFieldVoxel& voxel = getCell(loc.x(), loc.y(), loc.z());
+  const int update_direction = negative ? voxel.negative_update_direction_ : voxel.update_direction_;
+  if (update_direction < 0 || update_direction > 26)
+  {
+    ROS_ERROR_NAMED("distance_field", "PROGRAMMING ERROR: Invalid update direction detected: %d", update_direction);
+    return;
+  }
+  const Eigen::Vector3i& closest_point = negative ? voxel.closest_negative_point_ : voxel.closest_point_;
+
+  // select the neighborhood list based on the update direction:
+  for (const Eigen::Vector3i& diff : neighborhoods_[bucket > 1 ? 1 : bucket][update_direction])
+  {
+    Eigen::Vector3i nloc(loc.x() + diff.x(), loc.y() + diff.y(), loc.z() + diff.z());
+    if (!isCellValid(nloc.x(), nloc.y(), nloc.z()))
+      continue;
+
+    int new_distance_sq = eucDistSq(closest_point, nloc);
+    if (new_distance_sq > max_distance_sq_)
+      continue;
+
+    const PropDistanceFieldVoxel& neighbor = getCell(nloc.x(), nloc.y(), nloc.z());
+    if (new_distance_sq < (negative ? neighbor.negative_distance_square_ : neighbor.distance_square_))
+      updates.push_back(PropagationUpdate{ nloc, new_distance_sq, getDirectionNumber(diff.x(), diff.y(), diff.z()) });
+  }
+}
+
+void PropagationDistanceField::applyUpdates(const Eigen::Vector3i& closest_point,
+                                            std::vector<PropagationUpdate>::const_iterator begin,
+                                            std::vector<PropagationUpdate>::const_iterator end, bool negative,
+                                            std::vector<EigenSTL::vector_Vector3i>& bucket_queue)
+{
+  for (; begin != end; ++begin)
+  {
+    PropDistanceFieldVoxel& neighbor = voxel_grid_->getCell(begin->loc_.x(), begin->loc_.y(), begin->loc_.z());
+    int& distance_square = negative ? neighbor.negative_distance_square_ : neighbor.distance_square_;
+    if (begin->distance_square_ < distance_square)
+    {
+      distance_square = begin->distance_square_;
+      (negative ? neighbor.closest_negative_point_ : neighbor.closest_point_) = closest_point;
+      (negative ? neighbor.negative_update_direction_ : neighbor.update_direction_) = begin->update_direction_;
+      bucket_queue[begin->distance_square_].push_back(begin->loc_);
+    }
+  }
+}
+
 void PropagationDistanceField::reset()
 {
+  clearGradientChannels();
   voxel_grid_->reset(PropDistanceFieldVoxel(max_distance_sq_, 0));
+  // voxels of sparse storage keep an uninitialized closest negative point, which is resolved to the voxel itself
+  // when negative distances are propagated, rather than allocating the whole volume here
+  if (sparse_storage_)
+    return;
   for (int x = 0; x < getXNumCells(); x++)
   {
     for (int y = 0; y < getYNumCells(); y++)
@@ -606,7 +784,23 @@ double PropagationDistanceField::getDistance(double x, double y, double z) const
 
 double PropagationDistanceField::getDistance(int x, int y, int z) const
 {
-  return getDistance(voxel_grid_->getCell(x, y, z));
+  return getDistance(getCell(x, y, z));
+}
+
+bool PropagationDistanceField::computeGradientChannels()
+{
+  if (sparse_storage_)
+  {
+    ROS_DEBUG_NAMED("distance_field", "Not computing dense gradient channels for a field with sparse storage");
+    return false;
+  }
+  return DistanceField::computeGradientChannels();
+}
+
+void PropagationDistanceField::getCornerDistances(int x, int y, int z, double distances[8]) const
+{
+  for (int c = 0; c < 8; ++c)
+    distances[c] = getDistance(getCell(x + (c >> 2), y + ((c >> 1) & 1), z + (c & 1)));
 }
 
 bool PropagationDistanceField::isCellValid(int x, int y, int z) const
@@ -38,6 +38,7 @@
 
 #include <moveit/distance_field/voxel_grid.h>
 #include <moveit/distance_field/propagation_distance_field.h>
+#include <moveit/distance_field/euclidean_distance_field.h>
 #include <moveit/distance_field/find_internal_points.h>
 #include <geometric_shapes/body_operations.h>
 #include <tf2_eigen/tf2_eigen.h>
@@ -45,6 +46,7 @@
 #include <ros/console.h>
 
 #include <memory>
+#include <sstream>
 
 using namespace distance_field;
 
@@ -196,6 +198,28 @@ bool areDistanceFieldsDistancesEqual(const PropagationDistanceField& df1, const
   return true;
 }
 
+bool areDistanceFieldsIdentical(const PropagationDistanceField& df1, const PropagationDistanceField& df2)
+{
+  if (!areDistanceFieldsDistancesEqual(df1, df2))
+    return false;
+  for (int z = 0; z < df1.getZNumCells(); z++)
+  {
+    for (int x = 0; x < df1.getXNumCells(); x++)
+    {
+      for (int y = 0; y < df1.getYNumCells(); y++)
+      {
+        if (df1.getCell(x, y, z).closest_point_ != df2.getCell(x, y, z).closest_point_ ||
+            df1.getCell(x, y, z).closest_negative_point_ != df2.getCell(x, y, z).closest_negative_point_)
+        {
+          printf("Cell %d %d %d closest points not equal\n", x, y, z);
+          return false;
+        }
+      }
+    }
+  }
+  return true;
+}
+
 bool checkOctomapVersusDistanceField(const PropagationDistanceField& df, const octomap::OcTree& octree)
 {
   // just one way for now
@@ -929,6 +953,330 @@ TEST(TestSignedPropagationDistanceField, TestReadWrite)
   EXPECT_FALSE(areDistanceFieldsDistancesEqual(df, df3));
 }
 
+TEST(TestSignedPropagationDistanceField, TestParallelPropagation)
+{
+  for (bool propagate_negative : { false, true })
+  {
+    PropagationDistanceField df(2.0, 2.0, 2.0, PERF_RESOLUTION, PERF_ORIGIN_X, PERF_ORIGIN_Y, PERF_ORIGIN_Z,
+                                PERF_MAX_DIST, propagate_negative);
+    PropagationDistanceField parallel_df(2.0, 2.0, 2.0, PERF_RESOLUTION, PERF_ORIGIN_X, PERF_ORIGIN_Y, PERF_ORIGIN_Z,
+                                         PERF_MAX_DIST, propagate_negative);
+    parallel_df.setNumThreads(4);
+    EXPECT_EQ(parallel_df.getNumThreads(), 4u);
+
+    shapes::Box table(1.5, 1.5, .1);
+    shapes::Sphere sphere(.3);
+    Eigen::Isometry3d p = Eigen::Translation3d(1.0, 1.0, 0.6) * Eigen::Quaterniond(0.0, 0.0, 0.0, 1.0);
+    Eigen::Isometry3d np = Eigen::Translation3d(1.05, 0.98, 0.61) * Eigen::Quaterniond(0.0, 0.0, 0.0, 1.0);
+    Eigen::Isometry3d sp = Eigen::Translation3d(0.7, 0.8, 1.2) * Eigen::Quaterniond(0.0, 0.0, 0.0, 1.0);
+
+    df.addShapeToField(&table, p);
+    parallel_df.addShapeToField(&table, p);
+    EXPECT_TRUE(areDistanceFieldsIdentical(df, parallel_df));
+
+    df.addShapeToField(&sphere, sp);
+    parallel_df.addShapeToField(&sphere, sp);
+    EXPECT_TRUE(areDistanceFieldsIdentical(df, parallel_df));
+
+    df.moveShapeInField(&table, p, np);
+    parallel_df.moveShapeInField(&table, p, np);
+    EXPECT_TRUE(areDistanceFieldsIdentical(df, parallel_df));
+
+    df.removeShapeFromField(&sphere, sp);
+    parallel_df.removeShapeFromField(&sphere, sp);
+    EXPECT_TRUE(areDistanceFieldsIdentical(df, parallel_df));
+
+    // all cores
+    parallel_df.setNumThreads(0);
+    df.removeShapeFromField(&table, np);
+    parallel_df.removeShapeFromField(&table, np);
+    EXPECT_TRUE(areDistanceFieldsIdentical(df, parallel_df));
+  }
+}
+
+TEST(TestSignedPropagationDistanceField, TestParallelPerformance)
+{
+  shapes::Box big_table(2.0, 2.0, .5);
+  shapes::Box small_table(.25, .25, .05);
+  Eigen::Isometry3d p = Eigen::Translation3d(PERF_WIDTH / 2.0, PERF_DEPTH / 2.0, PERF_HEIGHT / 2.0) *
+                        Eigen::Quaterniond(0.0, 0.0, 0.0, 1.0);
+  Eigen::Isometry3d np = Eigen::Translation3d(PERF_WIDTH / 2.0 + .01, PERF_DEPTH / 2.0, PERF_HEIGHT / 2.0) *
+                         Eigen::Quaterniond(0.0, 0.0, 0.0, 1.0);
+
+  for (double resolution : { 0.05, 0.03, 0.02 })
+  {
+    for (std::size_t num_threads : { 1u, 0u })
+    {
+      PropagationDistanceField sdf(PERF_WIDTH, PERF_HEIGHT, PERF_DEPTH, resolution, PERF_ORIGIN_X, PERF_ORIGIN_Y,
+                                   PERF_ORIGIN_Z, PERF_MAX_DIST, true);
+      sdf.setNumThreads(num_threads);
+      const double num_cells = 1.0 * sdf.getXNumCells() * sdf.getYNumCells() * sdf.getZNumCells();
+
+      // full rebuild of the field
+      ros::WallTime dt = ros::WallTime::now();
+      sdf.reset();
+      sdf.addShapeToField(&big_table, p);
+      double rebuild = (ros::WallTime::now() - dt).toSec();
+
+      // incremental update of a small part of the field
+      sdf.addShapeToField(&small_table, p);
+      dt = ros::WallTime::now();
+      sdf.moveShapeInField(&small_table, p, np);
+      double update = (ros::WallTime::now() - dt).toSec();
+
+      printf("Resolution %g (%g cells), %s: rebuild took %g (%g cells/s), incremental update took %g\n", resolution,
+             num_cells, num_threads == 1 ? "single thread" : "all cores", rebuild, num_cells / rebuild, update);
+    }
+  }
+}
+
+TEST(TestSignedPropagationDistanceField, TestSparseStorage)
+{
+  for (bool propagate_negative : { false, true })
+  {
+    PropagationDistanceField df(2.0, 2.0, 2.0, PERF_RESOLUTION, PERF_ORIGIN_X, PERF_ORIGIN_Y, PERF_ORIGIN_Z,
+                                PERF_MAX_DIST, propagate_negative);
+    PropagationDistanceField sparse_df(2.0, 2.0, 2.0, PERF_RESOLUTION, PERF_ORIGIN_X, PERF_ORIGIN_Y, PERF_ORIGIN_Z,
+                                       PERF_MAX_DIST, propagate_negative, true);
+    EXPECT_FALSE(df.hasSparseStorage());
+    EXPECT_TRUE(sparse_df.hasSparseStorage());
+    EXPECT_EQ(sparse_df.getNumAllocatedCells(), 0u);
+
+    shapes::Box table(1.5, 1.5, .1);
+    shapes::Sphere sphere(.3);
+    Eigen::Isometry3d p = Eigen::Translation3d(1.0, 1.0, 0.6) * Eigen::Quaterniond(0.0, 0.0, 0.0, 1.0);
+    Eigen::Isometry3d np = Eigen::Translation3d(1.05, 0.98, 0.61) * Eigen::Quaterniond(0.0, 0.0, 0.0, 1.0);
+    Eigen::Isometry3d sp = Eigen::Translation3d(0.7, 0.8, 1.2) * Eigen::Quaterniond(0.0, 0.0, 0.0, 1.0);
+
+    df.addShapeToField(&table, p);
+    sparse_df.addShapeToField(&table, p);
+    EXPECT_TRUE(areDistanceFieldsDistancesEqual(df, sparse_df));
+    EXPECT_LT(sparse_df.getNumAllocatedCells(), df.getNumAllocatedCells());
+
+    df.addShapeToField(&sphere, sp);
+    sparse_df.addShapeToField(&sphere, sp);
+    EXPECT_TRUE(areDistanceFieldsDistancesEqual(df, sparse_df));
+
+    // reading from several threads does not allocate
+    sparse_df.setNumThreads(4);
+    df.moveShapeInField(&table, p, np);
+    sparse_df.moveShapeInField(&table, p, np);
+    EXPECT_TRUE(areDistanceFieldsDistancesEqual(df, sparse_df));
+
+    df.removeShapeFromField(&sphere, sp);
+    sparse_df.removeShapeFromField(&sphere, sp);
+    EXPECT_TRUE(areDistanceFieldsDistancesEqual(df, sparse_df));
+
+    sparse_df.reset();
+    EXPECT_EQ(sparse_df.getNumAllocatedCells(), 0u);
+  }
+
+  // a large workspace only allocates voxels near its obstacles
+  PropagationDistanceField large_df(10.0, 10.0, 2.0, PERF_RESOLUTION, PERF_ORIGIN_X, PERF_ORIGIN_Y, PERF_ORIGIN_Z,
+                                    PERF_MAX_DIST, true, true);
+  shapes::Sphere sphere(.1);
+  large_df.addShapeToField(&sphere, Eigen::Isometry3d(Eigen::Translation3d(5.0, 5.0, 1.0)));
+  const std::size_t num_cells = static_cast<std::size_t>(large_df.getXNumCells()) * large_df.getYNumCells() *
+                                static_cast<std::size_t>(large_df.getZNumCells());
+  EXPECT_LT(large_df.getNumAllocatedCells() * 100, num_cells);
+  EXPECT_LT(large_df.getDistance(5.0, 5.0, 1.0), 0.0);
+  EXPECT_NEAR(large_df.getDistance(5.0, 5.2, 1.0), 0.1, 2 * PERF_RESOLUTION);
+  EXPECT_GE(large_df.getDistance(0.5, 0.5, 0.5), PERF_MAX_DIST);
+}
+
+TEST(TestEuclideanDistanceField, TestExactDistances)
+{
+  for (bool compute_negative : { false, true })
+  {
+    EuclideanDistanceField df(WIDTH, HEIGHT, DEPTH, RESOLUTION, ORIGIN_X, ORIGIN_Y, ORIGIN_Z, MAX_DIST,
+                              compute_negative);
+    EXPECT_EQ(df.getDistance(0.5, 0.5, 0.5), df.getUninitializedDistance());
+
+    shapes::Sphere sphere(.25);
+    Eigen::Isometry3d p = Eigen::Translation3d(0.5, 0.5, 0.5) * Eigen::Quaterniond(0.0, 0.0, 0.0, 1.0);
+    df.addShapeToField(&sphere, p);
+    df.addPointsToField({ POINT1, POINT2, POINT3 });
+    df.removePointsFromField({ POINT3 });
+
+    // compare to the distances to the closest obstacle and unoccupied cells found by brute force
+    const int max_distance_sq = df.getMaximumDistanceSquared();
+    for (int x = 0; x < df.getXNumCells(); x++)
+      for (int y = 0; y < df.getYNumCells(); y++)
+        for (int z = 0; z < df.getZNumCells(); z++)
+        {
+          int positive = max_distance_sq;
+          int negative = compute_negative ? max_distance_sq : 0;
+          for (int cx = 0; cx < df.getXNumCells(); cx++)
+            for (int cy = 0; cy < df.getYNumCells(); cy++)
+              for (int cz = 0; cz < df.getZNumCells(); cz++)
+              {
+                int distance_sq = dist_sq(cx - x, cy - y, cz - z);
+                if (df.getCell(cx, cy, cz).occupied_)
+                  positive = std::min(positive, distance_sq);
+                else if (compute_negative)
+                  negative = std::min(negative, distance_sq);
+              }
+          ASSERT_EQ(df.getCell(x, y, z).distance_square_, positive) << x << " " << y << " " << z;
+          ASSERT_EQ(df.getCell(x, y, z).negative_distance_square_, negative) << x << " " << y << " " << z;
+        }
+
+    // the propagation never finds a closer obstacle
+    PropagationDistanceField pdf(WIDTH, HEIGHT, DEPTH, RESOLUTION, ORIGIN_X, ORIGIN_Y, ORIGIN_Z, MAX_DIST,
+                                 compute_negative);
+    pdf.addShapeToField(&sphere, p);
+    pdf.addPointsToField({ POINT1, POINT2 });
+    for (int x = 0; x < df.getXNumCells(); x++)
+      for (int y = 0; y < df.getYNumCells(); y++)
+        for (int z = 0; z < df.getZNumCells(); z++)
+        {
+          EXPECT_EQ(df.getCell(x, y, z).occupied_, pdf.getCell(x, y, z).distance_square_ == 0);
+          EXPECT_LE(df.getCell(x, y, z).distance_square_, pdf.getCell(x, y, z).distance_square_);
+          EXPECT_LE(df.getCell(x, y, z).negative_distance_square_, pdf.getCell(x, y, z).negative_distance_square_);
+        }
+
+    df.reset();
+    EXPECT_EQ(df.getDistance(0.5, 0.5, 0.5), df.getUninitializedDistance());
+  }
+}
+
+TEST(TestEuclideanDistanceField, TestParallelTransform)
+{
+  EuclideanDistanceField df(PERF_WIDTH, PERF_HEIGHT, PERF_DEPTH, 0.04, PERF_ORIGIN_X, PERF_ORIGIN_Y, PERF_ORIGIN_Z,
+                            PERF_MAX_DIST, true);
+  EuclideanDistanceField parallel_df(PERF_WIDTH, PERF_HEIGHT, PERF_DEPTH, 0.04, PERF_ORIGIN_X, PERF_ORIGIN_Y,
+                                     PERF_ORIGIN_Z, PERF_MAX_DIST, true);
+  parallel_df.setNumThreads(0);
+
+  shapes::Box table(2.0, 2.0, .5);
+  Eigen::Isometry3d p = Eigen::Translation3d(PERF_WIDTH / 2.0, PERF_DEPTH / 2.0, PERF_HEIGHT / 2.0) *
+                        Eigen::Quaterniond(0.0, 0.0, 0.0, 1.0);
+  Eigen::Isometry3d np = Eigen::Translation3d(PERF_WIDTH / 2.0 + .1, PERF_DEPTH / 2.0, PERF_HEIGHT / 2.0) *
+                         Eigen::Quaterniond(0.0, 0.0, 0.0, 1.0);
+
+  ros::WallTime dt = ros::WallTime::now();
+  df.addShapeToField(&table, p);
+  std::cout << "Exact transform on a single thread took " << (ros::WallTime::now() - dt).toSec() << std::endl;
+  dt = ros::WallTime::now();
+  parallel_df.addShapeToField(&table, p);
+  std::cout << "Exact transform on all cores took " << (ros::WallTime::now() - dt).toSec() << std::endl;
+
+  df.moveShapeInField(&table, p, np);
+  parallel_df.moveShapeInField(&table, p, np);
+  for (int x = 0; x < df.getXNumCells(); x++)
+    for (int y = 0; y < df.getYNumCells(); y++)
+      for (int z = 0; z < df.getZNumCells(); z++)
+      {
+        ASSERT_EQ(df.getCell(x, y, z).distance_square_, parallel_df.getCell(x, y, z).distance_square_);
+        ASSERT_EQ(df.getCell(x, y, z).negative_distance_square_,
+                  parallel_df.getCell(x, y, z).negative_distance_square_);
+      }
+}
+
+TEST(TestEuclideanDistanceField, TestStream)
+{
+  PropagationDistanceField pdf(WIDTH, HEIGHT, DEPTH, RESOLUTION, ORIGIN_X, ORIGIN_Y, ORIGIN_Z, MAX_DIST, false);
+  pdf.addPointsToField({ POINT1, POINT2, POINT3 });
+
+  // fields written by the propagation can be read
+  std::stringstream pdf_stream;
+  pdf.writeToStream(pdf_stream);
+  EuclideanDistanceField df(pdf_stream, MAX_DIST, true);
+  EXPECT_EQ(df.getXNumCells(), pdf.getXNumCells());
+  EXPECT_EQ(df.getYNumCells(), pdf.getYNumCells());
+  EXPECT_EQ(df.getZNumCells(), pdf.getZNumCells());
+
+  std::stringstream df_stream;
+  df.writeToStream(df_stream);
+  EuclideanDistanceField df2(df_stream, MAX_DIST, true);
+  for (int x = 0; x < df.getXNumCells(); x++)
+    for (int y = 0; y < df.getYNumCells(); y++)
+      for (int z = 0; z < df.getZNumCells(); z++)
+      {
+        EXPECT_EQ(df.getCell(x, y, z).occupied_, pdf.getCell(x, y, z).distance_square_ == 0);
+        EXPECT_EQ(df2.getCell(x, y, z).distance_square_, df.getCell(x, y, z).distance_square_);
+        EXPECT_EQ(df2.getCell(x, y, z).negative_distance_square_, df.getCell(x, y, z).negative_distance_square_);
+      }
+}
+
+TEST(TestDistanceField, TestInterpolatedGradients)
+{
+  std::vector<std::shared_ptr<DistanceField>> fields = {
+    std::make_shared<PropagationDistanceField>(WIDTH, HEIGHT, DEPTH, RESOLUTION, ORIGIN_X, ORIGIN_Y, ORIGIN_Z,
+                                               MAX_DIST),
+    std::make_shared<EuclideanDistanceField>(WIDTH, HEIGHT, DEPTH, RESOLUTION, ORIGIN_X, ORIGIN_Y, ORIGIN_Z, MAX_DIST),
+    std::make_shared<PropagationDistanceField>(WIDTH, HEIGHT, DEPTH, RESOLUTION, ORIGIN_X, ORIGIN_Y, ORIGIN_Z,
+                                               MAX_DIST, false, true)
+  };
+  for (const std::shared_ptr<DistanceField>& df : fields)
+  {
+    // sparse fields do not store dense gradients, their lookups differentiate the interpolated distance
+    const PropagationDistanceField* pdf = dynamic_cast<const PropagationDistanceField*>(df.get());
+    const bool sparse = pdf && pdf->hasSparseStorage();
+
+    // a plane of obstacle cells at x = 0.5
+    EigenSTL::vector_Vector3d points;
+    for (int y = 0; y < df->getYNumCells(); ++y)
+      for (int z = 0; z < df->getZNumCells(); ++z)
+        points.push_back(Eigen::Vector3d(0.5, y * RESOLUTION, z * RESOLUTION));
+    df->addPointsToField(points);
+
+    for (bool channels : { false, true })
+    {
+      if (channels)
+        EXPECT_EQ(df->computeGradientChannels(), !sparse);
+      EXPECT_EQ(df->hasGradientChannels(), channels && !sparse);
+
+      // distances are interpolated between cell centers
+      double gx, gy, gz;
+      bool in_bounds;
+      double dist = df->getInterpolatedDistanceGradient(0.65, 0.5, 0.5, gx, gy, gz, in_bounds);
+      EXPECT_TRUE(in_bounds);
+      EXPECT_NEAR(dist, 0.15, 1e-9);
+      EXPECT_NEAR(gx, 1.0, 1e-6);
+      EXPECT_NEAR(gy, 0.0, 1e-6);
+      EXPECT_NEAR(gz, 0.0, 1e-6);
+
+      dist = df->getInterpolatedDistanceGradient(0.35, 0.44, 0.51, gx, gy, gz, in_bounds);
+      EXPECT_TRUE(in_bounds);
+      EXPECT_NEAR(dist, 0.15, 1e-9);
+      EXPECT_NEAR(gx, -1.0, 1e-6);
+
+      // and equal to the cell distances at cell centers
+      for (int x = 0; x < df->getXNumCells(); ++x)
+      {
+        dist = df->getInterpolatedDistanceGradient(x * RESOLUTION, 0.3, 0.9, gx, gy, gz, in_bounds);
+        EXPECT_TRUE(in_bounds);
+        EXPECT_NEAR(dist, df->getDistance(x, 3, 9), 1e-9);
+      }
+
+      // beyond the outermost cell centers
+      dist = df->getInterpolatedDistanceGradient(-0.01, 0.5, 0.5, gx, gy, gz, in_bounds);
+      EXPECT_FALSE(in_bounds);
+      EXPECT_EQ(dist, df->getUninitializedDistance());
+      EXPECT_EQ(gx, 0.0);
+      df->getInterpolatedDistanceGradient(0.5, 0.5, 0.95, gx, gy, gz, in_bounds);
+      EXPECT_FALSE(in_bounds);
+
+      EigenSTL::vector_Vector3d queries = { Eigen::Vector3d(0.65, 0.5, 0.5), Eigen::Vector3d(2.0, 2.0, 2.0) };
+      std::vector<double> distances;
+      EigenSTL::vector_Vector3d gradients;
+      std::vector<bool> queries_in_bounds;
+      df->getInterpolatedDistanceGradients(queries, distances, gradients, queries_in_bounds);
+      ASSERT_EQ(distances.size(), 2u);
+      ASSERT_EQ(gradients.size(), 2u);
+      ASSERT_EQ(queries_in_bounds.size(), 2u);
+      EXPECT_TRUE(queries_in_bounds[0]);
+      EXPECT_FALSE(queries_in_bounds[1]);
+      EXPECT_NEAR(distances[0], 0.15, 1e-9);
+      EXPECT_NEAR(gradients[0].x(), 1.0, 1e-6);
+    }
+
+    // changing the field discards the precomputed gradients
+    df->removePointsFromField(EigenSTL::vector_Vector3d(points.begin(), points.begin() + 1));
+    EXPECT_FALSE(df->hasGradientChannels());
+  }
+}
+
 int main(int argc, char** argv)
 {
   testing::InitGoogleTest(&argc, argv);
@@ -95,6 +95,37 @@ TEST(TestVoxelGrid, TestReadWrite)
       }
 }
 
+TEST(TestVoxelGrid, TestSparseReadWrite)
+{
+  int def = -100;
+  VoxelGrid<int> vg(0.5, 0.5, 0.5, 0.01, 0, 0, 0, def, true);
+  EXPECT_TRUE(vg.isSparse());
+  EXPECT_EQ(vg.getNumAllocatedCells(), 0u);
+
+  // unallocated cells hold the reset value and reading them does not allocate
+  vg.reset(0);
+  const VoxelGrid<int>& const_vg = vg;
+  EXPECT_EQ(const_vg.getCell(0, 0, 0), 0);
+  EXPECT_EQ(const_vg.getCell(49, 49, 49), 0);
+  EXPECT_EQ(vg.getNumAllocatedCells(), 0u);
+  EXPECT_EQ(vg(10.0, 0.0, 0.0), def);
+
+  // writing a cell allocates its block only
+  vg.setCell(3, 4, 5, 7);
+  vg.getCell(49, 0, 49) = 8;
+  EXPECT_EQ(vg.getNumAllocatedCells(), 2u * VoxelGrid<int>::BLOCK_SIZE * VoxelGrid<int>::BLOCK_SIZE *
+                                           VoxelGrid<int>::BLOCK_SIZE);
+  EXPECT_EQ(const_vg.getCell(3, 4, 5), 7);
+  EXPECT_EQ(const_vg.getCell(49, 0, 49), 8);
+  EXPECT_EQ(const_vg.getCell(3, 4, 6), 0);
+  EXPECT_EQ(const_vg.getCell(48, 48, 48), 0);
+  EXPECT_EQ(vg(0.03, 0.04, 0.05), 7);
+
+  vg.reset(1);
+  EXPECT_EQ(vg.getNumAllocatedCells(), 0u);
+  EXPECT_EQ(const_vg.getCell(3, 4, 5), 1);
+}
+
 int main(int argc, char** argv)
 {
   testing::InitGoogleTest(&argc, argv);
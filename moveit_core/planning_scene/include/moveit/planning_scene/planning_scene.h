@@ -864,6 +864,28 @@ public:
   bool isStateValid(const moveit::core::RobotState& state, const kinematic_constraints::KinematicConstraintSet& constr,
                     const std::string& group = "", bool verbose = false) const;
 
+  /** \brief Check a batch of states for validity (collision avoidance, feasibility and constraint satisfaction), as
+   * isStateValid() does for a single state. The collision environments and the allowed collision matrix are resolved
+   * once for the whole batch. Returns true if all states are valid.
+   *
+   * If \e valid is not null, it receives the validity of each state. If \e stop_at_first_invalid is true, states
+   * after the first invalid one are not necessarily checked and \e valid is resized to end at the first invalid state.
+   *
+   * The states are checked by up to \e num_threads threads (0 for all cores). When more than one thread is used, the
+   * state feasibility predicate must be safe to call concurrently. The states need to have up-to-date collision body
+   * transforms. */
+  bool areStatesValid(const std::vector<const moveit::core::RobotState*>& states,
+                      const kinematic_constraints::KinematicConstraintSet& constr, const std::string& group = "",
+                      std::vector<bool>* valid = nullptr, bool stop_at_first_invalid = false,
+                      std::size_t num_threads = 1, bool verbose = false) const;
+
+  /** \brief Check a batch of states for validity, as described above. The constraints are constructed once for the
+   * whole batch. */
+  bool areStatesValid(const std::vector<const moveit::core::RobotState*>& states,
+                      const moveit_msgs::Constraints& constr, const std::string& group = "",
+                      std::vector<bool>* valid = nullptr, bool stop_at_first_invalid = false,
+                      std::size_t num_threads = 1, bool verbose = false) const;
+
   /** \brief Check if a given path is valid. Each state is checked for validity (collision avoidance and feasibility) */
   bool isPathValid(const moveit_msgs::RobotState& start_state, const moveit_msgs::RobotTrajectory& trajectory,
                    const std::string& group = "", bool verbose = false,
@@ -44,8 +44,10 @@
 #include <moveit/exceptions/exceptions.h>
 #include <moveit/robot_state/attached_body.h>
 #include <moveit/utils/message_checks.h>
+#include <moveit/utils/thread_pool.h>
 #include <octomap_msgs/conversions.h>
 #include <tf2_eigen/tf2_eigen.h>
+#include <atomic>
 #include <memory>
 #include <set>
 
@@ -1344,6 +1346,15 @@ void PlanningScene::processOctomapPtr(const std::shared_ptr<const octomap::OcTre
           if (world_diff_)
             world_diff_->set(OCTOMAP_NS, collision_detection::World::DESTROY | collision_detection::World::CREATE |
                                              collision_detection::World::ADD_SHAPE);
+
+          // the octree was modified in place, which the world does not report to the collision environments
+          for (std::pair<const std::string, CollisionDetectorPtr>& it : collision_)
+          {
+            if (it.second->cenv_)
+              it.second->cenv_->updateOctreeObject(OCTOMAP_NS);
+            if (it.second->cenv_unpadded_)
+              it.second->cenv_unpadded_->updateOctreeObject(OCTOMAP_NS);
+          }
         }
         else
         {
@@ -2116,6 +2127,82 @@ bool PlanningScene::isStateValid(const moveit::core::RobotState& state,
   return isStateConstrained(state, constr, verbose);
 }
 
+bool PlanningScene::areStatesValid(const std::vector<const moveit::core::RobotState*>& states,
+                                   const moveit_msgs::Constraints& constr, const std::string& group,
+                                   std::vector<bool>* valid, bool stop_at_first_invalid, std::size_t num_threads,
+                                   bool verbose) const
+{
+  kinematic_constraints::KinematicConstraintSet ks(getRobotModel());
+  ks.add(constr, getTransforms());
+  return areStatesValid(states, ks, group, valid, stop_at_first_invalid, num_threads, verbose);
+}
+
+bool PlanningScene::areStatesValid(const std::vector<const moveit::core::RobotState*>& states,
+                                   const kinematic_constraints::KinematicConstraintSet& constr,
+                                   const std::string& group, std::vector<bool>* valid, bool stop_at_first_invalid,
+                                   std::size_t num_threads, bool verbose) const
+{
+  // resolve everything that does not depend on the state once for the whole batch
+  const collision_detection::CollisionEnvConstPtr& env = getCollisionEnv();
+  const collision_detection::CollisionEnvConstPtr& env_unpadded = getCollisionEnvUnpadded();
+  const collision_detection::AllowedCollisionMatrix& acm = getAllowedCollisionMatrix();
+  const bool check_constraints = !constr.empty();
+  collision_detection::CollisionRequest req;
+  req.verbose = verbose;
+  req.group_name = group;
+
+  const std::size_t count = states.size();
+  // std::vector<bool> does not support concurrent writes to distinct elements
+  std::vector<unsigned char> state_valid(count, 0);
+  // the lowest index of an invalid state found so far; only ever decreases
+  std::atomic<std::size_t> first_invalid(count);
+
+  auto check_state = [&](std::size_t /*thread*/, std::size_t index) {
+    // states after a known invalid one are irrelevant if we stop there; lower indices are always checked, so the
+    // result does not depend on scheduling
+    if (stop_at_first_invalid && index > first_invalid.load(std::memory_order_relaxed))
+      return;
+
+    const moveit::core::RobotState& state = *states[index];
+    collision_detection::CollisionResult res;
+    env->checkRobotCollision(req, res, state, acm);
+    if (!res.collision)
+      env_unpadded->checkSelfCollision(req, res, state, acm);
+
+    if (!res.collision && isStateFeasible(state, verbose) &&
+        (!check_constraints || constr.decide(state, verbose).satisfied))
+    {
+      state_valid[index] = 1;
+      return;
+    }
+
+    std::size_t current = first_invalid.load(std::memory_order_relaxed);
+    while (index < current && !first_invalid.compare_exchange_weak(current, index, std::memory_order_relaxed))
+      ;
+  };
+
+  moveit::core::ThreadPool& pool = moveit::core::ThreadPool::getShared();
+  if (num_threads == 1 || count < 2 || pool.getConcurrency() < 2)
+  {
+    for (std::size_t i = 0; i < count; ++i)
+    {
+      check_state(0, i);
+      if (stop_at_first_invalid && first_invalid < count)
+        break;
+    }
+  }
+  else
+    pool.parallelFor(count, check_state, num_threads);
+
+  const std::size_t invalid_index = first_invalid;
+  if (valid)
+  {
+    const std::size_t checked = stop_at_first_invalid && invalid_index < count ? invalid_index + 1 : count;
+    valid->assign(state_valid.begin(), state_valid.begin() + checked);
+  }
+  return invalid_index == count;
+}
+
 bool PlanningScene::isPathValid(const moveit_msgs::RobotState& start_state,
                                 const moveit_msgs::RobotTrajectory& trajectory, const std::string& group, bool verbose,
                                 std::vector<std::size_t>* invalid_index) const
@@ -2162,54 +2249,42 @@ bool PlanningScene::isPathValid(const robot_trajectory::RobotTrajectory& traject
                                 const std::vector<moveit_msgs::Constraints>& goal_constraints, const std::string& group,
                                 bool verbose, std::vector<std::size_t>* invalid_index) const
 {
-  bool result = true;
   if (invalid_index)
     invalid_index->clear();
-  kinematic_constraints::KinematicConstraintSet ks_p(getRobotModel());
-  ks_p.add(path_constraints, getTransforms());
   std::size_t n_wp = trajectory.getWayPointCount();
+  std::vector<const moveit::core::RobotState*> waypoints(n_wp);
   for (std::size_t i = 0; i < n_wp; ++i)
-  {
-    const moveit::core::RobotState& st = trajectory.getWayPoint(i);
-
-    bool this_state_valid = true;
-    if (isStateColliding(st, group, verbose))
-      this_state_valid = false;
-    if (!isStateFeasible(st, verbose))
-      this_state_valid = false;
-    if (!ks_p.empty() && !ks_p.decide(st, verbose).satisfied)
-      this_state_valid = false;
+    waypoints[i] = &trajectory.getWayPoint(i);
 
-    if (!this_state_valid)
-    {
-      if (invalid_index)
-        invalid_index->push_back(i);
-      else
-        return false;
-      result = false;
-    }
+  // without invalid_index, only whether the path is valid matters: stop at the first invalid state
+  std::vector<bool> valid;
+  bool result = areStatesValid(waypoints, path_constraints, group, &valid, invalid_index == nullptr, 1, verbose);
+  if (!result && !invalid_index)
+    return false;
+  for (std::size_t i = 0; i < valid.size(); ++i)
+    if (!valid[i])
+      invalid_index->push_back(i);
 
-    // check goal for last state
-    if (i + 1 == n_wp && !goal_constraints.empty())
+  // check goal for last state
+  if (n_wp > 0 && !goal_constraints.empty())
+  {
+    bool found = false;
+    for (const moveit_msgs::Constraints& goal_constraint : goal_constraints)
     {
-      bool found = false;
-      for (const moveit_msgs::Constraints& goal_constraint : goal_constraints)
-      {
-        if (isStateConstrained(st, goal_constraint))
-        {
-          found = true;
-          break;
-        }
-      }
-      if (!found)
+      if (isStateConstrained(*waypoints.back(), goal_constraint))
       {
-        if (verbose)
-          ROS_INFO_NAMED(LOGNAME, "Goal not satisfied");
-        if (invalid_index)
-          invalid_index->push_back(i);
-        result = false;
+        found = true;
+        break;
       }
     }
+    if (!found)
+    {
+      if (verbose)
+        ROS_INFO_NAMED(LOGNAME, "Goal not satisfied");
+      if (invalid_index)
+        invalid_index->push_back(n_wp - 1);
+      result = false;
+    }
   }
   return result;
 }
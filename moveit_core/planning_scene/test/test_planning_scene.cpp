@@ -38,6 +38,7 @@
 #include <moveit/planning_scene/planning_scene.h>
 #include <moveit/utils/message_checks.h>
 #include <urdf_parser/urdf_parser.h>
+#include <algorithm>
 #include <fstream>
 #include <sstream>
 #include <string>
@@ -200,6 +201,53 @@ TEST(PlanningScene, isStateValid)
   }
 }
 
+TEST(PlanningScene, areStatesValid)
+{
+  srdf::ModelSharedPtr srdf_model(new srdf::Model());
+  urdf::ModelInterfaceSharedPtr urdf_model;
+  loadRobotModels(urdf_model, srdf_model);
+
+  planning_scene::PlanningScenePtr ps(new planning_scene::PlanningScene(urdf_model, srdf_model));
+  Eigen::Isometry3d pose = Eigen::Isometry3d::Identity();
+  pose.translation() = Eigen::Vector3d(0.6, 0.0, 0.8);
+  ps->getWorldNonConst()->addToObject("box", shapes::ShapeConstPtr(new shapes::Box(0.4, 0.4, 0.4)), pose);
+
+  random_numbers::RandomNumberGenerator rng(42);
+  std::vector<moveit::core::RobotState> states(200, ps->getCurrentState());
+  std::vector<const moveit::core::RobotState*> state_ptrs;
+  for (moveit::core::RobotState& state : states)
+  {
+    state.setToRandomPositions(state.getJointModelGroup("left_arm"), rng);
+    state.update();
+    state_ptrs.push_back(&state);
+  }
+
+  std::vector<bool> expected;
+  for (const moveit::core::RobotState& state : states)
+    expected.push_back(ps->isStateValid(state, "left_arm"));
+  const std::size_t first_invalid = std::find(expected.begin(), expected.end(), false) - expected.begin();
+  ASSERT_LT(first_invalid, states.size()) << "Expected some random states to be invalid";
+
+  const kinematic_constraints::KinematicConstraintSet no_constraints(ps->getRobotModel());
+  for (std::size_t num_threads : { 1, 4 })
+  {
+    std::vector<bool> valid;
+    EXPECT_FALSE(ps->areStatesValid(state_ptrs, no_constraints, "left_arm", &valid, false, num_threads));
+    EXPECT_EQ(valid, expected);
+
+    // with early termination, the result ends at the first invalid state
+    EXPECT_FALSE(ps->areStatesValid(state_ptrs, no_constraints, "left_arm", &valid, true, num_threads));
+    ASSERT_EQ(valid.size(), first_invalid + 1);
+    EXPECT_TRUE(std::equal(valid.begin(), valid.end(), expected.begin()));
+  }
+
+  std::vector<const moveit::core::RobotState*> valid_states;
+  for (std::size_t i = 0; i < states.size(); ++i)
+    if (expected[i])
+      valid_states.push_back(state_ptrs[i]);
+  EXPECT_TRUE(ps->areStatesValid(valid_states, moveit_msgs::Constraints(), "left_arm", nullptr, true, 0));
+}
+
 TEST(PlanningScene, loadGoodSceneGeometry)
 {
   srdf::ModelSharedPtr srdf_model(new srdf::Model());
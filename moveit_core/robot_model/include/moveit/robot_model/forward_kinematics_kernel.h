@@ -0,0 +1,118 @@
+/*********************************************************************
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2020, PickNik LLC.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the copyright holder nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************/
+
+#pragma once
+
+#include <moveit/macros/class_forward.h>
+#include <Eigen/Geometry>
+#include <vector>
+
+namespace moveit
+{
+namespace core
+{
+class JointModel;
+class LinkModel;
+class RobotModel;
+
+MOVEIT_CLASS_FORWARD(ForwardKinematicsKernel);
+
+/** \brief Forward kinematics program, compiled from a RobotModel, that evaluates many configurations at once.
+
+    The kinematic tree is flattened into a sequence of per-link operations with all constant data (joint origins,
+    joint axes, rotation coefficients) precomputed. Configurations are processed in blocks of getLaneCount() lanes
+    using a structure-of-arrays layout, such that the arithmetic for revolute, prismatic and fixed joints maps onto
+    the SIMD instructions enabled at compile time (SSE2, AVX2 or AVX-512, via Eigen's packet math). If no
+    vectorization is available, the same code runs as plain scalar loops.
+
+    Joints of other types (planar, floating) are evaluated lane by lane through JointModel::computeTransform(). */
+class ForwardKinematicsKernel
+{
+public:
+  /** \brief Compile the kernel for \e model. The kernel keeps pointers into \e model, which must outlive it. */
+  ForwardKinematicsKernel(const RobotModel& model);
+
+  /** \brief The number of configurations evaluated together in one block */
+  static std::size_t getLaneCount();
+
+  /** \brief The number of links whose transform is computed lane by lane instead of vectorized */
+  std::size_t getScalarJointCount() const
+  {
+    return scalar_joint_count_;
+  }
+
+  /** \brief Compute the global link transforms for \e size configurations.
+
+      \e positions holds the variable positions in variable-major layout: positions[variable_index * size + state].
+      \e link_transforms receives the transform of every link w.r.t. the model frame in link-major layout:
+      link_transforms[link_index * size + state]. Mimic joint values are expected to be up to date. */
+  void computeLinkTransforms(const double* positions, std::size_t size, Eigen::Isometry3d* link_transforms) const;
+
+private:
+  enum OperationType
+  {
+    FIXED,
+    REVOLUTE,
+    PRISMATIC,
+    SCALAR
+  };
+
+  /** \brief A single step of the flattened kinematic tree, computing the transform of one link */
+  struct Operation
+  {
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+    OperationType type;
+    int link_index;
+    int parent_link_index;  ///< -1 for the root link
+    int variable_index;
+    bool origin_is_identity;
+    const JointModel* joint;
+    Eigen::Isometry3d origin;
+
+    /** \brief Joint axis (revolute, prismatic) */
+    Eigen::Vector3d axis;
+
+    /** \brief Coefficients of the revolute joint rotation R(q) = rot_const + cos(q) * rot_cos + sin(q) * rot_sin */
+    Eigen::Matrix3d rot_const;
+    Eigen::Matrix3d rot_cos;
+    Eigen::Matrix3d rot_sin;
+  };
+
+  std::vector<Operation, Eigen::aligned_allocator<Operation>> operations_;
+  std::size_t link_count_;
+  std::size_t scalar_joint_count_;
+};
+}  // namespace core
+}  // namespace moveit
@@ -290,6 +290,13 @@ public:
   /** \brief Get the index of a variable within the group. Return -1 on error. */
   int getVariableGroupIndex(const std::string& variable) const;
 
+  /** \brief Get the index of the first variable of \e joint within the group, or -1 if the joint is not part of the
+      group or has no variables. Unlike the lookup by name, this does not involve any string comparisons. */
+  int getVariableGroupIndex(const JointModel* joint) const
+  {
+    return joint_variable_group_index_[joint->getJointIndex()];
+  }
+
   /** \brief Get the names of the known default states (as specified in the SRDF) */
   const std::vector<std::string>& getDefaultStateNames() const
   {
@@ -632,6 +639,10 @@ protected:
       Additionaly, it includes the names of the joints and the index for the first variable of that joint. */
   VariableIndexMap joint_variables_index_map_;
 
+  /** \brief For every joint of the robot model (by joint index), the index of its first variable within the group,
+      or -1 if the joint is not part of the group */
+  std::vector<int> joint_variable_group_index_;
+
   /** \brief The bounds for all the active joint models */
   JointBoundsVector active_joint_models_bounds_;
 
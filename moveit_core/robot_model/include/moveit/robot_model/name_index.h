@@ -0,0 +1,91 @@
+/*********************************************************************
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2020, PickNik LLC.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the copyright holder nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace moveit
+{
+namespace core
+{
+/** \brief Immutable name-to-index lookup table, built once and queried many times.
+
+    Names are stored in a flat open-addressing hash table with a load factor of at most 1/2, so a lookup computes
+    one hash and usually compares a single string. Unlike std::map, no tree traversal with repeated string
+    comparisons is needed, and all data is contiguous in memory. */
+class NameIndex
+{
+public:
+  NameIndex();
+
+  /** \brief Build the table from (name, index) pairs, replacing any previous content. Names must be unique. */
+  void build(const std::vector<std::pair<std::string, int>>& entries);
+
+  /** \brief Build the table such that \e names[i] maps to i */
+  void build(const std::vector<std::string>& names);
+
+  /** \brief Get the index stored for \e name, or -1 if the name is not known */
+  int find(const std::string& name) const;
+
+  /** \brief Get the number of names in the table */
+  std::size_t size() const
+  {
+    return names_.size();
+  }
+
+  bool empty() const
+  {
+    return names_.empty();
+  }
+
+private:
+  static std::uint64_t hash(const std::string& name);
+
+  struct Slot
+  {
+    std::uint64_t hash;
+    int entry;  // position in names_ and values_, -1 for empty slots
+  };
+
+  std::vector<Slot> slots_;
+  std::size_t mask_;
+  std::vector<std::string> names_;
+  std::vector<int> values_;
+};
+}  // namespace core
+}  // namespace moveit
@@ -49,8 +49,11 @@
 #include <moveit/robot_model/planar_joint_model.h>
 #include <moveit/robot_model/revolute_joint_model.h>
 #include <moveit/robot_model/prismatic_joint_model.h>
+#include <moveit/robot_model/forward_kinematics_kernel.h>
+#include <moveit/robot_model/name_index.h>
 
 #include <Eigen/Geometry>
+#include <cstdint>
 #include <iostream>
 
 /** \brief Main namespace for MoveIt */
@@ -72,6 +75,10 @@ public:
   /** \brief Destructor. Clear all memory. */
   ~RobotModel();
 
+  /** \brief Meshes of link geometry are loaded once per process and shared between all models.
+      Clear this cache, e.g. to pick up modified mesh files when reconstructing a model. */
+  static void clearMeshCache();
+
   /** \brief Get the model name. */
   const std::string& getName() const
   {
@@ -404,6 +411,13 @@ public:
     return variable_names_;
   }
 
+  /** \brief Get a hash of the variable names and joint types, in the order variables are stored in a state.
+      Models with equal hashes can exchange raw variable arrays, e.g. as binary state snapshots. */
+  std::uint64_t getVariableLayoutHash() const
+  {
+    return variable_layout_hash_;
+  }
+
   /** \brief Get the bounds for a specific variable. Throw an exception of variable is not found. */
   const VariableBounds& getVariableBounds(const std::string& variable) const
   {
@@ -422,6 +436,13 @@ public:
   /** \brief Get the index of a variable in the robot state */
   int getVariableIndex(const std::string& variable) const;
 
+  /** \brief Get the index in the robot state for each of the variables in \e variables, or -1 for unknown names.
+
+      This is meant to be computed once for a fixed ordering of names, e.g. the layout of a JointState message,
+      such that subsequent messages with the same layout can be applied without any string lookups.
+      Returns true if all names are known. */
+  bool getVariableIndices(const std::vector<std::string>& variables, std::vector<int>& indices) const;
+
   /** \brief Get the deepest joint in the kinematic tree that is a common parent of both joints passed as argument */
   const JointModel* getCommonRoot(const JointModel* a, const JointModel* b) const
   {
@@ -433,6 +454,12 @@ public:
                                                    b->getJointIndex()]];
   }
 
+  /** \brief Get the forward kinematics kernel compiled for this model, to evaluate many configurations at once */
+  const ForwardKinematicsKernel& getForwardKinematicsKernel() const
+  {
+    return *fk_kernel_;
+  }
+
   /// A map of known kinematics solvers (associated to their group name)
   void setKinematicsAllocators(const std::map<std::string, SolverAllocatorFn>& allocators);
 
@@ -468,6 +495,9 @@ protected:
   /** \brief A map from link names to their instances */
   LinkModelMap link_model_map_;
 
+  /** \brief Fast lookup of link names, mapping to the index in link_model_vector_ */
+  NameIndex link_name_index_;
+
   /** \brief The vector of links that are updated when computeTransforms() is called, in the order they are updated */
   std::vector<LinkModel*> link_model_vector_;
 
@@ -494,6 +524,9 @@ protected:
   /** \brief A map from joint names to their instances */
   JointModelMap joint_model_map_;
 
+  /** \brief Fast lookup of joint names, mapping to the index in joint_model_vector_ */
+  NameIndex joint_name_index_;
+
   /** \brief The vector of joints in the model, in the order they appear in the state vector */
   std::vector<JointModel*> joint_model_vector_;
 
@@ -537,11 +570,17 @@ protected:
   /** \brief Get the number of variables necessary to describe this model */
   std::size_t variable_count_;
 
+  /** \brief Hash of variable names and joint types, see getVariableLayoutHash() */
+  std::uint64_t variable_layout_hash_;
+
   /** \brief The state includes all the joint variables that make up the joints the state consists of.
       This map gives the position in the state vector of the group for each of these variables.
       Additionaly, it includes the names of the joints and the index for the first variable of that joint. */
   VariableIndexMap joint_variables_index_map_;
 
+  /** \brief Fast lookup with the same content as joint_variables_index_map_ */
+  NameIndex variable_name_index_;
+
   std::vector<int> active_joint_model_start_index_;
 
   /** \brief The bounds for all the active joint models */
@@ -555,6 +594,9 @@ protected:
   /** \brief A map from group names to joint groups */
   JointModelGroupMap joint_model_group_map_;
 
+  /** \brief Fast lookup of group names, mapping to the index in joint_model_groups_ */
+  NameIndex group_name_index_;
+
   /** \brief The known end effectors */
   JointModelGroupMap end_effectors_map_;
 
@@ -570,6 +612,9 @@ protected:
   /** \brief The array of end-effectors, in alphabetical order */
   std::vector<const JointModelGroup*> end_effectors_;
 
+  /** \brief Forward kinematics kernel for batches of configurations, compiled in buildModel() */
+  ForwardKinematicsKernelConstPtr fk_kernel_;
+
   /** \brief Given an URDF model and a SRDF model, build a full kinematic model */
   void buildModel(const urdf::ModelInterface& urdf_model, const srdf::Model& srdf_model);
 
@@ -612,8 +657,12 @@ protected:
   /** \brief Given a urdf link, build the corresponding LinkModel object*/
   LinkModel* constructLinkModel(const urdf::Link* urdf_link);
 
-  /** \brief Given a geometry spec from the URDF and a filename (for a mesh), construct the corresponding shape object*/
-  shapes::ShapePtr constructShape(const urdf::Geometry* geom);
+  /** \brief Load the meshes of all collision geometries in \e urdf_model in parallel, ahead of constructShape() */
+  void preloadMeshes(const urdf::ModelInterface& urdf_model);
+
+  /** \brief Given a geometry spec from the URDF and a filename (for a mesh), construct the corresponding shape object.
+      Meshes are shared with other models through a process-wide cache. */
+  shapes::ShapeConstPtr constructShape(const urdf::Geometry* geom);
 };
 }  // namespace core
 }  // namespace moveit
@@ -0,0 +1,260 @@
+/*********************************************************************
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2020, PickNik LLC.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the copyright holder nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************/
+
+#include <moveit/robot_model/forward_kinematics_kernel.h>
+#include <moveit/robot_model/robot_model.h>
+
+namespace moveit
+{
+namespace core
+{
+namespace
+{
+// a multiple of the widest SIMD register (AVX-512: 8 doubles), such that a block fills whole packets
+constexpr std::size_t LANES = 16;
+typedef Eigen::Array<double, LANES, 1> Lanes;
+
+// transforms of LANES configurations in SoA layout; rotation is column-major: r[col * 3 + row]
+struct Frame
+{
+  Lanes r[9];
+  Lanes t[3];
+};
+typedef std::vector<Frame, Eigen::aligned_allocator<Frame>> Frames;
+
+void setIdentity(Frame& f)
+{
+  for (int c = 0; c < 3; ++c)
+    for (int i = 0; i < 3; ++i)
+      f.r[c * 3 + i].setConstant(c == i ? 1.0 : 0.0);
+  for (int i = 0; i < 3; ++i)
+    f.t[i].setZero();
+}
+
+// out = in * m, where m is the same for all lanes; out must not alias in
+void multiplyConstant(const Frame& in, const Eigen::Isometry3d& m, Frame& out)
+{
+  for (int c = 0; c < 3; ++c)
+    for (int i = 0; i < 3; ++i)
+      out.r[c * 3 + i] = in.r[i] * m(0, c) + in.r[3 + i] * m(1, c) + in.r[6 + i] * m(2, c);
+  for (int i = 0; i < 3; ++i)
+    out.t[i] = in.t[i] + in.r[i] * m(0, 3) + in.r[3 + i] * m(1, 3) + in.r[6 + i] * m(2, 3);
+}
+
+void loadLanes(const double* values, std::size_t count, Lanes& lanes)
+{
+  if (count == LANES)
+    lanes = Eigen::Map<const Lanes>(values);
+  else
+  {
+    lanes.setZero();
+    for (std::size_t l = 0; l < count; ++l)
+      lanes[l] = values[l];
+  }
+}
+
+void getLane(const Frame& f, std::size_t lane, Eigen::Isometry3d& transform)
+{
+  double* d = transform.data();
+  for (int c = 0; c < 3; ++c)
+  {
+    for (int i = 0; i < 3; ++i)
+      d[c * 4 + i] = f.r[c * 3 + i][lane];
+    d[c * 4 + 3] = 0.0;
+  }
+  for (int i = 0; i < 3; ++i)
+    d[12 + i] = f.t[i][lane];
+  d[15] = 1.0;
+}
+
+void setLane(const Eigen::Isometry3d& transform, std::size_t lane, Frame& f)
+{
+  for (int c = 0; c < 3; ++c)
+    for (int i = 0; i < 3; ++i)
+      f.r[c * 3 + i][lane] = transform(i, c);
+  for (int i = 0; i < 3; ++i)
+    f.t[i][lane] = transform(i, 3);
+}
+}  // namespace
+
+ForwardKinematicsKernel::ForwardKinematicsKernel(const RobotModel& model)
+  : link_count_(model.getLinkModelCount()), scalar_joint_count_(0)
+{
+  const JointModel* root = model.getRootJoint();
+  if (!root)
+    return;
+
+  for (const LinkModel* link : root->getDescendantLinkModels())
+  {
+    const JointModel* joint = link->getParentJointModel();
+    Operation op;
+    op.link_index = link->getLinkIndex();
+    op.parent_link_index = link->getParentLinkModel() ? link->getParentLinkModel()->getLinkIndex() : -1;
+    op.variable_index = joint->getVariableCount() > 0 ? joint->getFirstVariableIndex() : -1;
+    op.origin_is_identity = link->jointOriginTransformIsIdentity();
+    op.joint = joint;
+    op.origin = link->getJointOriginTransform();
+    op.axis.setZero();
+
+    switch (joint->getType())
+    {
+      case JointModel::FIXED:
+        op.type = FIXED;
+        break;
+      case JointModel::REVOLUTE:
+      {
+        op.type = REVOLUTE;
+        // R(q) = (1 - cos q) * a * a^T + cos q * I + sin q * [a]_x, cf. RevoluteJointModel::computeTransform()
+        const Eigen::Vector3d& a = static_cast<const RevoluteJointModel*>(joint)->getAxis();
+        op.axis = a;
+        op.rot_const = a * a.transpose();
+        op.rot_cos = Eigen::Matrix3d::Identity() - op.rot_const;
+        op.rot_sin << 0.0, -a.z(), a.y(), a.z(), 0.0, -a.x(), -a.y(), a.x(), 0.0;
+        break;
+      }
+      case JointModel::PRISMATIC:
+        op.type = PRISMATIC;
+        op.axis = static_cast<const PrismaticJointModel*>(joint)->getAxis();
+        break;
+      default:
+        op.type = SCALAR;
+        ++scalar_joint_count_;
+        break;
+    }
+    operations_.push_back(op);
+  }
+}
+
+std::size_t ForwardKinematicsKernel::getLaneCount()
+{
+  return LANES;
+}
+
+void ForwardKinematicsKernel::computeLinkTransforms(const double* positions, std::size_t size,
+                                                    Eigen::Isometry3d* link_transforms) const
+{
+  // one frame per link, plus the identity as parent of the root link
+  Frames frames(link_count_ + 1);
+  Frame& identity = frames[link_count_];
+  setIdentity(identity);
+  Frame tmp;
+  Lanes q, c, s, rot[9];
+  std::vector<double> joint_values;
+  Eigen::Isometry3d parent_transform, joint_transform, result;
+
+  for (std::size_t base = 0; base < size; base += LANES)
+  {
+    const std::size_t count = std::min(LANES, size - base);
+    for (const Operation& op : operations_)
+    {
+      const Frame& parent = op.parent_link_index < 0 ? identity : frames[op.parent_link_index];
+      Frame& out = frames[op.link_index];
+
+      if (op.type == FIXED)
+      {
+        if (op.origin_is_identity)
+          out = parent;
+        else
+          multiplyConstant(parent, op.origin, out);
+        continue;
+      }
+
+      // the frame of the joint: parent * origin
+      const Frame* joint_frame = &parent;
+      if (!op.origin_is_identity)
+      {
+        multiplyConstant(parent, op.origin, tmp);
+        joint_frame = &tmp;
+      }
+
+      switch (op.type)
+      {
+        case REVOLUTE:
+        {
+          loadLanes(positions + op.variable_index * size + base, count, q);
+          c = q.cos();
+          s = q.sin();
+          for (int k = 0; k < 9; ++k)
+            rot[k] = op.rot_const(k % 3, k / 3) + c * op.rot_cos(k % 3, k / 3) + s * op.rot_sin(k % 3, k / 3);
+          const Frame& m = *joint_frame;
+          for (int col = 0; col < 3; ++col)
+            for (int i = 0; i < 3; ++i)
+              out.r[col * 3 + i] =
+                  m.r[i] * rot[col * 3] + m.r[3 + i] * rot[col * 3 + 1] + m.r[6 + i] * rot[col * 3 + 2];
+          for (int i = 0; i < 3; ++i)
+            out.t[i] = m.t[i];
+          break;
+        }
+        case PRISMATIC:
+        {
+          loadLanes(positions + op.variable_index * size + base, count, q);
+          const Frame& m = *joint_frame;
+          for (int i = 0; i < 3; ++i)
+            out.t[i] = m.t[i] + q * (m.r[i] * op.axis.x() + m.r[3 + i] * op.axis.y() + m.r[6 + i] * op.axis.z());
+          for (int k = 0; k < 9; ++k)
+            out.r[k] = m.r[k];
+          break;
+        }
+        case SCALAR:
+        {
+          const std::size_t nvars = op.joint->getVariableCount();
+          joint_values.resize(nvars);
+          for (std::size_t l = 0; l < count; ++l)
+          {
+            for (std::size_t v = 0; v < nvars; ++v)
+              joint_values[v] = positions[(op.variable_index + v) * size + base + l];
+            op.joint->computeTransform(joint_values.data(), joint_transform);
+            getLane(*joint_frame, l, parent_transform);
+            result.affine().noalias() = parent_transform.affine() * joint_transform.matrix();
+            setLane(result, l, out);
+          }
+          break;
+        }
+        case FIXED:
+          break;
+      }
+    }
+
+    // scatter the computed block into the link-major output
+    for (const Operation& op : operations_)
+    {
+      const Frame& f = frames[op.link_index];
+      Eigen::Isometry3d* out = link_transforms + op.link_index * size + base;
+      for (std::size_t l = 0; l < count; ++l)
+        getLane(f, l, out[l]);
+    }
+  }
+}
+}  // namespace core
+}  // namespace moveit
@@ -114,6 +114,7 @@ JointModelGroup::JointModelGroup(const std::string& group_name, const srdf::Mode
   joint_model_vector_ = unsorted_group_joints;
   std::sort(joint_model_vector_.begin(), joint_model_vector_.end(), OrderJointsByIndex());
   joint_model_name_vector_.reserve(joint_model_vector_.size());
+  joint_variable_group_index_.assign(parent_model_->getJointModelCount(), -1);
 
   // figure out active joints, mimic joints, fixed joints
   // construct index maps, list of variables
@@ -149,6 +150,7 @@ JointModelGroup::JointModelGroup(const std::string& group_name, const srdf::Mode
         joint_variables_index_map_[name_order[j]] = variable_count_ + j;
       }
       joint_variables_index_map_[joint_model->getName()] = variable_count_;
+      joint_variable_group_index_[joint_model->getJointIndex()] = variable_count_;
 
       if (joint_model->getType() == JointModel::REVOLUTE &&
           static_cast<const RevoluteJointModel*>(joint_model)->isContinuous())
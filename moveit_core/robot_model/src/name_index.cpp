@@ -0,0 +1,98 @@
+/*********************************************************************
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2020, PickNik LLC.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the copyright holder nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************/
+
+#include <moveit/robot_model/name_index.h>
+
+namespace moveit
+{
+namespace core
+{
+NameIndex::NameIndex() : slots_(1, Slot{ 0, -1 }), mask_(0)
+{
+}
+
+std::uint64_t NameIndex::hash(const std::string& name)
+{
+  // FNV-1a
+  std::uint64_t h = 14695981039346656037ULL;
+  for (char c : name)
+    h = (h ^ static_cast<unsigned char>(c)) * 1099511628211ULL;
+  return h;
+}
+
+void NameIndex::build(const std::vector<std::pair<std::string, int>>& entries)
+{
+  names_.clear();
+  values_.clear();
+  names_.reserve(entries.size());
+  values_.reserve(entries.size());
+
+  std::size_t capacity = 1;
+  while (capacity < 2 * entries.size())
+    capacity *= 2;
+  slots_.assign(capacity, Slot{ 0, -1 });
+  mask_ = capacity - 1;
+
+  for (const std::pair<std::string, int>& entry : entries)
+  {
+    const std::uint64_t h = hash(entry.first);
+    std::size_t i = h & mask_;
+    while (slots_[i].entry >= 0)
+      i = (i + 1) & mask_;
+    slots_[i].hash = h;
+    slots_[i].entry = names_.size();
+    names_.push_back(entry.first);
+    values_.push_back(entry.second);
+  }
+}
+
+void NameIndex::build(const std::vector<std::string>& names)
+{
+  std::vector<std::pair<std::string, int>> entries;
+  entries.reserve(names.size());
+  for (std::size_t i = 0; i < names.size(); ++i)
+    entries.emplace_back(names[i], i);
+  build(entries);
+}
+
+int NameIndex::find(const std::string& name) const
+{
+  const std::uint64_t h = hash(name);
+  for (std::size_t i = h & mask_; slots_[i].entry >= 0; i = (i + 1) & mask_)
+    if (slots_[i].hash == h && names_[slots_[i].entry] == name)
+      return values_[slots_[i].entry];
+  return -1;
+}
+}  // namespace core
+}  // namespace moveit
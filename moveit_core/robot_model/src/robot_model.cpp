@@ -44,6 +44,10 @@
 #include <queue>
 #include <cmath>
 #include <memory>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <tuple>
 #include "order_robot_model_items.inc"
 
 namespace moveit
@@ -52,6 +56,122 @@ namespace core
 {
 const std::string LOGNAME = "robot_model";
 
+namespace
+{
+/** \brief Process-wide cache of meshes loaded for link geometry.
+
+    Loading and parsing mesh resources dominates the construction time of models with many links. Meshes are
+    therefore loaded concurrently before the kinematic tree is built, and shared between all models constructed
+    by the process (e.g. the models of several RobotModelLoaders, or repeated constructions in tests).
+
+    Meshes that failed to load are not cached, such that fixed resources are picked up by the next model. Once the
+    cache holds more than MAX_CACHED_MESHES entries, meshes no longer used by any model are evicted, which bounds the
+    memory held by processes that construct models of changing descriptions. */
+class MeshCache
+{
+public:
+  typedef std::tuple<std::string, double, double, double> Key;
+
+  static const std::size_t MAX_CACHED_MESHES = 1024;
+
+  static MeshCache& instance()
+  {
+    static MeshCache cache;
+    return cache;
+  }
+
+  static Key key(const urdf::Mesh& mesh)
+  {
+    return Key(mesh.filename, mesh.scale.x, mesh.scale.y, mesh.scale.z);
+  }
+
+  /** \brief Load all meshes that are not cached yet, using up to one thread per core */
+  void preload(const std::vector<const urdf::Mesh*>& meshes)
+  {
+    std::vector<Key> missing;
+    {
+      std::lock_guard<std::mutex> slock(lock_);
+      for (const urdf::Mesh* mesh : meshes)
+        if (meshes_.find(key(*mesh)) == meshes_.end())
+          missing.push_back(key(*mesh));
+    }
+    std::sort(missing.begin(), missing.end());
+    missing.erase(std::unique(missing.begin(), missing.end()), missing.end());
+    if (missing.empty())
+      return;
+
+    std::vector<shapes::ShapeConstPtr> loaded(missing.size());
+    std::atomic<std::size_t> next(0);
+    const auto load = [&missing, &loaded, &next] {
+      for (std::size_t i = next++; i < missing.size(); i = next++)
+      {
+        const Key& k = missing[i];
+        loaded[i].reset(shapes::createMeshFromResource(std::get<0>(k),
+                                                       Eigen::Vector3d(std::get<1>(k), std::get<2>(k), std::get<3>(k))));
+      }
+    };
+    const std::size_t thread_count =
+        std::min<std::size_t>(std::max(1u, std::thread::hardware_concurrency()), missing.size());
+    std::vector<std::thread> threads;
+    for (std::size_t i = 1; i < thread_count; ++i)
+      threads.emplace_back(load);
+    load();
+    for (std::thread& thread : threads)
+      thread.join();
+
+    // failed meshes are loaded (and reported) again when the link is constructed
+    std::lock_guard<std::mutex> slock(lock_);
+    evictUnused(missing.size());
+    for (std::size_t i = 0; i < missing.size(); ++i)
+      if (loaded[i])
+        meshes_[missing[i]] = loaded[i];
+  }
+
+  /** \brief Get a cached mesh or load it; null if loading failed */
+  shapes::ShapeConstPtr get(const urdf::Mesh& mesh)
+  {
+    const Key k = key(mesh);
+    {
+      std::lock_guard<std::mutex> slock(lock_);
+      std::map<Key, shapes::ShapeConstPtr>::const_iterator it = meshes_.find(k);
+      if (it != meshes_.end())
+        return it->second;
+    }
+    shapes::ShapeConstPtr shape(
+        shapes::createMeshFromResource(mesh.filename, Eigen::Vector3d(mesh.scale.x, mesh.scale.y, mesh.scale.z)));
+    if (shape)
+    {
+      std::lock_guard<std::mutex> slock(lock_);
+      evictUnused(1);
+      meshes_[k] = shape;
+    }
+    return shape;
+  }
+
+  void clear()
+  {
+    std::lock_guard<std::mutex> slock(lock_);
+    meshes_.clear();
+  }
+
+private:
+  /** \brief Make room for \e count new entries by dropping meshes only referenced by the cache. Requires lock_. */
+  void evictUnused(std::size_t count)
+  {
+    if (meshes_.size() + count <= MAX_CACHED_MESHES)
+      return;
+    for (std::map<Key, shapes::ShapeConstPtr>::iterator it = meshes_.begin(); it != meshes_.end();)
+      if (it->second.use_count() == 1)
+        it = meshes_.erase(it);
+      else
+        ++it;
+  }
+
+  std::mutex lock_;
+  std::map<Key, shapes::ShapeConstPtr> meshes_;
+};
+}  // namespace
+
 RobotModel::RobotModel(const urdf::ModelInterfaceSharedPtr& urdf_model, const srdf::ModelConstSharedPtr& srdf_model)
 {
   root_joint_ = nullptr;
@@ -89,6 +209,7 @@ void RobotModel::buildModel(const urdf::ModelInterface& urdf_model, const srdf::
   root_link_ = nullptr;
   link_geometry_count_ = 0;
   variable_count_ = 0;
+  variable_layout_hash_ = 0;
   model_name_ = urdf_model.getName();
   ROS_INFO_NAMED(LOGNAME, "Loading robot model '%s'...", model_name_.c_str());
 
@@ -97,6 +218,9 @@ void RobotModel::buildModel(const urdf::ModelInterface& urdf_model, const srdf::
     const urdf::Link* root_link_ptr = urdf_model.getRoot().get();
     model_frame_ = root_link_ptr->name;
 
+    ROS_DEBUG_NAMED(LOGNAME, "... loading meshes");
+    preloadMeshes(urdf_model);
+
     ROS_DEBUG_NAMED(LOGNAME, "... building kinematic chain");
     root_joint_ = buildRecursive(nullptr, root_link_ptr, srdf_model);
     if (root_joint_)
@@ -123,6 +247,35 @@ void RobotModel::buildModel(const urdf::ModelInterface& urdf_model, const srdf::
   }
   else
     ROS_WARN_NAMED(LOGNAME, "No root link found");
+
+  // an empty model yields an empty kernel
+  fk_kernel_ = std::make_shared<const ForwardKinematicsKernel>(*this);
+}
+
+void RobotModel::preloadMeshes(const urdf::ModelInterface& urdf_model)
+{
+  moveit::tools::Profiler::ScopedBlock prof_block("RobotModel::preloadMeshes");
+
+  std::vector<const urdf::Mesh*> meshes;
+  for (const std::pair<const std::string, urdf::LinkSharedPtr>& link : urdf_model.links_)
+  {
+    const std::vector<urdf::CollisionSharedPtr>& col_array =
+        link.second->collision_array.empty() ? std::vector<urdf::CollisionSharedPtr>(1, link.second->collision) :
+                                               link.second->collision_array;
+    for (const urdf::CollisionSharedPtr& col : col_array)
+      if (col && col->geometry && col->geometry->type == urdf::Geometry::MESH)
+      {
+        const urdf::Mesh* mesh = static_cast<const urdf::Mesh*>(col->geometry.get());
+        if (!mesh->filename.empty())
+          meshes.push_back(mesh);
+      }
+  }
+  MeshCache::instance().preload(meshes);
+}
+
+void RobotModel::clearMeshCache()
+{
+  MeshCache::instance().clear();
 }
 
 namespace
@@ -316,6 +469,25 @@ void RobotModel::buildJointInfo()
 
   computeDescendants();
   computeCommonRoots();  // must be called _after_ list of descendants was computed
+
+  // build the tables for fast lookups by name
+  variable_name_index_.build(
+      std::vector<std::pair<std::string, int>>(joint_variables_index_map_.begin(), joint_variables_index_map_.end()));
+  joint_name_index_.build(joint_model_names_vector_);
+  link_name_index_.build(link_model_names_vector_);
+
+  // FNV-1a hash of the variable layout
+  variable_layout_hash_ = 14695981039346656037ULL;
+  const auto hash_byte = [this](unsigned char c) {
+    variable_layout_hash_ = (variable_layout_hash_ ^ c) * 1099511628211ULL;
+  };
+  for (std::size_t i = 0; i < variable_names_.size(); ++i)
+  {
+    for (char c : variable_names_[i])
+      hash_byte(c);
+    hash_byte(0);
+    hash_byte(joints_of_variable_[i]->getType());
+  }
 }
 
 void RobotModel::buildGroupStates(const srdf::Model& srdf_model)
@@ -470,29 +642,23 @@ JointModelGroup* RobotModel::getEndEffector(const std::string& name)
 
 bool RobotModel::hasJointModelGroup(const std::string& name) const
 {
-  return joint_model_group_map_.find(name) != joint_model_group_map_.end();
+  return group_name_index_.find(name) >= 0;
 }
 
 const JointModelGroup* RobotModel::getJointModelGroup(const std::string& name) const
 {
-  JointModelGroupMap::const_iterator it = joint_model_group_map_.find(name);
-  if (it == joint_model_group_map_.end())
-  {
-    ROS_ERROR_NAMED(LOGNAME, "Group '%s' not found in model '%s'", name.c_str(), model_name_.c_str());
-    return nullptr;
-  }
-  return it->second;
+  return const_cast<RobotModel*>(this)->getJointModelGroup(name);
 }
 
 JointModelGroup* RobotModel::getJointModelGroup(const std::string& name)
 {
-  JointModelGroupMap::const_iterator it = joint_model_group_map_.find(name);
-  if (it == joint_model_group_map_.end())
+  int index = group_name_index_.find(name);
+  if (index < 0)
   {
     ROS_ERROR_NAMED(LOGNAME, "Group '%s' not found in model '%s'", name.c_str(), model_name_.c_str());
     return nullptr;
   }
-  return it->second;
+  return joint_model_groups_[index];
 }
 
 void RobotModel::buildGroups(const srdf::Model& srdf_model)
@@ -542,6 +708,7 @@ void RobotModel::buildGroups(const srdf::Model& srdf_model)
     joint_model_groups_const_.push_back(joint_model_group);
     joint_model_group_names_.push_back(joint_model_group->getName());
   }
+  group_name_index_.build(joint_model_group_names_);
 
   buildGroupsInfoSubgroups(srdf_model);
   buildGroupsInfoEndEffectors(srdf_model);
@@ -737,7 +904,9 @@ bool RobotModel::addJointModelGroup(const srdf::Model::Group& gc)
   // add joints from subgroups
   for (const std::string& subgroup : gc.subgroups_)
   {
-    const JointModelGroup* sg = getJointModelGroup(subgroup);
+    // group_name_index_ is not built yet
+    JointModelGroupMap::const_iterator sg_it = joint_model_group_map_.find(subgroup);
+    const JointModelGroup* sg = sg_it != joint_model_group_map_.end() ? sg_it->second : nullptr;
     if (sg)
     {
       // active joints
@@ -1054,10 +1223,16 @@ LinkModel* RobotModel::constructLinkModel(const urdf::Link* urdf_link)
   return new_link_model;
 }
 
-shapes::ShapePtr RobotModel::constructShape(const urdf::Geometry* geom)
+shapes::ShapeConstPtr RobotModel::constructShape(const urdf::Geometry* geom)
 {
   moveit::tools::Profiler::ScopedBlock prof_block("RobotModel::constructShape");
 
+  if (geom->type == urdf::Geometry::MESH)
+  {
+    const urdf::Mesh* mesh = static_cast<const urdf::Mesh*>(geom);
+    return mesh->filename.empty() ? shapes::ShapeConstPtr() : MeshCache::instance().get(*mesh);
+  }
+
   shapes::Shape* new_shape = nullptr;
   switch (geom->type)
   {
@@ -1074,42 +1249,27 @@ shapes::ShapePtr RobotModel::constructShape(const urdf::Geometry* geom)
       new_shape = new shapes::Cylinder(static_cast<const urdf::Cylinder*>(geom)->radius,
                                        static_cast<const urdf::Cylinder*>(geom)->length);
       break;
-    case urdf::Geometry::MESH:
-    {
-      const urdf::Mesh* mesh = static_cast<const urdf::Mesh*>(geom);
-      if (!mesh->filename.empty())
-      {
-        Eigen::Vector3d scale(mesh->scale.x, mesh->scale.y, mesh->scale.z);
-        shapes::Mesh* m = shapes::createMeshFromResource(mesh->filename, scale);
-        new_shape = m;
-      }
-    }
-    break;
     default:
       ROS_ERROR_NAMED(LOGNAME, "Unknown geometry type: %d", (int)geom->type);
       break;
   }
 
-  return shapes::ShapePtr(new_shape);
+  return shapes::ShapeConstPtr(new_shape);
 }
 
 bool RobotModel::hasJointModel(const std::string& name) const
 {
-  return joint_model_map_.find(name) != joint_model_map_.end();
+  return joint_name_index_.find(name) >= 0;
 }
 
 bool RobotModel::hasLinkModel(const std::string& name) const
 {
-  return link_model_map_.find(name) != link_model_map_.end();
+  return link_name_index_.find(name) >= 0;
 }
 
 const JointModel* RobotModel::getJointModel(const std::string& name) const
 {
-  JointModelMap::const_iterator it = joint_model_map_.find(name);
-  if (it != joint_model_map_.end())
-    return it->second;
-  ROS_ERROR_NAMED(LOGNAME, "Joint '%s' not found in model '%s'", name.c_str(), model_name_.c_str());
-  return nullptr;
+  return const_cast<RobotModel*>(this)->getJointModel(name);
 }
 
 const JointModel* RobotModel::getJointModel(int index) const
@@ -1125,9 +1285,9 @@ const JointModel* RobotModel::getJointModel(int index) const
 
 JointModel* RobotModel::getJointModel(const std::string& name)
 {
-  JointModelMap::const_iterator it = joint_model_map_.find(name);
-  if (it != joint_model_map_.end())
-    return it->second;
+  int index = joint_name_index_.find(name);
+  if (index >= 0)
+    return joint_model_vector_[index];
   ROS_ERROR_NAMED(LOGNAME, "Joint '%s' not found in model '%s'", name.c_str(), model_name_.c_str());
   return nullptr;
 }
@@ -1152,9 +1312,9 @@ LinkModel* RobotModel::getLinkModel(const std::string& name, bool* has_link)
 {
   if (has_link)
     *has_link = true;  // Start out optimistic
-  LinkModelMap::const_iterator it = link_model_map_.find(name);
-  if (it != link_model_map_.end())
-    return it->second;
+  int index = link_name_index_.find(name);
+  if (index >= 0)
+    return link_model_vector_[index];
 
   if (has_link)
     *has_link = false;  // Report failure via argument
@@ -1235,10 +1395,22 @@ void RobotModel::getMissingVariableNames(const std::vector<std::string>& variabl
 
 int RobotModel::getVariableIndex(const std::string& variable) const
 {
-  VariableIndexMap::const_iterator it = joint_variables_index_map_.find(variable);
-  if (it == joint_variables_index_map_.end())
+  int index = variable_name_index_.find(variable);
+  if (index < 0)
     throw Exception("Variable '" + variable + "' is not known to model '" + model_name_ + "'");
-  return it->second;
+  return index;
+}
+
+bool RobotModel::getVariableIndices(const std::vector<std::string>& variables, std::vector<int>& indices) const
+{
+  bool all_known = true;
+  indices.resize(variables.size());
+  for (std::size_t i = 0; i < variables.size(); ++i)
+  {
+    indices[i] = variable_name_index_.find(variables[i]);
+    all_known &= indices[i] >= 0;
+  }
+  return all_known;
 }
 
 double RobotModel::getMaximumExtent(const JointBoundsVector& active_joint_bounds) const
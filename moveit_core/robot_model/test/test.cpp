@@ -82,6 +82,68 @@ TEST_F(LoadPlanningModelsPr2, Model)
   moveit::tools::Profiler::Status();
 }
 
+TEST_F(LoadPlanningModelsPr2, NameLookups)
+{
+  for (const moveit::core::LinkModel* link : robot_model_->getLinkModels())
+  {
+    EXPECT_TRUE(robot_model_->hasLinkModel(link->getName()));
+    EXPECT_EQ(robot_model_->getLinkModel(link->getName()), link);
+  }
+  for (const moveit::core::JointModelGroup* group : robot_model_->getJointModelGroups())
+  {
+    EXPECT_TRUE(robot_model_->hasJointModelGroup(group->getName()));
+    EXPECT_EQ(robot_model_->getJointModelGroup(group->getName()), group);
+  }
+  const std::vector<std::string>& variables = robot_model_->getVariableNames();
+  for (std::size_t i = 0; i < variables.size(); ++i)
+    EXPECT_EQ(robot_model_->getVariableIndex(variables[i]), static_cast<int>(i));
+  for (const moveit::core::JointModel* joint : robot_model_->getJointModels())
+    if (joint->getVariableCount() > 0)
+      EXPECT_EQ(robot_model_->getVariableIndex(joint->getName()), joint->getFirstVariableIndex());
+
+  bool has_link = true;
+  EXPECT_FALSE(robot_model_->hasJointModel("no_such_joint"));
+  EXPECT_FALSE(robot_model_->hasLinkModel("no_such_link"));
+  EXPECT_FALSE(robot_model_->hasJointModelGroup("no_such_group"));
+  EXPECT_EQ(robot_model_->getLinkModel("no_such_link", &has_link), nullptr);
+  EXPECT_FALSE(has_link);
+  EXPECT_THROW(robot_model_->getVariableIndex("no_such_variable"), moveit::Exception);
+
+  // precomputed indices for a fixed ordering of names
+  std::vector<std::string> names = { variables[3], variables[1], "no_such_variable", variables[2] };
+  std::vector<int> indices;
+  EXPECT_FALSE(robot_model_->getVariableIndices(names, indices));
+  EXPECT_EQ(indices, std::vector<int>({ 3, 1, -1, 2 }));
+  names.erase(names.begin() + 2);
+  EXPECT_TRUE(robot_model_->getVariableIndices(names, indices));
+  EXPECT_EQ(indices, std::vector<int>({ 3, 1, 2 }));
+}
+
+TEST(MeshCache, SharedBetweenModels)
+{
+  moveit::core::RobotModelConstPtr first = moveit::core::loadTestingRobotModel("pr2");
+  moveit::core::RobotModelConstPtr second = moveit::core::loadTestingRobotModel("pr2");
+  moveit::core::RobotModel::clearMeshCache();
+  moveit::core::RobotModelConstPtr third = moveit::core::loadTestingRobotModel("pr2");
+
+  std::size_t meshes = 0;
+  for (const moveit::core::LinkModel* link : first->getLinkModelsWithCollisionGeometry())
+  {
+    const moveit::core::LinkModel* second_link = second->getLinkModel(link->getName());
+    const moveit::core::LinkModel* third_link = third->getLinkModel(link->getName());
+    ASSERT_EQ(link->getShapes().size(), second_link->getShapes().size());
+    ASSERT_EQ(link->getShapes().size(), third_link->getShapes().size());
+    for (std::size_t i = 0; i < link->getShapes().size(); ++i)
+      if (link->getShapes()[i]->type == shapes::MESH)
+      {
+        ++meshes;
+        EXPECT_EQ(link->getShapes()[i], second_link->getShapes()[i]);
+        EXPECT_NE(link->getShapes()[i], third_link->getShapes()[i]);
+      }
+  }
+  EXPECT_GT(meshes, 0u);
+}
+
 TEST(SiblingAssociateLinks, SimpleYRobot)
 {
   /* base_link - a - b - c
@@ -40,6 +40,8 @@
 #include <moveit/transforms/transforms.h>
 #include <moveit_msgs/RobotState.h>
 #include <moveit_msgs/RobotTrajectory.h>
+#include <cstdint>
+#include <vector>
 
 namespace moveit
 {
@@ -53,6 +55,57 @@ namespace core
  */
 bool jointStateToRobotState(const sensor_msgs::JointState& joint_state, RobotState& state);
 
+/** @brief Precomputed mapping from the name order of JointState messages to the variables of a RobotModel.
+ *
+ * Publishers usually send all their JointState messages with the same ordering of names. Computing the variable
+ * indices once for that ordering allows to apply subsequent messages without any string lookups. */
+class JointStateLayout
+{
+public:
+  JointStateLayout(const RobotModel& model, const std::vector<std::string>& names);
+
+  /** @brief True if \e names is exactly the ordering this layout was computed for */
+  bool matches(const std::vector<std::string>& names) const
+  {
+    return names == names_;
+  }
+
+  /** @brief True if all names are variables of the model */
+  bool isComplete() const
+  {
+    return complete_;
+  }
+
+  const std::vector<std::string>& getNames() const
+  {
+    return names_;
+  }
+
+  /** @brief Get the variable index for every name, -1 for names that are not known to the model */
+  const std::vector<int>& getVariableIndices() const
+  {
+    return indices_;
+  }
+
+private:
+  std::vector<std::string> names_;
+  std::vector<int> indices_;
+  bool complete_;
+};
+
+/**
+ * @brief Convert a joint state to a MoveIt robot state, using a precomputed layout for the order of joint names.
+ *
+ * The names in \e joint_state are not examined; the caller needs to ensure that \e layout matches them (see
+ * JointStateLayout::matches()). Names that are not known to the model are ignored.
+ * @param joint_state The input joint state to be converted
+ * @param layout The layout of names in \e joint_state
+ * @param state The resultant MoveIt robot state
+ * @return True if successful, false if the sizes of the message don't match the layout
+ */
+bool jointStateToRobotState(const sensor_msgs::JointState& joint_state, const JointStateLayout& layout,
+                            RobotState& state);
+
 /**
  * @brief Convert a robot state msg (with accompanying extra transforms) to a MoveIt robot state
  * @param tf An instance of a transforms object
@@ -140,5 +193,100 @@ void robotStateToStream(const RobotState& state, std::ostream& out,
  * \return true on success
  */
 void streamToRobotState(RobotState& state, const std::string& line, const std::string& separator = ",");
+
+/**
+ * @brief Serialize the variable positions (and optionally velocities) of a robot state into a compact binary snapshot.
+ *
+ * Instead of variable names, the snapshot stores the RobotModel's variable layout hash, so it can only be restored
+ * for a model with identical variables. Values are stored in native byte order, either as double or, if \e quantize
+ * is true, as float32 (about 1e-7 relative precision). Attached bodies are not stored.
+ * @param state - the input MoveIt robot state object
+ * @param buffer - the resulting snapshot; existing content is replaced
+ * @param quantize - store values as float32 instead of double
+ * @param include_velocities - store velocities too, if the state has them
+ */
+void robotStateToSnapshot(const RobotState& state, std::vector<std::uint8_t>& buffer, bool quantize = false,
+                          bool include_velocities = false);
+
+/**
+ * @brief Restore the variable positions (and velocities, if stored) of a robot state from a binary snapshot
+ * @param data - pointer to the snapshot
+ * @param size - number of bytes available at \e data
+ * @param state - the output MoveIt robot state object
+ * @return false if the snapshot is malformed or was created for a different variable layout
+ */
+bool snapshotToRobotState(const void* data, std::size_t size, RobotState& state);
+
+/** @brief Read-only view of a binary robot state snapshot created by robotStateToSnapshot().
+ *
+ * The view doesn't copy or parse the buffer, which needs to outlive it. For non-quantized snapshots in suitably
+ * aligned buffers, the positions can be accessed in place through getVariablePositions(). */
+class RobotStateSnapshotView
+{
+public:
+  RobotStateSnapshotView(const void* data, std::size_t size);
+
+  /** @brief True if the buffer contains a well-formed snapshot */
+  bool isValid() const
+  {
+    return valid_;
+  }
+
+  /** @brief True if the snapshot was created for a model with the same variable layout as \e model */
+  bool isCompatible(const RobotModel& model) const
+  {
+    return valid_ && layout_hash_ == model.getVariableLayoutHash() && variable_count_ == model.getVariableCount();
+  }
+
+  std::uint64_t getVariableLayoutHash() const
+  {
+    return layout_hash_;
+  }
+
+  std::size_t getVariableCount() const
+  {
+    return variable_count_;
+  }
+
+  /** @brief True if values are stored as float32 */
+  bool isQuantized() const
+  {
+    return quantized_;
+  }
+
+  bool hasVelocities() const
+  {
+    return has_velocities_;
+  }
+
+  /** @brief Get the position of variable \e index. No bounds checking is performed. */
+  double getVariablePosition(std::size_t index) const
+  {
+    return getValue(positions_, index);
+  }
+
+  /** @brief Get the velocity of variable \e index. Only valid if hasVelocities() */
+  double getVariableVelocity(std::size_t index) const
+  {
+    return getValue(velocities_, index);
+  }
+
+  /** @brief Get direct access to the stored positions, or nullptr if they are quantized or not aligned in memory */
+  const double* getVariablePositions() const;
+
+  /** @brief Copy the positions (and velocities, if stored) into \e state. Returns false if not compatible. */
+  bool copyToRobotState(RobotState& state) const;
+
+private:
+  double getValue(const std::uint8_t* values, std::size_t index) const;
+
+  bool valid_;
+  bool quantized_;
+  bool has_velocities_;
+  std::uint64_t layout_hash_;
+  std::size_t variable_count_;
+  const std::uint8_t* positions_;
+  const std::uint8_t* velocities_;
+};
 }  // namespace core
 }  // namespace moveit
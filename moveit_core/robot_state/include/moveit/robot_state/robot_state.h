@@ -1199,6 +1199,76 @@ public:
                                                              use_quaternion_representation);
   }
 
+  /** \brief Compute the Jacobian into a caller-provided buffer, e.g. an Eigen::Map, without allocating memory.
+   * \param jacobian The resultant jacobian, which needs to be of size (6 or 7) x group->getVariableCount()
+   * \return True if jacobian was successfully computed, false otherwise
+   * See the overload taking an Eigen::MatrixXd for the other parameters. The link transforms need to be up to date.
+   */
+  bool getJacobian(const JointModelGroup* group, const LinkModel* link, const Eigen::Vector3d& reference_point_position,
+                   Eigen::Ref<Eigen::MatrixXd> jacobian, bool use_quaternion_representation = false) const;
+
+  /** \brief Compute the Jacobian into a caller-provided buffer, e.g. an Eigen::Map, without allocating memory.
+   * \param jacobian The resultant jacobian, which needs to be of size (6 or 7) x group->getVariableCount()
+   * \return True if jacobian was successfully computed, false otherwise
+   * See the overload taking an Eigen::MatrixXd for the other parameters.
+   */
+  bool getJacobian(const JointModelGroup* group, const LinkModel* link, const Eigen::Vector3d& reference_point_position,
+                   Eigen::Ref<Eigen::MatrixXd> jacobian, bool use_quaternion_representation = false)
+  {
+    updateLinkTransforms();
+    return static_cast<const RobotState*>(this)->getJacobian(group, link, reference_point_position, jacobian,
+                                                             use_quaternion_representation);
+  }
+
+  /** \brief Compute the Jacobians of several links (e.g. multiple tips or points of interest) of the same group.
+   * \param group The group to compute the Jacobians for
+   * \param links The links to compute Jacobians for
+   * \param reference_point_positions One reference point position per link, with respect to that link
+   * \param jacobians The resultant jacobians, stacked vertically in the order of \e links. Needs to be of size
+   * (6 or 7) * links.size() x group->getVariableCount()
+   * \param use_quaternion_representation Flag indicating if the Jacobians should use a quaternion representation
+   * \return True if all jacobians were successfully computed, false otherwise
+   */
+  bool getJacobians(const JointModelGroup* group, const std::vector<const LinkModel*>& links,
+                    const EigenSTL::vector_Vector3d& reference_point_positions, Eigen::Ref<Eigen::MatrixXd> jacobians,
+                    bool use_quaternion_representation = false) const;
+
+  /** \brief Compute the Jacobians of several links (e.g. multiple tips or points of interest) of the same group.
+   * See the const version for a description of the parameters.
+   */
+  bool getJacobians(const JointModelGroup* group, const std::vector<const LinkModel*>& links,
+                    const EigenSTL::vector_Vector3d& reference_point_positions, Eigen::Ref<Eigen::MatrixXd> jacobians,
+                    bool use_quaternion_representation = false)
+  {
+    updateLinkTransforms();
+    return static_cast<const RobotState*>(this)->getJacobians(group, links, reference_point_positions, jacobians,
+                                                              use_quaternion_representation);
+  }
+
+  /** \brief Compute the time derivative of the Jacobian, for the current variable velocities of this state.
+   * Only chains of revolute and prismatic joints are supported.
+   * \param group The group to compute the Jacobian derivative for
+   * \param link The link
+   * \param reference_point_position The reference point position (with respect to the link)
+   * \param jacobian_derivative The result, which needs to be of size 6 x group->getVariableCount()
+   * \return True if the derivative was successfully computed, false otherwise
+   */
+  bool getJacobianDerivative(const JointModelGroup* group, const LinkModel* link,
+                             const Eigen::Vector3d& reference_point_position,
+                             Eigen::Ref<Eigen::MatrixXd> jacobian_derivative) const;
+
+  /** \brief Compute the time derivative of the Jacobian, for the current variable velocities of this state.
+   * See the const version for a description of the parameters.
+   */
+  bool getJacobianDerivative(const JointModelGroup* group, const LinkModel* link,
+                             const Eigen::Vector3d& reference_point_position,
+                             Eigen::Ref<Eigen::MatrixXd> jacobian_derivative)
+  {
+    updateLinkTransforms();
+    return static_cast<const RobotState*>(this)->getJacobianDerivative(group, link, reference_point_position,
+                                                                       jacobian_derivative);
+  }
+
   /** \brief Compute the Jacobian with reference to the last link of a specified group. If the group is not a chain, an
    * exception is thrown.
    * \param group The group to compute the Jacobian for
@@ -1747,24 +1817,67 @@ public:
   std::string getStateTreeString(const std::string& prefix = "") const;
 
 private:
+  /** \brief The size of the memory block holding positions, velocities, accelerations and transforms */
+  std::size_t getMemorySize() const;
   void allocMemory();
   void initTransforms();
   void copyFrom(const RobotState& other);
 
+  /** \brief Up to CAPACITY disjoint subtrees of the kinematic tree whose transforms are dirty.
+
+      This refines the common root of all dirty subtrees (dirty_link_transforms_ resp.
+      dirty_collision_body_transforms_): e.g. when moving both arms of a dual-arm robot, the other branches below the
+      arms' common root (head, sensors, ...) don't need to be recomputed. A count of zero means that only the common
+      root is known, which is always a valid (conservative) description. */
+  struct DirtySubtrees
+  {
+    enum
+    {
+      CAPACITY = 4
+    };
+    const JointModel* roots[CAPACITY];
+    unsigned int count;
+  };
+
+  /** \brief Add the subtree rooted at \e joint to the dirty subtrees described by \e common_root and \e subtrees */
+  void addDirtySubtree(const JointModel* joint, const JointModel*& common_root, DirtySubtrees& subtrees) const
+  {
+    if (common_root == nullptr)
+    {
+      common_root = joint;
+      subtrees.roots[0] = joint;
+      subtrees.count = 1;
+      return;
+    }
+    common_root = robot_model_->getCommonRoot(common_root, joint);
+    if (subtrees.count == 0)  // only the common root is known
+      return;
+    for (unsigned int i = 0; i < subtrees.count; ++i)
+    {
+      const JointModel* root = robot_model_->getCommonRoot(subtrees.roots[i], joint);
+      if (root == subtrees.roots[i])  // already covered by subtree i
+        return;
+      if (root == joint)  // subtree i is covered by the new one
+        subtrees.roots[i--] = subtrees.roots[--subtrees.count];
+    }
+    if (subtrees.count < DirtySubtrees::CAPACITY)
+      subtrees.roots[subtrees.count++] = joint;
+    else  // too many subtrees: fall back to the common root
+      subtrees.count = 0;
+  }
+
   void markDirtyJointTransforms(const JointModel* joint)
   {
     dirty_joint_transforms_[joint->getJointIndex()] = 1;
-    dirty_link_transforms_ =
-        dirty_link_transforms_ == nullptr ? joint : robot_model_->getCommonRoot(dirty_link_transforms_, joint);
+    addDirtySubtree(joint, dirty_link_transforms_, dirty_link_subtrees_);
   }
 
   void markDirtyJointTransforms(const JointModelGroup* group)
   {
     for (const JointModel* jm : group->getActiveJointModels())
       dirty_joint_transforms_[jm->getJointIndex()] = 1;
-    dirty_link_transforms_ = dirty_link_transforms_ == nullptr ?
-                                 group->getCommonRoot() :
-                                 robot_model_->getCommonRoot(dirty_link_transforms_, group->getCommonRoot());
+    for (const JointModel* jm : group->getJointRoots())
+      addDirtySubtree(jm, dirty_link_transforms_, dirty_link_subtrees_);
   }
 
   void markVelocity();
@@ -1809,6 +1922,7 @@ private:
   }
 
   void updateLinkTransformsInternal(const JointModel* start);
+  void updateCollisionBodyTransformsInternal(const JointModel* start);
 
   void getMissingKeys(const std::map<std::string, double>& variable_map,
                       std::vector<std::string>& missing_variables) const;
@@ -1836,10 +1950,13 @@ private:
 
   const JointModel* dirty_link_transforms_;
   const JointModel* dirty_collision_body_transforms_;
+  DirtySubtrees dirty_link_subtrees_;
+  DirtySubtrees dirty_collision_body_subtrees_;
 
   // All the following transform variables point into aligned memory in memory_
   // They are updated lazily, based on the flags in dirty_joint_transforms_
-  // resp. the pointers dirty_link_transforms_ and dirty_collision_body_transforms_
+  // resp. the pointers dirty_link_transforms_ and dirty_collision_body_transforms_,
+  // refined by dirty_link_subtrees_ and dirty_collision_body_subtrees_
   Eigen::Isometry3d* variable_joint_transforms_;         ///< Local transforms of all joints
   Eigen::Isometry3d* global_link_transforms_;            ///< Transforms from model frame to link frame for each link
   Eigen::Isometry3d* global_collision_body_transforms_;  ///< Transforms from model frame to collision bodies
@@ -0,0 +1,242 @@
+/*********************************************************************
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2020, PickNik LLC.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the copyright holder nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************/
+
+#pragma once
+
+#include <moveit/robot_model/robot_model.h>
+#include <moveit/robot_state/robot_state.h>
+#include <eigen_stl_containers/eigen_stl_containers.h>
+#include <random_numbers/random_numbers.h>
+
+namespace moveit
+{
+namespace core
+{
+MOVEIT_CLASS_FORWARD(RobotStateBatch);
+
+/** \brief A batch of robot configurations that share a RobotModel.
+
+    In contrast to a vector of RobotState instances, all configurations of a batch are stored in a single
+    structure-of-arrays (SoA) layout: the positions of one variable are stored contiguously for all states
+    of the batch, and the transforms of one joint resp. link are stored contiguously for all states as well.
+    This avoids one heap allocation per configuration and lets forward kinematics iterate over the
+    robot's links only once, processing all configurations of the batch in the inner loop.
+
+    Only positions are stored. Forward kinematics is computed lazily by updateLinkTransforms(), by default
+    through the model's vectorized ForwardKinematicsKernel. The scalar path uses the same
+    JointModel::computeTransform() code paths as RobotState. */
+class RobotStateBatch
+{
+public:
+  /** \brief Construct a batch of \e size states for the given robot model. All states are set to default values. */
+  RobotStateBatch(const RobotModelConstPtr& robot_model, std::size_t size);
+
+  /** \brief Get the robot model this batch is constructed for. */
+  const RobotModelConstPtr& getRobotModel() const
+  {
+    return robot_model_;
+  }
+
+  /** \brief Get the number of states in this batch */
+  std::size_t size() const
+  {
+    return size_;
+  }
+
+  /** \brief Change the number of states in this batch. Existing states are preserved where possible,
+      new states are set to default values. */
+  void resize(std::size_t size);
+
+  /** \brief Get the number of variables that make up each state. */
+  std::size_t getVariableCount() const
+  {
+    return robot_model_->getVariableCount();
+  }
+
+  /** \name Getting and setting variable positions
+   *  @{
+   */
+
+  /** \brief Get a raw pointer to the positions of variable \e index for all states in the batch (size() values).
+      After modifying these values, updateMimicJoints() needs to be called if the model has mimic joints. */
+  double* getVariablePositions(int index)
+  {
+    dirty_ = true;
+    return &positions_[index * size_];
+  }
+
+  /** \brief Get a raw pointer to the positions of variable \e index for all states in the batch (size() values). */
+  const double* getVariablePositions(int index) const
+  {
+    return &positions_[index * size_];
+  }
+
+  /** \brief Get the position of variable \e index of state \e state */
+  double getVariablePosition(std::size_t state, int index) const
+  {
+    return positions_[index * size_ + state];
+  }
+
+  /** \brief Set the position of variable \e index of state \e state. Mimic joints are not updated. */
+  void setVariablePosition(std::size_t state, int index, double value)
+  {
+    dirty_ = true;
+    positions_[index * size_ + state] = value;
+  }
+
+  /** \brief Set all variable positions of state \e state from an array ordered as RobotModel::getVariableNames() */
+  void setStatePositions(std::size_t state, const double* positions);
+
+  /** \brief Copy all variable positions of state \e state into an array ordered as RobotModel::getVariableNames() */
+  void copyStatePositions(std::size_t state, double* positions) const;
+
+  /** \brief Set state \e state to the positions of \e robot_state */
+  void setState(std::size_t state, const RobotState& robot_state)
+  {
+    setStatePositions(state, robot_state.getVariablePositions());
+  }
+
+  /** \brief Copy the positions of state \e state into \e robot_state */
+  void copyToState(std::size_t state, RobotState& robot_state) const;
+
+  /** \brief Set all states to the default positions of the model */
+  void setToDefaultValues();
+
+  /** \brief Set all states to random positions within default bounds */
+  void setToRandomPositions(random_numbers::RandomNumberGenerator& rng);
+
+  /** \brief Recompute the positions of all mimic joints from the joints they are mimicking */
+  void updateMimicJoints();
+
+  /** @} */
+
+  /** \name Updating and getting transforms
+   *  @{
+   */
+
+  /** \brief Compute the global link transforms of all states, if any position changed since the last update */
+  void updateLinkTransforms();
+
+  /** \brief Choose between the vectorized ForwardKinematicsKernel (default) and the scalar per-joint path */
+  void setUseForwardKinematicsKernel(bool flag)
+  {
+    use_kernel_ = flag;
+    dirty_ = true;
+  }
+
+  bool getUseForwardKinematicsKernel() const
+  {
+    return use_kernel_;
+  }
+
+  /** \brief Returns true if positions were modified since the last call to updateLinkTransforms() */
+  bool dirtyLinkTransforms() const
+  {
+    return dirty_;
+  }
+
+  /** \brief Get the transform of \e link w.r.t. the model frame, for state \e state */
+  const Eigen::Isometry3d& getGlobalLinkTransform(std::size_t state, const LinkModel* link)
+  {
+    updateLinkTransforms();
+    return global_link_transforms_[link->getLinkIndex() * size_ + state];
+  }
+
+  /** \brief Get the transform of \e link w.r.t. the model frame, for state \e state */
+  const Eigen::Isometry3d& getGlobalLinkTransform(std::size_t state, const LinkModel* link) const
+  {
+    assert(!dirty_);
+    return global_link_transforms_[link->getLinkIndex() * size_ + state];
+  }
+
+  /** \brief Get the transforms of \e link w.r.t. the model frame for all states (size() consecutive values) */
+  const Eigen::Isometry3d* getGlobalLinkTransforms(const LinkModel* link)
+  {
+    updateLinkTransforms();
+    return &global_link_transforms_[link->getLinkIndex() * size_];
+  }
+
+  /** \brief Get the transforms of \e link w.r.t. the model frame for all states (size() consecutive values) */
+  const Eigen::Isometry3d* getGlobalLinkTransforms(const LinkModel* link) const
+  {
+    assert(!dirty_);
+    return &global_link_transforms_[link->getLinkIndex() * size_];
+  }
+
+  /** @} */
+
+  /** \name Computing Jacobians
+   *  @{
+   */
+
+  /** \brief Compute the Jacobian of \e link for state \e state, using the cached link transforms of the batch.
+      \e jacobian needs to be of size (6 or 7) x group->getVariableCount(), see RobotState::getJacobian().
+      The link transforms need to be up to date. */
+  bool getJacobian(std::size_t state, const JointModelGroup* group, const LinkModel* link,
+                   const Eigen::Vector3d& reference_point_position, Eigen::Ref<Eigen::MatrixXd> jacobian,
+                   bool use_quaternion_representation = false) const;
+
+  /** \brief Compute the Jacobians of \e link for all states of the batch.
+      The Jacobians are stacked vertically in state order, such that \e jacobians needs to be of size
+      (6 or 7) * size() x group->getVariableCount(). An Eigen::Map of a caller-provided buffer can be passed. */
+  bool getJacobians(const JointModelGroup* group, const LinkModel* link, const Eigen::Vector3d& reference_point_position,
+                    Eigen::Ref<Eigen::MatrixXd> jacobians, bool use_quaternion_representation = false);
+
+  /** @} */
+
+private:
+  /** \brief Compute the local transforms of all joints for all states */
+  void updateJointTransforms();
+
+  RobotModelConstPtr robot_model_;
+  std::size_t size_;
+
+  /** \brief Variable positions, variable-major: positions_[variable_index * size_ + state] */
+  std::vector<double> positions_;
+
+  /** \brief Local joint transforms, joint-major: joint_transforms_[joint_index * size_ + state] */
+  EigenSTL::vector_Isometry3d joint_transforms_;
+
+  /** \brief Transforms from model frame to link frame, link-major: global_link_transforms_[link_index * size_ + state]
+   */
+  EigenSTL::vector_Isometry3d global_link_transforms_;
+
+  /** \brief Scratch space to gather the variables of a multi-DOF joint for a single state */
+  std::vector<double> joint_values_;
+
+  bool use_kernel_;
+  bool dirty_;
+};
+}  // namespace core
+}  // namespace moveit
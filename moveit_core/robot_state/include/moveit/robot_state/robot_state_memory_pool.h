@@ -0,0 +1,105 @@
+/*********************************************************************
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2020, PickNik LLC.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the copyright holder nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************/
+
+#pragma once
+
+#include <cstddef>
+
+namespace moveit
+{
+namespace core
+{
+/** \brief Recycles the memory blocks of RobotState instances.
+
+    Every RobotState owns one contiguous memory block, sized from its RobotModel, for positions, velocities,
+    accelerations and transforms. Planners create and destroy many temporary states, so this allocation becomes a
+    contention point for the system allocator when planning with many threads.
+
+    When enabled, blocks of destroyed states are kept in a cache local to the destroying thread and handed out again
+    to states constructed on that thread, without locking. Each thread caches at most getCapacity() blocks;
+    additional blocks are returned to the system allocator. The pool is disabled by default.
+
+    Allocation statistics are only counted while the pool is enabled and are kept per thread next to its cache, such
+    that the number of allocations caused by a planning request is the difference of two getStatistics() snapshots
+    taken on the planning thread. */
+class RobotStateMemoryPool
+{
+public:
+  struct Statistics
+  {
+    Statistics() : allocations(0), recycled(0), releases(0)
+    {
+    }
+
+    /** \brief Number of blocks requested by RobotState instances */
+    std::size_t allocations;
+    /** \brief Number of requests served from a thread's cache */
+    std::size_t recycled;
+    /** \brief Number of blocks given back by RobotState instances */
+    std::size_t releases;
+
+    Statistics operator-(const Statistics& other) const
+    {
+      Statistics result;
+      result.allocations = allocations - other.allocations;
+      result.recycled = recycled - other.recycled;
+      result.releases = releases - other.releases;
+      return result;
+    }
+  };
+
+  /** \brief Enable or disable recycling of memory blocks for all threads */
+  static void setEnabled(bool enabled);
+
+  static bool isEnabled();
+
+  /** \brief Set the maximum number of blocks each thread keeps cached */
+  static void setCapacity(std::size_t capacity);
+
+  static std::size_t getCapacity();
+
+  /** \brief Get the allocation counters of the calling thread */
+  static Statistics getStatistics();
+
+  /** \brief Free all blocks cached by the calling thread */
+  static void clearThreadCache();
+
+  /** \brief Get a block of at least \e bytes bytes */
+  static void* allocate(std::size_t bytes);
+
+  /** \brief Give back a block previously obtained from allocate() with the same \e bytes */
+  static void release(void* memory, std::size_t bytes);
+};
+}  // namespace core
+}  // namespace moveit
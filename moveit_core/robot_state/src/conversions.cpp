@@ -39,6 +39,7 @@
 #include <geometric_shapes/shape_operations.h>
 #include <tf2_eigen/tf2_eigen.h>
 #include <boost/lexical_cast.hpp>
+#include <cstring>
 
 namespace moveit
 {
@@ -402,6 +403,33 @@ bool jointStateToRobotState(const sensor_msgs::JointState& joint_state, RobotSta
   return result;
 }
 
+JointStateLayout::JointStateLayout(const RobotModel& model, const std::vector<std::string>& names) : names_(names)
+{
+  complete_ = model.getVariableIndices(names_, indices_);
+}
+
+bool jointStateToRobotState(const sensor_msgs::JointState& joint_state, const JointStateLayout& layout,
+                            RobotState& state)
+{
+  const std::vector<int>& indices = layout.getVariableIndices();
+  const bool has_velocities = !joint_state.velocity.empty();
+  if (joint_state.position.size() != indices.size() || (has_velocities && joint_state.velocity.size() != indices.size()))
+  {
+    ROS_ERROR_NAMED(LOGNAME, "JointState message does not match the layout of %zu joint names", indices.size());
+    return false;
+  }
+
+  for (std::size_t i = 0; i < indices.size(); ++i)
+    if (indices[i] >= 0)
+    {
+      state.setVariablePosition(indices[i], joint_state.position[i]);
+      if (has_velocities)
+        state.setVariableVelocity(indices[i], joint_state.velocity[i]);
+    }
+  state.update();
+  return true;
+}
+
 bool robotStateMsgToRobotState(const moveit_msgs::RobotState& robot_state, RobotState& state, bool copy_attached_bodies)
 {
   bool result = _robotStateMsgToRobotStateHelper(nullptr, robot_state, state, copy_attached_bodies);
@@ -566,5 +594,146 @@ void streamToRobotState(RobotState& state, const std::string& line, const std::s
   }
 }
 
+// ********************************************
+// * Binary snapshots
+// ********************************************
+
+namespace
+{
+/* Snapshot layout, all values in native byte order:
+   offset  0: uint32 magic
+   offset  4: uint8  version
+   offset  5: uint8  flags (SNAPSHOT_QUANTIZED, SNAPSHOT_VELOCITIES)
+   offset  6: uint16 reserved
+   offset  8: uint64 variable layout hash of the RobotModel
+   offset 16: uint32 variable count
+   offset 20: uint32 reserved, such that values start 8-byte aligned
+   offset 24: positions, followed by velocities (double, or float if quantized) */
+const std::uint32_t SNAPSHOT_MAGIC = 0x5352564d;  // "MVRS"
+const std::uint8_t SNAPSHOT_VERSION = 1;
+const std::uint8_t SNAPSHOT_QUANTIZED = 1;
+const std::uint8_t SNAPSHOT_VELOCITIES = 2;
+const std::size_t SNAPSHOT_HEADER_SIZE = 24;
+
+template <typename T>
+void writeValue(std::uint8_t* buffer, std::size_t offset, T value)
+{
+  std::memcpy(buffer + offset, &value, sizeof(T));
+}
+
+template <typename T>
+T readValue(const std::uint8_t* buffer, std::size_t offset)
+{
+  T value;
+  std::memcpy(&value, buffer + offset, sizeof(T));
+  return value;
+}
+
+void writeValues(const double* values, std::size_t count, bool quantize, std::uint8_t* out)
+{
+  if (quantize)
+    for (std::size_t i = 0; i < count; ++i)
+      writeValue<float>(out, i * sizeof(float), static_cast<float>(values[i]));
+  else
+    std::memcpy(out, values, count * sizeof(double));
+}
+}  // namespace
+
+void robotStateToSnapshot(const RobotState& state, std::vector<std::uint8_t>& buffer, bool quantize,
+                          bool include_velocities)
+{
+  const std::size_t count = state.getVariableCount();
+  const std::size_t value_size = quantize ? sizeof(float) : sizeof(double);
+  const bool velocities = include_velocities && state.hasVelocities();
+  buffer.resize(SNAPSHOT_HEADER_SIZE + count * value_size * (velocities ? 2 : 1));
+
+  std::uint8_t* data = buffer.data();
+  writeValue<std::uint32_t>(data, 0, SNAPSHOT_MAGIC);
+  writeValue<std::uint8_t>(data, 4, SNAPSHOT_VERSION);
+  writeValue<std::uint8_t>(data, 5, (quantize ? SNAPSHOT_QUANTIZED : 0) | (velocities ? SNAPSHOT_VELOCITIES : 0));
+  writeValue<std::uint16_t>(data, 6, 0);
+  writeValue<std::uint64_t>(data, 8, state.getRobotModel()->getVariableLayoutHash());
+  writeValue<std::uint32_t>(data, 16, count);
+  writeValue<std::uint32_t>(data, 20, 0);
+  writeValues(state.getVariablePositions(), count, quantize, data + SNAPSHOT_HEADER_SIZE);
+  if (velocities)
+    writeValues(state.getVariableVelocities(), count, quantize, data + SNAPSHOT_HEADER_SIZE + count * value_size);
+}
+
+bool snapshotToRobotState(const void* data, std::size_t size, RobotState& state)
+{
+  return RobotStateSnapshotView(data, size).copyToRobotState(state);
+}
+
+RobotStateSnapshotView::RobotStateSnapshotView(const void* data, std::size_t size)
+  : valid_(false)
+  , quantized_(false)
+  , has_velocities_(false)
+  , layout_hash_(0)
+  , variable_count_(0)
+  , positions_(nullptr)
+  , velocities_(nullptr)
+{
+  const std::uint8_t* buffer = static_cast<const std::uint8_t*>(data);
+  if (!buffer || size < SNAPSHOT_HEADER_SIZE || readValue<std::uint32_t>(buffer, 0) != SNAPSHOT_MAGIC ||
+      readValue<std::uint8_t>(buffer, 4) != SNAPSHOT_VERSION)
+    return;
+
+  const std::uint8_t flags = readValue<std::uint8_t>(buffer, 5);
+  quantized_ = flags & SNAPSHOT_QUANTIZED;
+  has_velocities_ = flags & SNAPSHOT_VELOCITIES;
+  layout_hash_ = readValue<std::uint64_t>(buffer, 8);
+  variable_count_ = readValue<std::uint32_t>(buffer, 16);
+
+  const std::size_t values_size = variable_count_ * (quantized_ ? sizeof(float) : sizeof(double));
+  if (size < SNAPSHOT_HEADER_SIZE + values_size * (has_velocities_ ? 2 : 1))
+    return;
+  positions_ = buffer + SNAPSHOT_HEADER_SIZE;
+  if (has_velocities_)
+    velocities_ = positions_ + values_size;
+  valid_ = true;
+}
+
+double RobotStateSnapshotView::getValue(const std::uint8_t* values, std::size_t index) const
+{
+  if (quantized_)
+    return readValue<float>(values, index * sizeof(float));
+  return readValue<double>(values, index * sizeof(double));
+}
+
+const double* RobotStateSnapshotView::getVariablePositions() const
+{
+  if (!valid_ || quantized_ || reinterpret_cast<std::uintptr_t>(positions_) % alignof(double) != 0)
+    return nullptr;
+  return reinterpret_cast<const double*>(positions_);
+}
+
+bool RobotStateSnapshotView::copyToRobotState(RobotState& state) const
+{
+  if (!isCompatible(*state.getRobotModel()))
+  {
+    ROS_ERROR_NAMED(LOGNAME, "Robot state snapshot is invalid or was created for a different robot model");
+    return false;
+  }
+
+  if (const double* aligned_positions = getVariablePositions())
+    state.setVariablePositions(aligned_positions);
+  else
+  {
+    std::vector<double> positions(variable_count_);
+    for (std::size_t i = 0; i < variable_count_; ++i)
+      positions[i] = getVariablePosition(i);
+    state.setVariablePositions(positions);
+  }
+
+  if (has_velocities_)
+  {
+    double* velocities = state.getVariableVelocities();
+    for (std::size_t i = 0; i < variable_count_; ++i)
+      velocities[i] = getVariableVelocity(i);
+  }
+  return true;
+}
+
 }  // end of namespace core
 }  // end of namespace moveit
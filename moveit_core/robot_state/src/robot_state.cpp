@@ -37,6 +37,7 @@
 
 #include <moveit/robot_state/robot_state.h>
 #include <moveit/robot_state/cartesian_interpolator.h>
+#include <moveit/robot_state/robot_state_memory_pool.h>
 #include <moveit/transforms/transforms.h>
 #include <geometric_shapes/shape_operations.h>
 #include <tf2_eigen/tf2_eigen.h>
@@ -45,6 +46,7 @@
 #include <moveit/macros/console_colors.h>
 #include <boost/bind.hpp>
 #include <moveit/robot_model/aabb.h>
+#include "jacobian.inc"
 
 namespace moveit
 {
@@ -61,6 +63,8 @@ RobotState::RobotState(const RobotModelConstPtr& robot_model)
   , dirty_collision_body_transforms_(nullptr)
   , rng_(nullptr)
 {
+  dirty_link_subtrees_.count = 0;
+  dirty_collision_body_subtrees_.count = 0;
   allocMemory();
   initTransforms();
 }
@@ -75,11 +79,23 @@ RobotState::RobotState(const RobotState& other) : rng_(nullptr)
 RobotState::~RobotState()
 {
   clearAttachedBodies();
-  free(memory_);
+  RobotStateMemoryPool::release(memory_, getMemorySize());
   if (rng_)
     delete rng_;
 }
 
+std::size_t RobotState::getMemorySize() const
+{
+  constexpr unsigned int extra_alignment_bytes = EIGEN_MAX_ALIGN_BYTES - 1;
+  // memory for the dirty joint transforms
+  const int nr_doubles_for_dirty_joint_transforms =
+      1 + robot_model_->getJointModelCount() / (sizeof(double) / sizeof(unsigned char));
+  return sizeof(Eigen::Isometry3d) * (robot_model_->getJointModelCount() + robot_model_->getLinkModelCount() +
+                                      robot_model_->getLinkGeometryCount()) +
+         sizeof(double) * (robot_model_->getVariableCount() * 3 + nr_doubles_for_dirty_joint_transforms) +
+         extra_alignment_bytes;
+}
+
 void RobotState::allocMemory()
 {
   static_assert((sizeof(Eigen::Isometry3d) / EIGEN_MAX_ALIGN_BYTES) * EIGEN_MAX_ALIGN_BYTES ==
@@ -87,15 +103,9 @@ void RobotState::allocMemory()
                 "sizeof(Eigen::Isometry3d) should be a multiple of EIGEN_MAX_ALIGN_BYTES");
 
   constexpr unsigned int extra_alignment_bytes = EIGEN_MAX_ALIGN_BYTES - 1;
-  // memory for the dirty joint transforms
-  const int nr_doubles_for_dirty_joint_transforms =
-      1 + robot_model_->getJointModelCount() / (sizeof(double) / sizeof(unsigned char));
-  const size_t bytes =
-      sizeof(Eigen::Isometry3d) * (robot_model_->getJointModelCount() + robot_model_->getLinkModelCount() +
-                                   robot_model_->getLinkGeometryCount()) +
-      sizeof(double) * (robot_model_->getVariableCount() * 3 + nr_doubles_for_dirty_joint_transforms) +
-      extra_alignment_bytes;
-  memory_ = malloc(bytes);
+  const std::size_t memory_size = getMemorySize();
+  // blocks are recycled by the memory pool if enabled, otherwise this is a plain malloc
+  memory_ = RobotStateMemoryPool::allocate(memory_size);
 
   // make the memory for transforms align at EIGEN_MAX_ALIGN_BYTES
   // https://eigen.tuxfamily.org/dox/classEigen_1_1aligned__allocator.html
@@ -105,7 +115,10 @@ void RobotState::allocMemory()
   global_collision_body_transforms_ = global_link_transforms_ + robot_model_->getLinkModelCount();
   dirty_joint_transforms_ =
       reinterpret_cast<unsigned char*>(global_collision_body_transforms_ + robot_model_->getLinkGeometryCount());
-  position_ = reinterpret_cast<double*>(dirty_joint_transforms_) + nr_doubles_for_dirty_joint_transforms;
+  // positions, velocities and accelerations / efforts make up the end of the block, see getMemorySize()
+  position_ = reinterpret_cast<double*>(reinterpret_cast<char*>(variable_joint_transforms_) + memory_size -
+                                        extra_alignment_bytes) -
+              robot_model_->getVariableCount() * 3;
   velocity_ = position_ + robot_model_->getVariableCount();
   // acceleration and effort share the memory (not both can be specified)
   effort_ = acceleration_ = velocity_ + robot_model_->getVariableCount();
@@ -114,9 +127,7 @@ void RobotState::allocMemory()
 void RobotState::initTransforms()
 {
   // mark all transforms as dirty
-  const int nr_doubles_for_dirty_joint_transforms =
-      1 + robot_model_->getJointModelCount() / (sizeof(double) / sizeof(unsigned char));
-  memset(dirty_joint_transforms_, 1, sizeof(double) * nr_doubles_for_dirty_joint_transforms);
+  memset(dirty_joint_transforms_, 1, reinterpret_cast<unsigned char*>(position_) - dirty_joint_transforms_);
 
   // initialize last row of transformation matrices, which will not be modified by transform updates anymore
   for (size_t i = 0, end = robot_model_->getJointModelCount() + robot_model_->getLinkModelCount() +
@@ -140,6 +151,8 @@ void RobotState::copyFrom(const RobotState& other)
 
   dirty_collision_body_transforms_ = other.dirty_collision_body_transforms_;
   dirty_link_transforms_ = other.dirty_link_transforms_;
+  dirty_collision_body_subtrees_ = other.dirty_collision_body_subtrees_;
+  dirty_link_subtrees_ = other.dirty_link_subtrees_;
 
   if (dirty_link_transforms_ == robot_model_->getRootJoint())
   {
@@ -153,15 +166,10 @@ void RobotState::copyFrom(const RobotState& other)
   else
   {
     // copy all the memory; maybe avoid copying velocity and acceleration if possible
-    const int nr_doubles_for_dirty_joint_transforms =
-        1 + robot_model_->getJointModelCount() / (sizeof(double) / sizeof(unsigned char));
-    const size_t bytes =
-        sizeof(Eigen::Isometry3d) * (robot_model_->getJointModelCount() + robot_model_->getLinkModelCount() +
-                                     robot_model_->getLinkGeometryCount()) +
-        sizeof(double) *
-            (robot_model_->getVariableCount() * (1 + ((has_velocity_ || has_acceleration_ || has_effort_) ? 1 : 0) +
-                                                 ((has_acceleration_ || has_effort_) ? 1 : 0)) +
-             nr_doubles_for_dirty_joint_transforms);
+    const int unused_variable_arrays =
+        ((has_velocity_ || has_acceleration_ || has_effort_) ? 0 : 1) + ((has_acceleration_ || has_effort_) ? 0 : 1);
+    const size_t bytes = getMemorySize() - (EIGEN_MAX_ALIGN_BYTES - 1) -
+                         sizeof(double) * robot_model_->getVariableCount() * unused_variable_arrays;
     memcpy(variable_joint_transforms_, other.variable_joint_transforms_, bytes);
   }
 
@@ -278,6 +286,7 @@ void RobotState::setToRandomPositions()
   robot_model_->getVariableRandomPositions(rng, position_);
   memset(dirty_joint_transforms_, 1, robot_model_->getJointModelCount() * sizeof(unsigned char));
   dirty_link_transforms_ = robot_model_->getRootJoint();
+  dirty_link_subtrees_.count = 0;
   // mimic values are correctly set in RobotModel
 }
 
@@ -343,6 +352,7 @@ void RobotState::setToDefaultValues()
   memset(velocity_, 0, sizeof(double) * 2 * robot_model_->getVariableCount());
   memset(dirty_joint_transforms_, 1, robot_model_->getJointModelCount() * sizeof(unsigned char));
   dirty_link_transforms_ = robot_model_->getRootJoint();
+  dirty_link_subtrees_.count = 0;
 }
 
 void RobotState::setVariablePositions(const double* position)
@@ -355,6 +365,7 @@ void RobotState::setVariablePositions(const double* position)
   // Since all joint values have potentially changed, we will need to recompute all transforms
   memset(dirty_joint_transforms_, 1, robot_model_->getJointModelCount() * sizeof(unsigned char));
   dirty_link_transforms_ = robot_model_->getRootJoint();
+  dirty_link_subtrees_.count = 0;
 }
 
 void RobotState::setVariablePositions(const std::map<std::string, double>& variable_map)
@@ -614,6 +625,7 @@ void RobotState::update(bool force)
   {
     memset(dirty_joint_transforms_, 1, robot_model_->getJointModelCount() * sizeof(unsigned char));
     dirty_link_transforms_ = robot_model_->getRootJoint();
+    dirty_link_subtrees_.count = 0;
   }
 
   // this actually triggers all needed updates
@@ -627,23 +639,31 @@ void RobotState::updateCollisionBodyTransforms()
 
   if (dirty_collision_body_transforms_ != nullptr)
   {
-    const std::vector<const LinkModel*>& links = dirty_collision_body_transforms_->getDescendantLinkModels();
+    if (dirty_collision_body_subtrees_.count == 0)
+      updateCollisionBodyTransformsInternal(dirty_collision_body_transforms_);
+    else
+      for (unsigned int i = 0; i < dirty_collision_body_subtrees_.count; ++i)
+        updateCollisionBodyTransformsInternal(dirty_collision_body_subtrees_.roots[i]);
     dirty_collision_body_transforms_ = nullptr;
+    dirty_collision_body_subtrees_.count = 0;
+  }
+}
 
-    for (const LinkModel* link : links)
+void RobotState::updateCollisionBodyTransformsInternal(const JointModel* start)
+{
+  for (const LinkModel* link : start->getDescendantLinkModels())
+  {
+    const EigenSTL::vector_Isometry3d& ot = link->getCollisionOriginTransforms();
+    const std::vector<int>& ot_id = link->areCollisionOriginTransformsIdentity();
+    const int index_co = link->getFirstCollisionBodyTransformIndex();
+    const int index_l = link->getLinkIndex();
+    for (std::size_t j = 0, end = ot.size(); j != end; ++j)
     {
-      const EigenSTL::vector_Isometry3d& ot = link->getCollisionOriginTransforms();
-      const std::vector<int>& ot_id = link->areCollisionOriginTransformsIdentity();
-      const int index_co = link->getFirstCollisionBodyTransformIndex();
-      const int index_l = link->getLinkIndex();
-      for (std::size_t j = 0, end = ot.size(); j != end; ++j)
-      {
-        if (ot_id[j])
-          global_collision_body_transforms_[index_co + j] = global_link_transforms_[index_l];
-        else
-          global_collision_body_transforms_[index_co + j].affine().noalias() =
-              global_link_transforms_[index_l].affine() * ot[j].matrix();
-      }
+      if (ot_id[j])
+        global_collision_body_transforms_[index_co + j] = global_link_transforms_[index_l];
+      else
+        global_collision_body_transforms_[index_co + j].affine().noalias() =
+            global_link_transforms_[index_l].affine() * ot[j].matrix();
     }
   }
 }
@@ -652,13 +672,25 @@ void RobotState::updateLinkTransforms()
 {
   if (dirty_link_transforms_ != nullptr)
   {
-    updateLinkTransformsInternal(dirty_link_transforms_);
-    if (dirty_collision_body_transforms_)
-      dirty_collision_body_transforms_ =
-          robot_model_->getCommonRoot(dirty_collision_body_transforms_, dirty_link_transforms_);
+    // only recompute the subtrees below modified joints, if they are known
+    if (dirty_link_subtrees_.count == 0)
+    {
+      updateLinkTransformsInternal(dirty_link_transforms_);
+      addDirtySubtree(dirty_link_transforms_, dirty_collision_body_transforms_, dirty_collision_body_subtrees_);
+    }
     else
-      dirty_collision_body_transforms_ = dirty_link_transforms_;
+      for (unsigned int i = 0; i < dirty_link_subtrees_.count; ++i)
+      {
+        updateLinkTransformsInternal(dirty_link_subtrees_.roots[i]);
+        addDirtySubtree(dirty_link_subtrees_.roots[i], dirty_collision_body_transforms_,
+                        dirty_collision_body_subtrees_);
+      }
     dirty_link_transforms_ = nullptr;
+    dirty_link_subtrees_.count = 0;
+
+    // update attached bodies tf; these are usually very few, so we update them all
+    for (const std::pair<const std::string, AttachedBody*>& it : attached_body_map_)
+      it.second->computeTransform(global_link_transforms_[it.second->getAttachedLink()->getLinkIndex()]);
   }
 }
 
@@ -694,11 +726,6 @@ void RobotState::updateLinkTransformsInternal(const JointModel* start)
             link->getJointOriginTransform().affine() * getJointTransform(link->getParentJointModel()).matrix();
     }
   }
-
-  // update attached bodies tf; these are usually very few, so we update them all
-  for (std::map<std::string, AttachedBody*>::const_iterator it = attached_body_map_.begin();
-       it != attached_body_map_.end(); ++it)
-    it->second->computeTransform(global_link_transforms_[it->second->getAttachedLink()->getLinkIndex()]);
 }
 
 void RobotState::updateStateWithLinkAt(const LinkModel* link, const Eigen::Isometry3d& transform, bool backward)
@@ -706,11 +733,7 @@ void RobotState::updateStateWithLinkAt(const LinkModel* link, const Eigen::Isome
   updateLinkTransforms();  // no link transforms must be dirty, otherwise the transform we set will be overwritten
 
   // update the fact that collision body transforms are out of date
-  if (dirty_collision_body_transforms_)
-    dirty_collision_body_transforms_ =
-        robot_model_->getCommonRoot(dirty_collision_body_transforms_, link->getParentJointModel());
-  else
-    dirty_collision_body_transforms_ = link->getParentJointModel();
+  addDirtySubtree(link->getParentJointModel(), dirty_collision_body_transforms_, dirty_collision_body_subtrees_);
 
   global_link_transforms_[link->getLinkIndex()] = transform;
 
@@ -745,6 +768,7 @@ void RobotState::updateStateWithLinkAt(const LinkModel* link, const Eigen::Isome
     }
     // all collision body transforms are invalid now
     dirty_collision_body_transforms_ = parent_link->getParentJointModel();
+    dirty_collision_body_subtrees_.count = 0;
   }
 
   // update attached bodies tf; these are usually very few, so we update them all
@@ -882,6 +906,7 @@ void RobotState::interpolate(const RobotState& to, double t, RobotState& state)
 
   memset(state.dirty_joint_transforms_, 1, state.robot_model_->getJointModelCount() * sizeof(unsigned char));
   state.dirty_link_transforms_ = state.robot_model_->getRootJoint();
+  state.dirty_link_subtrees_.count = 0;
 }
 
 void RobotState::interpolate(const RobotState& to, double t, RobotState& state,
@@ -1224,108 +1249,54 @@ Eigen::MatrixXd RobotState::getJacobian(const JointModelGroup* group,
 bool RobotState::getJacobian(const JointModelGroup* group, const LinkModel* link,
                              const Eigen::Vector3d& reference_point_position, Eigen::MatrixXd& jacobian,
                              bool use_quaternion_representation) const
+{
+  jacobian.resize(use_quaternion_representation ? 7 : 6, group->getVariableCount());
+  return getJacobian(group, link, reference_point_position, Eigen::Ref<Eigen::MatrixXd>(jacobian),
+                     use_quaternion_representation);
+}
+
+bool RobotState::getJacobian(const JointModelGroup* group, const LinkModel* link,
+                             const Eigen::Vector3d& reference_point_position, Eigen::Ref<Eigen::MatrixXd> jacobian,
+                             bool use_quaternion_representation) const
 {
   BOOST_VERIFY(checkLinkTransforms());
+  return computeJacobian(group, link, reference_point_position,
+                         [this](const LinkModel* l) -> const Eigen::Isometry3d& { return getGlobalLinkTransform(l); },
+                         jacobian, use_quaternion_representation);
+}
 
-  if (!group->isChain())
+bool RobotState::getJacobians(const JointModelGroup* group, const std::vector<const LinkModel*>& links,
+                              const EigenSTL::vector_Vector3d& reference_point_positions,
+                              Eigen::Ref<Eigen::MatrixXd> jacobians, bool use_quaternion_representation) const
+{
+  const int rows = use_quaternion_representation ? 7 : 6;
+  if (links.size() != reference_point_positions.size() ||
+      jacobians.rows() != static_cast<Eigen::Index>(rows * links.size()))
   {
-    ROS_ERROR_NAMED(LOGNAME, "The group '%s' is not a chain. Cannot compute Jacobian.", group->getName().c_str());
+    ROS_ERROR_NAMED(LOGNAME, "Number of links, reference points and Jacobian rows do not match");
     return false;
   }
+  for (std::size_t i = 0; i < links.size(); ++i)
+    if (!getJacobian(group, links[i], reference_point_positions[i], jacobians.middleRows(i * rows, rows),
+                     use_quaternion_representation))
+      return false;
+  return true;
+}
 
-  if (!group->isLinkUpdated(link->getName()))
+bool RobotState::getJacobianDerivative(const JointModelGroup* group, const LinkModel* link,
+                                       const Eigen::Vector3d& reference_point_position,
+                                       Eigen::Ref<Eigen::MatrixXd> jacobian_derivative) const
+{
+  BOOST_VERIFY(checkLinkTransforms());
+  if (!has_velocity_)
   {
-    ROS_ERROR_NAMED(LOGNAME, "Link name '%s' does not exist in the chain '%s' or is not a child for this chain",
-                    link->getName().c_str(), group->getName().c_str());
+    ROS_ERROR_NAMED(LOGNAME, "The Jacobian derivative requires variable velocities to be set");
     return false;
   }
-
-  const moveit::core::JointModel* root_joint_model = group->getJointModels()[0];  // group->getJointRoots()[0];
-  const moveit::core::LinkModel* root_link_model = root_joint_model->getParentLinkModel();
-  Eigen::Isometry3d reference_transform =
-      root_link_model ? getGlobalLinkTransform(root_link_model).inverse() : Eigen::Isometry3d::Identity();
-  int rows = use_quaternion_representation ? 7 : 6;
-  int columns = group->getVariableCount();
-  jacobian = Eigen::MatrixXd::Zero(rows, columns);
-
-  Eigen::Isometry3d link_transform = reference_transform * getGlobalLinkTransform(link);
-  Eigen::Vector3d point_transform = link_transform * reference_point_position;
-
-  /*
-  ROS_DEBUG_NAMED(LOGNAME, "Point from reference origin expressed in world coordinates: %f %f %f",
-           point_transform.x(),
-           point_transform.y(),
-           point_transform.z());
-  */
-
-  Eigen::Vector3d joint_axis;
-  Eigen::Isometry3d joint_transform;
-
-  while (link)
-  {
-    /*
-    ROS_DEBUG_NAMED(LOGNAME, "Link: %s, %f %f %f",link_state->getName().c_str(),
-             link_state->getGlobalLinkTransform().translation().x(),
-             link_state->getGlobalLinkTransform().translation().y(),
-             link_state->getGlobalLinkTransform().translation().z());
-    ROS_DEBUG_NAMED(LOGNAME, "Joint: %s",link_state->getParentJointState()->getName().c_str());
-    */
-    const JointModel* pjm = link->getParentJointModel();
-    if (pjm->getVariableCount() > 0)
-    {
-      if (!group->hasJointModel(pjm->getName()))
-      {
-        link = pjm->getParentLinkModel();
-        continue;
-      }
-      unsigned int joint_index = group->getVariableGroupIndex(pjm->getName());
-      if (pjm->getType() == moveit::core::JointModel::REVOLUTE)
-      {
-        joint_transform = reference_transform * getGlobalLinkTransform(link);
-        joint_axis = joint_transform.rotation() * static_cast<const moveit::core::RevoluteJointModel*>(pjm)->getAxis();
-        jacobian.block<3, 1>(0, joint_index) =
-            jacobian.block<3, 1>(0, joint_index) + joint_axis.cross(point_transform - joint_transform.translation());
-        jacobian.block<3, 1>(3, joint_index) = jacobian.block<3, 1>(3, joint_index) + joint_axis;
-      }
-      else if (pjm->getType() == moveit::core::JointModel::PRISMATIC)
-      {
-        joint_transform = reference_transform * getGlobalLinkTransform(link);
-        joint_axis = joint_transform.rotation() * static_cast<const moveit::core::PrismaticJointModel*>(pjm)->getAxis();
-        jacobian.block<3, 1>(0, joint_index) = jacobian.block<3, 1>(0, joint_index) + joint_axis;
-      }
-      else if (pjm->getType() == moveit::core::JointModel::PLANAR)
-      {
-        joint_transform = reference_transform * getGlobalLinkTransform(link);
-        joint_axis = joint_transform * Eigen::Vector3d(1.0, 0.0, 0.0);
-        jacobian.block<3, 1>(0, joint_index) = jacobian.block<3, 1>(0, joint_index) + joint_axis;
-        joint_axis = joint_transform * Eigen::Vector3d(0.0, 1.0, 0.0);
-        jacobian.block<3, 1>(0, joint_index + 1) = jacobian.block<3, 1>(0, joint_index + 1) + joint_axis;
-        joint_axis = joint_transform * Eigen::Vector3d(0.0, 0.0, 1.0);
-        jacobian.block<3, 1>(0, joint_index + 2) = jacobian.block<3, 1>(0, joint_index + 2) +
-                                                   joint_axis.cross(point_transform - joint_transform.translation());
-        jacobian.block<3, 1>(3, joint_index + 2) = jacobian.block<3, 1>(3, joint_index + 2) + joint_axis;
-      }
-      else
-        ROS_ERROR_NAMED(LOGNAME, "Unknown type of joint in Jacobian computation");
-    }
-    if (pjm == root_joint_model)
-      break;
-    link = pjm->getParentLinkModel();
-  }
-  if (use_quaternion_representation)
-  {  // Quaternion representation
-    // From "Advanced Dynamics and Motion Simulation" by Paul Mitiguy
-    // d/dt ( [w] ) = 1/2 * [ -x -y -z ]  * [ omega_1 ]
-    //        [x]           [  w -z  y ]    [ omega_2 ]
-    //        [y]           [  z  w -x ]    [ omega_3 ]
-    //        [z]           [ -y  x  w ]
-    Eigen::Quaterniond q(link_transform.rotation());
-    double w = q.w(), x = q.x(), y = q.y(), z = q.z();
-    Eigen::MatrixXd quaternion_update_matrix(4, 3);
-    quaternion_update_matrix << -x, -y, -z, w, -z, y, z, w, -x, -y, x, w;
-    jacobian.block(3, 0, 4, columns) = 0.5 * quaternion_update_matrix * jacobian.block(3, 0, 3, columns);
-  }
-  return true;
+  return computeJacobianDerivative(
+      group, link, reference_point_position,
+      [this](const LinkModel* l) -> const Eigen::Isometry3d& { return getGlobalLinkTransform(l); }, velocity_,
+      jacobian_derivative);
 }
 
 bool RobotState::setFromDiffIK(const JointModelGroup* jmg, const Eigen::VectorXd& twist, const std::string& tip,
@@ -0,0 +1,242 @@
+/*********************************************************************
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2020, PickNik LLC.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the copyright holder nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************/
+
+#include <moveit/robot_state/robot_state_batch.h>
+#include "jacobian.inc"
+
+namespace moveit
+{
+namespace core
+{
+RobotStateBatch::RobotStateBatch(const RobotModelConstPtr& robot_model, std::size_t size)
+  : robot_model_(robot_model), size_(0), use_kernel_(true), dirty_(true)
+{
+  std::size_t max_joint_variables = 0;
+  for (const JointModel* jm : robot_model_->getJointModels())
+    max_joint_variables = std::max(max_joint_variables, jm->getVariableCount());
+  joint_values_.resize(max_joint_variables);
+  resize(size);
+}
+
+void RobotStateBatch::resize(std::size_t size)
+{
+  if (size == size_)
+    return;
+
+  const std::size_t variable_count = robot_model_->getVariableCount();
+  std::vector<double> defaults(variable_count);
+  robot_model_->getVariableDefaultPositions(defaults.data());
+
+  // re-layout positions, as the stride between variables changes with the batch size
+  std::vector<double> positions(variable_count * size);
+  const std::size_t keep = std::min(size, size_);
+  for (std::size_t v = 0; v < variable_count; ++v)
+  {
+    std::copy(positions_.begin() + v * size_, positions_.begin() + v * size_ + keep, positions.begin() + v * size);
+    std::fill(positions.begin() + v * size + keep, positions.begin() + (v + 1) * size, defaults[v]);
+  }
+  positions_.swap(positions);
+  size_ = size;
+
+  // transforms are recomputed on the next update anyway; the last row is never modified by updates
+  joint_transforms_.assign(robot_model_->getJointModelCount() * size_, Eigen::Isometry3d::Identity());
+  global_link_transforms_.assign(robot_model_->getLinkModelCount() * size_, Eigen::Isometry3d::Identity());
+  dirty_ = true;
+}
+
+void RobotStateBatch::setStatePositions(std::size_t state, const double* positions)
+{
+  for (std::size_t v = 0, end = robot_model_->getVariableCount(); v < end; ++v)
+    positions_[v * size_ + state] = positions[v];
+  dirty_ = true;
+}
+
+void RobotStateBatch::copyStatePositions(std::size_t state, double* positions) const
+{
+  for (std::size_t v = 0, end = robot_model_->getVariableCount(); v < end; ++v)
+    positions[v] = positions_[v * size_ + state];
+}
+
+void RobotStateBatch::copyToState(std::size_t state, RobotState& robot_state) const
+{
+  std::vector<double> positions(robot_model_->getVariableCount());
+  copyStatePositions(state, positions.data());
+  robot_state.setVariablePositions(positions);
+}
+
+void RobotStateBatch::setToDefaultValues()
+{
+  std::vector<double> defaults(robot_model_->getVariableCount());
+  robot_model_->getVariableDefaultPositions(defaults.data());
+  for (std::size_t v = 0; v < defaults.size(); ++v)
+    std::fill(positions_.begin() + v * size_, positions_.begin() + (v + 1) * size_, defaults[v]);
+  dirty_ = true;
+}
+
+void RobotStateBatch::setToRandomPositions(random_numbers::RandomNumberGenerator& rng)
+{
+  std::vector<double> values(robot_model_->getVariableCount());
+  for (std::size_t i = 0; i < size_; ++i)
+  {
+    robot_model_->getVariableRandomPositions(rng, values.data());
+    setStatePositions(i, values.data());
+  }
+}
+
+void RobotStateBatch::updateMimicJoints()
+{
+  for (const JointModel* jm : robot_model_->getMimicJointModels())
+  {
+    const double* src = &positions_[jm->getMimic()->getFirstVariableIndex() * size_];
+    double* dest = &positions_[jm->getFirstVariableIndex() * size_];
+    const double factor = jm->getMimicFactor();
+    const double offset = jm->getMimicOffset();
+    for (std::size_t i = 0; i < size_; ++i)
+      dest[i] = factor * src[i] + offset;
+  }
+  dirty_ = true;
+}
+
+void RobotStateBatch::updateJointTransforms()
+{
+  for (const JointModel* jm : robot_model_->getJointModels())
+  {
+    Eigen::Isometry3d* transforms = &joint_transforms_[jm->getJointIndex() * size_];
+    const std::size_t nvars = jm->getVariableCount();
+    const double* positions = &positions_[jm->getFirstVariableIndex() * size_];
+    if (nvars == 0)
+    {
+      // fixed joints don't depend on the state: compute once and replicate
+      if (size_ > 0)
+      {
+        jm->computeTransform(nullptr, transforms[0]);
+        std::fill(transforms + 1, transforms + size_, transforms[0]);
+      }
+    }
+    else if (nvars == 1)
+    {
+      // the positions of a single-DOF joint are already laid out contiguously
+      for (std::size_t i = 0; i < size_; ++i)
+        jm->computeTransform(positions + i, transforms[i]);
+    }
+    else
+    {
+      for (std::size_t i = 0; i < size_; ++i)
+      {
+        for (std::size_t v = 0; v < nvars; ++v)
+          joint_values_[v] = positions[v * size_ + i];
+        jm->computeTransform(joint_values_.data(), transforms[i]);
+      }
+    }
+  }
+}
+
+void RobotStateBatch::updateLinkTransforms()
+{
+  if (!dirty_)
+    return;
+  dirty_ = false;
+
+  if (use_kernel_)
+  {
+    robot_model_->getForwardKinematicsKernel().computeLinkTransforms(positions_.data(), size_,
+                                                                     global_link_transforms_.data());
+    return;
+  }
+
+  updateJointTransforms();
+
+  // same composition rules as RobotState::updateLinkTransformsInternal(), but iterating all states per link
+  for (const LinkModel* link : robot_model_->getRootJoint()->getDescendantLinkModels())
+  {
+    Eigen::Isometry3d* out = &global_link_transforms_[link->getLinkIndex() * size_];
+    const Eigen::Isometry3d* joint = &joint_transforms_[link->getParentJointModel()->getJointIndex() * size_];
+    const Eigen::Isometry3d& origin = link->getJointOriginTransform();
+    const LinkModel* parent = link->getParentLinkModel();
+    if (parent)
+    {
+      const Eigen::Isometry3d* in = &global_link_transforms_[parent->getLinkIndex() * size_];
+      if (link->parentJointIsFixed())
+        for (std::size_t i = 0; i < size_; ++i)
+          out[i].affine().noalias() = in[i].affine() * origin.matrix();
+      else if (link->jointOriginTransformIsIdentity())
+        for (std::size_t i = 0; i < size_; ++i)
+          out[i].affine().noalias() = in[i].affine() * joint[i].matrix();
+      else
+        for (std::size_t i = 0; i < size_; ++i)
+          out[i].affine().noalias() = in[i].affine() * origin.matrix() * joint[i].matrix();
+    }
+    else
+    {
+      if (link->jointOriginTransformIsIdentity())
+        std::copy(joint, joint + size_, out);
+      else
+        for (std::size_t i = 0; i < size_; ++i)
+          out[i].affine().noalias() = origin.affine() * joint[i].matrix();
+    }
+  }
+}
+
+bool RobotStateBatch::getJacobian(std::size_t state, const JointModelGroup* group, const LinkModel* link,
+                                  const Eigen::Vector3d& reference_point_position, Eigen::Ref<Eigen::MatrixXd> jacobian,
+                                  bool use_quaternion_representation) const
+{
+  assert(!dirty_);
+  return computeJacobian(group, link, reference_point_position,
+                         [this, state](const LinkModel* l) -> const Eigen::Isometry3d& {
+                           return global_link_transforms_[l->getLinkIndex() * size_ + state];
+                         },
+                         jacobian, use_quaternion_representation);
+}
+
+bool RobotStateBatch::getJacobians(const JointModelGroup* group, const LinkModel* link,
+                                   const Eigen::Vector3d& reference_point_position, Eigen::Ref<Eigen::MatrixXd> jacobians,
+                                   bool use_quaternion_representation)
+{
+  const int rows = use_quaternion_representation ? 7 : 6;
+  if (jacobians.rows() != static_cast<Eigen::Index>(rows * size_))
+  {
+    ROS_ERROR_NAMED("robot_state", "Jacobian buffer has %d rows, expected %d for a batch of %zu states",
+                    static_cast<int>(jacobians.rows()), static_cast<int>(rows * size_), size_);
+    return false;
+  }
+  updateLinkTransforms();
+  for (std::size_t i = 0; i < size_; ++i)
+    if (!getJacobian(i, group, link, reference_point_position, jacobians.middleRows(i * rows, rows),
+                     use_quaternion_representation))
+      return false;
+  return true;
+}
+}  // namespace core
+}  // namespace moveit
@@ -0,0 +1,174 @@
+/*********************************************************************
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2020, PickNik LLC.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the copyright holder nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************/
+
+#include <moveit/robot_state/robot_state_memory_pool.h>
+#include <atomic>
+#include <cstdlib>
+#include <vector>
+
+namespace moveit
+{
+namespace core
+{
+namespace
+{
+std::atomic<bool> POOL_ENABLED(false);
+std::atomic<std::size_t> POOL_CAPACITY(64);
+
+// set when the calling thread's cache was destroyed, e.g. for states destroyed during static destruction
+thread_local bool THREAD_CACHE_DESTROYED = false;
+
+/* Free blocks cached by one thread, grouped by size, and the thread's counters. Usually all states of a process
+   share one or two robot models, so a linear search over the sizes is sufficient. */
+struct ThreadCache
+{
+  struct Bucket
+  {
+    std::size_t bytes;
+    std::vector<void*> blocks;
+  };
+
+  ThreadCache() : size(0)
+  {
+  }
+
+  ~ThreadCache()
+  {
+    THREAD_CACHE_DESTROYED = true;
+    clear();
+  }
+
+  void clear()
+  {
+    for (Bucket& bucket : buckets)
+      for (void* block : bucket.blocks)
+        free(block);
+    buckets.clear();
+    size = 0;
+  }
+
+  Bucket& getBucket(std::size_t bytes)
+  {
+    for (Bucket& bucket : buckets)
+      if (bucket.bytes == bytes)
+        return bucket;
+    buckets.push_back(Bucket{ bytes, std::vector<void*>() });
+    return buckets.back();
+  }
+
+  std::vector<Bucket> buckets;
+  std::size_t size;
+  RobotStateMemoryPool::Statistics stats;
+};
+
+ThreadCache* getThreadCache()
+{
+  if (THREAD_CACHE_DESTROYED)
+    return nullptr;
+  static thread_local ThreadCache cache;
+  return &cache;
+}
+}  // namespace
+
+void RobotStateMemoryPool::setEnabled(bool enabled)
+{
+  POOL_ENABLED = enabled;
+}
+
+bool RobotStateMemoryPool::isEnabled()
+{
+  return POOL_ENABLED;
+}
+
+void RobotStateMemoryPool::setCapacity(std::size_t capacity)
+{
+  POOL_CAPACITY = capacity;
+}
+
+std::size_t RobotStateMemoryPool::getCapacity()
+{
+  return POOL_CAPACITY;
+}
+
+RobotStateMemoryPool::Statistics RobotStateMemoryPool::getStatistics()
+{
+  const ThreadCache* cache = getThreadCache();
+  return cache ? cache->stats : Statistics();
+}
+
+void RobotStateMemoryPool::clearThreadCache()
+{
+  if (ThreadCache* cache = getThreadCache())
+    cache->clear();
+}
+
+void* RobotStateMemoryPool::allocate(std::size_t bytes)
+{
+  ThreadCache* cache = POOL_ENABLED.load(std::memory_order_relaxed) ? getThreadCache() : nullptr;
+  if (!cache)
+    return malloc(bytes);
+  ++cache->stats.allocations;
+  ThreadCache::Bucket& bucket = cache->getBucket(bytes);
+  if (!bucket.blocks.empty())
+  {
+    void* block = bucket.blocks.back();
+    bucket.blocks.pop_back();
+    --cache->size;
+    ++cache->stats.recycled;
+    return block;
+  }
+  return malloc(bytes);
+}
+
+void RobotStateMemoryPool::release(void* memory, std::size_t bytes)
+{
+  if (!memory)
+    return;
+  ThreadCache* cache = POOL_ENABLED.load(std::memory_order_relaxed) ? getThreadCache() : nullptr;
+  if (!cache)
+  {
+    free(memory);
+    return;
+  }
+  ++cache->stats.releases;
+  if (cache->size < POOL_CAPACITY.load(std::memory_order_relaxed))
+  {
+    cache->getBucket(bytes).blocks.push_back(memory);
+    ++cache->size;
+    return;
+  }
+  free(memory);
+}
+}  // namespace core
+}  // namespace moveit
@@ -35,6 +35,7 @@
 /* Author: Robert Haschke */
 #include <moveit/robot_model/robot_model.h>
 #include <moveit/robot_state/robot_state.h>
+#include <moveit/robot_state/robot_state_batch.h>
 #include <moveit/utils/robot_model_test_utils.h>
 #include <eigen_stl_containers/eigen_stl_containers.h>
 #include <gtest/gtest.h>
@@ -106,6 +107,93 @@ TEST_F(Timing, stateUpdate)
   }
 }
 
+// Compare updates after modifying joints on separate branches of the kinematic tree to a full update
+TEST_F(Timing, partialUpdate)
+{
+  moveit::core::RobotModelPtr model = moveit::core::loadTestingRobotModel("pr2_description");
+  ASSERT_TRUE(bool(model));
+  moveit::core::RobotState state(model);
+  state.setToDefaultValues();
+  state.update();
+  const int r_arm = model->getVariableIndex("r_shoulder_pan_joint");
+  const int l_arm = model->getVariableIndex("l_shoulder_pan_joint");
+  const int head = model->getVariableIndex("head_pan_joint");
+  const int torso = model->getVariableIndex("torso_lift_joint");
+  const unsigned runs = 1e5;
+  double gold_standard = 0;
+  {
+    ScopedTimer t("Full update: ", &gold_standard);
+    for (unsigned i = 0; i < runs; ++i)
+      state.update(true);
+  }
+  {
+    // dual-arm: both arms have the torso as common root, but only the arm subtrees need an update
+    ScopedTimer t("Dual-arm update: ", &gold_standard);
+    for (unsigned i = 0; i < runs; ++i)
+    {
+      state.setVariablePosition(r_arm, i * 1e-6);
+      state.setVariablePosition(l_arm, -(i * 1e-6));
+      state.update();
+    }
+  }
+  {
+    // mobile manipulator: arm and head (sensor) moving, torso and base fixed
+    ScopedTimer t("Arm + head update: ", &gold_standard);
+    for (unsigned i = 0; i < runs; ++i)
+    {
+      state.setVariablePosition(r_arm, i * 1e-6);
+      state.setVariablePosition(head, i * 1e-6);
+      state.update();
+    }
+  }
+  {
+    ScopedTimer t("Torso update: ", &gold_standard);
+    for (unsigned i = 0; i < runs; ++i)
+    {
+      state.setVariablePosition(torso, 0.1 + i * 1e-8);
+      state.update();
+    }
+  }
+}
+
+TEST_F(Timing, batchUpdate)
+{
+  moveit::core::RobotModelPtr model = moveit::core::loadTestingRobotModel("pr2_description");
+  ASSERT_TRUE(bool(model));
+  const std::size_t batch_size = 1000;
+  const std::size_t runs = 100;
+  random_numbers::RandomNumberGenerator rng(0);
+  double gold_standard = 0;
+  {
+    moveit::core::RobotState state(model);
+    ScopedTimer t("RobotState updates: ", &gold_standard);
+    for (unsigned i = 0; i < runs * batch_size; ++i)
+    {
+      state.setToRandomPositions();
+      state.updateLinkTransforms();
+    }
+  }
+  moveit::core::RobotStateBatch batch(model, batch_size);
+  {
+    batch.setUseForwardKinematicsKernel(false);
+    ScopedTimer t("RobotStateBatch updates (scalar): ", &gold_standard);
+    for (unsigned i = 0; i < runs; ++i)
+    {
+      batch.setToRandomPositions(rng);
+      batch.updateLinkTransforms();
+    }
+  }
+  {
+    batch.setUseForwardKinematicsKernel(true);
+    ScopedTimer t("RobotStateBatch updates (kernel): ", &gold_standard);
+    for (unsigned i = 0; i < runs; ++i)
+    {
+      batch.setToRandomPositions(rng);
+      batch.updateLinkTransforms();
+    }
+  }
+}
+
 TEST_F(Timing, multiply)
 {
   size_t runs = 1e7;
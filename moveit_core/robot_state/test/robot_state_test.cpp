@@ -35,6 +35,7 @@
 /* Author: Ioan Sucan */
 #include <moveit/robot_model/robot_model.h>
 #include <moveit/robot_state/robot_state.h>
+#include <moveit/robot_state/conversions.h>
 #include <moveit/utils/robot_model_test_utils.h>
 #include <urdf_parser/urdf_parser.h>
 #include <tf2_geometry_msgs/tf2_geometry_msgs.h>
@@ -560,6 +561,85 @@ TEST_F(OneRobot, testPrintCurrentPositionWithJointLimits)
   state.printStatePositionsWithJointLimits(joint_model_group);
 }
 
+TEST_F(OneRobot, BinarySnapshot)
+{
+  moveit::core::RobotState state(robot_model_);
+  random_numbers::RandomNumberGenerator rng(42);
+  state.setToDefaultValues();
+  state.setToRandomPositions(robot_model_->getJointModelGroup("base_from_base_to_e"), rng);
+  state.setVariableVelocity("joint_f", 0.5);
+
+  // full precision round trip, including velocities
+  std::vector<std::uint8_t> buffer;
+  moveit::core::robotStateToSnapshot(state, buffer, false, true);
+  moveit::core::RobotStateSnapshotView view(buffer.data(), buffer.size());
+  ASSERT_TRUE(view.isValid());
+  EXPECT_TRUE(view.isCompatible(*robot_model_));
+  EXPECT_TRUE(view.hasVelocities());
+  EXPECT_FALSE(view.isQuantized());
+  ASSERT_EQ(view.getVariableCount(), state.getVariableCount());
+  ASSERT_NE(view.getVariablePositions(), nullptr);
+
+  moveit::core::RobotState restored(robot_model_);
+  restored.setToDefaultValues();
+  ASSERT_TRUE(moveit::core::snapshotToRobotState(buffer.data(), buffer.size(), restored));
+  for (std::size_t i = 0; i < state.getVariableCount(); ++i)
+  {
+    EXPECT_EQ(view.getVariablePosition(i), state.getVariablePosition(i));
+    EXPECT_EQ(restored.getVariablePosition(i), state.getVariablePosition(i));
+    EXPECT_EQ(restored.getVariableVelocity(i), state.getVariableVelocity(i));
+  }
+
+  // quantized snapshots are smaller and approximately restore the state
+  std::vector<std::uint8_t> quantized;
+  moveit::core::robotStateToSnapshot(state, quantized, true);
+  EXPECT_LT(quantized.size(), buffer.size());
+  moveit::core::RobotStateSnapshotView quantized_view(quantized.data(), quantized.size());
+  ASSERT_TRUE(quantized_view.isValid());
+  EXPECT_TRUE(quantized_view.isQuantized());
+  EXPECT_FALSE(quantized_view.hasVelocities());
+  EXPECT_EQ(quantized_view.getVariablePositions(), nullptr);
+  ASSERT_TRUE(quantized_view.copyToRobotState(restored));
+  for (std::size_t i = 0; i < state.getVariableCount(); ++i)
+    EXPECT_NEAR(restored.getVariablePosition(i), state.getVariablePosition(i), 1e-6);
+
+  // truncated buffers and states of different models are rejected
+  EXPECT_FALSE(moveit::core::RobotStateSnapshotView(buffer.data(), buffer.size() - 1).isValid());
+  EXPECT_FALSE(moveit::core::RobotStateSnapshotView(buffer.data(), 10).isValid());
+  moveit::core::RobotState other(moveit::core::loadTestingRobotModel("panda"));
+  EXPECT_NE(other.getRobotModel()->getVariableLayoutHash(), robot_model_->getVariableLayoutHash());
+  EXPECT_FALSE(view.isCompatible(*other.getRobotModel()));
+  EXPECT_FALSE(moveit::core::snapshotToRobotState(buffer.data(), buffer.size(), other));
+}
+
+TEST_F(OneRobot, JointStateLayout)
+{
+  sensor_msgs::JointState msg;
+  msg.name = { "joint_f", "unknown_joint", "joint_a" };
+  msg.position = { 0.2, 5.0, 0.3 };
+  msg.velocity = { 0.1, 5.0, -0.1 };
+
+  moveit::core::JointStateLayout layout(*robot_model_, msg.name);
+  EXPECT_TRUE(layout.matches(msg.name));
+  EXPECT_FALSE(layout.isComplete());
+  EXPECT_EQ(layout.getVariableIndices()[1], -1);
+
+  moveit::core::RobotState state(robot_model_);
+  state.setToDefaultValues();
+  ASSERT_TRUE(moveit::core::jointStateToRobotState(msg, layout, state));
+  EXPECT_EQ(state.getVariablePosition("joint_f"), 0.2);
+  EXPECT_EQ(state.getVariablePosition("joint_a"), 0.3);
+  EXPECT_EQ(state.getVariableVelocity("joint_a"), -0.1);
+  // mimic joints are updated as well
+  EXPECT_NEAR(state.getVariablePosition("mim_f"), 1.5 * 0.2 + 0.1, 1e-12);
+
+  // messages that don't fit the layout are rejected
+  msg.position.pop_back();
+  EXPECT_FALSE(moveit::core::jointStateToRobotState(msg, layout, state));
+  msg.name.pop_back();
+  EXPECT_FALSE(layout.matches(msg.name));
+}
+
 int main(int argc, char** argv)
 {
   testing::InitGoogleTest(&argc, argv);
@@ -276,6 +276,100 @@ TEST_F(LoadPlanningModelsPr2, FullTest)
   ASSERT_EQ(attached_bodies_2.size(), 0u);
 }
 
+TEST_F(LoadPlanningModelsPr2, DirtySubtrees)
+{
+  moveit::core::RobotState state(robot_model_);
+  state.setToDefaultValues();
+  state.update();
+
+  // modify joints on separate branches and of an entire group, then compare with a full update
+  random_numbers::RandomNumberGenerator rng(1);
+  state.setToRandomPositions(robot_model_->getJointModelGroup("left_arm"), rng);
+  state.setVariablePosition("r_shoulder_pan_joint", 0.3);
+  state.setVariablePosition("r_elbow_flex_joint", -0.5);
+  state.setVariablePosition("head_pan_joint", 0.2);
+  EXPECT_TRUE(state.dirtyLinkTransforms());
+  state.update();
+  EXPECT_FALSE(state.dirty());
+
+  moveit::core::RobotState reference(state);
+  reference.update(true);
+  for (const moveit::core::LinkModel* link : robot_model_->getLinkModels())
+  {
+    EXPECT_TRUE(state.getGlobalLinkTransform(link).isApprox(reference.getGlobalLinkTransform(link)))
+        << link->getName();
+    for (std::size_t i = 0; i < link->getShapes().size(); ++i)
+      EXPECT_TRUE(state.getCollisionBodyTransform(link, i).isApprox(reference.getCollisionBodyTransform(link, i)))
+          << link->getName();
+  }
+
+  // more dirty subtrees than tracked individually fall back to their common root
+  const char* joints[] = { "r_shoulder_pan_joint", "l_shoulder_pan_joint", "head_pan_joint", "laser_tilt_mount_joint",
+                           "fl_caster_rotation_joint" };
+  for (const char* joint : joints)
+    state.setVariablePosition(joint, state.getVariablePosition(joint) + 0.01);
+  moveit::core::RobotState copy(state);
+  state.update();
+  copy.update(true);
+  for (const moveit::core::LinkModel* link : robot_model_->getLinkModels())
+    EXPECT_TRUE(state.getGlobalLinkTransform(link).isApprox(copy.getGlobalLinkTransform(link))) << link->getName();
+}
+
+TEST_F(LoadPlanningModelsPr2, JacobianBuffersAndDerivative)
+{
+  const moveit::core::JointModelGroup* group = robot_model_->getJointModelGroup("right_arm");
+  const moveit::core::LinkModel* tip = robot_model_->getLinkModel("r_wrist_roll_link");
+  const moveit::core::LinkModel* elbow = robot_model_->getLinkModel("r_elbow_flex_link");
+  const Eigen::Vector3d point(0.1, 0.0, 0.05);
+  const int columns = group->getVariableCount();
+
+  moveit::core::RobotState state(robot_model_);
+  state.setToDefaultValues();
+  random_numbers::RandomNumberGenerator rng(3);
+  state.setToRandomPositions(group, rng);
+  state.update();
+
+  // writing into caller-provided memory gives the same result as the allocating version
+  Eigen::MatrixXd jacobian;
+  ASSERT_TRUE(state.getJacobian(group, tip, point, jacobian));
+  std::vector<double> buffer(6 * columns);
+  Eigen::Map<Eigen::MatrixXd> mapped(buffer.data(), 6, columns);
+  ASSERT_TRUE(state.getJacobian(group, tip, point, mapped));
+  EXPECT_TRUE(mapped.isApprox(jacobian));
+  Eigen::MatrixXd wrong_size(6, columns + 1);
+  EXPECT_FALSE(state.getJacobian(group, tip, point, Eigen::Ref<Eigen::MatrixXd>(wrong_size)));
+
+  // several links at once
+  Eigen::MatrixXd stacked(12, columns);
+  ASSERT_TRUE(state.getJacobians(group, { tip, elbow }, { point, Eigen::Vector3d::Zero() }, stacked));
+  Eigen::MatrixXd elbow_jacobian;
+  ASSERT_TRUE(state.getJacobian(group, elbow, Eigen::Vector3d::Zero(), elbow_jacobian));
+  EXPECT_TRUE(stacked.topRows(6).isApprox(jacobian));
+  EXPECT_TRUE(stacked.bottomRows(6).isApprox(elbow_jacobian));
+
+  // the derivative matches central differences along the joint velocities
+  Eigen::VectorXd positions, velocities(columns);
+  state.copyJointGroupPositions(group, positions);
+  for (int i = 0; i < columns; ++i)
+    velocities[i] = rng.uniformReal(-1.0, 1.0);
+  state.setJointGroupVelocities(group, velocities);
+  Eigen::MatrixXd derivative(6, columns);
+  ASSERT_TRUE(state.getJacobianDerivative(group, tip, point, derivative));
+
+  const double h = 1e-6;
+  moveit::core::RobotState displaced(state);
+  Eigen::MatrixXd jacobian_plus, jacobian_minus;
+  displaced.setJointGroupPositions(group, positions + h * velocities);
+  displaced.update();
+  ASSERT_TRUE(displaced.getJacobian(group, tip, point, jacobian_plus));
+  displaced.setJointGroupPositions(group, positions - h * velocities);
+  displaced.update();
+  ASSERT_TRUE(displaced.getJacobian(group, tip, point, jacobian_minus));
+  EXPECT_TRUE(derivative.isApprox((jacobian_plus - jacobian_minus) / (2 * h), 1e-5))
+      << derivative << "\n\n"
+      << (jacobian_plus - jacobian_minus) / (2 * h);
+}
+
 int main(int argc, char** argv)
 {
   testing::InitGoogleTest(&argc, argv);
@@ -0,0 +1,177 @@
+/*********************************************************************
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2020, PickNik LLC.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the copyright holder nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************/
+
+#include <moveit/robot_model/robot_model.h>
+#include <moveit/robot_state/robot_state.h>
+#include <moveit/robot_state/robot_state_batch.h>
+#include <moveit/utils/robot_model_test_utils.h>
+#include <gtest/gtest.h>
+
+class RobotStateBatchTest : public testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    robot_model_ = moveit::core::loadTestingRobotModel("pr2");
+  }
+
+  moveit::core::RobotModelPtr robot_model_;
+};
+
+TEST_F(RobotStateBatchTest, PositionsRoundTrip)
+{
+  moveit::core::RobotStateBatch batch(robot_model_, 5);
+  moveit::core::RobotState state(robot_model_);
+  random_numbers::RandomNumberGenerator rng(42);
+
+  state.setToRandomPositions(robot_model_->getJointModelGroup("right_arm"), rng);
+  batch.setState(3, state);
+
+  moveit::core::RobotState copy(robot_model_);
+  copy.setToDefaultValues();
+  batch.copyToState(3, copy);
+  for (std::size_t v = 0; v < robot_model_->getVariableCount(); ++v)
+  {
+    EXPECT_EQ(state.getVariablePosition(v), copy.getVariablePosition(v));
+    EXPECT_EQ(state.getVariablePosition(v), batch.getVariablePosition(3, v));
+    EXPECT_EQ(batch.getVariablePositions(v)[3], batch.getVariablePosition(3, v));
+  }
+
+  // resizing keeps existing states
+  batch.resize(10);
+  EXPECT_EQ(batch.size(), 10u);
+  for (std::size_t v = 0; v < robot_model_->getVariableCount(); ++v)
+    EXPECT_EQ(state.getVariablePosition(v), batch.getVariablePosition(3, v));
+}
+
+TEST_F(RobotStateBatchTest, ForwardKinematicsMatchesRobotState)
+{
+  const std::size_t n = 64;
+  moveit::core::RobotStateBatch batch(robot_model_, n);
+  random_numbers::RandomNumberGenerator rng(7);
+  batch.setToRandomPositions(rng);
+  batch.updateLinkTransforms();
+  EXPECT_FALSE(batch.dirtyLinkTransforms());
+
+  moveit::core::RobotState state(robot_model_);
+  for (std::size_t i = 0; i < n; ++i)
+  {
+    batch.copyToState(i, state);
+    state.updateLinkTransforms();
+    for (const moveit::core::LinkModel* link : robot_model_->getLinkModels())
+      EXPECT_TRUE(state.getGlobalLinkTransform(link).isApprox(batch.getGlobalLinkTransform(i, link), 1e-12))
+          << "state " << i << ", link " << link->getName();
+  }
+}
+
+TEST_F(RobotStateBatchTest, KernelMatchesScalarPath)
+{
+  // pr2 contains planar and floating joints, evaluated lane by lane, and fixed, revolute and prismatic joints
+  EXPECT_GT(robot_model_->getForwardKinematicsKernel().getScalarJointCount(), 0u);
+
+  // use a size that is not a multiple of the lane count to cover partially filled blocks
+  const std::size_t n = 3 * moveit::core::ForwardKinematicsKernel::getLaneCount() + 5;
+  moveit::core::RobotStateBatch vectorized(robot_model_, n);
+  moveit::core::RobotStateBatch scalar(robot_model_, n);
+  scalar.setUseForwardKinematicsKernel(false);
+  random_numbers::RandomNumberGenerator rng(11);
+  vectorized.setToRandomPositions(rng);
+  std::vector<double> positions(robot_model_->getVariableCount());
+  for (std::size_t i = 0; i < n; ++i)
+  {
+    vectorized.copyStatePositions(i, positions.data());
+    scalar.setStatePositions(i, positions.data());
+  }
+  vectorized.updateLinkTransforms();
+  scalar.updateLinkTransforms();
+
+  for (std::size_t i = 0; i < n; ++i)
+    for (const moveit::core::LinkModel* link : robot_model_->getLinkModels())
+    {
+      const Eigen::Isometry3d& a = vectorized.getGlobalLinkTransform(i, link);
+      const Eigen::Isometry3d& b = scalar.getGlobalLinkTransform(i, link);
+      EXPECT_TRUE(a.isApprox(b, 1e-12)) << "state " << i << ", link " << link->getName();
+      EXPECT_EQ(a.matrix().row(3), Eigen::RowVector4d(0, 0, 0, 1));
+    }
+}
+
+TEST_F(RobotStateBatchTest, MimicJoints)
+{
+  moveit::core::RobotStateBatch batch(robot_model_, 4);
+  random_numbers::RandomNumberGenerator rng(3);
+  batch.setToRandomPositions(rng);
+  for (const moveit::core::JointModel* jm : robot_model_->getMimicJointModels())
+  {
+    // scramble the mimic value; updateMimicJoints() must restore it
+    const int src = jm->getMimic()->getFirstVariableIndex();
+    const int dest = jm->getFirstVariableIndex();
+    batch.setVariablePosition(1, dest, 1e3);
+    batch.updateMimicJoints();
+    EXPECT_DOUBLE_EQ(batch.getVariablePosition(1, dest),
+                     jm->getMimicFactor() * batch.getVariablePosition(1, src) + jm->getMimicOffset());
+  }
+}
+
+TEST_F(RobotStateBatchTest, Jacobians)
+{
+  const moveit::core::JointModelGroup* group = robot_model_->getJointModelGroup("right_arm");
+  const moveit::core::LinkModel* tip = robot_model_->getLinkModel("r_wrist_roll_link");
+  const Eigen::Vector3d point(0.1, 0.0, 0.05);
+  const std::size_t n = 20;
+  const int columns = group->getVariableCount();
+
+  moveit::core::RobotStateBatch batch(robot_model_, n);
+  random_numbers::RandomNumberGenerator rng(11);
+  batch.setToRandomPositions(rng);
+
+  std::vector<double> buffer(6 * n * columns);
+  Eigen::Map<Eigen::MatrixXd> jacobians(buffer.data(), 6 * n, columns);
+  ASSERT_TRUE(batch.getJacobians(group, tip, point, jacobians));
+
+  moveit::core::RobotState state(robot_model_);
+  Eigen::MatrixXd expected;
+  for (std::size_t i = 0; i < n; ++i)
+  {
+    batch.copyToState(i, state);
+    state.update();
+    ASSERT_TRUE(state.getJacobian(group, tip, point, expected));
+    EXPECT_TRUE(jacobians.middleRows(6 * i, 6).isApprox(expected, 1e-12)) << "state " << i;
+  }
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,157 @@
+/*********************************************************************
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2020, PickNik LLC.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the copyright holder nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************/
+
+#include <moveit/robot_state/robot_state_memory_pool.h>
+#include <moveit/robot_state/robot_state.h>
+#include <moveit/utils/robot_model_test_utils.h>
+#include <gtest/gtest.h>
+#include <thread>
+
+using moveit::core::RobotStateMemoryPool;
+
+class MemoryPoolTest : public testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    RobotStateMemoryPool::setEnabled(true);
+    RobotStateMemoryPool::setCapacity(4);
+  }
+
+  void TearDown() override
+  {
+    RobotStateMemoryPool::setEnabled(false);
+    RobotStateMemoryPool::clearThreadCache();
+  }
+};
+
+TEST_F(MemoryPoolTest, RecyclesBlocks)
+{
+  RobotStateMemoryPool::Statistics start = RobotStateMemoryPool::getStatistics();
+  void* a = RobotStateMemoryPool::allocate(128);
+  RobotStateMemoryPool::release(a, 128);
+  // a block of a different size is not reused
+  void* b = RobotStateMemoryPool::allocate(256);
+  void* c = RobotStateMemoryPool::allocate(128);
+  EXPECT_EQ(a, c);
+  RobotStateMemoryPool::release(b, 256);
+  RobotStateMemoryPool::release(c, 128);
+
+  RobotStateMemoryPool::Statistics stats = RobotStateMemoryPool::getStatistics() - start;
+  EXPECT_EQ(stats.allocations, 3u);
+  EXPECT_EQ(stats.recycled, 1u);
+  EXPECT_EQ(stats.releases, 3u);
+}
+
+TEST_F(MemoryPoolTest, Capacity)
+{
+  std::vector<void*> blocks;
+  for (int i = 0; i < 10; ++i)
+    blocks.push_back(RobotStateMemoryPool::allocate(64));
+  for (void* block : blocks)
+    RobotStateMemoryPool::release(block, 64);
+
+  // only getCapacity() blocks are kept
+  RobotStateMemoryPool::Statistics start = RobotStateMemoryPool::getStatistics();
+  for (int i = 0; i < 10; ++i)
+    blocks[i] = RobotStateMemoryPool::allocate(64);
+  EXPECT_EQ((RobotStateMemoryPool::getStatistics() - start).recycled, 4u);
+  for (void* block : blocks)
+    RobotStateMemoryPool::release(block, 64);
+}
+
+TEST_F(MemoryPoolTest, Disabled)
+{
+  RobotStateMemoryPool::setEnabled(false);
+  RobotStateMemoryPool::Statistics start = RobotStateMemoryPool::getStatistics();
+  for (int i = 0; i < 3; ++i)
+    RobotStateMemoryPool::release(RobotStateMemoryPool::allocate(64), 64);
+  // nothing is counted while the pool is disabled
+  RobotStateMemoryPool::Statistics stats = RobotStateMemoryPool::getStatistics() - start;
+  EXPECT_EQ(stats.allocations, 0u);
+  EXPECT_EQ(stats.releases, 0u);
+  EXPECT_EQ(stats.recycled, 0u);
+}
+
+TEST_F(MemoryPoolTest, StatisticsPerThread)
+{
+  RobotStateMemoryPool::Statistics start = RobotStateMemoryPool::getStatistics();
+  std::vector<RobotStateMemoryPool::Statistics> thread_stats(4);
+  std::vector<std::thread> threads;
+  for (std::size_t t = 0; t < thread_stats.size(); ++t)
+    threads.emplace_back([&thread_stats, t] {
+      for (int i = 0; i < 100; ++i)
+        RobotStateMemoryPool::release(RobotStateMemoryPool::allocate(64), 64);
+      thread_stats[t] = RobotStateMemoryPool::getStatistics();
+    });
+  for (std::thread& thread : threads)
+    thread.join();
+
+  for (const RobotStateMemoryPool::Statistics& stats : thread_stats)
+  {
+    EXPECT_EQ(stats.allocations, 100u);
+    EXPECT_EQ(stats.releases, 100u);
+    EXPECT_EQ(stats.recycled, 99u);
+  }
+
+  // other threads do not show up in the counters of this thread
+  RobotStateMemoryPool::Statistics stats = RobotStateMemoryPool::getStatistics() - start;
+  EXPECT_EQ(stats.allocations, 0u);
+  EXPECT_EQ(stats.releases, 0u);
+}
+
+TEST_F(MemoryPoolTest, RobotStateCopies)
+{
+  moveit::core::RobotModelPtr model = moveit::core::loadTestingRobotModel("panda");
+  moveit::core::RobotState state(model);
+  state.setToDefaultValues();
+
+  RobotStateMemoryPool::Statistics start = RobotStateMemoryPool::getStatistics();
+  for (int i = 0; i < 10; ++i)
+  {
+    moveit::core::RobotState copy(state);
+    copy.update();
+    EXPECT_EQ(copy.getVariablePosition(0), state.getVariablePosition(0));
+  }
+  RobotStateMemoryPool::Statistics stats = RobotStateMemoryPool::getStatistics() - start;
+  EXPECT_EQ(stats.allocations, 10u);
+  EXPECT_EQ(stats.releases, 10u);
+  EXPECT_EQ(stats.recycled, 9u);
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,109 @@
+/*********************************************************************
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2020, PickNik LLC.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the copyright holder nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace moveit
+{
+namespace core
+{
+/** \brief A fixed set of worker threads that execute data-parallel loops.
+
+    parallelFor() distributes the iterations of a loop over the workers and the calling thread, and blocks until
+    all iterations are done. Only one loop runs on a pool at a time: if the pool is busy (or parallelFor() is called
+    from within a loop running on the same pool), the loop is executed sequentially on the calling thread instead of
+    waiting, so nested or concurrent use never deadlocks. */
+class ThreadPool
+{
+public:
+  /** \brief The type of the loop body: called with the index of the executing thread (in [0, getConcurrency()))
+      and the index of the iteration */
+  typedef std::function<void(std::size_t thread, std::size_t index)> LoopBody;
+
+  /** \brief Start \e num_threads worker threads. If \e num_threads is 0, one worker less than the number of
+      hardware threads is started, as the calling thread participates in every loop. */
+  explicit ThreadPool(std::size_t num_threads = 0);
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  ~ThreadPool();
+
+  /** \brief A process-wide pool with one thread per hardware thread, created on first use */
+  static ThreadPool& getShared();
+
+  /** \brief The maximum number of threads that execute a loop, including the calling thread */
+  std::size_t getConcurrency() const
+  {
+    return threads_.size() + 1;
+  }
+
+  /** \brief Call \e body for all iterations in [0, \e count), using at most \e max_concurrency threads
+      (0 for getConcurrency()). Returns once all iterations are done. If \e body throws, the remaining iterations
+      are skipped and the first exception is rethrown to the caller. */
+  void parallelFor(std::size_t count, const LoopBody& body, std::size_t max_concurrency = 0);
+
+private:
+  void workerLoop(std::size_t thread);
+  void runLoop(std::size_t thread);
+
+  std::vector<std::thread> threads_;
+
+  /** \brief Held by the thread that currently runs a loop on this pool */
+  std::mutex loop_mutex_;
+
+  /** \brief Protects the loop description below */
+  std::mutex mutex_;
+  std::condition_variable loop_started_;
+  std::condition_variable loop_finished_;
+  std::size_t generation_;
+  std::size_t pending_threads_;
+  bool shutdown_;
+
+  const LoopBody* body_;
+  std::size_t count_;
+  std::size_t concurrency_;
+  std::atomic<std::size_t> next_index_;
+  std::exception_ptr exception_;
+};
+}  // namespace core
+}  // namespace moveit
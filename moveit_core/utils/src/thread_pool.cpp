@@ -0,0 +1,178 @@
+/*********************************************************************
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2020, PickNik LLC.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the copyright holder nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************/
+
+#include <moveit/utils/thread_pool.h>
+
+#include <algorithm>
+
+namespace moveit
+{
+namespace core
+{
+namespace
+{
+// the pool whose loop the current thread is executing, used to detect nested loops
+thread_local const ThreadPool* active_pool = nullptr;
+
+class ActivePoolScope
+{
+public:
+  ActivePoolScope(const ThreadPool* pool) : previous_(active_pool)
+  {
+    active_pool = pool;
+  }
+  ~ActivePoolScope()
+  {
+    active_pool = previous_;
+  }
+
+private:
+  const ThreadPool* previous_;
+};
+}  // namespace
+
+ThreadPool::ThreadPool(std::size_t num_threads)
+  : generation_(0)
+  , pending_threads_(0)
+  , shutdown_(false)
+  , body_(nullptr)
+  , count_(0)
+  , concurrency_(0)
+  , next_index_(0)
+{
+  if (num_threads == 0)
+    num_threads = std::max(2u, std::thread::hardware_concurrency()) - 1;
+  threads_.reserve(num_threads);
+  for (std::size_t i = 0; i < num_threads; ++i)
+    threads_.emplace_back(&ThreadPool::workerLoop, this, i + 1);
+}
+
+ThreadPool::~ThreadPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    shutdown_ = true;
+  }
+  loop_started_.notify_all();
+  for (std::thread& thread : threads_)
+    thread.join();
+}
+
+ThreadPool& ThreadPool::getShared()
+{
+  static ThreadPool pool;
+  return pool;
+}
+
+void ThreadPool::parallelFor(std::size_t count, const LoopBody& body, std::size_t max_concurrency)
+{
+  if (count == 0)
+    return;
+  if (max_concurrency == 0 || max_concurrency > getConcurrency())
+    max_concurrency = getConcurrency();
+
+  std::unique_lock<std::mutex> loop_lock(loop_mutex_, std::defer_lock);
+  if (count == 1 || max_concurrency == 1 || active_pool == this || !loop_lock.try_lock())
+  {
+    for (std::size_t i = 0; i < count; ++i)
+      body(0, i);
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    body_ = &body;
+    count_ = count;
+    concurrency_ = max_concurrency;
+    next_index_ = 0;
+    exception_ = nullptr;
+    pending_threads_ = threads_.size();
+    ++generation_;
+  }
+  loop_started_.notify_all();
+
+  runLoop(0);
+
+  std::exception_ptr exception;
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    loop_finished_.wait(lock, [this] { return pending_threads_ == 0; });
+    body_ = nullptr;
+    std::swap(exception, exception_);
+  }
+  if (exception)
+    std::rethrow_exception(exception);
+}
+
+void ThreadPool::workerLoop(std::size_t thread)
+{
+  std::size_t generation = 0;
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true)
+  {
+    loop_started_.wait(lock, [this, generation] { return shutdown_ || generation_ != generation; });
+    if (shutdown_)
+      return;
+    generation = generation_;
+
+    lock.unlock();
+    runLoop(thread);
+    lock.lock();
+
+    if (--pending_threads_ == 0)
+      loop_finished_.notify_one();
+  }
+}
+
+void ThreadPool::runLoop(std::size_t thread)
+{
+  if (thread >= concurrency_)
+    return;
+  ActivePoolScope scope(this);
+  try
+  {
+    for (std::size_t i = next_index_++; i < count_; i = next_index_++)
+      (*body_)(thread, i);
+  }
+  catch (...)
+  {
+    // skip all remaining iterations
+    next_index_ = count_;
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!exception_)
+      exception_ = std::current_exception();
+  }
+}
+}  // namespace core
+}  // namespace moveit
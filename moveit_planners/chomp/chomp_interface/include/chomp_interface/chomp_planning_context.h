@@ -59,6 +59,11 @@ public:
 
   void initialize();
 
+  const chomp::ChompParameters& getParams() const
+  {
+    return chomp_interface_->getParams();
+  }
+
 private:
   CHOMPInterfacePtr chomp_interface_;
   moveit::core::RobotModelConstPtr robot_model_;
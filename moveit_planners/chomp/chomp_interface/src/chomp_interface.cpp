@@ -73,5 +73,7 @@ void CHOMPInterface::loadParams()
             std::string("quintic-spline"));
   nh_.param("enable_failure_recovery", params_.enable_failure_recovery_, false);
   nh_.param("max_recovery_attempts", params_.max_recovery_attempts_, 5);
+  nh_.param("use_exact_distance_field", params_.use_exact_distance_field_, false);
+  nh_.param("use_interpolated_gradients", params_.use_interpolated_gradients_, false);
 }
 }  // namespace chomp_interface
@@ -80,12 +80,18 @@ public:
       return planning_interface::PlanningContextPtr();
     }
 
+    const CHOMPPlanningContextPtr& context = planning_contexts_.at(req.group_name);
+
     // create PlanningScene using hybrid collision detector
     planning_scene::PlanningScenePtr ps = planning_scene->diff();
-    ps->setActiveCollisionDetector(collision_detection::CollisionDetectorAllocatorHybrid::create(), true);
+    ps->setActiveCollisionDetector(collision_detection::CollisionDetectorAllocatorHybrid::create(
+                                       context->getParams().use_exact_distance_field_ ?
+                                           collision_detection::DistanceFieldType::EUCLIDEAN :
+                                           collision_detection::DEFAULT_DISTANCE_FIELD_TYPE,
+                                       context->getParams().use_interpolated_gradients_),
+                                   true);
 
-    // retrieve and configure existing context
-    const CHOMPPlanningContextPtr& context = planning_contexts_.at(req.group_name);
+    // configure existing context
     context->setPlanningScene(ps);
     context->setMotionPlanRequest(req);
     error_code.val = moveit_msgs::MoveItErrorCodes::SUCCESS;
@@ -94,6 +94,10 @@ public:
                                   /// an initial path is not found with the specified chomp parameters
   int max_recovery_attempts_;     /// this the maximum recovery attempts to find a collision free path after an initial
                                   /// failure to find a solution
+  bool use_exact_distance_field_;  /// compute obstacle costs with exact Euclidean distance fields instead of
+                                   /// propagated ones
+  bool use_interpolated_gradients_;  /// interpolate the obstacle cost gradients of all collision spheres of a link
+                                     /// in one batched lookup instead of using those of the containing cells
 };
 
 }  // namespace chomp
@@ -68,6 +68,8 @@ ChompParameters::ChompParameters()
   trajectory_initialization_method_ = std::string("quintic-spline");
   enable_failure_recovery_ = false;
   max_recovery_attempts_ = 5;
+  use_exact_distance_field_ = false;
+  use_interpolated_gradients_ = false;
 }
 
 ChompParameters::~ChompParameters() = default;
@@ -157,6 +157,18 @@ public:
       ROS_INFO_STREAM("Param trajectory_initialization_method was not set. Using New value as: "
                       << params_.trajectory_initialization_method_);
     }
+    if (!nh.getParam("use_exact_distance_field", params_.use_exact_distance_field_))
+    {
+      params_.use_exact_distance_field_ = false;
+      ROS_INFO_STREAM(
+          "Param use_exact_distance_field was not set. Using default value: " << params_.use_exact_distance_field_);
+    }
+    if (!nh.getParam("use_interpolated_gradients", params_.use_interpolated_gradients_))
+    {
+      params_.use_interpolated_gradients_ = false;
+      ROS_INFO_STREAM("Param use_interpolated_gradients was not set. Using default value: "
+                      << params_.use_interpolated_gradients_);
+    }
   }
 
   std::string getDescription() const override
@@ -175,7 +187,10 @@ public:
 
     // create a hybrid collision detector to set the collision checker as hybrid
     collision_detection::CollisionDetectorAllocatorPtr hybrid_cd(
-        collision_detection::CollisionDetectorAllocatorHybrid::create());
+        collision_detection::CollisionDetectorAllocatorHybrid::create(
+            params_.use_exact_distance_field_ ? collision_detection::DistanceFieldType::EUCLIDEAN :
+                                                collision_detection::DEFAULT_DISTANCE_FIELD_TYPE,
+            params_.use_interpolated_gradients_));
 
     // create a writable planning scene
     planning_scene::PlanningScenePtr planning_scene = ps->diff();
@@ -0,0 +1,100 @@
+/*********************************************************************
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2020, PickNik LLC.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the copyright holder nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************/
+
+#pragma once
+
+#include <moveit/ompl_interface/detail/threadsafe_state_storage.h>
+#include <moveit/collision_detection/collision_common.h>
+#include <ompl/base/MotionValidator.h>
+#include <ompl/base/DiscreteMotionValidator.h>
+
+namespace ompl_interface
+{
+class ModelBasedPlanningContext;
+
+/** @class ContinuousMotionValidator
+    @brief An OMPL motion validator that checks segments against the world with continuous collision queries of the
+    active collision environment.
+
+    Continuous queries sweep every link on a straight line (and a rotation about a fixed axis) from its start to its
+    end pose, while the links of a joint-space motion move along arcs. A segment is therefore split in halves until,
+    for every link, the middle of that sweep deviates from the link's actual middle pose by no more than the link's
+    padding, or until the pieces are no longer than the longest valid segment of the space information. Each piece
+    is checked against the world with one continuous query, and the robot is checked for self collisions at the
+    states where the segment is split.
+
+    The end state of the segment is checked with the regular state validity checker, so it is tested for bounds,
+    feasibility and self collisions. If the collision environment does not implement continuous checks, or path
+    constraints are set (they may be violated in the middle of a segment), the segment is validated by interpolation
+    instead, exactly like OMPL's DiscreteMotionValidator. */
+class ContinuousMotionValidator : public ompl::base::MotionValidator
+{
+public:
+  ContinuousMotionValidator(const ModelBasedPlanningContext* planning_context);
+
+  bool checkMotion(const ompl::base::State* s1, const ompl::base::State* s2) const override;
+  bool checkMotion(const ompl::base::State* s1, const ompl::base::State* s2,
+                   std::pair<ompl::base::State*, double>& last_valid) const override;
+
+  /** \brief Return true if the next motion will be checked with continuous collision queries */
+  bool usesContinuousCheck() const;
+
+  /** \brief Get the number of continuous collision queries issued so far */
+  unsigned int getContinuousCheckCount() const
+  {
+    return continuous_checks_;
+  }
+
+protected:
+  /** \brief Check the robot moving from \e s1 to \e s2 against the world, and for self collisions in between */
+  bool checkWorldMotion(const ompl::base::State* s1, const ompl::base::State* s2) const;
+
+  /** \brief Check the motion between the up-to-date states \e start and \e end, splitting it at most \e depth
+      more times */
+  bool checkSegment(const moveit::core::RobotState& start, const moveit::core::RobotState& end,
+                    unsigned int depth) const;
+
+  /** \brief Return true if a continuous query from \e start to \e end sweeps any link farther from its pose in
+      \e middle, the state halfway between them, than that link's padding */
+  bool exceedsPadding(const moveit::core::RobotState& start, const moveit::core::RobotState& middle,
+                      const moveit::core::RobotState& end) const;
+
+  const ModelBasedPlanningContext* planning_context_;
+  TSStateStorage tss_start_;
+  TSStateStorage tss_end_;
+  collision_detection::CollisionRequest collision_request_;
+  ompl::base::DiscreteMotionValidator fallback_;
+  mutable unsigned int continuous_checks_;
+};
+}  // namespace ompl_interface
@@ -0,0 +1,169 @@
+/*********************************************************************
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2020, PickNik LLC.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the copyright holder nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************/
+
+#include <moveit/ompl_interface/detail/continuous_motion_validator.h>
+#include <moveit/ompl_interface/model_based_planning_context.h>
+#include <ros/ros.h>
+
+namespace
+{
+// a segment is split into at most 2^MAX_SPLIT_DEPTH pieces
+const unsigned int MAX_SPLIT_DEPTH = 8;
+}  // namespace
+
+ompl_interface::ContinuousMotionValidator::ContinuousMotionValidator(const ModelBasedPlanningContext* pc)
+  : ompl::base::MotionValidator(pc->getOMPLSimpleSetup()->getSpaceInformation())
+  , planning_context_(pc)
+  , tss_start_(pc->getCompleteInitialRobotState())
+  , tss_end_(pc->getCompleteInitialRobotState())
+  , fallback_(pc->getOMPLSimpleSetup()->getSpaceInformation())
+  , continuous_checks_(0)
+{
+  collision_request_.group_name = pc->getGroupName();
+}
+
+bool ompl_interface::ContinuousMotionValidator::usesContinuousCheck() const
+{
+  // planning requests always set path constraints, which are empty if the request has none
+  const kinematic_constraints::KinematicConstraintSetPtr& path_constraints = planning_context_->getPathConstraints();
+  return (!path_constraints || path_constraints->empty()) &&
+         planning_context_->getPlanningScene()->getCollisionEnv()->supportsContinuousCollision();
+}
+
+bool ompl_interface::ContinuousMotionValidator::checkWorldMotion(const ompl::base::State* s1,
+                                                                 const ompl::base::State* s2) const
+{
+  moveit::core::RobotState* start_state = tss_start_.getStateStorage();
+  moveit::core::RobotState* end_state = tss_end_.getStateStorage();
+  planning_context_->getOMPLStateSpace()->copyToRobotState(*start_state, s1);
+  planning_context_->getOMPLStateSpace()->copyToRobotState(*end_state, s2);
+  start_state->update();
+  end_state->update();
+  return checkSegment(*start_state, *end_state, MAX_SPLIT_DEPTH);
+}
+
+bool ompl_interface::ContinuousMotionValidator::exceedsPadding(const moveit::core::RobotState& start,
+                                                               const moveit::core::RobotState& middle,
+                                                               const moveit::core::RobotState& end) const
+{
+  const collision_detection::CollisionEnvConstPtr& env = planning_context_->getPlanningScene()->getCollisionEnv();
+  const moveit::core::JointModelGroup* group = planning_context_->getJointModelGroup();
+  for (const moveit::core::LinkModel* link : group->getUpdatedLinkModelsWithGeometry())
+  {
+    const Eigen::Isometry3d& start_pose = start.getGlobalLinkTransform(link);
+    const Eigen::Isometry3d& middle_pose = middle.getGlobalLinkTransform(link);
+    const Eigen::Isometry3d& end_pose = end.getGlobalLinkTransform(link);
+
+    // the sweep moves the link origin on the chord and rotates the link geometry about a fixed axis
+    double deviation = (middle_pose.translation() - 0.5 * (start_pose.translation() + end_pose.translation())).norm();
+    const Eigen::Quaterniond swept_rotation =
+        Eigen::Quaterniond(start_pose.linear()).slerp(0.5, Eigen::Quaterniond(end_pose.linear()));
+    const double radius = link->getCenteredBoundingBoxOffset().norm() + 0.5 * link->getShapeExtentsAtOrigin().norm();
+    deviation += swept_rotation.angularDistance(Eigen::Quaterniond(middle_pose.linear())) * radius;
+    if (deviation > env->getLinkPadding(link->getName()))
+      return true;
+  }
+  return false;
+}
+
+bool ompl_interface::ContinuousMotionValidator::checkSegment(const moveit::core::RobotState& start,
+                                                             const moveit::core::RobotState& end,
+                                                             unsigned int depth) const
+{
+  const planning_scene::PlanningSceneConstPtr& scene = planning_context_->getPlanningScene();
+  const moveit::core::JointModelGroup* group = planning_context_->getJointModelGroup();
+  if (depth > 0 && start.distance(end, group) > si_->getStateValidityCheckingResolution() * si_->getMaximumExtent())
+  {
+    moveit::core::RobotState middle(start);
+    start.interpolate(end, 0.5, middle, group);
+    middle.update();
+    if (exceedsPadding(start, middle, end))
+    {
+      collision_detection::CollisionResult res;
+      scene->checkSelfCollision(collision_request_, res, middle, scene->getAllowedCollisionMatrix());
+      return !res.collision && checkSegment(start, middle, depth - 1) && checkSegment(middle, end, depth - 1);
+    }
+  }
+
+  ++continuous_checks_;
+  collision_detection::CollisionResult res;
+  scene->getCollisionEnv()->checkRobotCollision(collision_request_, res, start, end,
+                                                scene->getAllowedCollisionMatrix());
+  return !res.collision;
+}
+
+bool ompl_interface::ContinuousMotionValidator::checkMotion(const ompl::base::State* s1,
+                                                            const ompl::base::State* s2) const
+{
+  // as in DiscreteMotionValidator, s1 is assumed to be valid
+  bool result;
+  if (!usesContinuousCheck())
+    result = fallback_.checkMotion(s1, s2);
+  else
+    result = si_->isValid(s2) && checkWorldMotion(s1, s2);
+
+  if (result)
+    valid_++;
+  else
+    invalid_++;
+  return result;
+}
+
+bool ompl_interface::ContinuousMotionValidator::checkMotion(const ompl::base::State* s1, const ompl::base::State* s2,
+                                                            std::pair<ompl::base::State*, double>& last_valid) const
+{
+  bool result;
+  if (!usesContinuousCheck())
+    result = fallback_.checkMotion(s1, s2, last_valid);
+  else if (si_->isValid(s2) && checkWorldMotion(s1, s2))
+    result = true;
+  else
+  {
+    // The continuous query does not say where the motion stops being valid; interpolate to find out. If the
+    // interpolated states all pass, the collision lies between two of them and s1 is the last known valid state.
+    result = false;
+    if (fallback_.checkMotion(s1, s2, last_valid))
+    {
+      if (last_valid.first != nullptr)
+        si_->copyState(last_valid.first, s1);
+      last_valid.second = 0.0;
+    }
+  }
+
+  if (result)
+    valid_++;
+  else
+    invalid_++;
+  return result;
+}
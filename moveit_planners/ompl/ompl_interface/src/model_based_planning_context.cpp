@@ -39,6 +39,7 @@
 
 #include <moveit/ompl_interface/model_based_planning_context.h>
 #include <moveit/ompl_interface/detail/state_validity_checker.h>
+#include <moveit/ompl_interface/detail/continuous_motion_validator.h>
 #include <moveit/ompl_interface/detail/constrained_sampler.h>
 #include <moveit/ompl_interface/detail/constrained_goal_sampler.h>
 #include <moveit/ompl_interface/detail/goal_union.h>
@@ -286,6 +287,27 @@ void ompl_interface::ModelBasedPlanningContext::useConfig()
     cfg["longest_valid_segment_fraction"] = moveit::core::toString(longest_valid_segment_fraction_final);
   }
 
+  // select how motions between states are validated: "discrete" interpolates states along the motion, "continuous"
+  // checks the whole motion against the world at once if the collision detector supports it
+  it = cfg.find("motion_validator");
+  if (it != cfg.end())
+  {
+    const std::string validator = boost::trim_copy(it->second);
+    const ompl::base::SpaceInformationPtr& si = ompl_simple_setup_->getSpaceInformation();
+    if (validator == "continuous")
+    {
+      si->setMotionValidator(std::make_shared<ContinuousMotionValidator>(this));
+    }
+    else
+    {
+      if (validator != "discrete")
+        ROS_WARN_NAMED("model_based_planning_context", "%s: Unknown motion validator '%s', using 'discrete'",
+                       name_.c_str(), validator.c_str());
+      si->setMotionValidator(std::make_shared<ompl::base::DiscreteMotionValidator>(si));
+    }
+    cfg.erase(it);
+  }
+
   // set the projection evaluator
   it = cfg.find("projection_evaluator");
   if (it != cfg.end())
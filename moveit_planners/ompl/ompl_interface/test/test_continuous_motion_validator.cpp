@@ -0,0 +1,118 @@
+/*********************************************************************
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2020, PickNik LLC.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the copyright holder nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************/
+
+#include <moveit/ompl_interface/model_based_planning_context.h>
+#include <moveit/ompl_interface/detail/continuous_motion_validator.h>
+#include <moveit/ompl_interface/detail/state_validity_checker.h>
+#include <moveit/ompl_interface/parameterization/joint_space/joint_model_state_space.h>
+#include <moveit/planning_scene/planning_scene.h>
+#include <moveit/utils/robot_model_test_utils.h>
+
+#include <geometric_shapes/shapes.h>
+#include <ompl/base/ScopedState.h>
+#include <ompl/geometric/SimpleSetup.h>
+#include <gtest/gtest.h>
+
+/** \brief Exposes useConfig(), which is otherwise only called by configure() together with ROS parameter lookups */
+class TestPlanningContext : public ompl_interface::ModelBasedPlanningContext
+{
+public:
+  using ompl_interface::ModelBasedPlanningContext::ModelBasedPlanningContext;
+  using ompl_interface::ModelBasedPlanningContext::useConfig;
+};
+
+TEST(ContinuousMotionValidator, RejectsMotionThroughThinObstacle)
+{
+  moveit::core::RobotModelPtr robot_model = moveit::core::loadTestingRobotModel("pr2");
+  planning_scene::PlanningScenePtr scene = std::make_shared<planning_scene::PlanningScene>(robot_model);
+  moveit::core::RobotState& current_state = scene->getCurrentStateNonConst();
+  current_state.setToDefaultValues();
+  current_state.update();
+  ASSERT_TRUE(scene->getCollisionEnv()->supportsContinuousCollision());
+
+  // swing the right arm around the shoulder pan joint, through a 2 mm thin plate in front of the palm
+  moveit::core::RobotState start_state(current_state);
+  moveit::core::RobotState middle_state(current_state);
+  moveit::core::RobotState end_state(current_state);
+  start_state.setVariablePosition("r_shoulder_pan_joint", -0.5);
+  middle_state.setVariablePosition("r_shoulder_pan_joint", 0.0);
+  end_state.setVariablePosition("r_shoulder_pan_joint", 0.5);
+  start_state.update();
+  middle_state.update();
+  end_state.update();
+  Eigen::Isometry3d plate_pose = Eigen::Isometry3d::Identity();
+  plate_pose.translation() = middle_state.getGlobalLinkTransform("r_gripper_palm_link").translation();
+  scene->getWorldNonConst()->addToObject("plate", std::make_shared<const shapes::Box>(0.1, 0.002, 0.1), plate_pose);
+
+  ompl_interface::ModelBasedStateSpaceSpecification space_spec(robot_model, "right_arm");
+  ompl_interface::ModelBasedPlanningContextSpecification spec;
+  spec.state_space_ = std::make_shared<ompl_interface::JointModelStateSpace>(space_spec);
+  spec.ompl_simple_setup_ = std::make_shared<ompl::geometric::SimpleSetup>(spec.state_space_);
+  spec.config_["motion_validator"] = "continuous";
+
+  TestPlanningContext context("continuous", spec);
+  context.setPlanningScene(scene);
+  context.setCompleteInitialState(current_state);
+  // planning requests always set path constraints, even if they are empty
+  moveit_msgs::MoveItErrorCodes error;
+  ASSERT_TRUE(context.setPathConstraints(moveit_msgs::Constraints(), &error));
+  context.getOMPLSimpleSetup()->setStateValidityChecker(
+      std::make_shared<ompl_interface::StateValidityChecker>(&context));
+  context.useConfig();
+
+  const ompl::base::SpaceInformationPtr& si = context.getOMPLSimpleSetup()->getSpaceInformation();
+  si->setup();
+  ompl::base::ScopedState<> start(spec.state_space_);
+  ompl::base::ScopedState<> end(spec.state_space_);
+  spec.state_space_->copyToOMPLState(start.get(), start_state);
+  spec.state_space_->copyToOMPLState(end.get(), end_state);
+
+  // make sure the motion is checked by continuous queries rather than the interpolating fallback
+  std::shared_ptr<ompl_interface::ContinuousMotionValidator> validator =
+      std::dynamic_pointer_cast<ompl_interface::ContinuousMotionValidator>(si->getMotionValidator());
+  ASSERT_TRUE(validator);
+  ASSERT_TRUE(validator->usesContinuousCheck());
+
+  ASSERT_TRUE(si->isValid(start.get()));
+  ASSERT_TRUE(si->isValid(end.get()));
+  // the palm moves on an arc through the plate, which a single straight sweep from start to end would miss
+  EXPECT_FALSE(si->checkMotion(start.get(), end.get()));
+  EXPECT_GT(validator->getContinuousCheckCount(), 1u);
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -241,6 +241,66 @@ void runCollisionDetection(unsigned int trials, const planning_scene::PlanningSc
   scene->setCurrentState(states.back());
 }
 
+/** \brief Runs a distance query benchmark and measures the time.
+*
+*   \param trials The number of repeated distance queries for each state
+*   \param scene The planning scene
+*   \param CollisionDetector The type of collision detector
+*   \param only_self Flag for only self distance queries performed
+*   \param type The type of the distance request */
+void runDistanceQueries(unsigned int trials, const planning_scene::PlanningScenePtr& scene,
+                        const std::vector<moveit::core::RobotState>& states, const CollisionDetector col_detector,
+                        bool only_self, collision_detection::DistanceRequestType type)
+{
+  collision_detection::AllowedCollisionMatrix acm{ collision_detection::AllowedCollisionMatrix(
+      scene->getRobotModel()->getLinkModelNames(), true) };
+
+  ROS_INFO_STREAM("Starting distance queries using " << (col_detector == CollisionDetector::FCL ? "FCL" : "Bullet"));
+
+  if (col_detector == CollisionDetector::FCL)
+  {
+    scene->setActiveCollisionDetector(collision_detection::CollisionDetectorAllocatorFCL::create());
+  }
+  else
+  {
+    scene->setActiveCollisionDetector(collision_detection::CollisionDetectorAllocatorBullet::create());
+  }
+
+  collision_detection::DistanceRequest req;
+  collision_detection::DistanceResult res;
+  req.type = type;
+  req.enable_nearest_points = true;
+  req.enable_signed_distance = true;
+  if (only_self)
+    req.acm = &scene->getAllowedCollisionMatrix();
+  else
+    req.acm = &acm;
+
+  ros::WallTime start = ros::WallTime::now();
+  for (unsigned int i = 0; i < trials; ++i)
+  {
+    for (auto& state : states)
+    {
+      res.clear();
+
+      if (only_self)
+      {
+        scene->getCollisionEnv()->distanceSelf(req, res, state);
+      }
+      else
+      {
+        scene->getCollisionEnv()->distanceRobot(req, res, state);
+      }
+    }
+  }
+  double duration = (ros::WallTime::now() - start).toSec();
+  ROS_INFO("Performed %lf distance queries per second", (double)trials * states.size() / duration);
+  ROS_INFO_STREAM("Minimum distance was " << res.minimum_distance.distance << " between "
+                                          << res.minimum_distance.link_names[0] << " and "
+                                          << res.minimum_distance.link_names[1] << ", distances for "
+                                          << res.distances.size() << " pairs reported.");
+}
+
 /** \brief Samples valid states of the robot which can be in collision if desired.
  *  \param desired_states Specifier for type for desired state
  *  \param num_states Number of desired states
@@ -341,6 +401,22 @@ int main(int argc, char** argv)
     runCollisionDetection(trials, planning_scene, sampled_states, CollisionDetector::BULLET, false);
     runCollisionDetection(trials, planning_scene, sampled_states, CollisionDetector::FCL, false);
 
+    ROS_INFO("Starting benchmark: Robot in cluttered world, minimum distance to self and world");
+    runDistanceQueries(trials / 10, planning_scene, sampled_states, CollisionDetector::BULLET, true,
+                       collision_detection::DistanceRequestType::GLOBAL);
+    runDistanceQueries(trials / 10, planning_scene, sampled_states, CollisionDetector::FCL, true,
+                       collision_detection::DistanceRequestType::GLOBAL);
+    runDistanceQueries(trials / 10, planning_scene, sampled_states, CollisionDetector::BULLET, false,
+                       collision_detection::DistanceRequestType::GLOBAL);
+    runDistanceQueries(trials / 10, planning_scene, sampled_states, CollisionDetector::FCL, false,
+                       collision_detection::DistanceRequestType::GLOBAL);
+
+    ROS_INFO("Starting benchmark: Robot in cluttered world, distance to each world object");
+    runDistanceQueries(trials / 10, planning_scene, sampled_states, CollisionDetector::BULLET, false,
+                       collision_detection::DistanceRequestType::SINGLE);
+    runDistanceQueries(trials / 10, planning_scene, sampled_states, CollisionDetector::FCL, false,
+                       collision_detection::DistanceRequestType::SINGLE);
+
     // bring the robot into a position which collides with the world clutter
     double joint_2 = 1.5;
     current_state.setJointPositions("panda_joint2", &joint_2);
@@ -36,6 +36,7 @@
 
 #include <moveit/planning_pipeline/planning_pipeline.h>
 #include <moveit/robot_state/conversions.h>
+#include <moveit/robot_state/robot_state_memory_pool.h>
 #include <moveit/collision_detection/collision_tools.h>
 #include <moveit/trajectory_processing/trajectory_tools.h>
 #include <moveit_msgs/DisplayTrajectory.h>
@@ -84,6 +85,11 @@ void planning_pipeline::PlanningPipeline::configure()
   publish_received_requests_ = false;
   display_computed_motion_plans_ = false;  // this is set to true below
 
+  // recycle the memory of the many temporary RobotState instances created by planners
+  bool use_memory_pool;
+  if (nh_.getParam("robot_state_memory_pool", use_memory_pool))
+    moveit::core::RobotStateMemoryPool::setEnabled(use_memory_pool);
+
   // load the planning plugin
   try
   {
@@ -223,6 +229,9 @@ bool planning_pipeline::PlanningPipeline::generatePlan(const planning_scene::Pla
     return false;
   }
 
+  const moveit::core::RobotStateMemoryPool::Statistics memory_stats_start =
+      moveit::core::RobotStateMemoryPool::getStatistics();
+
   bool solved = false;
   try
   {
@@ -251,6 +260,12 @@ bool planning_pipeline::PlanningPipeline::generatePlan(const planning_scene::Pla
   }
   bool valid = true;
 
+  // the counters are kept per thread, so states allocated by planner worker threads are not included
+  const moveit::core::RobotStateMemoryPool::Statistics memory_stats =
+      moveit::core::RobotStateMemoryPool::getStatistics() - memory_stats_start;
+  ROS_DEBUG("Planning allocated %zu robot states (%zu recycled by the memory pool)", memory_stats.allocations,
+            memory_stats.recycled);
+
   if (solved && res.trajectory_)
   {
     std::size_t state_count = res.trajectory_->getWayPointCount();
@@ -43,6 +43,7 @@
 #include <boost/function.hpp>
 #include <boost/thread/mutex.hpp>
 #include <boost/thread/condition_variable.hpp>
+#include <memory>
 
 namespace planning_scene_monitor
 {
@@ -136,6 +137,18 @@ public:
    *  @return Returns the map from joint names to joint state values*/
   std::map<std::string, double> getCurrentStateValues() const;
 
+  /** @brief Get an immutable snapshot of the current state
+   *
+   *  Snapshots are published copy-on-write whenever the monitored state changes, so this call neither copies the
+   *  state nor waits for joint state or TF updates in progress. The returned state has up-to-date transforms and
+   *  remains valid (and unchanged) for as long as the caller holds on to it.
+   *  @return Returns the current state */
+  moveit::core::RobotStateConstPtr getCurrentStateSnapshot() const;
+
+  /** @brief Get an immutable snapshot of the current state and its time stamp
+   *  @return Returns a pair of the current state and its time stamp */
+  std::pair<moveit::core::RobotStateConstPtr, ros::Time> getCurrentStateSnapshotAndTime() const;
+
   /** @brief Wait for at most \e wait_time seconds (default 1s) for a robot state more recent than t
    *  @return true on success, false if up-to-date robot state wasn't received within \e wait_time
   */
@@ -191,6 +204,16 @@ private:
   void jointStateCallback(const sensor_msgs::JointStateConstPtr& joint_state);
   void tfCallback();
 
+  /** @brief Publish a new snapshot of robot_state_ and current_state_time_. Must be called with state_update_lock_
+   *  held. If \e state_changed is false, the state of the previous snapshot is shared instead of copied. */
+  void publishSnapshot(bool state_changed);
+
+  struct StateSnapshot
+  {
+    moveit::core::RobotStateConstPtr state;
+    ros::Time time;
+  };
+
   ros::NodeHandle nh_;
   std::shared_ptr<tf2_ros::Buffer> tf_buffer_;
   moveit::core::RobotModelConstPtr robot_model_;
@@ -207,6 +230,9 @@ private:
   mutable boost::condition_variable state_update_condition_;
   std::vector<JointStateUpdateCallback> update_callbacks_;
 
+  // Latest published snapshot; only accessed through std::atomic_load() / std::atomic_store()
+  std::shared_ptr<const StateSnapshot> snapshot_;
+
   std::shared_ptr<TFConnection> tf_connection_;
 };
 
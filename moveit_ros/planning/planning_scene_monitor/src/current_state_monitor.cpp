@@ -59,6 +59,7 @@ planning_scene_monitor::CurrentStateMonitor::CurrentStateMonitor(const moveit::c
   , error_(std::numeric_limits<double>::epsilon())
 {
   robot_state_.setToDefaultValues();
+  publishSnapshot(true);
 }
 
 planning_scene_monitor::CurrentStateMonitor::~CurrentStateMonitor()
@@ -68,61 +69,85 @@ planning_scene_monitor::CurrentStateMonitor::~CurrentStateMonitor()
 
 moveit::core::RobotStatePtr planning_scene_monitor::CurrentStateMonitor::getCurrentState() const
 {
-  boost::mutex::scoped_lock slock(state_update_lock_);
-  moveit::core::RobotState* result = new moveit::core::RobotState(robot_state_);
-  return moveit::core::RobotStatePtr(result);
+  return std::make_shared<moveit::core::RobotState>(*getCurrentStateSnapshot());
 }
 
 ros::Time planning_scene_monitor::CurrentStateMonitor::getCurrentStateTime() const
 {
-  boost::mutex::scoped_lock slock(state_update_lock_);
-  return current_state_time_;
+  return std::atomic_load(&snapshot_)->time;
 }
 
 std::pair<moveit::core::RobotStatePtr, ros::Time>
 planning_scene_monitor::CurrentStateMonitor::getCurrentStateAndTime() const
 {
-  boost::mutex::scoped_lock slock(state_update_lock_);
-  moveit::core::RobotState* result = new moveit::core::RobotState(robot_state_);
-  return std::make_pair(moveit::core::RobotStatePtr(result), current_state_time_);
+  std::shared_ptr<const StateSnapshot> snapshot = std::atomic_load(&snapshot_);
+  return std::make_pair(std::make_shared<moveit::core::RobotState>(*snapshot->state), snapshot->time);
 }
 
 std::map<std::string, double> planning_scene_monitor::CurrentStateMonitor::getCurrentStateValues() const
 {
   std::map<std::string, double> m;
-  boost::mutex::scoped_lock slock(state_update_lock_);
-  const double* pos = robot_state_.getVariablePositions();
-  const std::vector<std::string>& names = robot_state_.getVariableNames();
+  moveit::core::RobotStateConstPtr state = getCurrentStateSnapshot();
+  const double* pos = state->getVariablePositions();
+  const std::vector<std::string>& names = state->getVariableNames();
   for (std::size_t i = 0; i < names.size(); ++i)
     m[names[i]] = pos[i];
   return m;
 }
 
+moveit::core::RobotStateConstPtr planning_scene_monitor::CurrentStateMonitor::getCurrentStateSnapshot() const
+{
+  return std::atomic_load(&snapshot_)->state;
+}
+
+std::pair<moveit::core::RobotStateConstPtr, ros::Time>
+planning_scene_monitor::CurrentStateMonitor::getCurrentStateSnapshotAndTime() const
+{
+  std::shared_ptr<const StateSnapshot> snapshot = std::atomic_load(&snapshot_);
+  return std::make_pair(snapshot->state, snapshot->time);
+}
+
 void planning_scene_monitor::CurrentStateMonitor::setToCurrentState(moveit::core::RobotState& upd) const
 {
-  boost::mutex::scoped_lock slock(state_update_lock_);
-  const double* pos = robot_state_.getVariablePositions();
+  moveit::core::RobotStateConstPtr state = getCurrentStateSnapshot();
+  const double* pos = state->getVariablePositions();
   upd.setVariablePositions(pos);
   if (copy_dynamics_)
   {
-    if (robot_state_.hasVelocities())
+    if (state->hasVelocities())
     {
-      const double* vel = robot_state_.getVariableVelocities();
+      const double* vel = state->getVariableVelocities();
       upd.setVariableVelocities(vel);
     }
-    if (robot_state_.hasAccelerations())
+    if (state->hasAccelerations())
     {
-      const double* acc = robot_state_.getVariableAccelerations();
+      const double* acc = state->getVariableAccelerations();
       upd.setVariableAccelerations(acc);
     }
-    if (robot_state_.hasEffort())
+    if (state->hasEffort())
     {
-      const double* eff = robot_state_.getVariableEffort();
+      const double* eff = state->getVariableEffort();
       upd.setVariableEffort(eff);
     }
   }
 }
 
+void planning_scene_monitor::CurrentStateMonitor::publishSnapshot(bool state_changed)
+{
+  std::shared_ptr<const StateSnapshot> previous = std::atomic_load(&snapshot_);
+  auto snapshot = std::make_shared<StateSnapshot>();
+  if (state_changed || !previous)
+  {
+    auto state = std::make_shared<moveit::core::RobotState>(robot_state_);
+    state->update();
+    snapshot->state = state;
+  }
+  else
+    snapshot->state = previous->state;
+  snapshot->time = current_state_time_;
+  std::atomic_store(&snapshot_, std::shared_ptr<const StateSnapshot>(std::move(snapshot)));
+}
+
 void planning_scene_monitor::CurrentStateMonitor::addUpdateCallback(const JointStateUpdateCallback& fn)
 {
   if (fn)
@@ -400,6 +425,7 @@ void planning_scene_monitor::CurrentStateMonitor::jointStateCallback(const senso
         }
       }
     }
+    publishSnapshot(update);
   }
 
   // callbacks, if needed
@@ -463,6 +489,8 @@ void planning_scene_monitor::CurrentStateMonitor::tfCallback()
       robot_state_.setJointPositions(joint, new_values.data());
       update = true;
     }
+    if (update)
+      publishSnapshot(true);
   }
 
   // callbacks, if needed